@@ -0,0 +1,696 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <windows.h>
+#include "wperf-common/macros.h"
+#include "wperf-common/iorequest.h"
+#include "wperf/events.h"
+#include "wperf/json_writer.h"
+#include "wperf/metric.h"
+#include "wperf/output.h"
+#include "wperf/padding.h"
+#include "wperf/parsers.h"
+#include "wperf/pe_file.h"
+#include "wperf/perfdata.h"
+#include "wperf/pmu_simulator.h"
+#include "wperf/spe_device.h"
+#include "wperf/timeline.h"
+#include "wperf/utils.h"
+
+//
+// wperf-bench: microbenchmarks of `wperf` user space hot paths: event string parsing,
+// metric evaluation, SPE buffer decoding, sample resolution and aggregation, output
+// rendering, timeline and perf.data exports.
+//
+// Inputs are generated with pmu_simulator and are sized like production sessions
+// (80 cores, 1M samples, 1 GB SPE buffer). Use `--quick` for smaller, CI sized inputs.
+//
+// Results are printed as a table and with `--output` saved as JSON. With `--baseline`
+// results are compared against results saved earlier: benchmark regressed when its
+// median time per item grew by more than `--threshold` percent. wperf-bench then exits
+// with 1 so it can gate CI jobs.
+//
+
+namespace
+{
+    struct bench_options
+    {
+        std::string filter;             // Run only benchmarks with this substring in name
+        std::wstring output;            // Save results (JSON) to this file
+        std::wstring baseline;          // Compare results with results saved to this file
+        double threshold = 10.0;        // Regression threshold, percent of baseline time per item
+        uint32_t iterations = 5;        // Measured runs of each benchmark
+        uint32_t warmup = 1;            // Not measured runs of each benchmark
+        uint32_t scale = 1;             // Inputs are SCALE times smaller than production ones, see `--quick`
+        bool list = false;
+    };
+
+    struct bench_result
+    {
+        std::string name;
+        std::string unit;               // What items are, e.g. samples or bytes
+        uint64_t items = 0;             // Items processed by one run
+        uint32_t iterations = 0;
+        double min_ns = 0;
+        double median_ns = 0;
+        double mean_ns = 0;
+        double max_ns = 0;
+    };
+
+    struct benchmark
+    {
+        std::string name;
+        std::string description;
+        std::function<bench_result(const bench_options&)> run;
+    };
+
+    // Production sized inputs
+    constexpr uint32_t BENCH_CORES = 80;
+    constexpr uint64_t BENCH_SAMPLES = 1000000;
+    constexpr uint64_t BENCH_SPE_BYTES = 1ULL << 30;
+    constexpr uint32_t BENCH_SAMPLE_PCS = 1 << 18;         // 1 MB of sampled code
+    constexpr uint32_t BENCH_SYMBOLS = 2048;
+    constexpr uint32_t BENCH_TIMELINE_INTERVALS = 3600;     // One hour with 1 s count interval
+    constexpr uint32_t BENCH_EVENT_STRINGS = 10000;
+    constexpr uint32_t BENCH_METRIC_EVALS = 1000000;
+    constexpr uint32_t BENCH_QUICK_SCALE = 64;
+
+    const std::vector<uint16_t> bench_events = { 0x08, 0x11, 0x1B, 0x70, 0x71, 0x73, 0x74, 0x75 };
+
+    volatile uint64_t g_sink;           // Results are folded here so benchmarked work is not optimised away
+
+    bench_result measure(const std::string& name, const std::string& unit, uint64_t items,
+        const bench_options& opts, const std::function<void()>& run)
+    {
+        for (uint32_t i = 0; i < opts.warmup; i++)
+            run();
+
+        std::vector<double> times;
+        for (uint32_t i = 0; i < opts.iterations; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            run();
+            const auto stop = std::chrono::steady_clock::now();
+            times.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+
+        bench_result res;
+        res.name = name;
+        res.unit = unit;
+        res.items = items;
+        res.iterations = opts.iterations;
+        res.min_ns = times.front();
+        res.max_ns = times.back();
+        const size_t n = times.size();
+        res.median_ns = n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+        for (double t : times)
+            res.mean_ns += t / n;
+        return res;
+    }
+
+    void sim_ioctl(pmu_simulator& sim, uint32_t action, const void* in, size_t in_size, void* out, size_t out_size, uint32_t& returned)
+    {
+        if (sim.io_control(action, in, static_cast<uint32_t>(in_size), out, static_cast<uint32_t>(out_size), returned) != pmu_backend_status::ok)
+            throw std::runtime_error("simulated PMU request " + std::to_string(action) + " failed");
+    }
+
+    void sim_lock(pmu_simulator& sim)
+    {
+        uint32_t returned = 0;
+        struct lock_request req = { LOCK_GET };
+        enum status_flag sts = STS_BUSY;
+        sim_ioctl(sim, PMU_CTL_LOCK_ACQUIRE, &req, sizeof(req), &sts, sizeof(sts), returned);
+        if (sts != STS_LOCK_AQUIRED)
+            throw std::runtime_error("simulated PMU is locked");
+    }
+
+    struct pmu_ctl_hdr sim_ctl_hdr(uint8_t core_idx, uint32_t flags)
+    {
+        struct pmu_ctl_hdr ctl = {};
+        ctl.cores_idx.cores_count = 1;
+        ctl.cores_idx.cores_no[0] = core_idx;
+        ctl.flags = flags;
+        return ctl;
+    }
+
+    // Samples of cycle counter and INST_RETIRED of all cores, like `wperf sample` on the whole system
+    const std::vector<FrameChain>& bench_samples(const bench_options& opts)
+    {
+        static std::vector<FrameChain> samples;
+        if (!samples.empty())
+            return samples;
+
+        pmu_simulator_cfg cfg;
+        cfg.core_num = BENCH_CORES;
+        cfg.sample_pcs = BENCH_SAMPLE_PCS;
+        cfg.event_rates = { { 0x08, 1.0 } };
+        pmu_simulator sim(cfg);
+        sim_lock(sim);
+
+        const uint64_t count = BENCH_SAMPLES / opts.scale;
+        const uint64_t per_core = (count + BENCH_CORES - 1) / BENCH_CORES;
+        auto payload = std::make_unique<PMUSamplePayload>();
+        uint32_t returned = 0;
+
+        samples.reserve(count);
+        for (uint8_t core = 0; core < BENCH_CORES && samples.size() < count; core++)
+        {
+            // Below SAMPLE_CHAIN_BUFFER_SIZE samples per read so no sample is dropped
+            std::vector<uint8_t> buf(sizeof(PMUSampleSetSrcHdr) + 2 * sizeof(SampleSrcDesc));
+            PMUSampleSetSrcHdr* src = reinterpret_cast<PMUSampleSetSrcHdr*>(buf.data());
+            src->core_idx = core;
+            src->sources[0] = { CYCLE_EVT_IDX, 12500, 0 };
+            src->sources[1] = { 0x08, 62500, 0 };
+            sim_ioctl(sim, PMU_CTL_SAMPLE_SET_SRC, buf.data(), buf.size(), nullptr, 0, returned);
+
+            struct pmu_ctl_hdr ctl = sim_ctl_hdr(core, CTL_FLAG_CORE);
+            sim_ioctl(sim, PMU_CTL_SAMPLE_START, &ctl, sizeof(ctl), nullptr, 0, returned);
+
+            const uint64_t end = std::min(count, samples.size() + per_core);
+            struct PMUCtlGetSampleHdr hdr = { core };
+            while (samples.size() < end)
+            {
+                sim_ioctl(sim, PMU_CTL_SAMPLE_GET, &hdr, sizeof(hdr), payload.get(), sizeof(PMUSamplePayload), returned);
+                for (UINT32 i = 0; i < payload->size && samples.size() < end; i++)
+                    samples.push_back(payload->payload[i]);
+            }
+
+            struct PMUSampleSummary summary = {};
+            sim_ioctl(sim, PMU_CTL_SAMPLE_STOP, &ctl, sizeof(ctl), &summary, sizeof(summary), returned);
+        }
+
+        return samples;
+    }
+
+    uint32_t bench_sample_event(const FrameChain& sample)
+    {
+        return (sample.ov_flags & (1ULL << CYCLE_COUNTER_IDX)) ? CYCLE_EVT_IDX : 0x08;
+    }
+
+    bench_result bench_parse_events(const bench_options& opts)
+    {
+        const std::wstring events_str = L"{inst_spec,vfp_spec,ase_spec,dp_spec},{ld_spec,st_spec},l1d_cache,l1d_cache_refill,"
+            L"l2d_cache,l2d_cache_refill,br_pred,br_mis_pred,stall_frontend,stall_backend,mem_access,bus_access,r1b,r73,r74,r75";
+        struct pmu_device_cfg pmu_cfg = { 0 };
+        pmu_cfg.gpc_nums[EVT_CORE] = 6;
+        pmu_cfg.core_num = BENCH_CORES;
+
+        const uint32_t n = std::max(1u, BENCH_EVENT_STRINGS / opts.scale);
+        return measure("parse_events_str", "strings", n, opts, [&]() {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                std::map<enum evt_class, std::deque<struct evt_noted>> events;
+                std::map<enum evt_class, std::vector<struct evt_noted>> groups;
+                std::map<enum evt_class, std::vector<struct evt_noted>> ioctl_events;
+                parse_events_str(events_str, events, groups, L"", pmu_cfg);
+                set_event_padding(ioctl_events, pmu_cfg, events, groups);
+                g_sink += ioctl_events[EVT_CORE].size();
+            }
+        });
+    }
+
+    bench_result bench_metric(const bench_options& opts)
+    {
+        const std::wstring formula_sy = L"100 1 op_retired op_spec / - 1 stall_slot cpu_cycles 8 * / - * br_mis_pred 4 * cpu_cycles / + *";
+        std::map<std::wstring, double> vars = {
+            { L"op_retired", 7.0e8 }, { L"op_spec", 8.0e8 }, { L"stall_slot", 2.0e9 },
+            { L"cpu_cycles", 1.0e9 }, { L"br_mis_pred", 1.0e6 } };
+        double& cpu_cycles = vars[L"cpu_cycles"];
+
+        const uint32_t n = std::max(1u, BENCH_METRIC_EVALS / opts.scale);
+        return measure("metric_shunting_yard", "evals", n, opts, [&]() {
+            double sum = 0;
+            for (uint32_t i = 0; i < n; i++)
+            {
+                cpu_cycles = 1.0e9 + i;
+                sum += metric_calculate_shunting_yard_expression(vars, formula_sy);
+            }
+            g_sink += static_cast<uint64_t>(sum);
+        });
+    }
+
+    bench_result bench_spe(const bench_options& opts)
+    {
+        pmu_simulator_cfg cfg;
+        cfg.core_num = 1;
+        cfg.sample_pcs = BENCH_SAMPLE_PCS;
+        cfg.spe_records_per_get = 1 << 16;
+        pmu_simulator sim(cfg);
+        sim_lock(sim);
+
+        uint32_t returned = 0;
+        struct spe_ctl_hdr spe = {};
+        spe.cores_idx.cores_count = 1;
+        spe.cores_idx.cores_no[0] = 0;
+        sim_ioctl(sim, PMU_CTL_SPE_START, &spe, sizeof(spe), nullptr, 0, returned);
+
+        const uint64_t size = BENCH_SPE_BYTES / opts.scale;
+        struct pmu_ctl_hdr ctl = sim_ctl_hdr(0, CTL_FLAG_SPE);
+        std::vector<UINT8> buffer;
+        buffer.reserve(size);
+        while (buffer.size() < size)
+        {
+            size_t chunk = 0;
+            sim_ioctl(sim, PMU_CTL_SPE_GET_SIZE, &ctl, sizeof(ctl), &chunk, sizeof(chunk), returned);
+
+            const size_t offset = buffer.size();
+            buffer.resize(offset + chunk);
+            spe.buffer_size = chunk;
+            sim_ioctl(sim, PMU_CTL_SPE_GET_BUFFER, &spe, sizeof(spe), buffer.data() + offset, chunk, returned);
+            buffer.resize(offset + returned);
+        }
+        sim_ioctl(sim, PMU_CTL_SPE_STOP, &spe, sizeof(spe), nullptr, 0, returned);
+
+        return measure("spe_get_samples", "bytes", buffer.size(), opts, [&]() {
+            std::vector<FrameChain> raw_samples;
+            std::map<UINT64, std::wstring> spe_events;
+            spe_device::get_samples(buffer, raw_samples, spe_events);
+            g_sink += raw_samples.size();
+        });
+    }
+
+    // Resolution of sampled PCs against image symbols and aggregation of samples per symbol,
+    // see `wperf sample` in main.cpp
+    bench_result bench_sample_resolve(const bench_options& opts)
+    {
+        const std::vector<FrameChain>& samples = bench_samples(opts);
+        const pmu_simulator_cfg cfg;
+
+        SectionDesc text;
+        text.idx = 0;
+        text.offset = 0x1000;
+        text.virtual_size = 4ULL * BENCH_SAMPLE_PCS;
+        text.name = L".text";
+        const std::vector<SectionDesc> sec_info = { text };
+        const uint64_t load_base = cfg.sample_pc_base - text.offset;
+
+        std::vector<FuncSymDesc> sym_info(BENCH_SYMBOLS);
+        const uint32_t sym_size = static_cast<uint32_t>(text.virtual_size / BENCH_SYMBOLS);
+        for (uint32_t i = 0; i < BENCH_SYMBOLS; i++)
+        {
+            sym_info[i].sec_idx = 1;
+            sym_info[i].offset = static_cast<uint64_t>(i) * sym_size;
+            sym_info[i].size = sym_size;
+            sym_info[i].name = L"func_" + std::to_wstring(i);
+            sym_info[i].sname = sym_info[i].name;
+        }
+
+        return measure("sample_resolve", "samples", samples.size(), opts, [&]() {
+            std::vector<SampleDesc> resolved_samples;
+            for (const FrameChain& a : samples)
+            {
+                SampleDesc sd;
+                if (const FuncSymDesc* sym = find_image_symbol(a.pc, sym_info, sec_info, load_base))
+                    sd.desc = *sym;
+                else
+                    sd.desc.name = L"unknown";
+
+                add_resolved_sample(resolved_samples, sd, bench_sample_event(a), a.pc, 1, a.period);
+            }
+            std::sort(resolved_samples.begin(), resolved_samples.end(), sort_samples);
+            g_sink += resolved_samples.size();
+        });
+    }
+
+    // Per core tables of `wperf stat` rendered as pretty tables and as JSON
+    bench_result bench_stat_output(const bench_options& opts)
+    {
+        return measure("stat_output", "cores", BENCH_CORES, opts, [&]() {
+            WPerfStatJSON<GlobalCharType> stat;
+            std::wostringstream pretty;
+
+            for (uint32_t core = 0; core < BENCH_CORES; core++)
+            {
+                std::vector<uint64_t> col_counter_value, col_scaled_value;
+                std::vector<std::wstring> col_event_name, col_event_idx, col_event_note, col_multiplexed;
+                std::vector<double> col_scaling_error;
+
+                for (size_t j = 0; j < bench_events.size(); j++)
+                {
+                    const uint64_t value = 1000000ULL * (core + 1) + j;
+                    col_counter_value.push_back(value);
+                    col_event_name.push_back(pmu_events::get_event_name(bench_events[j]));
+                    col_event_idx.push_back(IntToHexWideString(bench_events[j], 2));
+                    col_event_note.push_back(L"e");
+                    col_multiplexed.push_back(L"5/8");
+                    col_scaled_value.push_back(value * 8 / 5);
+                    col_scaling_error.push_back(0.5);
+                }
+
+                TableOutput<PerformanceCounterOutputTraitsL<true, true>, GlobalCharType> table(TableType::ALL);
+                table.PresetHeaders();
+                table.SetAlignment(0, ColumnAlignL::RIGHT);
+                table.SetAlignment(4, ColumnAlignL::RIGHT);
+                table.SetAlignment(5, ColumnAlignL::RIGHT);
+                table.SetAlignment(6, ColumnAlignL::RIGHT);
+                table.Insert(col_counter_value, col_event_name, col_event_idx, col_event_note, col_multiplexed, col_scaled_value, col_scaling_error);
+                pretty << table.m_tablePretty;
+                table.m_core = std::to_wstring(core);
+                stat.m_corePerformanceTables.push_back(table);
+            }
+            stat.m_multiplexing = true;
+
+            std::ostringstream json;
+            {
+                JSONStreamBuffer<GlobalCharType> buffer(json);
+                std::wostream os(&buffer);
+                stat.Print(os);
+            }
+            g_sink += pretty.str().size() + json.str().size();
+        });
+    }
+
+    bench_result bench_timeline(const bench_options& opts)
+    {
+        const std::string filename = (std::filesystem::temp_directory_path() / "wperf-bench-timeline.csv").string();
+        const uint32_t intervals = std::max(1u, BENCH_TIMELINE_INTERVALS / opts.scale);
+
+        timeline::init();
+        struct timeline_header& header = timeline::timeline_headers[EVT_CORE];
+        header.multiplexing = true;
+        header.count_interval = 1.0;
+        header.vendor_name = L"Arm Limited";
+        header.event_class = L"core";
+        header.filename = filename;
+
+        for (uint32_t core = 0; core < BENCH_CORES; core++)
+        {
+            for (uint16_t event : bench_events)
+            {
+                timeline::timeline_header_cores[EVT_CORE].push_back(L"core " + std::to_wstring(core));
+                timeline::timeline_header_event_names[EVT_CORE].push_back(pmu_events::get_event_name(event));
+            }
+            timeline::timeline_header_metric_names[EVT_CORE].push_back(L"imix");
+        }
+
+        for (uint32_t line = 0; line < intervals; line++)
+        {
+            std::vector<std::wstring> values, metric_values;
+            for (uint32_t core = 0; core < BENCH_CORES; core++)
+            {
+                for (size_t j = 0; j < bench_events.size(); j++)
+                    values.push_back(std::to_wstring(1000000ULL * (line + 1) + core * 100 + j));
+                metric_values.push_back(DoubleToWideString(1.5 + core * 0.01));
+            }
+            timeline::timeline_header_event_values[EVT_CORE].push_back(values);
+            timeline::timeline_header_metric_values[EVT_CORE].push_back(metric_values);
+        }
+
+        bench_result res = measure("timeline_print", "intervals", intervals, opts, [&]() {
+            timeline::print();
+            g_sink += std::filesystem::file_size(filename);
+        });
+
+        timeline::init();
+        std::filesystem::remove(filename);
+        return res;
+    }
+
+    bench_result bench_perfdata(const bench_options& opts)
+    {
+        const std::vector<FrameChain>& samples = bench_samples(opts);
+        const std::string filename = (std::filesystem::temp_directory_path() / "wperf-bench-perf.data").string();
+        std::wstring command = L"wperf-bench.exe";
+        const DWORD pid = 1000;
+
+        bench_result res = measure("perfdata_write", "samples", samples.size(), opts, [&]() {
+            PerfDataWriter writer;
+            writer.RegisterSampleEvent(CYCLE_EVT_IDX);
+            writer.RegisterSampleEvent(0x08);
+            writer.RegisterEvent(PerfDataWriter::COMM, pid, command, UINT64(0));
+            for (size_t i = 0; i < samples.size(); i++)
+            {
+                const UINT32 cpu = static_cast<UINT32>(i * BENCH_CORES / samples.size());
+                const UINT64 event = bench_sample_event(samples[i]);
+                writer.RegisterEvent(PerfDataWriter::SAMPLE, pid, samples[i].pc, cpu, event, UINT64(i * 1000));
+            }
+            writer.Write(filename);
+            g_sink += std::filesystem::file_size(filename);
+        });
+
+        std::filesystem::remove(filename);
+        return res;
+    }
+
+    const std::vector<benchmark> benchmarks = {
+        { "parse_events_str",       "Parse event string with groups and pad events for 6 GPCs",             bench_parse_events },
+        { "metric_shunting_yard",   "Evaluate metric formula in RPN (shunting yard) form",                  bench_metric },
+        { "spe_get_samples",        "Decode SPE buffer into samples",                                       bench_spe },
+        { "sample_resolve",         "Resolve sampled PCs to symbols and aggregate samples per symbol",      bench_sample_resolve },
+        { "stat_output",            "Render per core counting tables as pretty tables and JSON",            bench_stat_output },
+        { "timeline_print",         "Write timeline CSV file",                                              bench_timeline },
+        { "perfdata_write",         "Register samples and write perf.data file",                            bench_perfdata },
+    };
+
+    double ns_per_item(const bench_result& r)
+    {
+        return r.items ? r.median_ns / r.items : r.median_ns;
+    }
+
+    void print_results(const std::vector<bench_result>& results)
+    {
+        std::cout << std::left << std::setw(24) << "benchmark" << std::right
+            << std::setw(14) << "items" << std::setw(16) << "median ms" << std::setw(12) << "min ms"
+            << std::setw(12) << "max ms" << std::setw(14) << "ns/item" << std::setw(16) << "items/s" << std::endl;
+
+        for (const auto& r : results)
+        {
+            std::cout << std::left << std::setw(24) << r.name << std::right
+                << std::setw(14) << r.items
+                << std::fixed << std::setprecision(3)
+                << std::setw(16) << r.median_ns / 1e6 << std::setw(12) << r.min_ns / 1e6 << std::setw(12) << r.max_ns / 1e6
+                << std::setw(14) << ns_per_item(r)
+                << std::setprecision(0) << std::setw(16) << (r.median_ns ? r.items * 1e9 / r.median_ns : 0)
+                << std::defaultfloat << std::endl;
+        }
+    }
+
+    // Results file has one benchmark per line so baseline can be read back with read_baseline()
+    void write_results(const std::wstring& filename, const std::vector<bench_result>& results, const bench_options& opts)
+    {
+        std::ofstream file(std::filesystem::path(filename), std::ios::out | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("unable to open " + MultiByteFromWideString(filename.c_str()));
+
+        file << "{" << std::endl;
+        file << "  \"wperf-bench\": 1," << std::endl;
+        file << "  \"scale\": " << opts.scale << "," << std::endl;
+        file << "  \"benchmarks\": [" << std::endl;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const bench_result& r = results[i];
+            file << std::fixed << std::setprecision(1)
+                << "    { \"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\", \"items\": " << r.items
+                << ", \"iterations\": " << r.iterations << ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns
+                << ", \"mean_ns\": " << r.mean_ns << ", \"max_ns\": " << r.max_ns
+                << ", \"items_per_sec\": " << (r.median_ns ? r.items * 1e9 / r.median_ns : 0) << " }"
+                << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        file << "  ]" << std::endl;
+        file << "}" << std::endl;
+    }
+
+    std::map<std::string, bench_result> read_baseline(const std::wstring& filename)
+    {
+        std::ifstream file{ std::filesystem::path(filename) };
+        if (!file.is_open())
+            throw std::runtime_error("unable to open " + MultiByteFromWideString(filename.c_str()));
+
+        static const std::regex re("\"name\": \"([^\"]+)\".*\"items\": ([0-9]+).*\"median_ns\": ([0-9.eE+-]+)");
+        std::map<std::string, bench_result> baseline;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::smatch m;
+            if (!std::regex_search(line, m, re))
+                continue;
+
+            bench_result r;
+            r.name = m[1];
+            r.items = std::stoull(m[2]);
+            r.median_ns = std::stod(m[3]);
+            baseline[r.name] = r;
+        }
+        return baseline;
+    }
+
+    // Median times per item are compared, so results of runs with other input sizes (e.g. `--quick`)
+    // can be compared too, but only roughly. Returns number of regressions.
+    uint32_t compare_results(const std::vector<bench_result>& results, const std::map<std::string, bench_result>& baseline, double threshold)
+    {
+        uint32_t regressions = 0;
+
+        std::cout << std::endl << std::left << std::setw(24) << "benchmark" << std::right
+            << std::setw(16) << "baseline ns/item" << std::setw(14) << "ns/item" << std::setw(10) << "change" << "  status" << std::endl;
+
+        for (const auto& r : results)
+        {
+            std::cout << std::left << std::setw(24) << r.name << std::right;
+
+            auto it = baseline.find(r.name);
+            if (it == baseline.end() || !it->second.median_ns)
+            {
+                std::cout << std::setw(16) << "-" << std::fixed << std::setprecision(3) << std::setw(14) << ns_per_item(r)
+                    << std::setw(10) << "-" << "  new" << std::defaultfloat << std::endl;
+                continue;
+            }
+
+            const double base = ns_per_item(it->second);
+            const double change = (ns_per_item(r) - base) * 100 / base;
+            const char* status = "ok";
+            if (change > threshold)
+            {
+                status = "REGRESSION";
+                regressions++;
+            }
+            else if (change < -threshold)
+                status = "improved";
+
+            std::cout << std::fixed << std::setprecision(3) << std::setw(16) << base << std::setw(14) << ns_per_item(r)
+                << std::showpos << std::setprecision(1) << std::setw(9) << change << "%" << std::noshowpos
+                << "  " << status << (it->second.items != r.items ? " (different input size)" : "")
+                << std::defaultfloat << std::endl;
+        }
+
+        std::cout << std::endl << std::setprecision(6) << regressions << " regression(s), threshold " << threshold << "%" << std::endl;
+        return regressions;
+    }
+
+    void usage()
+    {
+        std::cout << "usage: wperf-bench [options]" << std::endl
+            << std::endl
+            << "  --list               List benchmarks" << std::endl
+            << "  --filter NAME        Run only benchmarks with NAME in their name" << std::endl
+            << "  --iterations N       Measured runs of each benchmark (default 5)" << std::endl
+            << "  --warmup N           Not measured runs of each benchmark (default 1)" << std::endl
+            << "  --quick              Inputs " << BENCH_QUICK_SCALE << " times smaller than production ones" << std::endl
+            << "  --output FILE        Save results to FILE (JSON)" << std::endl
+            << "  --baseline FILE      Compare results with results saved to FILE with --output" << std::endl
+            << "  --threshold PCT      Slowdown in percent reported as regression (default 10)" << std::endl
+            << std::endl
+            << "Exit status is 1 when a regression was found, 2 on error." << std::endl;
+    }
+}
+
+int wmain(int argc, const wchar_t* argv[])
+{
+    bench_options opts;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::wstring arg = argv[i];
+            auto value = [&]() -> std::wstring {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("missing value of " + MultiByteFromWideString(arg.c_str()));
+                return argv[++i];
+            };
+
+            if (arg == L"--list")
+                opts.list = true;
+            else if (arg == L"--filter")
+                opts.filter = MultiByteFromWideString(value().c_str());
+            else if (arg == L"--iterations")
+                opts.iterations = std::max(1ul, std::stoul(value()));
+            else if (arg == L"--warmup")
+                opts.warmup = std::stoul(value());
+            else if (arg == L"--quick")
+                opts.scale = BENCH_QUICK_SCALE;
+            else if (arg == L"--output")
+                opts.output = value();
+            else if (arg == L"--baseline")
+                opts.baseline = value();
+            else if (arg == L"--threshold")
+                opts.threshold = std::stod(value());
+            else if (arg == L"-h" || arg == L"--help")
+            {
+                usage();
+                return 0;
+            }
+            else
+                throw std::invalid_argument("unknown option " + MultiByteFromWideString(arg.c_str()));
+        }
+
+        if (opts.list)
+        {
+            for (const auto& b : benchmarks)
+                std::cout << std::left << std::setw(24) << b.name << b.description << std::endl;
+            return 0;
+        }
+
+        std::cout << "wperf-bench: " << opts.iterations << " iteration(s), " << opts.warmup << " warmup run(s)";
+        if (opts.scale > 1)
+            std::cout << ", inputs 1/" << opts.scale << " of production size";
+        std::cout << std::endl << std::endl;
+
+        std::vector<bench_result> results;
+        for (const auto& b : benchmarks)
+        {
+            if (!opts.filter.empty() && b.name.find(opts.filter) == std::string::npos)
+                continue;
+            results.push_back(b.run(opts));
+        }
+
+        print_results(results);
+
+        if (!opts.output.empty())
+            write_results(opts.output, results, opts);
+
+        if (!opts.baseline.empty() && compare_results(results, read_baseline(opts.baseline), opts.threshold))
+            return 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "wperf-bench: " << e.what() << std::endl;
+        return 2;
+    }
+
+    return 0;
+}
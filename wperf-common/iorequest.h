@@ -29,7 +29,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "wperf-common\macros.h"
+#include "wperf-common/macros.h"
 
 #define MAX_GITVER_SIZE 32
 #define MAX_FEATURESTRING_SIZE 128
@@ -81,6 +81,8 @@ struct hw_cfg
     wchar_t device_id_str[MAX_DEVICE_ID_STR_SIZE];      // Driver devices and their capabilities
     UINT64  pmbidr_el1_value;                           // FEAT_SPE only
     UINT64  pmsidr_el1_value;                           // FEAT_SPE only
+    UINT32  period_min;                                 // Counting timer period range (in microseconds) accepted by PMU_CTL_START
+    UINT32  period_max;
 };
 
 struct version_info
@@ -122,6 +124,10 @@ enum pmu_ctl_action
     PMU_CTL_SPE_GET_BUFFER,
     PMU_CTL_SPE_START,
     PMU_CTL_SPE_STOP,
+    PMU_CTL_SAMPLE_GET_HISTOGRAM,
+    PMU_CTL_SAMPLE_SET_INTERVAL,
+    PMU_CTL_READ_COUNTING_LIVE,
+    PMU_CTL_QUERY_OVERHEAD,
 };
 
 #define IOCTL_PMU_CTL_START                     CTL_CODE(WPERF_TYPE,  PMU_CTL_START,                METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
@@ -147,6 +153,10 @@ enum pmu_ctl_action
 #define IOCTL_PMU_CTL_SPE_GET_BUFFER            CTL_CODE(WPERF_TYPE,  PMU_CTL_SPE_GET_BUFFER,       METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
 #define IOCTL_PMU_CTL_SPE_START                 CTL_CODE(WPERF_TYPE,  PMU_CTL_SPE_START,            METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
 #define IOCTL_PMU_CTL_SPE_STOP                  CTL_CODE(WPERF_TYPE,  PMU_CTL_SPE_STOP,             METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_SAMPLE_GET_HISTOGRAM      CTL_CODE(WPERF_TYPE,  PMU_CTL_SAMPLE_GET_HISTOGRAM, METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_SAMPLE_SET_INTERVAL       CTL_CODE(WPERF_TYPE,  PMU_CTL_SAMPLE_SET_INTERVAL,  METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_READ_COUNTING_LIVE        CTL_CODE(WPERF_TYPE,  PMU_CTL_READ_COUNTING_LIVE,   METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
+#define IOCTL_PMU_CTL_QUERY_OVERHEAD            CTL_CODE(WPERF_TYPE,  PMU_CTL_QUERY_OVERHEAD,       METHOD_BUFFERED, FILE_READ_DATA|FILE_WRITE_DATA)
 
 enum lock_flag
 {
@@ -176,6 +186,14 @@ typedef struct
 } PMUSampleSetSrcHdr;
 #pragma warning(pop)
 
+// Change sampling intervals while sampling is running (frequency mode, see `-F`).
+// New interval is used from the next overflow of given counter.
+struct PMUSampleSetIntervalHdr
+{
+    UINT32 core_idx;
+    UINT32 interval[AARCH64_MAX_HWC_SUPP + 1];  // Indexed with raw counter index, 31 is cycle counter. 0 - keep current interval
+};
+
 struct PMUSampleSummary
 {
     UINT64 sample_generated;
@@ -188,6 +206,7 @@ typedef struct
     UINT64 pc;
     UINT64 ov_flags;
     UINT32 spe_event_idx;
+    UINT32 period;                              // Sampling interval of overflowed counter (one bit in ov_flags) when this sample was taken
 } FrameChain;
 
 struct PMUCtlGetSampleHdr
@@ -201,6 +220,21 @@ struct PMUSamplePayload
     FrameChain payload[SAMPLE_CHAIN_BUFFER_SIZE];   
 };
 
+// Histogram sampling mode (see CTL_FLAG_SAMPLE_HISTOGRAM): driver counts samples
+// per (PC, counter) pair instead of storing every sample, see pc_histogram.h.
+typedef struct
+{
+    UINT64 pc;
+    UINT32 counter_idx;                         // Raw (not mapped) index of overflowed counter, 31 is cycle counter
+    UINT32 count;                               // 0 - empty slot
+} PCHistogramEntry;
+
+struct PMUSampleHistogramPayload
+{
+    UINT32 size;                                // How many histogram entries in payload
+    PCHistogramEntry payload[PC_HISTOGRAM_SIZE];
+};
+
 struct pmu_ctl_ver_hdr
 {
     struct version_info version;
@@ -215,7 +249,7 @@ struct pmu_ctl_cores_count_hdr
 struct pmu_ctl_hdr
 {
     struct pmu_ctl_cores_count_hdr cores_idx;
-    LONG period;
+    LONG period;                                // Counting timer period in microseconds, see PMU_CTL_START_PERIOD_MIN
 	UINT8 dmc_idx;
 #define CTL_FLAG_CORE (0x1 << 0)
 #define CTL_FLAG_DSU  (0x1 << 1)
@@ -223,6 +257,7 @@ struct pmu_ctl_hdr
 #define CTL_FLAG_SPE  (0x1 << 3)
 #define CTL_FLAG_MAX  (0x1 << 4)
 #define CTRL_FLAG_VALID(flag_s) (flag_s < CTL_FLAG_MAX)
+#define CTL_FLAG_SAMPLE_HISTOGRAM (0x1 << 16)   // PMU_CTL_SAMPLE_START only: aggregate samples in driver, see PMU_CTL_SAMPLE_GET_HISTOGRAM
 	UINT32 flags;
 };
 
@@ -231,6 +266,8 @@ struct pmu_ctl_evt_assign_hdr
     UINT32 core_idx;
     UINT8 dmc_idx;
     UINT64 filter_bits;
+    UINT8 core_groups[MAX_MANAGED_CORE_EVENTS];     // Multiplexing unit of each core event, see mux_init()
+    UINT8 core_weights[MAX_MANAGED_CORE_EVENTS];    // Multiplexing weight of unit starting at given core event, 0 - default
 };
 
 struct pmu_event_usr
@@ -239,15 +276,53 @@ struct pmu_event_usr
     UINT64 filter_bits;
     UINT64 value;
     UINT64 scheduled;
+    UINT64 time_enabled;    // In cycles, 0 if not accounted (DSU, DMC)
+    UINT64 time_running;    // In cycles
+    UINT64 slice_sq_lo;     // Sum of squares of counts per multiplexing slice, low 64 bits
+    UINT64 slice_sq_hi;     // ... and high 64 bits
 };
 
 typedef struct pmu_event_read_out
 {
     UINT32 evt_num;
     UINT64 round;
+    UINT64 dpc_calls;                           // Counting DPCs run on the core since PMU_CTL_RESET
+    UINT64 dpc_time_ns;                         // ... and total time spent in them
     struct pmu_event_usr evts[MAX_MANAGED_CORE_EVENTS];
 } ReadOut;
 
+// Live read of core counters, see PMU_CTL_READ_COUNTING_LIVE. Request is handled on the core
+// the calling thread runs on, values are read from that core without stopping counting.
+struct PMUCtlReadLiveHdr
+{
+    UINT32 core_idx;                            // Core the caller runs on
+};
+
+struct PMUReadLiveOut
+{
+    UINT32 core_idx;                            // Core the values were read on, differs from PMUCtlReadLiveHdr.core_idx if caller was migrated
+    UINT32 evt_num;
+    UINT64 value[MAX_MANAGED_CORE_EVENTS];      // Accumulated value plus current counter value, same order as ReadOut.evts
+};
+
+// Driver self-overhead, see PMU_CTL_QUERY_OVERHEAD. Every code path counts its invocations,
+// total time and the longest invocation since its own reset: counting DPC - PMU_CTL_RESET,
+// sampling interrupt - PMU_CTL_SAMPLE_START of the core, IOCTLs - PMU_CTL_LOCK_ACQUIRE.
+struct overhead_stat
+{
+    UINT64 calls;
+    UINT64 time_ns;
+    UINT64 max_ns;
+};
+
+typedef struct overhead_out
+{
+    UINT32 core_num;                                    // Cores with valid `dpc` and `isr`
+    struct overhead_stat ioctl;                         // All IOCTLs, driver wide
+    struct overhead_stat dpc[MAX_PMU_CTL_CORES_COUNT];  // Counting timer DPC (multiplex_dpc, overflow_dpc) of each core
+    struct overhead_stat isr[MAX_PMU_CTL_CORES_COUNT];  // PMU overflow interrupt (arm64_pmi_ISR) of each core
+} OverheadOut;
+
 //
 // SPE communication
 // 
@@ -304,6 +379,9 @@ typedef struct dmc_pmu_event_read_out
 	struct pmu_event_usr clkdiv2_events[MAX_MANAGED_DMC_CLKDIV2_EVENTS];
 	UINT8 clk_events_num;
 	UINT8 clkdiv2_events_num;
+	UINT64 round;               // Counter refreshes by counting DPC since PMU_CTL_RESET
+	UINT64 refresh_time_ns;     // Driver time of the last refresh (or reset)
+	UINT64 read_time_ns;        // Driver time of this read, same clock as refresh_time_ns
 } DMCReadOut;
 
 #pragma warning(push)
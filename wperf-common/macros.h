@@ -30,13 +30,14 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <limits.h>
+#include <stdint.h>
 
 //
 // Macros used by various parts of the solution
 //
-#define ALL_CORE                            _UI32_MAX
-#define ALL_DMC_CHANNEL                     _UI8_MAX
-#define CYCLE_EVENT_IDX                     _UI32_MAX
+#define ALL_CORE                            UINT32_MAX
+#define ALL_DMC_CHANNEL                     UINT8_MAX
+#define CYCLE_EVENT_IDX                     UINT32_MAX
 
 #define CYCLE_COUNTER_IDX                   31
 #define INVALID_COUNTER_IDX                 32
@@ -52,6 +53,9 @@
 #define AARCH64_MAX_HWC_SUPP                31
 
 #define SAMPLE_CHAIN_BUFFER_SIZE            128
+#define PC_HISTOGRAM_BITS                   12      // Per core in-driver sample histogram has 2^PC_HISTOGRAM_BITS slots
+#define PC_HISTOGRAM_SIZE                   (1U << PC_HISTOGRAM_BITS)
+#define PC_HISTOGRAM_MAX_PROBE              32      // Max number of slots visited when inserting into histogram
 
 #define MAX_PROCESSES					1024
 
@@ -61,8 +65,9 @@
 
 #define FILTER_BIT_EXCL_EL1                 (1U << 31)
 
-#define PMU_CTL_START_PERIOD                100     // Default (and max) value
-#define PMU_CTL_START_PERIOD_MIN            10      // Minimal value for period
+#define PMU_CTL_START_PERIOD                100000  // Default (and max) value, in microseconds
+#define PMU_CTL_START_PERIOD_MIN            100     // Minimal value for period, in microseconds
+#define PMU_CTL_START_PERIOD_HIRES          10000   // Shorter periods (in microseconds) use high resolution timer
 
 // Define how many fixed counters are now handled
 // Currently we are having "cycles" as 1 (only) fixed counter
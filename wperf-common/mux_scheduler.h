@@ -0,0 +1,215 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "wperf-common/macros.h"
+
+//
+// Multiplexing scheduler of core events (PROF_MULTIPLEX). Events are grouped
+// in scheduling units: user defined event group (`{a,b,c}`) is one unit and
+// each event outside of a group is a unit of its own. Unit is scheduled as a
+// whole, all its events get counters in the same round or none does.
+//
+// Every round units are taken in order of their normalized service
+// (`served / weight`, smallest first) and packed greedily into free counters,
+// units which do not fit are skipped so smaller ones can fill the remaining
+// counters. Over time each unit gets share of rounds proportional to its
+// weight. On ties units which already hold counters go first and keep their
+// counters, so only newly scheduled events need their counters reprogrammed.
+//
+// Note: this code is shared between wperf-driver (C) and wperf (C++) so it can
+//       be simulated and tested in user space, keep it free of kernel and user
+//       space APIs.
+//
+#define MUX_NO_COUNTER          0xFF        // Event is not scheduled
+#define MUX_NO_EVENT            0xFF        // Counter is free
+#define MUX_MAX_COUNTERS        AARCH64_MAX_HWC_SUPP
+
+typedef struct
+{
+    UINT8 first;                // Index of first event of the unit, events of a unit are consecutive
+    UINT8 size;                 // Number of events (counters needed)
+    UINT8 weight;               // Relative share of rounds, at least 1
+    UINT8 running;              // Unit holds counters in current round
+    UINT64 served;              // Number of rounds unit was scheduled for
+} MuxUnit;
+
+typedef struct
+{
+    UINT32 units_num;
+    UINT32 events_num;
+    UINT32 counters_num;
+    MuxUnit units[MAX_MANAGED_CORE_EVENTS];
+    UINT8 order[MAX_MANAGED_CORE_EVENTS];               // Unit indexes, highest priority first
+    UINT8 event_counter[MAX_MANAGED_CORE_EVENTS];       // [event] -> counter or MUX_NO_COUNTER
+    UINT8 counter_event[MUX_MAX_COUNTERS];              // [counter] -> event or MUX_NO_EVENT
+} MuxScheduler;
+
+/// <summary>
+/// Set up scheduler for EVENTS_NUM events sharing COUNTERS_NUM counters.
+/// GROUPS[i] is unit id of event i: consecutive events with the same non-zero
+/// id form one unit, 0 means event is not grouped. WEIGHTS[i] is weight of
+/// the unit event i starts (0 is treated as 1). GROUPS and WEIGHTS can be NULL.
+/// No event is scheduled until first mux_schedule() call.
+/// </summary>
+/// <returns>FALSE if arguments are out of range or some unit needs more
+/// counters than COUNTERS_NUM</returns>
+static __inline BOOLEAN mux_init(MuxScheduler* s, UINT32 events_num, const UINT8* groups, const UINT8* weights, UINT32 counters_num)
+{
+    if (events_num > MAX_MANAGED_CORE_EVENTS || counters_num == 0 || counters_num > MUX_MAX_COUNTERS)
+        return FALSE;
+
+    s->units_num = 0;
+    s->events_num = events_num;
+    s->counters_num = counters_num;
+
+    for (UINT32 i = 0; i < events_num; i++)
+    {
+        s->event_counter[i] = MUX_NO_COUNTER;
+
+        if (i > 0 && groups && groups[i] && groups[i] == groups[i - 1])
+        {
+            MuxUnit* unit = &s->units[s->units_num - 1];
+            if (++unit->size > counters_num)
+                return FALSE;
+            continue;
+        }
+
+        MuxUnit* unit = &s->units[s->units_num];
+        unit->first = (UINT8)i;
+        unit->size = 1;
+        unit->weight = (weights && weights[i]) ? weights[i] : 1;
+        unit->running = 0;
+        unit->served = 0;
+        s->order[s->units_num] = (UINT8)s->units_num;
+        s->units_num++;
+    }
+
+    for (UINT32 i = 0; i < MUX_MAX_COUNTERS; i++)
+        s->counter_event[i] = MUX_NO_EVENT;
+
+    return TRUE;
+}
+
+/// <summary>
+/// TRUE if unit A should be scheduled before unit B: it has received less
+/// service relative to its weight (compared as served_a / weight_a <
+/// served_b / weight_b without division). Running units win ties.
+/// </summary>
+static __inline BOOLEAN mux_unit_before(const MuxUnit* a, const MuxUnit* b)
+{
+    UINT64 va = a->served * b->weight;
+    UINT64 vb = b->served * a->weight;
+
+    if (va != vb)
+        return va < vb;
+
+    if (a->running != b->running)
+        return a->running > b->running;
+
+    return a->first < b->first;
+}
+
+/// <summary>
+/// Compute schedule for next round. After the call event_counter[] tells which
+/// counter (0 ... counters_num - 1) each event uses, or MUX_NO_COUNTER.
+/// Events which keep their counters from previous round are not touched.
+/// </summary>
+/// <returns>Number of events which got a new counter (need to be programmed)</returns>
+static __inline UINT32 mux_schedule(MuxScheduler* s)
+{
+    UINT8 selected[MAX_MANAGED_CORE_EVENTS];
+    UINT32 free_counters = s->counters_num;
+    UINT32 programmed = 0;
+
+    // Only units served in previous round changed their priority, order is
+    // almost sorted and insertion sort is close to linear here.
+    for (UINT32 i = 1; i < s->units_num; i++)
+    {
+        UINT8 u = s->order[i];
+        UINT32 j = i;
+        for (; j > 0 && mux_unit_before(&s->units[u], &s->units[s->order[j - 1]]); j--)
+            s->order[j] = s->order[j - 1];
+        s->order[j] = u;
+    }
+
+    for (UINT32 i = 0; i < s->units_num; i++)
+        selected[i] = 0;
+
+    for (UINT32 i = 0; i < s->units_num && free_counters; i++)
+    {
+        UINT8 u = s->order[i];
+        if (s->units[u].size <= free_counters)
+        {
+            selected[u] = 1;
+            free_counters -= s->units[u].size;
+        }
+    }
+
+    // Release counters of units which are not scheduled this round first
+    for (UINT32 u = 0; u < s->units_num; u++)
+    {
+        MuxUnit* unit = &s->units[u];
+        if (!unit->running || selected[u])
+            continue;
+
+        for (UINT32 e = unit->first; e < (UINT32)unit->first + unit->size; e++)
+        {
+            s->counter_event[s->event_counter[e]] = MUX_NO_EVENT;
+            s->event_counter[e] = MUX_NO_COUNTER;
+        }
+        unit->running = 0;
+    }
+
+    for (UINT32 u = 0; u < s->units_num; u++)
+    {
+        MuxUnit* unit = &s->units[u];
+        if (!selected[u])
+            continue;
+
+        if (!unit->running)
+        {
+            UINT32 c = 0;
+            for (UINT32 e = unit->first; e < (UINT32)unit->first + unit->size; e++)
+            {
+                while (s->counter_event[c] != MUX_NO_EVENT)
+                    c++;
+                s->counter_event[c] = (UINT8)e;
+                s->event_counter[e] = (UINT8)c;
+                programmed++;
+            }
+            unit->running = 1;
+        }
+
+        unit->served++;
+    }
+
+    return programmed;
+}
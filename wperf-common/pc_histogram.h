@@ -0,0 +1,121 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdint.h>
+#include "wperf-common/macros.h"
+#include "wperf-common/iorequest.h"
+
+//
+// Per core histogram of samples used by the driver in histogram sampling mode
+// (see CTL_FLAG_SAMPLE_HISTOGRAM). Instead of storing every sample (FrameChain)
+// the ISR increments a counter for the sampled (PC, counter) pair. Table is a
+// fixed-size open-addressing hash table with linear probing, so it can live in
+// non-paged memory and be updated from the ISR without allocations.
+// User space periodically drains the table with PMU_CTL_SAMPLE_GET_HISTOGRAM.
+//
+// Note: this code is shared between wperf-driver (C) and wperf (C++) so it can
+//       be tested in user space, keep it free of kernel and user space APIs.
+//
+typedef struct
+{
+    UINT32 used;                                // Number of occupied slots
+    PCHistogramEntry entries[PC_HISTOGRAM_SIZE];
+} PCHistogram;
+
+/// <summary>
+/// Fibonacci hashing of (PC, COUNTER_IDX) into slot index. Counter index is
+/// mixed into top bits of the PC which are (almost) constant for user space
+/// and kernel addresses.
+/// </summary>
+static __inline UINT32 pc_histogram_hash(UINT64 pc, UINT32 counter_idx)
+{
+    UINT64 key = (pc ^ ((UINT64)counter_idx << 58)) * 0x9E3779B97F4A7C15ULL;
+    return (UINT32)(key >> (64 - PC_HISTOGRAM_BITS));
+}
+
+/// <summary>
+/// Count one sample of PC for counter COUNTER_IDX in HIST.
+/// </summary>
+/// <returns>FALSE if sample was not counted as there was no free slot
+/// within PC_HISTOGRAM_MAX_PROBE slots (sample should be counted as dropped)</returns>
+static __inline BOOLEAN pc_histogram_add(PCHistogram* hist, UINT64 pc, UINT32 counter_idx)
+{
+    UINT32 idx = pc_histogram_hash(pc, counter_idx);
+
+    for (UINT32 probe = 0; probe < PC_HISTOGRAM_MAX_PROBE; probe++)
+    {
+        PCHistogramEntry* entry = &hist->entries[(idx + probe) & (PC_HISTOGRAM_SIZE - 1)];
+
+        if (entry->count == 0)
+        {
+            entry->pc = pc;
+            entry->counter_idx = counter_idx;
+            entry->count = 1;
+            hist->used++;
+            return TRUE;
+        }
+
+        if (entry->pc == pc && entry->counter_idx == counter_idx)
+        {
+            if (entry->count != UINT32_MAX)     // Saturate, do not wrap to "empty"
+                entry->count++;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/// <summary>
+/// Move up to OUT_SIZE occupied entries of HIST to OUT (compacted) and free
+/// their slots. When OUT_SIZE is smaller than number of used slots entries
+/// left behind may be counted again in new slots, so the same (PC, counter)
+/// pair can be returned more than once by consecutive drains. Caller should
+/// merge entries when this is a problem.
+/// </summary>
+/// <returns>Number of entries stored in OUT</returns>
+static __inline UINT32 pc_histogram_drain(PCHistogram* hist, PCHistogramEntry* out, UINT32 out_size)
+{
+    UINT32 n = 0;
+
+    for (UINT32 i = 0; i < PC_HISTOGRAM_SIZE && n < out_size && hist->used; i++)
+    {
+        PCHistogramEntry* entry = &hist->entries[i];
+        if (entry->count == 0)
+            continue;
+
+        out[n++] = *entry;
+        entry->count = 0;
+        hist->used--;
+    }
+
+    return n;
+}
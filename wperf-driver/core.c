@@ -100,6 +100,13 @@ VOID CoreCounterEnableIrq(UINT32 mask)
     _WriteStatusReg(PMINTENSET_EL1, (__int64)mask);
 }
 
+// Event counters wrap at 32 bits unless PMCR_EL0.LP is in effect. Note that ARMV8_PMCR_MASK
+// does not let CorePmcrSet() set LP, so check what hardware actually does.
+UINT64 CoreCounterWidthMask(VOID)
+{
+    return (CorePmcrGet() & ARMV8_PMCR_LP) ? MAXUINT64 : MAXUINT32;
+}
+
 #define SET_COUNTER_TYPE(N) case N: _WriteStatusReg(PMEVTYPER##N##_EL0, evtype_val); break
 VOID CoreCouterSetType(UINT32 counter_idx, __int64 evtype_val)
 {
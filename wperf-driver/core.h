@@ -61,6 +61,7 @@ VOID CoreCounterIrqDisable(UINT32 mask);
 VOID CoreCounterStart(VOID);
 VOID CoreCounterStop(VOID);
 VOID CoreCounterEnableIrq(UINT32 mask);
+UINT64 CoreCounterWidthMask(VOID);
 VOID CoreCouterSetType(UINT32 counter_idx, __int64 evtype_val);
 UINT64 CoreReadCounter(UINT32 counter_idx);
 VOID CoreWriteCounter(UINT32 counter_idx, __int64 val);
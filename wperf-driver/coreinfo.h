@@ -33,6 +33,8 @@
 #include "pmu.h"
 #include "queue.h"
 #include "wperf-common\iorequest.h"
+#include "wperf-common\pc_histogram.h"
+#include "wperf-common\mux_scheduler.h"
 
 enum prof_action
 {
@@ -41,6 +43,22 @@ enum prof_action
     PROF_MULTIPLEX,
 };
 
+// Counting timer set by core_timer_start()
+enum core_timer_kind
+{
+    CORE_TIMER_NONE,
+    CORE_TIMER_KTIMER,              // KTIMER `timer`, periods from PMU_CTL_START_PERIOD_HIRES
+    CORE_TIMER_HIRES,               // EX_TIMER `hr_timer`, shorter periods
+};
+
+// Self-overhead of one driver code path, see PMU_CTL_QUERY_OVERHEAD
+typedef struct overhead_acc
+{
+    UINT64 calls;
+    UINT64 time;                    // In KeQueryPerformanceCounter() ticks
+    UINT64 time_max;                // Longest single call
+} OverheadAcc;
+
 typedef struct core_info
 {
     struct pmu_event_pseudo events[MAX_MANAGED_CORE_EVENTS];
@@ -48,8 +66,11 @@ typedef struct core_info
     UINT32 events_num;
     UINT32 dsu_events_num;
     UINT64 timer_round;
+    MuxScheduler mux;               // Schedule of core events when multiplexing (PROF_MULTIPLEX)
     KTIMER timer;
-    UINT8 timer_running;
+    PEX_TIMER hr_timer;             // High resolution timer for periods below PMU_CTL_START_PERIOD_HIRES, allocated on first use
+    PRKDPC timer_dpc;               // DPC queued on this core when `hr_timer` expires
+    UINT8 timer_running;            // Which counting timer is set: CORE_TIMER_NONE, CORE_TIMER_KTIMER or CORE_TIMER_HIRES
     UINT8 dmc_ch;
     KDPC dpc_overflow, dpc_multiplex, dpc_queue, dpc_reset;
     enum prof_action prof_core;
@@ -61,7 +82,13 @@ typedef struct core_info
     UINT16 sample_idx;
     UINT64 sample_generated;
     UINT64 sample_dropped;
-    UINT32 sample_interval[AARCH64_MAX_HWC_SUPP + numFPC];
+    PCHistogram* histogram;         // Allocated on first PMU_CTL_SAMPLE_START with CTL_FLAG_SAMPLE_HISTOGRAM
+    BOOLEAN sample_histogram;       // Samples are counted in `histogram` instead of stored in `samples`
+    UINT32 sample_interval[AARCH64_MAX_HWC_SUPP + numFPC];   // Reload value for next overflow, see PMU_CTL_SAMPLE_SET_INTERVAL
+    UINT32 sample_period[AARCH64_MAX_HWC_SUPP + numFPC];     // Interval counter is currently counting down, reported with its next sample
     UINT64 ov_mask;
+    UINT64 counter_last[AARCH64_MAX_HWC_SUPP];  // Raw GPC values read on last counting DPC tick, counters are not reset between ticks in PROF_NORMAL
     UINT64 idx;
+    OverheadAcc dpc;                // Counting DPCs run since PMU_CTL_RESET
+    OverheadAcc isr;                // PMU interrupts taken since PMU_CTL_SAMPLE_START
 } CoreInfo;
@@ -110,10 +110,8 @@ static UINT64 arm64_clear_ov_flags(void)
 
 typedef VOID (*PMIHANDLER)(PKTRAP_FRAME TrapFrame);
 
-VOID arm64_pmi_ISR(PKTRAP_FRAME pTrapFrame)
+static VOID arm64_pmi_handle(CoreInfo* core, PKTRAP_FRAME pTrapFrame)
 {
-    ULONG core_idx = KeGetCurrentProcessorNumberEx(NULL);
-    CoreInfo* core = core_info + core_idx;
     /* core->ov_mask represents the bitmap with the GPCs that this core is using. We do a & with ov_flags to 
     * check if any of the GPCs we are interested were overflown.
     */
@@ -131,7 +129,25 @@ VOID arm64_pmi_ISR(PKTRAP_FRAME pTrapFrame)
         return;
     }
 
-    if (core->sample_idx == SAMPLE_CHAIN_BUFFER_SIZE)
+    if (core->sample_histogram)
+    {
+        CoreCounterStop();
+
+        /* Histogram mode: count sample for each overflowed counter, there is no
+        *  per sample buffer which could overflow between user space reads.
+        */
+        for (int i = 0; i < 32; i++)
+        {
+            if (!(ov_flags & (1ULL << i)))
+                continue;
+
+            if (!pc_histogram_add(core->histogram, pTrapFrame->Pc, i))
+                core->sample_dropped++;
+        }
+
+        KeReleaseSpinLockFromDpcLevel(&core->SampleLock);
+    }
+    else if (core->sample_idx == SAMPLE_CHAIN_BUFFER_SIZE)
     {
 
         KeReleaseSpinLockFromDpcLevel(&core->SampleLock);
@@ -142,29 +158,57 @@ VOID arm64_pmi_ISR(PKTRAP_FRAME pTrapFrame)
     {
         CoreCounterStop();
 
-        core->samples[core->sample_idx].lr = pTrapFrame->Lr;
-        core->samples[core->sample_idx].pc = pTrapFrame->Pc;
-        core->samples[core->sample_idx].ov_flags = ov_flags;
-        core->sample_idx++;
-
-        KeReleaseSpinLockFromDpcLevel(&core->SampleLock);
-
-        /* Here all the GPC indexes are raw indexes and do not need to be mapped. 
+        /* One frame per overflowed counter, so each frame can carry the period its
+        *  counter was loaded with. Periods differ between counters and may change
+        *  between overflows with PMU_CTL_SAMPLE_SET_INTERVAL.
         */
         for (int i = 0; i < 32; i++)
         {
             if (!(ov_flags & (1ULL << i)))
                 continue;
 
-            UINT32 val = 0xFFFFFFFF - core->sample_interval[i];
-
-            if (i == 31)
-                _WriteStatusReg(PMCCNTR_EL0, (__int64)val);
-            else
-                CoreWriteCounter(i, (__int64)val);
+            if (core->sample_idx == SAMPLE_CHAIN_BUFFER_SIZE)
+            {
+                core->sample_dropped++;
+                break;
+            }
+
+            core->samples[core->sample_idx].lr = pTrapFrame->Lr;
+            core->samples[core->sample_idx].pc = pTrapFrame->Pc;
+            core->samples[core->sample_idx].ov_flags = 1ULL << i;
+            core->samples[core->sample_idx].period = core->sample_period[i];
+            core->sample_idx++;
         }
-        CoreCounterStart();
+
+        KeReleaseSpinLockFromDpcLevel(&core->SampleLock);
+    }
+
+    /* Here all the GPC indexes are raw indexes and do not need to be mapped. 
+    */
+    for (int i = 0; i < 32; i++)
+    {
+        if (!(ov_flags & (1ULL << i)))
+            continue;
+
+        core->sample_period[i] = core->sample_interval[i];
+        UINT32 val = 0xFFFFFFFF - core->sample_period[i];
+
+        if (i == 31)
+            _WriteStatusReg(PMCCNTR_EL0, (__int64)val);
+        else
+            CoreWriteCounter(i, (__int64)val);
     }
+    CoreCounterStart();
+}
+
+VOID arm64_pmi_ISR(PKTRAP_FRAME pTrapFrame)
+{
+    LARGE_INTEGER isr_start = KeQueryPerformanceCounter(NULL);
+    ULONG core_idx = KeGetCurrentProcessorNumberEx(NULL);
+    CoreInfo* core = core_info + core_idx;
+
+    arm64_pmi_handle(core, pTrapFrame);
+    overhead_account(&core->isr, isr_start);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////
@@ -217,8 +261,7 @@ VOID free_pmu_resource(VOID)
     {
         CoreInfo* core = &core_info[i];
 
-        KeCancelTimer(&core->timer);
-        core->timer_running = 0;
+        core_timer_free(core);
 
         KeRemoveQueueDpc(&core->dpc_queue);
         KeRemoveQueueDpc(&core->dpc_reset);
@@ -429,11 +472,11 @@ NTSTATUS WindowsPerfDeviceQueryRemove(
     for (ULONG i = 0; i < numCores; i++)
     {
         CoreInfo* core = &core_info[i];
+        core_timer_stop(core);
         KeRemoveQueueDpc(&core->dpc_queue);
         KeRemoveQueueDpc(&core->dpc_reset);
         KeRemoveQueueDpc(&core->dpc_overflow);
         KeRemoveQueueDpc(&core->dpc_multiplex);
-        KeCancelTimer(&core->timer);
     }
 
     /// clear the work item
@@ -455,7 +498,13 @@ void WindowsPerfDeviceIOCleanup(
     free_pmu_resource();
 
     if (core_info)
+    {
+        for (ULONG i = 0; i < numCores; i++)
+            if (core_info[i].histogram)
+                ExFreePoolWithTag(core_info[i].histogram, 'HIST');
+
         ExFreePoolWithTag(core_info, 'CORE');
+    }
 
     if (last_fpc_read)
         ExFreePoolWithTag(last_fpc_read, 'LAST');
@@ -675,6 +724,10 @@ WindowsPerfDeviceCreate(
         // Initialize fields for sampling;
         KeInitializeSpinLock(&core->SampleLock);
 
+        // Counting timer, see core_timer_start()
+        KeInitializeTimer(&core->timer);
+        core->timer_running = CORE_TIMER_NONE;
+
         // Enable  events and counters
         PRKDPC dpc = &core_info[i].dpc_queue;
         KeInitializeDpc(dpc, arm64pmc_enable_default, NULL);
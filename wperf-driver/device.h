@@ -66,6 +66,16 @@ VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
 
 VOID reset_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
 
+struct core_info;
+
+NTSTATUS core_timer_start(struct core_info* core, LONG period, PRKDPC dpc);
+
+VOID core_timer_stop(struct core_info* core);
+
+VOID core_timer_free(struct core_info* core);
+
+VOID core_read_counting_live(struct core_info* core, UINT64* values);
+
 VOID arm64pmc_enable_default(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2);
 
 VOID free_pmu_resource(VOID);
@@ -64,6 +64,7 @@ extern HANDLE pmc_resource_handle;
 extern CoreInfo* core_info;
 extern KEVENT sync_reset_dpc;
 extern UINT8 counter_idx_map[AARCH64_MAX_HWC_SUPP + 1];
+extern OverheadAcc ioctl_overhead;
 static UINT16 armv8_arch_core_events[] =
 {
 #define WPERF_ARMV8_ARCH_EVENTS(n,a,b,c,d) b,
@@ -77,7 +78,8 @@ extern size_t spe_bytesToCopy;
 // must sync with enum pmu_ctl_action
 static VOID(*core_ctl_funcs[3])(VOID) = { CoreCounterStart, CoreCounterStop, CoreCounterReset };
 
-static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, UINT32 core_end, UINT16 core_event_num, UINT16* core_events, UINT64 filter_bits)
+static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, UINT32 core_end, UINT16 core_event_num, UINT16* core_events, UINT64 filter_bits,
+    const UINT8* core_groups, const UINT8* core_weights)
 {
     if ((core_event_num + numFPC) > MAX_MANAGED_CORE_EVENTS)
     {
@@ -93,14 +95,29 @@ static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, U
     {
         CoreInfo* core = &core_info[i];
         core->events_num = core_event_num + numFPC;
-        UINT32 init_num = core_event_num <= numFreeGPC ? core_event_num : numFreeGPC;
         struct pmu_event_pseudo* events = &core->events[0];
 
+        // With multiplexing first round is already scheduled with respect to event groups
+        BOOLEAN multiplex = core_event_num > numFreeGPC;
+        if (multiplex)
+        {
+            if (!mux_init(&core->mux, core_event_num, core_groups, core_weights, numFreeGPC))
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: event group does not fit in %d free GPCs\n", numFreeGPC));
+                return STATUS_INVALID_PARAMETER;
+            }
+            mux_schedule(&core->mux);
+        }
+
         RtlSecureZeroMemory(&events[numFPC], sizeof(struct pmu_event_pseudo) * (MAX_MANAGED_CORE_EVENTS - numFPC));
 
         // Don't clear event_idx and counter_idx, they are fixed.
         events[0].value = 0;
         events[0].scheduled = 0;
+        events[0].time_enabled = 0;
+        events[0].time_running = 0;
+        events[0].slice_sq_lo = 0;
+        events[0].slice_sq_hi = 0;
         events[0].filter_bits = filter_bits;
         events[0].counter_idx = CYCLE_COUNTER_IDX;
 
@@ -111,10 +128,10 @@ static NTSTATUS evt_assign_core(PQUEUE_CONTEXT queueContext, UINT32 core_base, U
             event->event_idx = core_events[j];
             event->filter_bits = filter_bits;
             event->enable_irq = 0;
-            if (j < init_num)
-                event->counter_idx = j;
+            if (multiplex)
+                event->counter_idx = core->mux.event_counter[j] == MUX_NO_COUNTER ? INVALID_COUNTER_IDX : core->mux.event_counter[j];
             else
-                event->counter_idx = INVALID_COUNTER_IDX;
+                event->counter_idx = j;
         }
     }
 
@@ -158,6 +175,10 @@ static NTSTATUS evt_assign_dsu(PQUEUE_CONTEXT queueContext, UINT32 core_base, UI
         events[0].enable_irq = 0;
         events[0].value = 0;
         events[0].scheduled = 0;
+        events[0].time_enabled = 0;
+        events[0].time_running = 0;
+        events[0].slice_sq_lo = 0;
+        events[0].slice_sq_hi = 0;
 
         for (UINT32 j = 0; j < dsu_event_num; j++)
         {
@@ -297,6 +318,10 @@ NTSTATUS deviceControl(
         }
 
 clean_lock_acquire:
+        // New session, IOCTL overhead is counted from here
+        if (out == STS_LOCK_AQUIRED)
+            RtlSecureZeroMemory(&ioctl_overhead, sizeof(ioctl_overhead));
+
         *((enum status_flag*)pOutBuffer) = out;
         *outputSize = sizeof(enum status_flag);
         break;
@@ -365,7 +390,7 @@ clean_lock_acquire:
             break;
         }
 
-        if (!CTRL_FLAG_VALID(ctl_req->flags))
+        if (!CTRL_FLAG_VALID(ctl_req->flags & ~CTL_FLAG_SAMPLE_HISTOGRAM))
         {
             KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid flags  0x%X for action %d\n",
                 ctl_req->flags, action));
@@ -383,10 +408,27 @@ clean_lock_acquire:
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_START\n"));
 
         UINT32 core_idx = ctl_req->cores_idx.cores_no[0];
+        CoreInfo* core = core_info + core_idx;
+
+        // Histogram is allocated once per core and reused by next sampling sessions
+        if ((ctl_req->flags & CTL_FLAG_SAMPLE_HISTOGRAM) && core->histogram == NULL)
+        {
+            core->histogram = (PCHistogram*)ExAllocatePool2(POOL_FLAG_NON_PAGED, sizeof(PCHistogram), 'HIST');
+            if (core->histogram == NULL)
+            {
+                KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "%s:%d - ExAllocatePool2: failed\n", __FUNCTION__, __LINE__));
+                status = STATUS_INSUFFICIENT_RESOURCES;
+                break;
+            }
+        }
 
-        core_info[core_idx].sample_dropped = 0;
-        core_info[core_idx].sample_generated = 0;
-        core_info[core_idx].sample_idx = 0;
+        core->sample_dropped = 0;
+        core->sample_generated = 0;
+        core->sample_idx = 0;
+        RtlSecureZeroMemory(&core->isr, sizeof(core->isr));
+        core->sample_histogram = !!(ctl_req->flags & CTL_FLAG_SAMPLE_HISTOGRAM);
+        if (core->sample_histogram)
+            RtlSecureZeroMemory(core->histogram, sizeof(PCHistogram));
 
         PWORK_ITEM_CTXT context;
         context = WdfObjectGet_WORK_ITEM_CTXT(queueContext->WorkItem);
@@ -508,6 +550,95 @@ clean_lock_acquire:
         KeReleaseSpinLock(&core->SampleLock, oldIrql);
         break;
     }
+    case IOCTL_PMU_CTL_SAMPLE_GET_HISTOGRAM:
+    {
+        struct PMUCtlGetSampleHdr* ctl_req = (struct PMUCtlGetSampleHdr*)pInBuffer;
+        UINT32 core_idx = ctl_req->core_idx;
+        KIRQL oldIrql;
+
+        // Check if current file_object is the owner of the lock
+        if (!IsLockOwner(IoCtlCode, file_object))
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        if (InBufSize != sizeof(struct PMUCtlGetSampleHdr))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for action %d\n", InBufSize, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (core_idx >= numCores || core_info[core_idx].histogram == NULL)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: histogram sampling not started on core %u\n", core_idx));
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        if (sizeof(struct PMUSampleHistogramPayload) > OutBufSize)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "*outputSize > OutBufSize\n"));
+            status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_GET_HISTOGRAM\n"));
+
+        // Only occupied slots are copied, user space gets compacted histogram
+        CoreInfo* core = core_info + core_idx;
+        struct PMUSampleHistogramPayload* out = (struct PMUSampleHistogramPayload*)pOutBuffer;
+        KeAcquireSpinLock(&core->SampleLock, &oldIrql);
+        out->size = pc_histogram_drain(core->histogram, out->payload, PC_HISTOGRAM_SIZE);
+        KeReleaseSpinLock(&core->SampleLock, oldIrql);
+
+        *outputSize = (ULONG)(FIELD_OFFSET(struct PMUSampleHistogramPayload, payload) + sizeof(PCHistogramEntry) * out->size);
+        break;
+    }
+    case IOCTL_PMU_CTL_SAMPLE_SET_INTERVAL:
+    {
+        struct PMUSampleSetIntervalHdr* ctl_req = (struct PMUSampleSetIntervalHdr*)pInBuffer;
+        KIRQL oldIrql;
+
+        // Check if current file_object is the owner of the lock
+        if (!IsLockOwner(IoCtlCode, file_object))
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        if (InBufSize != sizeof(struct PMUSampleSetIntervalHdr))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for action %d\n", InBufSize, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (ctl_req->core_idx >= numCores)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid core_idx %u\n", ctl_req->core_idx));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: PMU_CTL_SAMPLE_SET_INTERVAL\n"));
+
+        /* Counters keep counting, ISR picks up new interval when it reloads the counter
+        *  after its next overflow. Only counters used for sampling can be changed.
+        */
+        CoreInfo* core = core_info + ctl_req->core_idx;
+        KeAcquireSpinLock(&core->SampleLock, &oldIrql);
+        for (int i = 0; i < AARCH64_MAX_HWC_SUPP + numFPC; i++)
+        {
+            if (ctl_req->interval[i] && (core->ov_mask & (1ULL << i)))
+                core->sample_interval[i] = ctl_req->interval[i];
+        }
+        KeReleaseSpinLock(&core->SampleLock, oldIrql);
+
+        *outputSize = 0;
+        break;
+    }
     case IOCTL_PMU_CTL_SAMPLE_SET_SRC:
     {
         // Check if current file_object is the owner of the lock
@@ -539,10 +670,9 @@ clean_lock_acquire:
             SampleSrcDesc* src_desc = &sample_req->sources[i];
             UINT32 event_src = src_desc->event_src;
             UINT32 interval = src_desc->interval;
-            if (event_src == CYCLE_EVENT_IDX)
-                core->sample_interval[31] = interval;
-            else
-                core->sample_interval[counter_idx_map[gpc_num++]] = interval;
+            UINT32 counter_idx = event_src == CYCLE_EVENT_IDX ? 31 : counter_idx_map[gpc_num++];
+            core->sample_interval[counter_idx] = interval;
+            core->sample_period[counter_idx] = interval;
         }
 
         PWORK_ITEM_CTXT context;
@@ -666,11 +796,7 @@ clean_lock_acquire:
             {
                 int i = ctl_req->cores_idx.cores_no[k];
                 CoreInfo* core = &core_info[i];
-                if (core->timer_running)
-                {
-                    KeCancelTimer(&core->timer);
-                    core->timer_running = 0;
-                }
+                core_timer_stop(core);
 
                 core->prof_core = PROF_DISABLED;
                 core->prof_dsu = PROF_DISABLED;
@@ -705,27 +831,27 @@ clean_lock_acquire:
                 if (core->prof_core == PROF_DISABLED && core->prof_dsu == PROF_DISABLED && core->prof_dmc == PROF_DISABLED)
                     continue;
 
-                KeInitializeTimer(&core->timer);
-                core->timer_running = 1;
-
-                const LONGLONG ns100 = -10000; // negative, the expiration time is relative to the current system time
-                LARGE_INTEGER DueTime;
                 LONG Period = PMU_CTL_START_PERIOD;
 
                 if (ctl_req->period >= PMU_CTL_START_PERIOD_MIN
                     && ctl_req->period <= PMU_CTL_START_PERIOD)
                     Period = ctl_req->period;
 
-                DueTime.QuadPart = do_multiplex ? (Period * ns100) : (2 * (LONGLONG)Period * ns100);
+                // Without multiplexing timer only has to read counters before they overflow
                 Period = do_multiplex ? Period : (2 * Period);
 
                 KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d ctl_req->period = %d\n", __FUNCTION__, __LINE__, ctl_req->period));
                 KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d count.period = %d\n", __FUNCTION__, __LINE__, Period));
-                KdPrintEx((DPFLTR_IHVDRIVER_ID,  DPFLTR_INFO_LEVEL, "%s %d DueTime.QuadPart = %lld\n", __FUNCTION__, __LINE__, DueTime.QuadPart));
 
                 PRKDPC dpc = do_multiplex ? &core->dpc_multiplex : &core->dpc_overflow;
                 KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: action PMU_CTL_START calling set timer multiplex %s for loop k  %d core idx %lld\n", do_multiplex? "TRUE":"FALSE", k, core->idx));
-                KeSetTimerEx(&core->timer, DueTime, Period, dpc);
+                NTSTATUS timer_status = core_timer_start(core, Period, dpc);
+                if (timer_status != STATUS_SUCCESS)
+                {
+                    KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: PMU_CTL_START failed to start timer on core %lld\n", core->idx));
+                    status = timer_status;
+                    break;
+                }
             }
         }
         else if (action == PMU_CTL_STOP)
@@ -735,11 +861,7 @@ clean_lock_acquire:
             {
                 int i = ctl_req->cores_idx.cores_no[k];
                 CoreInfo* core = &core_info[i];
-                if (core->timer_running)
-                {
-                    KeCancelTimer(&core->timer);
-                    core->timer_running = 0;
-                }
+                core_timer_stop(core);
             }
         }
         else if (action == PMU_CTL_RESET)
@@ -750,12 +872,17 @@ clean_lock_acquire:
                 int i = ctl_req->cores_idx.cores_no[k];
                 CoreInfo* core = &core_info[i];
                 core->timer_round = 0;
+                RtlSecureZeroMemory(&core->dpc, sizeof(core->dpc));
                 struct pmu_event_pseudo* events = &core->events[0];
                 UINT32 events_num = core->events_num;
                 for (UINT32 j = 0; j < events_num; j++)
                 {
                     events[j].value = 0;
                     events[j].scheduled = 0;
+                    events[j].time_enabled = 0;
+                    events[j].time_running = 0;
+                    events[j].slice_sq_lo = 0;
+                    events[j].slice_sq_hi = 0;
                 }
 
                 struct pmu_event_pseudo* dsu_events = &core->dsu_events[0];
@@ -764,6 +891,10 @@ clean_lock_acquire:
                 {
                     dsu_events[j].value = 0;
                     dsu_events[j].scheduled = 0;
+                    dsu_events[j].time_enabled = 0;
+                    dsu_events[j].time_running = 0;
+                    dsu_events[j].slice_sq_lo = 0;
+                    dsu_events[j].slice_sq_hi = 0;
                 }
                 KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_INFO_LEVEL, "IOCTL: action PMU_CTL_RESET calling insert dpc loop k is %d core index is %lld\n", k, core->idx));
                 KeInsertQueueDpc(&core->dpc_reset, (VOID*)cores_count, NULL); // cores_count has been validated so the DPC will always be called prior to the code below waiting on its completion
@@ -785,6 +916,10 @@ clean_lock_acquire:
                     {
                         events[j].value = 0;
                         events[j].scheduled = 0;
+                        events[j].time_enabled = 0;
+                        events[j].time_running = 0;
+                        events[j].slice_sq_lo = 0;
+                        events[j].slice_sq_hi = 0;
                     }
 
                     events = dmc->clkdiv2_events;
@@ -793,7 +928,14 @@ clean_lock_acquire:
                     {
                         events[j].value = 0;
                         events[j].scheduled = 0;
+                        events[j].time_enabled = 0;
+                        events[j].time_running = 0;
+                        events[j].slice_sq_lo = 0;
+                        events[j].slice_sq_hi = 0;
                     }
+
+                    dmc->round = 0;
+                    dmc->refresh_time = KeQueryPerformanceCounter(NULL).QuadPart;
                 }
             }
         }
@@ -834,6 +976,8 @@ clean_lock_acquire:
         out->id_aa64dfr0_value = id_aa64dfr0_el1_value;
         out->pmbidr_el1_value = pmbidr_el1_value;
         out->pmsidr_el1_value = pmsidr_el1_value;
+        out->period_min = PMU_CTL_START_PERIOD_MIN;
+        out->period_max = PMU_CTL_START_PERIOD;
         RtlCopyMemory(out->counter_idx_map, counter_idx_map, sizeof(counter_idx_map));
 
         {   // Setup HW_CFG capability string for this driver:
@@ -1047,7 +1191,7 @@ clean_lock_acquire:
 
             if (evt_class == EVT_CORE)
             {
-                status = evt_assign_core(queueContext, core_base, core_end, evt_num, raw_evts, filter_bits);
+                status = evt_assign_core(queueContext, core_base, core_end, evt_num, raw_evts, filter_bits, ctl_req->core_groups, ctl_req->core_weights);
                 if (status != STATUS_SUCCESS)
                     break;
             }
@@ -1172,6 +1316,9 @@ clean_lock_acquire:
             core_end = core_idx + 1;
         }
 
+        LARGE_INTEGER freq;
+        KeQueryPerformanceCounter(&freq);
+
         outputSizeReturned = 0;
         for (UINT32 i = core_base; i < core_end; i++)
         {
@@ -1181,6 +1328,11 @@ clean_lock_acquire:
             out->evt_num = events_num;
             out->round = core->timer_round;
 
+            struct overhead_stat dpc;
+            overhead_stat_get(&core->dpc, &dpc, freq.QuadPart);
+            out->dpc_calls = dpc.calls;
+            out->dpc_time_ns = dpc.time_ns;
+
             struct pmu_event_usr* out_events = &out->evts[0];
             struct pmu_event_pseudo* events = core->events;
 
@@ -1191,6 +1343,10 @@ clean_lock_acquire:
                 out_event->event_idx = event->event_idx;
                 out_event->filter_bits = event->filter_bits;
                 out_event->scheduled = event->scheduled;
+                out_event->time_enabled = event->time_enabled;
+                out_event->time_running = event->time_running;
+                out_event->slice_sq_lo = event->slice_sq_lo;
+                out_event->slice_sq_hi = event->slice_sq_hi;
                 out_event->value = event->value;
             }
 
@@ -1205,6 +1361,97 @@ clean_lock_acquire:
         }
         break;
     }
+    case IOCTL_PMU_CTL_READ_COUNTING_LIVE:
+    {
+        struct PMUCtlReadLiveHdr* ctl_req = (struct PMUCtlReadLiveHdr*)pInBuffer;
+        struct PMUReadLiveOut* out = (struct PMUReadLiveOut*)pOutBuffer;
+        KIRQL oldIrql;
+
+        // Check if current file_object is the owner of the lock
+        if (!IsLockOwner(IoCtlCode, file_object))
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        if (InBufSize != sizeof(struct PMUCtlReadLiveHdr))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for action %d\n", InBufSize, action));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (ctl_req->core_idx >= numCores)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid core_idx %u\n", ctl_req->core_idx));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (sizeof(struct PMUReadLiveOut) > OutBufSize)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "*outputSize > OutBufSize\n"));
+            status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        /* PMU registers can be read only on the core itself. Request is handled in the context
+        *  of the calling thread so we read the core we run on. Raising IRQL keeps us on this
+        *  core and stops counting DPC from updating values in the middle of the read. Caller
+        *  compares returned core_idx with the one it asked for to detect migration.
+        */
+        oldIrql = KeRaiseIrqlToDpcLevel();
+        ULONG core_idx = KeGetCurrentProcessorNumberEx(NULL);
+        CoreInfo* core = core_info + core_idx;
+        out->core_idx = core_idx;
+        out->evt_num = core->events_num;
+        core_read_counting_live(core, out->value);
+        KeLowerIrql(oldIrql);
+
+        *outputSize = sizeof(struct PMUReadLiveOut);
+        break;
+    }
+    case IOCTL_PMU_CTL_QUERY_OVERHEAD:
+    {
+        // Check if current file_object is the owner of the lock
+        if (!IsLockOwner(IoCtlCode, file_object))
+        {
+            status = STATUS_INVALID_DEVICE_STATE;
+            break;
+        }
+
+        if (InBufSize != sizeof(enum pmu_ctl_action))
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "IOCTL: invalid inputsize %ld for PMU_CTL_QUERY_OVERHEAD\n", InBufSize));
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (sizeof(OverheadOut) > OutBufSize)
+        {
+            KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "*outputSize > OutBufSize\n"));
+            status = STATUS_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        LARGE_INTEGER freq;
+        KeQueryPerformanceCounter(&freq);
+
+        OverheadOut* out = (OverheadOut*)pOutBuffer;
+        RtlSecureZeroMemory(out, sizeof(OverheadOut));
+        out->core_num = numCores < MAX_PMU_CTL_CORES_COUNT ? numCores : MAX_PMU_CTL_CORES_COUNT;
+
+        // This IOCTL itself is not accounted yet, see WindowsPerfEvtDeviceControl()
+        overhead_stat_get(&ioctl_overhead, &out->ioctl, freq.QuadPart);
+        for (UINT32 i = 0; i < out->core_num; i++)
+        {
+            overhead_stat_get(&core_info[i].dpc, &out->dpc[i], freq.QuadPart);
+            overhead_stat_get(&core_info[i].isr, &out->isr[i], freq.QuadPart);
+        }
+
+        *outputSize = sizeof(OverheadOut);
+        break;
+    }
     case IOCTL_DSU_CTL_INIT:
     {
         // Check if current file_object is the owner of the lock
@@ -1327,6 +1574,10 @@ clean_lock_acquire:
                 struct pmu_event_usr* out_event = out_events + j;
                 out_event->event_idx = event->event_idx;
                 out_event->scheduled = event->scheduled;
+                out_event->time_enabled = event->time_enabled;
+                out_event->time_running = event->time_running;
+                out_event->slice_sq_lo = event->slice_sq_lo;
+                out_event->slice_sq_hi = event->slice_sq_hi;
                 out_event->value = event->value;
             }
 
@@ -1389,6 +1640,8 @@ clean_lock_acquire:
                 dmc_array.dmcs[i].iomem_len = iomem_len;
                 dmc_array.dmcs[i].clk_events_num = 0;
                 dmc_array.dmcs[i].clkdiv2_events_num = 0;
+                dmc_array.dmcs[i].round = 0;
+                dmc_array.dmcs[i].refresh_time = 0;
             }
             if (status != STATUS_SUCCESS)
                 break;
@@ -1465,6 +1718,9 @@ clean_lock_acquire:
             dmc_ch_end = dmc_idx + 1;
         }
 
+        LARGE_INTEGER freq;
+        LARGE_INTEGER now = KeQueryPerformanceCounter(&freq);
+
         outputSizeReturned = 0;
 
         for (UINT8 i = dmc_ch_base; i < dmc_ch_end; i++)
@@ -1475,6 +1731,9 @@ clean_lock_acquire:
             UINT8 clkdiv2_events_num = dmc->clkdiv2_events_num;
             out->clk_events_num = clk_events_num;
             out->clkdiv2_events_num = clkdiv2_events_num;
+            out->round = dmc->round;
+            out->refresh_time_ns = ticks_to_ns((UINT64)dmc->refresh_time, freq.QuadPart);
+            out->read_time_ns = ticks_to_ns((UINT64)now.QuadPart, freq.QuadPart);
 
             struct pmu_event_usr* to_events = out->clk_events;
             struct pmu_event_pseudo* from_events = dmc->clk_events;
@@ -1484,6 +1743,10 @@ clean_lock_acquire:
                 struct pmu_event_usr* to_event = to_events + j;
                 to_event->event_idx = from_event->event_idx;
                 to_event->scheduled = from_event->scheduled;
+                to_event->time_enabled = from_event->time_enabled;
+                to_event->time_running = from_event->time_running;
+                to_event->slice_sq_lo = from_event->slice_sq_lo;
+                to_event->slice_sq_hi = from_event->slice_sq_hi;
                 to_event->value = from_event->value;
             }
 
@@ -1495,6 +1758,10 @@ clean_lock_acquire:
                 struct pmu_event_usr* to_event = to_events + j;
                 to_event->event_idx = from_event->event_idx;
                 to_event->scheduled = from_event->scheduled;
+                to_event->time_enabled = from_event->time_enabled;
+                to_event->time_running = from_event->time_running;
+                to_event->slice_sq_lo = from_event->slice_sq_lo;
+                to_event->slice_sq_hi = from_event->slice_sq_hi;
                 to_event->value = from_event->value;
             }
 
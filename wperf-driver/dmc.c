@@ -120,9 +120,14 @@ VOID UpdateDmcCounting(UINT8 dmc_ch, struct dmcs_desc *dmc_array)
 
     DmcChannelIterator(ch_base, ch_end, DmcCounterStop, dmc_array);
 
+    LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+
     for (UINT8 ch_idx = ch_base; ch_idx < ch_end; ch_idx++)
     {
         struct dmc_desc* dmc = dmc_array->dmcs + ch_idx;
+        dmc->round++;
+        dmc->refresh_time = now.QuadPart;
+
         struct pmu_event_pseudo* events = dmc->clk_events;
         for (UINT8 i = 0; i < dmc->clk_events_num; i++)
         {
@@ -70,6 +70,8 @@ struct dmc_desc
     struct pmu_event_pseudo clkdiv2_events[MAX_MANAGED_DMC_CLKDIV2_EVENTS];
     UINT8 clk_events_num;
     UINT8 clkdiv2_events_num;
+    UINT64 round;                   // Counter refreshes since PMU_CTL_RESET
+    UINT64 refresh_time;            // KeQueryPerformanceCounter() ticks of the last refresh (or reset)
 };
 
 struct dmcs_desc
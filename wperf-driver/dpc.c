@@ -90,36 +90,157 @@ static UINT64 get_fixed_counter_value(UINT64 core_idx)
     return delta;
 }
 
-static UINT64 event_get_counting(struct pmu_event_kernel* event, UINT64 core_idx)
+// Time accounting of one timer slice, similar to Linux perf time_enabled/time_running.
+// Time is measured in cycles of the fixed counter between two reads of the slice. In
+// PROF_NORMAL all counters keep running, so the fixed counter and event deltas cover the
+// same interval, up to the few cycles between their reads. In PROF_MULTIPLEX counters are
+// stopped while being read and reprogrammed, and the fixed counter stops with them, so
+// the slice covers exactly the time the event could count. Sum of squared per-slice
+// counts is kept in 128 bits and lets user space estimate scaling error.
+static VOID account_slice(struct pmu_event_pseudo* event, UINT64 count, UINT64 cycles, BOOLEAN counting)
 {
-    UINT32 event_idx = event->event_idx;
+    event->time_enabled += cycles;
+    if (!counting)
+        return;
 
-    if (event_idx == CYCLE_EVENT_IDX)
-    {
-        return get_fixed_counter_value(core_idx);
-    }
+    UINT64 sq_lo = count * count;
+    event->time_running += cycles;
+    event->slice_sq_hi += __umulh(count, count);
+    event->slice_sq_lo += sq_lo;
+    if (event->slice_sq_lo < sq_lo)
+        event->slice_sq_hi += 1;
+}
 
-    return core_read_counter_helper(event->counter_idx);
+// In PROF_NORMAL counters keep running and each tick accumulates the delta from the raw
+// value read on the previous tick. `mask` handles wrap of 32-bit counters, as long as a
+// counter does not count over its whole range within one tick (same limit as before when
+// counters were reset every tick, see `Period` of PMU_CTL_START).
+static UINT64 core_counter_delta(CoreInfo* core, UINT32 counter_idx, UINT64 mask)
+{
+    UINT64 curr = core_read_counter_helper(counter_idx);
+    UINT64 delta = (curr - core->counter_last[counter_idx]) & mask;
+
+    core->counter_last[counter_idx] = curr;
+    return delta;
 }
 
+// Must follow every CoreCounterReset() of counters the counting DPC reads.
+static VOID core_counter_last_clear(CoreInfo* core)
+{
+    RtlZeroMemory(core->counter_last, sizeof(core->counter_last));
+}
+
+// Counters are not stopped here: stopping and resetting them on every tick left a blind
+// window each period on every core. Only multiplexing, which reprograms counters, stops them.
 static VOID update_core_counting(CoreInfo* core)
 {
     UINT32 events_num = core->events_num;
     struct pmu_event_pseudo* events = core->events;
-    CoreCounterStop();
+    UINT64 mask = CoreCounterWidthMask();
+
+    UINT64 cycles = get_fixed_counter_value(core->idx);
 
     for (UINT32 i = 0; i < events_num; i++)
     {
-        events[i].value += event_get_counting((struct pmu_event_kernel*)&events[i], core->idx);       
+        UINT64 count = events[i].event_idx == CYCLE_EVENT_IDX ? cycles : core_counter_delta(core, events[i].counter_idx, mask);
+        events[i].value += count;
         events[i].scheduled += 1;
+        account_slice(&events[i], count, cycles, TRUE);
 #if defined(ENABLE_ETW_TRACING)
         EventWriteReadGPC(NULL, core->idx, events[i].event_idx, events[i].counter_idx, events[i].value);
 #endif
     }
+}
 
-    update_last_fixed_counter(core->idx);
-    CoreCounterReset();
-    CoreCounterStart();
+// Counter values of the core right now: value accumulated by the counting DPC plus what
+// hardware counted since its last tick. Counting is not disturbed, see PMU_CTL_READ_COUNTING_LIVE.
+// Must be called on the core itself at DISPATCH_LEVEL so the counting DPC can't run in between.
+VOID core_read_counting_live(CoreInfo* core, UINT64* values)
+{
+    UINT64 curr = _ReadStatusReg(PMCCNTR_EL0);
+    UINT64 cycles = curr < last_fpc_read[core->idx] ? 0 : curr - last_fpc_read[core->idx];
+    UINT64 mask = CoreCounterWidthMask();
+
+    for (UINT32 i = 0; i < core->events_num; i++)
+    {
+        struct pmu_event_pseudo* event = core->events + i;
+        UINT64 live = 0;
+
+        // Events not scheduled on a counter (multiplexing) have only the accumulated value
+        if (core->timer_running)
+        {
+            if (event->event_idx == CYCLE_EVENT_IDX)
+                live = cycles;
+            else if (event->counter_idx != INVALID_COUNTER_IDX)
+                live = (core_read_counter_helper(event->counter_idx) - core->counter_last[event->counter_idx]) & mask;
+        }
+
+        values[i] = event->value + live;
+    }
+}
+
+// High resolution timer may expire on any core, counting has to be done on the core itself.
+static VOID hr_timer_callback(PEX_TIMER timer, PVOID ctx)
+{
+    UNREFERENCED_PARAMETER(timer);
+
+    CoreInfo* core = (CoreInfo*)ctx;
+    KeInsertQueueDpc(core->timer_dpc, NULL, NULL);
+}
+
+// Start periodic counting timer which queues DPC every PERIOD microseconds. KTIMER expires
+// only on system clock ticks (~15.6 ms, 1 ms at best) so shorter periods need high
+// resolution timer.
+NTSTATUS core_timer_start(CoreInfo* core, LONG period, PRKDPC dpc)
+{
+    const LONGLONG us100ns = -10; // negative, the expiration time is relative to the current system time
+    LARGE_INTEGER DueTime;
+    DueTime.QuadPart = period * us100ns;
+
+    core_timer_stop(core);
+
+    if (period < PMU_CTL_START_PERIOD_HIRES)
+    {
+        if (core->hr_timer == NULL)
+        {
+            core->hr_timer = ExAllocateTimer(hr_timer_callback, core, EX_TIMER_HIGH_RESOLUTION);
+            if (core->hr_timer == NULL)
+                return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        core->timer_dpc = dpc;
+        ExSetTimer(core->hr_timer, DueTime.QuadPart, (LONGLONG)period * 10, NULL);
+    }
+    else
+    {
+        // `timer` is initialized once with the core, see device.c
+        KeSetTimerEx(&core->timer, DueTime, period / 1000, dpc);
+    }
+
+    core->timer_running = period < PMU_CTL_START_PERIOD_HIRES ? CORE_TIMER_HIRES : CORE_TIMER_KTIMER;
+    return STATUS_SUCCESS;
+}
+
+// Only the timer which was set is cancelled, the other one may have never been initialized.
+VOID core_timer_stop(CoreInfo* core)
+{
+    if (core->timer_running == CORE_TIMER_HIRES)
+        ExCancelTimer(core->hr_timer, NULL);
+    else if (core->timer_running == CORE_TIMER_KTIMER)
+        KeCancelTimer(&core->timer);
+
+    core->timer_running = CORE_TIMER_NONE;
+}
+
+VOID core_timer_free(CoreInfo* core)
+{
+    core_timer_stop(core);
+
+    if (core->hr_timer)
+    {
+        ExDeleteTimer(core->hr_timer, TRUE, TRUE, NULL);
+        core->hr_timer = NULL;
+    }
 }
 
 VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
@@ -140,6 +261,7 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
     CoreInfo* core = (CoreInfo*)ctx;
     UINT64 round = core->timer_round;
     UINT64 new_round = round + 1;
+    LARGE_INTEGER dpc_start = KeQueryPerformanceCounter(NULL);
 
     if (core->prof_core == PROF_NORMAL)
     {
@@ -150,34 +272,54 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         struct pmu_event_pseudo* events = core->events;
         UINT32 events_num = core->events_num;
 
-        UINT32 event_start_idx1 = (numFreeGPC * round) % (events_num - numFPC);
-        UINT32 event_start_idx2 = (numFreeGPC * new_round) % (events_num - numFPC);
-
         CoreCounterStop();
 
         //Only one FPC, cycle counter
         //We will improve the logic handling FPC later
-        events[0].value += get_fixed_counter_value(core->idx); //_ReadStatusReg(PMCCNTR_EL0);
+        UINT64 cycles = get_fixed_counter_value(core->idx);
+        events[0].value += cycles;
         events[0].scheduled += 1;
+        account_slice(&events[0], cycles, cycles, TRUE);
 
-        for (UINT32 i = 0; i < numFreeGPC; i++)
+        for (UINT32 i = numFPC; i < events_num; i++)
         {
-            UINT32 adjusted_idx = (event_start_idx1 + i) % (events_num - numFPC);
-            events[adjusted_idx + numFPC].value += core_read_counter_helper(i);
-            events[adjusted_idx + numFPC].scheduled += 1;
+            if (events[i].counter_idx == INVALID_COUNTER_IDX)
+            {
+                account_slice(&events[i], 0, cycles, FALSE);
+                continue;
+            }
+
+            UINT64 count = core_read_counter_helper(events[i].counter_idx);
+            events[i].value += count;
+            events[i].scheduled += 1;
+            account_slice(&events[i], count, cycles, TRUE);
         }
 
         update_last_fixed_counter(core->idx);
         CoreCounterReset();
+        core_counter_last_clear(core);
 
-        for (UINT32 i = 0; i < numFreeGPC; i++)
+        /* Event groups are scheduled as a whole, see mux_scheduler.h. Events which
+        *  stay scheduled keep their counters and are not reprogrammed.
+        */
+        mux_schedule(&core->mux);
+
+        for (UINT32 i = numFPC; i < events_num; i++)
         {
-            UINT32 adjusted_idx = (event_start_idx2 + i) % (events_num - numFPC);
+            UINT8 counter = core->mux.event_counter[i - numFPC];
+            UINT32 counter_idx = counter == MUX_NO_COUNTER ? INVALID_COUNTER_IDX : counter;
+
+            if (counter_idx == events[i].counter_idx)
+                continue;
+
+            events[i].counter_idx = counter_idx;
+            if (counter_idx == INVALID_COUNTER_IDX)
+                continue;
 
             struct pmu_event_kernel event;
-            event.event_idx = events[adjusted_idx + numFPC].event_idx;
-            event.filter_bits = events[adjusted_idx + numFPC].filter_bits;
-            event.counter_idx = i;
+            event.event_idx = events[i].event_idx;
+            event.filter_bits = events[i].filter_bits;
+            event.counter_idx = counter_idx;
             event.enable_irq = 0;
             event_enable(&event);
         }
@@ -230,6 +372,7 @@ VOID multiplex_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         UpdateDmcCounting(core->dmc_ch, &dmc_array);
 
     core->timer_round = new_round;
+    overhead_account(&core->dpc, dpc_start);
 }
 
 // When there is no event multiplexing, we still need to use multiplexing-like timer for
@@ -250,6 +393,8 @@ VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         return;
 
     CoreInfo* core = (CoreInfo*)ctx;
+    LARGE_INTEGER dpc_start = KeQueryPerformanceCounter(NULL);
+
     if (core->prof_core != PROF_DISABLED)
         update_core_counting(core);
 
@@ -260,6 +405,7 @@ VOID overflow_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
         UpdateDmcCounting(core->dmc_ch, &dmc_array);
 
     core->timer_round++;
+    overhead_account(&core->dpc, dpc_start);
 }
 
 VOID reset_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
@@ -280,6 +426,7 @@ VOID reset_dpc(struct _KDPC* dpc, PVOID ctx, PVOID sys_arg1, PVOID sys_arg2)
     CoreCounterStop();
     update_last_fixed_counter(core->idx);
     CoreCounterReset();
+    core_counter_last_clear(core);
 
     ULONG_PTR cores_count = (ULONG_PTR)sys_arg1;
 
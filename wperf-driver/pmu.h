@@ -46,6 +46,10 @@ struct pmu_event_pseudo
     UINT32 enable_irq;
     UINT64 value;
     UINT64 scheduled;
+    UINT64 time_enabled;    // Cycles event was enabled, with or without a counter
+    UINT64 time_running;    // Cycles event was counting on hardware counter
+    UINT64 slice_sq_lo;     // 128-bit sum of squared per-slice counts (for scaling error)
+    UINT64 slice_sq_hi;
 };
 
 struct pmu_event_kernel
@@ -35,6 +35,8 @@
 #endif
 #include "device.h"
 #include "spe.h"
+#include "coreinfo.h"
+#include "utilities.h"
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (PAGE, WindowsPerfQueueInitialize)
@@ -43,6 +45,8 @@
 VOID EvtWorkItemFunc(WDFWORKITEM WorkItem);
 VOID SPEWorkItemFunc(WDFWORKITEM WorkItem);
 
+OverheadAcc ioctl_overhead;     // Time spent in deviceControl() since PMU_CTL_LOCK_ACQUIRE, see PMU_CTL_QUERY_OVERHEAD
+
 NTSTATUS
 WindowsPerfQueueInitialize(
     WDFDEVICE Device
@@ -319,7 +323,9 @@ WindowsPerfEvtDeviceControl(
     queueContext->CurrentRequest = Request;
 
     ULONG outputDataSize;
+    LARGE_INTEGER ioctl_start = KeQueryPerformanceCounter(NULL);
     Status = deviceControl(file_object, IoControlCode, queueContext->inBuffer, (ULONG)InputBufferLength, queueContext->outBuffer, (ULONG)OutputBufferLength, &outputDataSize, queueContext);
+    overhead_account(&ioctl_overhead, ioctl_start);
     if (!NT_SUCCESS(Status)) {
         KdPrintEx((DPFLTR_IHVDRIVER_ID, DPFLTR_ERROR_LEVEL, "%s %d deviceControl failed 0x%x\n", __FUNCTION__, __LINE__, Status));
         queueContext->CurrentRequest = NULL;
@@ -35,6 +35,7 @@
 #include "utilities.tmh"
 #endif
 #include "sysregs.h"
+#include "coreinfo.h"
 
 extern UINT64* last_fpc_read;
 extern UINT8   counter_idx_map[AARCH64_MAX_HWC_SUPP + 1];
@@ -44,6 +45,30 @@ void update_last_fixed_counter(UINT64 core_idx)
 {
     last_fpc_read[core_idx] = _ReadStatusReg(PMCCNTR_EL0);
 }
+
+// Account one call of a code path which started at `start`, see PMU_CTL_QUERY_OVERHEAD.
+// Only the core (or the sequential IOCTL queue) owning `acc` updates it, so no locking.
+VOID overhead_account(struct overhead_acc* acc, LARGE_INTEGER start)
+{
+    UINT64 time = (UINT64)(KeQueryPerformanceCounter(NULL).QuadPart - start.QuadPart);
+
+    acc->calls++;
+    acc->time += time;
+    if (time > acc->time_max)
+        acc->time_max = time;
+}
+
+UINT64 ticks_to_ns(UINT64 ticks, LONGLONG freq)
+{
+    return (ticks / freq) * 1000000000ULL + (ticks % freq) * 1000000000ULL / freq;
+}
+
+VOID overhead_stat_get(const struct overhead_acc* acc, struct overhead_stat* stat, LONGLONG freq)
+{
+    stat->calls = acc->calls;
+    stat->time_ns = ticks_to_ns(acc->time, freq);
+    stat->max_ns = ticks_to_ns(acc->time_max, freq);
+}
 extern LOCK_STATUS   current_status;
 
 static PCHAR DbgStatusStr(NTSTATUS status)
@@ -97,6 +122,10 @@ static PCHAR GetIoctlStr(ULONG ioctl)
     case IOCTL_PMU_CTL_SAMPLE_START:        return "IOCTL_PMU_CTL_SAMPLE_START";
     case IOCTL_PMU_CTL_SAMPLE_STOP:         return "IOCTL_PMU_CTL_SAMPLE_STOP";
     case IOCTL_PMU_CTL_SAMPLE_GET:          return "IOCTL_PMU_CTL_SAMPLE_GET";
+    case IOCTL_PMU_CTL_SAMPLE_GET_HISTOGRAM: return "IOCTL_PMU_CTL_SAMPLE_GET_HISTOGRAM";
+    case IOCTL_PMU_CTL_SAMPLE_SET_INTERVAL: return "IOCTL_PMU_CTL_SAMPLE_SET_INTERVAL";
+    case IOCTL_PMU_CTL_READ_COUNTING_LIVE:  return "IOCTL_PMU_CTL_READ_COUNTING_LIVE";
+    case IOCTL_PMU_CTL_QUERY_OVERHEAD:      return "IOCTL_PMU_CTL_QUERY_OVERHEAD";
     case IOCTL_PMU_CTL_LOCK_ACQUIRE:        return "IOCTL_PMU_CTL_LOCK_ACQUIRE";
     case IOCTL_PMU_CTL_LOCK_RELEASE:        return "IOCTL_PMU_CTL_LOCK_RELEASE";
     default:                                return "unknown IOCTL!";
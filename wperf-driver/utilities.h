@@ -29,6 +29,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 VOID update_last_fixed_counter(UINT64 core_idx);
+VOID overhead_account(struct overhead_acc* acc, LARGE_INTEGER start);
+UINT64 ticks_to_ns(UINT64 ticks, LONGLONG freq);
+VOID overhead_stat_get(const struct overhead_acc* acc, struct overhead_stat* stat, LONGLONG freq);
 VOID AcquireLockForce(ULONG ioctl, WDFFILEOBJECT file_object);
 BOOLEAN AcquireLock(ULONG ioctl, WDFFILEOBJECT file_object);
 BOOLEAN IsLockOwner(ULONG ioctl, WDFFILEOBJECT file_object);
@@ -144,10 +144,13 @@ VOID EvtWorkItemFunc(WDFWORKITEM WorkItem)
             CoreInfo* core = &core_info[i];
             UINT32 init_num = context->event_num <= numFreeGPC ? context->event_num : numFreeGPC;
             struct pmu_event_pseudo* events = &core->events[0];
-            for (UINT32 j = 0; j < init_num; j++)
+            for (UINT32 j = 0; j < context->event_num; j++)
             {
                 struct pmu_event_kernel* event = (struct pmu_event_kernel*)&events[numFPC + j];
-                func(event);
+
+                // Core events scheduled for the first round are picked by evt_assign_core()
+                if (context->isDSU ? j < init_num : event->counter_idx != INVALID_COUNTER_IDX)
+                    func(event);
             }
             KeRevertToUserGroupAffinityThread(&old_affinity);
         }
@@ -32,15 +32,22 @@
 #include "wperf-lib.h"
 #include "config.h"
 #include "exception.h"
+#include "multiplex_scaling.h"
+#include "output.h"
 #include "padding.h"
 #include "parsers.h"
 #include "pe_file.h"
 #include "pmu_device.h"
 #include "process_api.h"
+#include "region_profiler.h"
 #include "timeline.h"
+#include "utils.h"
 #include "wperf-common/gitver.h"
 #include "wperf-common/public.h"
 #include "perfdata.h"
+#include <atomic>
+#include <mutex>
+#include <numeric>
 #include <regex>
 
 typedef struct _COUNTING_INFO
@@ -68,6 +75,42 @@ typedef struct _SAMPLE_ANNOTATE_INFO
     uint64_t hits;
 } SAMPLE_ANNOTATE_INFO, *PSAMPLE_ANNOTATE_INFO;
 
+typedef struct _SESSION_COUNTING
+{
+    uint64_t value;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t scheduled;
+    uint64_t round;
+} SESSION_COUNTING;
+
+// Counting session, see wperf_session_open(). All sessions share __pmu_device
+// but each one counts on its own set of cores.
+struct _WPERF_SESSION
+{
+    std::vector<uint8_t> cores;
+    std::map<enum evt_class, std::vector<struct evt_noted>> ioctl_events;
+    std::vector<UINT32> evt_slots;                      // Indices of reported (not padding) events in ReadOut::evts
+    std::vector<EVENT_NOTE> evt_notes;                  // Notes of reported events
+    std::map<uint8_t, std::vector<SESSION_COUNTING>> last_delta;   // Values at previous SNAPSHOT_DELTA read
+    bool kernel_mode = false;
+    long period = 0;
+    bool configured = false;
+    bool started = false;
+};
+
+// Code region instrumentation, see wperf_region_init(). Guarded by __sessions_lock. Data
+// of each thread is kept in __region_threads, see region_thread().
+struct REGION_PROFILING
+{
+    bool configured = false;
+    bool kernel_mode = false;
+    size_t num_values = 0;                                  // Cycles and configured events
+    std::vector<uint16_t> events;                           // Event IDs of values
+    std::vector<std::wstring> names;                        // Region ID -> name
+    RegionCalibration calibration;
+};
+
 static pmu_device* __pmu_device = nullptr;
 static struct pmu_device_cfg* __pmu_cfg = nullptr;
 static std::map<enum evt_class, std::vector<uint16_t>> __list_events;
@@ -81,6 +124,11 @@ static std::map<uint16_t, std::vector<SAMPLING_INFO>> __samples;
 static std::map<uint16_t, std::vector<SAMPLE_ANNOTATE_INFO>> __annotate_samples;
 static size_t __annotate_sample_event_index = 0;
 static size_t __annotate_sample_index = 0;
+static std::set<WPERF_SESSION> __sessions;
+static std::mutex __sessions_lock;      // Sessions can be used from many threads, __pmu_device can't
+static REGION_PROFILING __regions;
+static RegionThreads __region_threads;                      // Data of every thread which used regions, guarded by __sessions_lock
+static thread_local RegionThreadSlot __region_thread;
 
 extern "C" bool wperf_init()
 {
@@ -107,6 +155,22 @@ extern "C" bool wperf_close()
 {
     try
     {
+        wperf_region_close();
+
+        {
+            std::lock_guard<std::mutex> lock(__sessions_lock);
+            for (WPERF_SESSION session : __sessions)
+            {
+                if (session->started && __pmu_device)
+                {
+                    __pmu_device->set_cores_idx(session->cores);
+                    __pmu_device->stop(CTL_FLAG_CORE);
+                }
+                delete session;
+            }
+            __sessions.clear();
+        }
+
         if (__pmu_device)
             delete __pmu_device;
 
@@ -371,6 +435,95 @@ extern "C" bool wperf_list_num_metrics_events(PLIST_CONF list_conf, int *num_met
     return true;
 }
 
+// Build list of events to assign to cores (with padding) from requested events, groups of events and metrics.
+static bool stat_ioctl_events(int num_events, const uint16_t* events_in, const GROUP_EVENT_INFO& group_events,
+                              int num_metrics, const wchar_t** metric_events,
+                              std::map<enum evt_class, std::vector<struct evt_noted>>& ioctl_events)
+{
+    // Process normal events.
+    std::map<enum evt_class, std::deque<struct evt_noted>> events;
+    for (int i = 0; i < num_events; i++)
+    {
+        events[EVT_CORE].push_back({ events_in[i], EVT_NORMAL, L"e" });
+    }
+
+    // Process groups.
+    std::map<enum evt_class, std::vector<struct evt_noted>> groups;
+    for (int i = 0; i < group_events.num_groups; i++)
+    {
+        groups[EVT_CORE].push_back({ (uint16_t)group_events.num_group_events[i], EVT_HDR, L"" });
+        for (int j = 0; j < group_events.num_group_events[i]; j++)
+        {
+            groups[EVT_CORE].push_back({ group_events.events[i][j], EVT_GROUPED, L"" });
+        }
+    }
+
+    // Process metrics.
+    std::map<std::wstring, metric_desc>& metrics = __pmu_device->builtin_metrics;
+    for (int i = 0; i < num_metrics; i++)
+    {
+        const wchar_t* metric = metric_events[i];
+        if (metrics.find(metric) == metrics.end())
+        {
+            // Not a valid builtin metric.
+            return false;
+        }
+
+        metric_desc desc = metrics[metric];
+        for (const auto& x : desc.events)
+            events[x.first].insert(events[x.first].end(), x.second.begin(), x.second.end());
+        for (const auto& y : desc.groups)
+            groups[y.first].insert(groups[y.first].end(), y.second.begin(), y.second.end());
+    }
+
+    set_event_padding(ioctl_events, *__pmu_cfg, events, groups);
+    return true;
+}
+
+// Translate note of an event built by stat_ioctl_events() to EVENT_NOTE.
+static bool stat_evt_note(const std::wstring& note, EVENT_NOTE& evt_note)
+{
+    std::wsmatch m;
+    if (note == L"e")
+    {
+        // This is a NORMAL_EVT_NOTE.
+        evt_note.type = NORMAL_EVT_NOTE;
+    }
+    else if (std::regex_match(note, m, std::wregex(L"g([0-9]+),([a-z0-9_]+)")))
+    {
+        // This is a METRIC_EVT_NOTE.
+        std::map<std::wstring, metric_desc>& metrics = __pmu_device->builtin_metrics;
+        auto it = metrics.find(m[2]);
+        if (it == metrics.end())
+        {
+            // Not a valide builtin metric.
+            return false;
+        }
+        evt_note.type = METRIC_EVT_NOTE;
+        evt_note.note.metric_note.group_id = std::stoi(m[1]);
+        evt_note.note.metric_note.name = it->first.c_str();
+    }
+    else if (std::regex_match(note, m, std::wregex(L"g([0-9]+)")))
+    {
+        // This is a GROUP_EVT_NOTE.
+        evt_note.type = GROUP_EVT_NOTE;
+        evt_note.note.group_note.group_id = std::stoi(m[1]);
+    }
+    else
+    {
+        // Not a valid event note type.
+        return false;
+    }
+    return true;
+}
+
+// wperf_stat() and wperf_sample() reprogram and reset counters of the cores they use,
+// they can't run while sessions or regions own the device. Called with __sessions_lock held.
+static bool exclusive_device()
+{
+    return __sessions.empty() && !__regions.configured;
+}
+
 extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
 {
     if (!stat_conf || !__pmu_device || !__pmu_cfg)
@@ -389,6 +542,10 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
 
     try
     {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+        if (!exclusive_device())
+            return false;
+
         if (!stat_info)
         {
             __ioctl_events.clear();
@@ -412,43 +569,9 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
             uint32_t stop_bits = __pmu_device->stop_bits();
             __pmu_device->stop(stop_bits);
 
-            // Process events from stat_conf.
-            std::map<enum evt_class, std::deque<struct evt_noted>> events;
-            for (int i = 0; i < stat_conf->num_events; i++)
-            {
-                events[EVT_CORE].push_back({ stat_conf->events[i], EVT_NORMAL, L"e" });
-            }
-
-            // Process groups from stat_conf.
-            std::map<enum evt_class, std::vector<struct evt_noted>> groups;
-            for (int i = 0; i < stat_conf->group_events.num_groups; i++)
-            {
-                groups[EVT_CORE].push_back({ (uint16_t)stat_conf->group_events.num_group_events[i], EVT_HDR, L"" });
-                for (int j = 0; j < stat_conf->group_events.num_group_events[i]; j++)
-                {
-                    groups[EVT_CORE].push_back({ stat_conf->group_events.events[i][j], EVT_GROUPED, L"" });
-                }
-            }
-
-            // Process metrics from stat_conf.
-            std::map<std::wstring, metric_desc>& metrics = __pmu_device->builtin_metrics;
-            for (int i = 0; i < stat_conf->num_metrics; i++)
-            {
-                const wchar_t* metric = stat_conf->metric_events[i];
-                if (metrics.find(metric) == metrics.end())
-                {
-                    // Not a valid builtin metric.
-                    return false;
-                }
-
-                metric_desc desc = metrics[metric];
-                for (const auto& x : desc.events)
-                    events[x.first].insert(events[x.first].end(), x.second.begin(), x.second.end());
-                for (const auto& y : desc.groups)
-                    groups[y.first].insert(groups[y.first].end(), y.second.begin(), y.second.end());
-            }
-
-            set_event_padding(__ioctl_events, *__pmu_cfg, events, groups);
+            if (!stat_ioctl_events(stat_conf->num_events, stat_conf->events, stat_conf->group_events,
+                                   stat_conf->num_metrics, stat_conf->metric_events, __ioctl_events))
+                return false;
 
             bool do_kernel = stat_conf->kernel_mode;
             __pmu_device->timeline_params(__ioctl_events, stat_conf->counting_interval, do_kernel);
@@ -464,7 +587,7 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
             int64_t counting_interval_iter = count_interval > 0 ?
                 static_cast<int64_t>(count_interval * 2) : 0;
 
-            drvconfig::set(L"count.period", std::to_wstring(stat_conf->period));
+            drvconfig::set(L"count.period", std::to_wstring(stat_conf->period) + L"ms");
 
             int counting_timeline_times = stat_conf->count_timeline;
 
@@ -539,44 +662,16 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
                             {
                                 counting_info.evt_note.type = NORMAL_EVT_NOTE;
                             }
-                            else
+                            else if (!stat_evt_note(__ioctl_events[EVT_CORE][j - 1].note, counting_info.evt_note))
                             {
-                                std::wstring note = __ioctl_events[EVT_CORE][j - 1].note;
-                                std::wsmatch m;
-                                if (note == L"e")
-                                {
-                                    // This is a NORMAL_EVT_NOTE.
-                                    counting_info.evt_note.type = NORMAL_EVT_NOTE;
-                                }
-                                else if (std::regex_match(note, m, std::wregex(L"g([0-9]+),([a-z0-9_]+)")))
-                                {
-                                    // This is a METRIC_EVT_NOTE.
-                                    auto it = metrics.find(m[2]);
-                                    if (it == metrics.end())
-                                    {
-                                        // Not a valide builtin metric.
-                                        return false;
-                                    }
-                                    counting_info.evt_note.type = METRIC_EVT_NOTE;
-                                    counting_info.evt_note.note.metric_note.group_id = std::stoi(m[1]);
-                                    counting_info.evt_note.note.metric_note.name = it->first.c_str();
-                                }
-                                else if (std::regex_match(note, m, std::wregex(L"g([0-9]+)")))
-                                {
-                                    // This is a GROUP_EVT_NOTE.
-                                    counting_info.evt_note.type = GROUP_EVT_NOTE;
-                                    counting_info.evt_note.note.group_note.group_id = std::stoi(m[1]);
-                                }
-                                else
-                                {
-                                    // Not a valid event note type.
-                                    return false;
-                                }
+                                return false;
                             }
 
                             counting_info.multiplexed_scheduled = evt->scheduled;
                             counting_info.multiplexed_round = round;
-                            counting_info.scaled_value = (uint64_t)((double)evt->value / ((double)evt->scheduled / (double)round));
+                            counting_info.scaled_value = evt->time_enabled
+                                ? MultiplexScaling::ScaledValue(evt->value, evt->time_enabled, evt->time_running)
+                                : MultiplexScaling::ScaledValue(evt->value, round, evt->scheduled);
                             __countings[i].push_back(counting_info);
                         }
                     }
@@ -664,6 +759,665 @@ extern "C" bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info)
     return true;
 }
 
+static bool session_valid(WPERF_SESSION session)
+{
+    return session && __pmu_device && __pmu_cfg && __sessions.count(session);
+}
+
+extern "C" bool wperf_session_open(WPERF_SESSION* session)
+{
+    if (!session || !__pmu_device)
+    {
+        // session and __pmu_device should not be NULL.
+        return false;
+    }
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+        *session = new _WPERF_SESSION();
+        __sessions.insert(*session);
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_session_configure(WPERF_SESSION session, PSESSION_CONF session_conf)
+{
+    if (!session_conf)
+        return false;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!session_valid(session) || session->started || __regions.configured)
+            return false;
+
+        if (session_conf->num_cores <= 0 || !session_conf->cores)
+            return false;
+
+        std::vector<uint8_t> cores(session_conf->cores, session_conf->cores + session_conf->num_cores);
+        for (uint8_t core : cores)
+            if (core >= __pmu_cfg->core_num)
+                return false;
+
+        // Each core can be used only by one session.
+        for (WPERF_SESSION other : __sessions)
+        {
+            if (other == session || !other->configured)
+                continue;
+            for (uint8_t core : cores)
+                if (std::find(other->cores.begin(), other->cores.end(), core) != other->cores.end())
+                    return false;
+        }
+
+        std::map<enum evt_class, std::vector<struct evt_noted>> ioctl_events;
+        if (!stat_ioctl_events(session_conf->num_events, session_conf->events, session_conf->group_events,
+                               session_conf->num_metrics, session_conf->metric_events, ioctl_events))
+            return false;
+
+        // Event notes are resolved here once, reads only copy them.
+        std::vector<UINT32> evt_slots = { 0 };      // Cycle counter is always the first one
+        std::vector<EVENT_NOTE> evt_notes(1);
+        evt_notes[0].type = NORMAL_EVT_NOTE;
+        const auto& core_events = ioctl_events[EVT_CORE];
+        if (core_events.size() >= MAX_MANAGED_CORE_EVENTS)
+            return false;
+        for (UINT32 j = 1; j <= core_events.size(); j++)
+        {
+            if (core_events[j - 1].type == EVT_PADDING)
+                continue;
+
+            EVENT_NOTE evt_note = {};
+            if (!stat_evt_note(core_events[j - 1].note, evt_note))
+                return false;
+            evt_slots.push_back(j);
+            evt_notes.push_back(evt_note);
+        }
+
+        // Everything above only validates, from here on cores are reprogrammed. If the driver
+        // still rejects events the session is left unconfigured and has to be configured again.
+        std::vector<uint8_t> cores_saved = __pmu_device->get_cores_idx();
+        try
+        {
+            __pmu_device->set_cores_idx(cores);
+            __pmu_device->stop(CTL_FLAG_CORE);
+            for (uint8_t core_idx : cores)
+                __pmu_device->events_assign(core_idx, ioctl_events, session_conf->kernel_mode);
+        }
+        catch (...)
+        {
+            session->configured = false;
+            __pmu_device->set_cores_idx(cores_saved);
+            throw;
+        }
+
+        session->cores = __pmu_device->get_cores_idx();     // Sorted and unique
+        session->ioctl_events = ioctl_events;
+        session->evt_slots = evt_slots;
+        session->evt_notes = evt_notes;
+        session->kernel_mode = session_conf->kernel_mode;
+        session->period = session_conf->period;
+        session->last_delta.clear();
+        session->configured = true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_session_start(WPERF_SESSION session)
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!session_valid(session) || !session->configured || session->started)
+            return false;
+
+        __pmu_device->set_cores_idx(session->cores);
+        drvconfig::set(L"count.period", std::to_wstring(session->period) + L"ms");
+        __pmu_device->reset(CTL_FLAG_CORE);
+        __pmu_device->start(CTL_FLAG_CORE);
+
+        session->last_delta.clear();
+        session->started = true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_session_read(WPERF_SESSION session, SNAPSHOT_TYPE type, PSNAPSHOT_INFO snapshots, int max_snapshots, int* num_snapshots)
+{
+    if (!num_snapshots)
+        return false;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!session_valid(session) || !session->configured)
+            return false;
+
+        const size_t evt_num = session->evt_slots.size();
+        *num_snapshots = static_cast<int>(session->cores.size() * evt_num);
+        if (!snapshots || max_snapshots < *num_snapshots)
+            return false;
+
+        PSNAPSHOT_INFO snapshot = snapshots;
+        for (uint8_t core_idx : session->cores)
+        {
+            // Driver keeps counting, values are up to date with its last timer tick.
+            __pmu_device->core_events_read_nth(core_idx);
+            const ReadOut& core_out = __pmu_device->get_core_outs()[core_idx];
+
+            std::vector<SESSION_COUNTING>& last = session->last_delta[core_idx];
+            last.resize(evt_num, SESSION_COUNTING{});
+
+            for (size_t i = 0; i < evt_num; i++, snapshot++)
+            {
+                const struct pmu_event_usr& evt = core_out.evts[session->evt_slots[i]];
+                SESSION_COUNTING cur = { evt.value, evt.time_enabled, evt.time_running, evt.scheduled, core_out.round };
+                SESSION_COUNTING val = cur;
+
+                if (type == SNAPSHOT_DELTA)
+                {
+                    val.value -= last[i].value;
+                    val.time_enabled -= last[i].time_enabled;
+                    val.time_running -= last[i].time_running;
+                    val.scheduled -= last[i].scheduled;
+                    val.round -= last[i].round;
+                    last[i] = cur;
+                }
+
+                snapshot->core_idx = core_idx;
+                snapshot->event_idx = evt.event_idx;
+                snapshot->counter_value = val.value;
+                snapshot->scaled_value = val.time_enabled
+                    ? MultiplexScaling::ScaledValue(val.value, val.time_enabled, val.time_running)
+                    : MultiplexScaling::ScaledValue(val.value, val.round, val.scheduled);
+                snapshot->time_enabled = val.time_enabled;
+                snapshot->time_running = val.time_running;
+                snapshot->evt_note = session->evt_notes[i];
+            }
+        }
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_session_stop(WPERF_SESSION session)
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!session_valid(session) || !session->started)
+            return false;
+
+        __pmu_device->set_cores_idx(session->cores);
+        __pmu_device->stop(CTL_FLAG_CORE);
+        session->started = false;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_session_close(WPERF_SESSION session)
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!session || !__sessions.count(session))
+            return false;
+
+        if (session->started && __pmu_device)
+        {
+            __pmu_device->set_cores_idx(session->cores);
+            __pmu_device->stop(CTL_FLAG_CORE);
+        }
+        __sessions.erase(session);
+        delete session;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_region_init(PREGION_CONF region_conf)
+{
+    if (!region_conf || !__pmu_device || !__pmu_cfg)
+        return false;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        // Regions count on all cores, threads can run anywhere.
+        if (__regions.configured)
+            return false;
+        for (WPERF_SESSION session : __sessions)
+            if (session->configured)
+                return false;
+
+        std::map<enum evt_class, std::vector<struct evt_noted>> ioctl_events;
+        if (!stat_ioctl_events(region_conf->num_events, region_conf->events, GROUP_EVENT_INFO{},
+                               0, nullptr, ioctl_events))
+            return false;
+
+        // Live reads see only events which are on a counter, multiplexing is not supported.
+        const auto& core_events = ioctl_events[EVT_CORE];
+        if (core_events.size() > __pmu_cfg->gpc_nums[EVT_CORE])
+            return false;
+
+        std::vector<uint16_t> events = { static_cast<uint16_t>(CYCLE_EVT_IDX) };
+        for (const auto& e : core_events)
+        {
+            if (e.type == EVT_PADDING)
+                return false;
+            events.push_back(e.index);
+        }
+
+        std::vector<uint8_t> cores(__pmu_cfg->core_num);
+        std::iota(cores.begin(), cores.end(), uint8_t(0));
+        __pmu_device->set_cores_idx(cores);
+        __pmu_device->stop(CTL_FLAG_CORE);
+        for (uint8_t core_idx : cores)
+            __pmu_device->events_assign(core_idx, ioctl_events, region_conf->kernel_mode);
+        drvconfig::set(L"count.period", std::to_wstring(region_conf->period) + L"ms");
+        __pmu_device->reset(CTL_FLAG_CORE);
+        __pmu_device->start(CTL_FLAG_CORE);
+
+        __regions = REGION_PROFILING();
+        __regions.kernel_mode = region_conf->kernel_mode;
+        __regions.num_values = events.size();
+        __regions.events = events;
+        __regions.configured = true;
+        __region_threads.Reset();
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_region_register(const wchar_t* name, int* region_id)
+{
+    if (!name || !region_id)
+        return false;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!__regions.configured)
+            return false;
+
+        auto it = std::find(__regions.names.begin(), __regions.names.end(), name);
+        if (it == __regions.names.end())
+        {
+            if (__regions.names.size() >= RegionThread::m_MAX_REGIONS)
+                return false;
+            it = __regions.names.insert(__regions.names.end(), name);
+        }
+        *region_id = static_cast<int>(it - __regions.names.begin());
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Data of the calling thread, allocated when the thread begins its first region. The thread
+// holds a reference to its data, so wperf_region_close() running at the same time does not
+// free it under begin / end.
+static RegionThread* region_thread()
+{
+    if (RegionThread* thread = __region_threads.Current(__region_thread))
+        return thread;
+
+    std::lock_guard<std::mutex> lock(__sessions_lock);
+
+    if (!__regions.configured)
+    {
+        __region_thread = RegionThreadSlot();
+        return nullptr;
+    }
+
+    return __region_threads.Attach(__region_thread, __regions.num_values);
+}
+
+// Global index of the processor we run on, as used by the driver (KeGetCurrentProcessorNumberEx()).
+// Processors are numbered group by group.
+static uint32_t current_processor_index()
+{
+    static const std::vector<uint32_t> group_base = [] {
+        std::vector<uint32_t> base;
+        uint32_t index = 0;
+        for (WORD group = 0; group < GetActiveProcessorGroupCount(); group++)
+        {
+            base.push_back(index);
+            index += GetActiveProcessorCount(group);
+        }
+        return base;
+    }();
+
+    PROCESSOR_NUMBER number;
+    GetCurrentProcessorNumberEx(&number);
+    return (number.Group < group_base.size() ? group_base[number.Group] : 0) + number.Number;
+}
+
+// Live read of counters of the core we run on. If the read was not done on this core
+// (thread moved, or the request was handled in the context of another thread calling
+// the driver at the same time) `core` is RegionThread::m_NO_CORE.
+static bool region_read(const RegionThread& thread, struct PMUReadLiveOut& out, uint32_t& core)
+{
+    uint32_t cpu = current_processor_index();
+    __pmu_device->core_events_read_live(cpu, out);
+    core = out.core_idx == cpu ? cpu : RegionThread::m_NO_CORE;
+    return out.evt_num >= thread.NumValues();
+}
+
+// Counters are read as late as possible in begin and as early as possible in end, what is
+// left is measured by wperf_region_calibrate().
+static bool region_begin(RegionThread& thread, uint32_t region_id)
+{
+    struct PMUReadLiveOut out;
+    uint32_t core;
+    if (!region_read(thread, out, core))
+        return false;
+    return thread.Begin(region_id, core, out.value);
+}
+
+static bool region_end(RegionThread& thread, uint32_t region_id)
+{
+    struct PMUReadLiveOut out;
+    uint32_t core;
+    if (!region_read(thread, out, core))
+        core = RegionThread::m_NO_CORE;
+    return thread.End(region_id, core, out.value);
+}
+
+extern "C" bool wperf_region_begin(int region_id)
+{
+    if (region_id < 0)
+        return false;
+
+    try
+    {
+        RegionThread* thread = region_thread();
+        return thread && region_begin(*thread, static_cast<uint32_t>(region_id));
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+extern "C" bool wperf_region_end(int region_id)
+{
+    if (region_id < 0)
+        return false;
+
+    try
+    {
+        RegionThread* thread = region_thread();
+        return thread && region_end(*thread, static_cast<uint32_t>(region_id));
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+extern "C" bool wperf_region_calibrate(int iterations)
+{
+    if (iterations < 10)
+        return false;
+
+    try
+    {
+        size_t num_values;
+        {
+            std::lock_guard<std::mutex> lock(__sessions_lock);
+            if (!__regions.configured)
+                return false;
+            num_values = __regions.num_values;
+        }
+
+        // Empty regions run on private thread data so they do not show up in the report.
+        RegionThread thread(num_values);
+        std::vector<std::vector<uint64_t>> self(num_values), outer(num_values);
+
+        auto measure = [&thread](uint32_t region, std::vector<std::vector<uint64_t>>& samples, auto&& body) {
+            RegionTotals before, after;
+            thread.Merge(region, before);
+            if (!region_begin(thread, region))
+                return;
+            body();
+            region_end(thread, region);
+            thread.Merge(region, after);
+            if (after.calls == before.calls)
+                return;     // Migrated
+            for (size_t i = 0; i < samples.size(); i++)
+                samples[i].push_back(after.values[i] - before.values[i]);
+        };
+
+        for (int i = 0; i < iterations; i++)
+        {
+            measure(0, self, [] {});
+            measure(1, outer, [&thread] {
+                region_begin(thread, 2);
+                region_end(thread, 2);
+            });
+        }
+
+        if (self[0].size() < size_t(iterations / 2) || outer[0].size() < size_t(iterations / 2))
+            return false;
+
+        RegionCalibration calibration;
+        for (size_t i = 0; i < num_values; i++)
+        {
+            uint64_t self_median = RegionCalibration::Median(self[i]);
+            uint64_t outer_median = RegionCalibration::Median(outer[i]);
+            calibration.self.push_back(self_median);
+            calibration.inner.push_back(outer_median > self_median ? outer_median - self_median : 0);
+        }
+
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+        if (!__regions.configured)
+            return false;
+        __regions.calibration = calibration;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+// Merge data of all threads, guarded by __sessions_lock. Accumulators are read while
+// threads may still update them, each value is consistent on its own.
+static std::vector<RegionTotals> region_totals()
+{
+    std::vector<RegionTotals> totals(__regions.names.size());
+    for (size_t region = 0; region < totals.size(); region++)
+    {
+        totals[region].values.resize(__regions.num_values, 0);
+        for (const auto& thread : __region_threads.Threads())
+            thread->Merge(static_cast<uint32_t>(region), totals[region]);
+    }
+    return totals;
+}
+
+extern "C" bool wperf_region_report(PREGION_INFO regions, int max_regions, int* num_regions)
+{
+    if (!num_regions)
+        return false;
+
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!__regions.configured)
+            return false;
+
+        *num_regions = static_cast<int>(__regions.names.size() * __regions.num_values);
+        if (!regions || max_regions < *num_regions)
+            return false;
+
+        PREGION_INFO info = regions;
+        for (const RegionTotals& raw : region_totals())
+        {
+            RegionTotals corrected = raw;
+            __regions.calibration.Correct(corrected);
+            const int region_id = static_cast<int>(info - regions) / static_cast<int>(__regions.num_values);
+
+            for (size_t i = 0; i < __regions.num_values; i++, info++)
+            {
+                info->region_id = region_id;
+                info->name = __regions.names[region_id].c_str();
+                info->event_idx = __regions.events[i];
+                info->calls = raw.calls;
+                info->migrated = raw.migrated;
+                info->counter_value = corrected.values[i];
+                info->raw_value = raw.values[i];
+            }
+        }
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_region_print(bool json, const wchar_t* output_file)
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!__regions.configured)
+            return false;
+
+        const TableType output_type = m_outputType;
+        const bool should_write_to_file = m_out.m_shouldWriteToFile;
+        const std::wstring filename = m_out.m_filename;
+        m_outputType = json ? TableType::JSON : TableType::PRETTY;
+        m_out.m_shouldWriteToFile = json && output_file;
+        m_out.m_filename = output_file ? output_file : L"";
+
+        WPerfRegionJSON<GlobalCharType> region_json;
+        region_json.m_kernel = __regions.kernel_mode;
+        region_json.m_calibrated = __regions.calibration.IsCalibrated();
+
+        std::vector<RegionTotals> totals = region_totals();
+        for (size_t region = 0; region < totals.size(); region++)
+        {
+            RegionTotals& total = totals[region];
+            __regions.calibration.Correct(total);
+
+            std::vector<uint64_t> col_counter_value;
+            std::vector<std::wstring> col_event_name, col_event_idx, col_event_note;
+            for (size_t i = 0; i < __regions.num_values; i++)
+            {
+                uint16_t event_idx = __regions.events[i];
+                col_counter_value.push_back(total.values[i]);
+                col_event_name.push_back(__pmu_device->pmu_events_get_event_name(event_idx));
+                col_event_idx.push_back(event_idx == static_cast<uint16_t>(CYCLE_EVT_IDX) ? L"fixed" : IntToHexWideString(event_idx, 2));
+                col_event_note.push_back(L"e");
+            }
+
+            TableOutput<PerformanceCounterOutputTraitsL<false>, GlobalCharType> table(m_outputType);
+            table.PresetHeaders();
+            table.SetAlignment(0, ColumnAlignL::RIGHT);
+            table.Insert(col_counter_value, col_event_name, col_event_idx, col_event_note);
+            table.InsertExtra(L"region", __regions.names[region]);
+            table.InsertExtra(L"calls", total.calls);
+            table.InsertExtra(L"migrated", total.migrated);
+
+            if (!json)
+            {
+                m_out.GetOutputStream() << std::endl << L"Region " << __regions.names[region] << L": "
+                    << total.calls << L" calls, " << total.migrated << L" migrated" << std::endl;
+                m_out.Print(table);
+            }
+            region_json.m_regionTables.push_back(table);
+        }
+
+        m_out.Print(region_json);
+
+        m_outputType = output_type;
+        m_out.m_shouldWriteToFile = should_write_to_file;
+        m_out.m_filename = filename;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+extern "C" bool wperf_region_close()
+{
+    try
+    {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+
+        if (!__regions.configured)
+            return true;
+
+        if (__pmu_device && __pmu_cfg)
+        {
+            std::vector<uint8_t> cores(__pmu_cfg->core_num);
+            std::iota(cores.begin(), cores.end(), uint8_t(0));
+            __pmu_device->set_cores_idx(cores);
+            __pmu_device->stop(CTL_FLAG_CORE);
+        }
+
+        __regions = REGION_PROFILING();
+        __region_threads.Reset();
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
 extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
 {
     if (!sample_conf || !__pmu_device)
@@ -682,6 +1436,10 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
 
     try
     {
+        std::lock_guard<std::mutex> lock(__sessions_lock);
+        if (!exclusive_device())
+            return false;
+
         if (!sample_info)
         {
             __sample_events.clear();
@@ -792,7 +1550,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
 
             if (sample_conf->export_perf_data)
             {
-                perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, std::wstring(sample_conf->image_name));
+                perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, std::wstring(sample_conf->image_name), UINT64(0));
             }
 
             if (EnumProcessModules(process_handle, hMods, sizeof(hMods), &cbNeeded))
@@ -821,26 +1579,14 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
                         {
                             if (sample_conf->export_perf_data)
                             {
-                                perfDataWriter.RegisterEvent(PerfDataWriter::MMAP, pid, reinterpret_cast<UINT64>(modinfo.lpBaseOfDll), modinfo.SizeOfImage, mod_path, 0);
+                                perfDataWriter.RegisterEvent(PerfDataWriter::MMAP, pid, reinterpret_cast<UINT64>(modinfo.lpBaseOfDll), modinfo.SizeOfImage, mod_path, 0, UINT64(0));
                             }
                         }
                     }
                 }
             }
 
-            for (auto& [key, value] : modules_metadata)
-            {
-                std::wstring pdb_path = gen_pdb_name(value.mod_path);
-                std::ifstream ifile(pdb_path);
-                if (ifile) {
-                    PeFileMetaData pefile_metadata;
-                    parse_pe_file(value.mod_path, pefile_metadata);
-                    dll_metadata[value.mod_name] = pefile_metadata;
-
-                    parse_pdb_file(pdb_path, value.sym_info, sample_conf->display_short);
-                    ifile.close();
-                }
-            }
+            load_modules_symbols(modules_metadata, dll_metadata, sample_conf->display_short);
 
             HMODULE module_handle;
             if (sample_conf->record)
@@ -859,7 +1605,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
                 runtime_vaddr_delta = (UINT64)modinfo.EntryPoint - (image_base + static_entry_point);
 
                 if (sample_conf->export_perf_data)
-                    perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, std::wstring(sample_conf->image_name));
+                    perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, std::wstring(sample_conf->image_name), UINT64(0));
             }
 
             std::vector<FrameChain> raw_samples;
@@ -1031,6 +1777,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
 
             int32_t group_idx = -1;
             prev_evt_src = CYCLE_EVT_IDX - 1;
+            PdbLineReader line_reader;
 
             for (auto &a : resolved_samples)
             {
@@ -1055,7 +1802,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
                             UINT64 mod_vaddr_delta = (UINT64)a.module->handle;
                             addr = (sample.first - mod_vaddr_delta) & 0xFFFFFF;
                         }
-                        perfDataWriter.RegisterEvent(PerfDataWriter::SAMPLE, pid, sample.first, sample_conf->core_idx, a.event_src);
+                        perfDataWriter.RegisterEvent(PerfDataWriter::SAMPLE, pid, sample.first, sample_conf->core_idx, a.event_src, UINT64(0));
                     }
                 }
 
@@ -1064,6 +1811,8 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
                     std::map<std::pair<std::wstring, DWORD>, uint64_t> hotspots;
                     if (a.desc.name != L"unknown")
                     {
+                        line_reader.ReadLines(a.module == NULL ? std::wstring(sample_conf->pdb_file) : gen_pdb_name(a.module->mod_path), a.desc);
+
                         for (const auto& sample : a.pc)
                         {
                             bool found_line = false;
@@ -1079,7 +1828,7 @@ extern "C" bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info)
                             {
                                 if (line.virtualAddress <= addr && line.virtualAddress + line.length > addr)
                                 {
-                                    std::pair<std::wstring, DWORD> cur = std::make_pair(line.source_file, line.lineNum);
+                                    std::pair<std::wstring, DWORD> cur = std::make_pair(*line.source_file, line.lineNum);
                                     if (auto el = hotspots.find(cur); el == hotspots.end())
                                     {
                                         hotspots[cur] = sample.second;
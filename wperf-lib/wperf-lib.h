@@ -372,7 +372,7 @@ typedef struct _STAT_CONF
     double duration;
     /// Set this to true if kernel mode should be included, false if not.
     bool kernel_mode;
-    /// The counting timer period (in milliseconds). The default period is 100ms. The period should be between 10ms to 100ms (i.e., [10ms, 100ms]).
+    /// The counting timer period (in milliseconds). The default period is 100ms. The period should be between 1ms to 100ms (i.e., [1ms, 100ms]).
     long period;
     /// Set this to true if you want to turn on timeline mode, false if not.
     bool timeline;
@@ -502,9 +502,300 @@ typedef struct _TEST_INFO
 /// to a caller-allocated STAT_INFO structure. The lib routine will populate the STAT_INFO
 /// pointed to by stat_info with the counter values and other related information defined
 /// in STAT_INFO for each requested event on each requestd core.</param>
-/// <returns>true if the call succeeds, false if not.</returns>
+/// <returns>true if the call succeeds, false if not. Fails while any counting session
+/// is open or code regions are initialized, see wperf_session_open() and wperf_region_init().</returns>
 WPERF_LIB_API bool wperf_stat(PSTAT_CONF stat_conf, PSTAT_INFO stat_info);
 
+/// Handle of a counting session, see wperf_session_open().
+typedef struct _WPERF_SESSION* WPERF_SESSION;
+
+typedef struct _SESSION_CONF
+{
+    /// The number of cores to count on.
+    int num_cores;
+    /// The list of cores to count on. Each core can be used by one session at a time.
+    uint8_t* cores;
+    /// The number of normal events to count.
+    int num_events;
+    /// The list of normal events to count.
+    uint16_t* events;
+    /// The group events to count.
+    /// Refer to definition of GROUP_EVENT_INFO for more details.
+    GROUP_EVENT_INFO group_events;
+    /// The number of metrics to count.
+    int num_metrics;
+    /// The list of metrics to count.
+    const wchar_t** metric_events;
+    /// Set this to true if kernel mode should be included, false if not.
+    bool kernel_mode;
+    /// The counting timer period (in milliseconds). Driver updates counter values once per period, so this
+    /// is the resolution of snapshots. The period should be between 1ms to 100ms (i.e., [1ms, 100ms]).
+    long period;
+} SESSION_CONF, *PSESSION_CONF;
+
+typedef enum _SNAPSHOT_TYPE
+{
+    /// Counts since wperf_session_start().
+    SNAPSHOT_CUMULATIVE,
+    /// Counts since previous SNAPSHOT_DELTA read (or wperf_session_start() for the first one).
+    SNAPSHOT_DELTA,
+} SNAPSHOT_TYPE;
+
+typedef struct _SNAPSHOT_INFO
+{
+    /// Core on which the event was counted.
+    uint8_t core_idx;
+    /// Event ID.
+    uint16_t event_idx;
+    /// Counter value.
+    uint64_t counter_value;
+    /// Counter value scaled for multiplexing.
+    uint64_t scaled_value;
+    /// Time (in cycles) the event was enabled.
+    uint64_t time_enabled;
+    /// Time (in cycles) the event was actually counting on a hardware counter.
+    uint64_t time_running;
+    /// Event note, refer to definition of EVENT_NOTE for details.
+    EVENT_NOTE evt_note;
+} SNAPSHOT_INFO, *PSNAPSHOT_INFO;
+
+/// <summary>
+/// Open a new counting session. Unlike wperf_stat, sessions do not block: counting is
+/// started and stopped explicitly and counters can be read at any time in between.
+/// Many sessions can be open at the same time as long as they count on different cores.
+/// </summary>
+/// <example> This example shows how to use a counting session.
+/// <code>
+/// wperf_init();
+///
+/// uint8_t cores[1] = { 1 };
+/// uint16_t events[2] = { 0x1B, 0x73 };
+/// SESSION_CONF session_conf =
+/// {
+///   1, // num_cores
+///   cores, // cores
+///   2, // num_events
+///   events, // events
+///   {0, NULL, NULL}, // group_events
+///   0, // num_metrics
+///   NULL, // metric_events
+///   false, // kernel_mode
+///   10, // period
+/// };
+///
+/// WPERF_SESSION session;
+/// SNAPSHOT_INFO snapshots[16];
+/// int num_snapshots;
+/// if (wperf_session_open(&session) && wperf_session_configure(session, &session_conf) && wperf_session_start(session))
+/// {
+///   for (int i = 0; i < 10; i++)
+///   {
+///     run_load();
+///     if (wperf_session_read(session, SNAPSHOT_DELTA, snapshots, 16, &num_snapshots))
+///       for (int j = 0; j < num_snapshots; j++)
+///         printf("core_idx=%u, event_idx=%u, counter=%llu\n", snapshots[j].core_idx, snapshots[j].event_idx, snapshots[j].counter_value);
+///   }
+///   wperf_session_stop(session);
+/// }
+/// wperf_session_close(session);
+///
+/// wperf_close();
+/// </code>
+/// </example>
+/// <param name="session">Pointer to a caller allocated WPERF_SESSION which this routine will
+/// set to the handle of the new session.</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_session_open(WPERF_SESSION* session);
+
+/// <summary>
+/// Configure cores and events of a session. Events are assigned to session cores
+/// immediately. A started session can't be configured, stop it first.
+/// </summary>
+/// <param name="session">Session handle returned by wperf_session_open().</param>
+/// <param name="session_conf">Pointer to a caller-allocated SESSION_CONF struct (refer
+/// to the definition of SESSION_CONF for more details).</param>
+/// <returns>true if the call succeeds, false if not (for example if one of the cores is
+/// used by another session).</returns>
+WPERF_LIB_API bool wperf_session_configure(WPERF_SESSION session, PSESSION_CONF session_conf);
+
+/// <summary>
+/// Reset counters of session cores and start counting. This routine returns immediately.
+/// </summary>
+/// <param name="session">Session handle returned by wperf_session_open().</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_session_start(WPERF_SESSION session);
+
+/// <summary>
+/// Read a snapshot of session counters without stopping them. There is one SNAPSHOT_INFO
+/// for each event on each session core.
+/// </summary>
+/// <param name="session">Session handle returned by wperf_session_open().</param>
+/// <param name="type">SNAPSHOT_CUMULATIVE for counts since wperf_session_start() or SNAPSHOT_DELTA
+/// for counts since previous SNAPSHOT_DELTA read.</param>
+/// <param name="snapshots">Pointer to a caller-allocated array of max_snapshots SNAPSHOT_INFO
+/// structures this routine will populate. It can be NULL to only query num_snapshots.</param>
+/// <param name="max_snapshots">Number of elements in snapshots array.</param>
+/// <param name="num_snapshots">Pointer to a caller allocated int. This routine will set it to the
+/// number of SNAPSHOT_INFO structures of a snapshot (also when snapshots array is too small).</param>
+/// <returns>true if the call succeeds, false if not (also when snapshots array is too small).</returns>
+WPERF_LIB_API bool wperf_session_read(WPERF_SESSION session, SNAPSHOT_TYPE type, PSNAPSHOT_INFO snapshots, int max_snapshots, int* num_snapshots);
+
+/// <summary>
+/// Stop counting. Counters can still be read with wperf_session_read() after the session was stopped.
+/// </summary>
+/// <param name="session">Session handle returned by wperf_session_open().</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_session_stop(WPERF_SESSION session);
+
+/// <summary>
+/// Stop counting (if needed) and release the session with its cores. Sessions left
+/// open are closed by wperf_close().
+/// </summary>
+/// <param name="session">Session handle returned by wperf_session_open().</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_session_close(WPERF_SESSION session);
+
+typedef struct _REGION_CONF
+{
+    /// The number of events to count in regions. Events are counted without multiplexing,
+    /// so there can be at most as many events as there are free general purpose counters.
+    int num_events;
+    /// The list of events to count. Cycles are always counted as the first event.
+    uint16_t* events;
+    /// Set this to true if kernel mode should be included, false if not.
+    bool kernel_mode;
+    /// The counting timer period (in milliseconds). Region counts do not depend on it,
+    /// it only has to be short enough for counters not to overflow between timer ticks.
+    long period;
+} REGION_CONF, *PREGION_CONF;
+
+typedef struct _REGION_INFO
+{
+    /// Region ID, see wperf_region_register().
+    int region_id;
+    /// Region name.
+    const wchar_t* name;
+    /// Event ID.
+    uint16_t event_idx;
+    /// Number of completed wperf_region_begin() / wperf_region_end() pairs, summed over all threads.
+    uint64_t calls;
+    /// Number of pairs not counted because the thread was moved to another core in between.
+    uint64_t migrated;
+    /// Counter value of all calls, with instrumentation overhead subtracted once
+    /// wperf_region_calibrate() was called.
+    uint64_t counter_value;
+    /// Counter value of all calls as counted.
+    uint64_t raw_value;
+} REGION_INFO, *PREGION_INFO;
+
+/// <summary>
+/// Start code region instrumentation. Events are counted on all cores, threads mark regions
+/// of their code with wperf_region_begin() and wperf_region_end() and get counts of each region
+/// aggregated over all its executions and all threads.
+///
+/// Counters are read on the core the thread runs on when region begins and ends. Time other
+/// threads run on that core in between is counted as well and pairs where the thread changed
+/// core are dropped (see REGION_INFO::migrated). Reads go through the driver, so call
+/// wperf_region_calibrate() to subtract the cost of instrumentation from results. Region
+/// instrumentation can't be used together with counting sessions.
+/// </summary>
+/// <example> This example shows how to instrument a code region.
+/// <code>
+/// wperf_init();
+///
+/// uint16_t events[2] = { 0x08, 0x03 };
+/// REGION_CONF region_conf =
+/// {
+///   2, // num_events
+///   events, // events
+///   false, // kernel_mode
+///   10, // period
+/// };
+///
+/// int region_id;
+/// if (wperf_region_init(&region_conf) && wperf_region_calibrate(1000) && wperf_region_register(L"hot_loop", &region_id))
+/// {
+///   for (int i = 0; i < 1000; i++)
+///   {
+///     wperf_region_begin(region_id);
+///     run_load();
+///     wperf_region_end(region_id);
+///   }
+///   wperf_region_print(false, NULL);
+/// }
+/// wperf_region_close();
+///
+/// wperf_close();
+/// </code>
+/// </example>
+/// <param name="region_conf">Pointer to a caller-allocated REGION_CONF struct (refer
+/// to the definition of REGION_CONF for more details).</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_region_init(PREGION_CONF region_conf);
+
+/// <summary>
+/// Get ID of a region with given name. Registering the same name again returns the same ID,
+/// so this can be called once per region and the ID kept for wperf_region_begin().
+/// </summary>
+/// <param name="name">Region name.</param>
+/// <param name="region_id">Pointer to a caller allocated int. This routine will set it to the
+/// region ID.</param>
+/// <returns>true if the call succeeds, false if not (also when too many regions were registered).</returns>
+WPERF_LIB_API bool wperf_region_register(const wchar_t* name, int* region_id);
+
+/// <summary>
+/// Begin a region in the calling thread. Regions can be nested but have to be ended in reverse
+/// order. This routine takes no locks.
+/// </summary>
+/// <param name="region_id">Region ID returned by wperf_region_register().</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_region_begin(int region_id);
+
+/// <summary>
+/// End the innermost region of the calling thread begun with wperf_region_begin() and
+/// add its counts to the region. This routine takes no locks.
+/// </summary>
+/// <param name="region_id">Region ID returned by wperf_region_register().</param>
+/// <returns>true if the call succeeds, false if not (also when the region was not counted
+/// because the thread was moved to another core).</returns>
+WPERF_LIB_API bool wperf_region_end(int region_id);
+
+/// <summary>
+/// Measure instrumentation overhead by running empty regions in the calling thread. The
+/// overhead is subtracted from results of all regions. Call it from a thread that does
+/// not have open regions.
+/// </summary>
+/// <param name="iterations">How many empty regions to run, at least 10.</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_region_calibrate(int iterations);
+
+/// <summary>
+/// Report counts of all registered regions. There is one REGION_INFO for each event of
+/// each region. Threads can keep running regions, their counts so far are reported.
+/// </summary>
+/// <param name="regions">Pointer to a caller-allocated array of max_regions REGION_INFO
+/// structures this routine will populate. It can be NULL to only query num_regions.</param>
+/// <param name="max_regions">Number of elements in regions array.</param>
+/// <param name="num_regions">Pointer to a caller allocated int. This routine will set it to the
+/// number of REGION_INFO structures of the report (also when regions array is too small).</param>
+/// <returns>true if the call succeeds, false if not (also when regions array is too small).</returns>
+WPERF_LIB_API bool wperf_region_report(PREGION_INFO regions, int max_regions, int* num_regions);
+
+/// <summary>
+/// Print counts of all registered regions as `wperf stat` counter tables, one per region.
+/// </summary>
+/// <param name="json">Print JSON instead of human readable tables.</param>
+/// <param name="output_file">File to write JSON to, NULL to print to standard output.</param>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_region_print(bool json, const wchar_t* output_file);
+
+/// <summary>
+/// Stop code region instrumentation and release all region data. No thread may be inside
+/// wperf_region_begin() or wperf_region_end() while this is called. Called by wperf_close().
+/// </summary>
+/// <returns>true if the call succeeds, false if not.</returns>
+WPERF_LIB_API bool wperf_region_close();
+
 typedef struct _SAMPLE_CONF
 {
     /// The PE file path.
@@ -652,7 +943,8 @@ typedef struct _SAMPLE_STATS
 /// to a caller-allocated SAMPLE_INFO structure. The lib routine will populate the SAMPLE_INFO
 /// pointed to by sample_info with the sample information defined in SAMPLE_INFO for each sample
 /// of each requested sampling event.</param>
-/// <returns>true if the call succeeds, false if not.</returns>
+/// <returns>true if the call succeeds, false if not. Fails while any counting session
+/// is open or code regions are initialized, see wperf_session_open() and wperf_region_init().</returns>
 WPERF_LIB_API bool wperf_sample(PSAMPLE_CONF sample_conf, PSAMPLE_INFO sample_info);
 
 /// <summary>
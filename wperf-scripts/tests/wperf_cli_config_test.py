@@ -48,10 +48,27 @@ from common import get_result_from_test_results
 ]
 )
 def test_wperf_config_set_count_period(period):
-    """ Test one event, no multiplexing """
+    """ Test one event, no multiplexing, period in milliseconds """
     cmd = f'wperf test --json --config count.period={period}'
     stdout, _ = run_command(cmd.split())
     json_output = json.loads(stdout)
     config_count = get_result_from_test_results(json_output, "config.count.period")
 
-    assert int(config_count) == period
+    assert int(config_count) == period * 1000
+
+@pytest.mark.parametrize("period,period_us",
+[
+    ("100us", 100),
+    ("250us", 250),
+    ("500us", 500),
+    ("2ms", 2000),
+]
+)
+def test_wperf_config_set_count_period_units(period, period_us):
+    """ Test `us` and `ms` suffixes of count.period, shown in microseconds """
+    cmd = f'wperf test --json --config count.period={period}'
+    stdout, _ = run_command(cmd.split())
+    json_output = json.loads(stdout)
+    config_count = get_result_from_test_results(json_output, "config.count.period")
+
+    assert int(config_count) == period_us
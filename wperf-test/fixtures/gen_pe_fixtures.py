@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""generates small PE images used by wperf-test PE reader tests and stores \
+   them as byte arrays in pe_fixtures.h"""
+
+# BSD 3-Clause License
+#
+# Copyright (c) 2024, Arm Limited
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+# 1. Redistributions of source code must retain the above copyright notice, this
+#    list of conditions and the following disclaimer.
+#
+# 2. Redistributions in binary form must reproduce the above copyright notice,
+#    this list of conditions and the following disclaimer in the documentation
+#    and/or other materials provided with the distribution.
+#
+# 3. Neither the name of the copyright holder nor the names of its
+#    contributors may be used to endorse or promote products derived from
+#    this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+import struct
+import os
+
+FILE_ALIGN = 0x200
+SECT_ALIGN = 0x1000
+IMAGE_BASE = 0x180000000
+
+PDB_GUID = bytes.fromhex("4c3d2e1f6a5b8879" "0123456789abcdef")
+PDB_AGE = 3
+PDB_PATH = b"C:\\build\\fixture\\fixture.pdb"
+
+
+def align(value, alignment):
+    """round VALUE up to ALIGNMENT"""
+    return (value + alignment - 1) & ~(alignment - 1)
+
+
+def build_rdata(rva, imports, exports, dll_name, with_debug, raw_offset):
+    """build .rdata section at RVA (file offset RAW_OFFSET), return data and directory entries"""
+    data = bytearray(FILE_ALIGN)
+    dirs = {}
+    pos = 0
+
+    def put(blob):
+        nonlocal pos, data
+        off = pos
+        if off + len(blob) > len(data):
+            data += bytearray(align(off + len(blob) - len(data), FILE_ALIGN))
+        data[off:off + len(blob)] = blob
+        pos = align(off + len(blob), 8)
+        return off
+
+    if imports:
+        # Descriptors (plus terminator), then one zero thunk shared as ILT and IAT
+        desc_off = put(bytes(20 * (len(imports) + 1)))
+        thunk_off = put(bytes(8))
+        for i, name in enumerate(imports):
+            name_off = put(name + b"\0")
+            struct.pack_into("<IIIII", data, desc_off + 20 * i,
+                             rva + thunk_off, 0, 0, rva + name_off, rva + thunk_off)
+        dirs[1] = (rva + desc_off, 20 * (len(imports) + 1))
+
+    if exports:
+        exp_off = put(bytes(40))
+        funcs_off = put(bytes(4 * len(exports)))
+        names_off = put(bytes(4 * len(exports)))
+        ords_off = put(bytes(2 * len(exports)))
+        dll_off = put(dll_name + b"\0")
+        for i, name in enumerate(sorted(exports)):
+            name_off = put(name + b"\0")
+            struct.pack_into("<I", data, funcs_off + 4 * i, 0x1000)
+            struct.pack_into("<I", data, names_off + 4 * i, rva + name_off)
+            struct.pack_into("<H", data, ords_off + 2 * i, i)
+        struct.pack_into("<IIHHIIIIIII", data, exp_off,
+                         0, 0, 0, 0, rva + dll_off, 1, len(exports), len(exports),
+                         rva + funcs_off, rva + names_off, rva + ords_off)
+        dirs[0] = (rva + exp_off, pos - exp_off)
+
+    if with_debug:
+        dbg_off = put(bytes(28))
+        cv = b"RSDS" + PDB_GUID + struct.pack("<I", PDB_AGE) + PDB_PATH + b"\0"
+        cv_off = put(cv)
+        struct.pack_into("<IIHHIIII", data, dbg_off,
+                         0, 0, 0, 0, 2, len(cv), rva + cv_off, raw_offset + cv_off)
+        dirs[6] = (rva + dbg_off, 28)
+
+    return bytes(data), dirs
+
+
+def build_pe(machine=0xAA64, magic=0x20B, imports=(), exports=(), dll_name=b"fixture.dll",
+             with_debug=False):
+    """build PE image with .text and .rdata sections"""
+    text = struct.pack("<II", 0x52800540, 0xD65F03C0)      # mov w0, #42 ; ret
+    text = text + bytes(FILE_ALIGN - len(text))
+
+    e_lfanew = 0x40
+    opt_size = 240 if magic == 0x20B else 224
+    sec_table = e_lfanew + 4 + 20 + opt_size
+    size_of_headers = align(sec_table + 2 * 40, FILE_ALIGN)
+
+    text_rva, text_raw = SECT_ALIGN, size_of_headers
+    rdata_rva, rdata_raw = 2 * SECT_ALIGN, text_raw + len(text)
+    rdata, dirs = build_rdata(rdata_rva, imports, exports, dll_name, with_debug, rdata_raw)
+    size_of_image = rdata_rva + align(len(rdata), SECT_ALIGN)
+
+    hdr = bytearray(size_of_headers)
+    struct.pack_into("<H", hdr, 0, 0x5A4D)
+    struct.pack_into("<I", hdr, 0x3C, e_lfanew)
+    struct.pack_into("<I", hdr, e_lfanew, 0x00004550)
+    struct.pack_into("<HHIIIHH", hdr, e_lfanew + 4, machine, 2, 0, 0, 0, opt_size, 0x2022)
+
+    opt = e_lfanew + 24
+    if magic == 0x20B:
+        struct.pack_into("<HBBIIIIIQIIHHHHHHIIIIHHQQQQII", hdr, opt,
+                         magic, 14, 0, len(text), len(rdata), 0, text_rva, text_rva,
+                         IMAGE_BASE, SECT_ALIGN, FILE_ALIGN, 6, 0, 0, 0, 6, 2, 0,
+                         size_of_image, size_of_headers, 0, 3, 0x160,
+                         0x100000, 0x1000, 0x100000, 0x1000, 0, 16)
+        dir_off = opt + 112
+    else:
+        struct.pack_into("<HBBIIIIIIIIIHHHHHHIIIIHHIIIIII", hdr, opt,
+                         magic, 14, 0, len(text), len(rdata), 0, text_rva, text_rva, rdata_rva,
+                         IMAGE_BASE & 0xFFFFFFFF, SECT_ALIGN, FILE_ALIGN, 6, 0, 0, 0, 6, 2, 0,
+                         size_of_image, size_of_headers, 0, 3, 0x140,
+                         0x100000, 0x1000, 0x100000, 0x1000, 0, 16)
+        dir_off = opt + 96
+    for idx, (d_rva, d_size) in dirs.items():
+        struct.pack_into("<II", hdr, dir_off + 8 * idx, d_rva, d_size)
+
+    struct.pack_into("<8sIIIIIIHHI", hdr, sec_table, b".text", 8, text_rva, len(text), text_raw,
+                     0, 0, 0, 0, 0x60000020)
+    struct.pack_into("<8sIIIIIIHHI", hdr, sec_table + 40, b".rdata", len(rdata), rdata_rva,
+                     len(rdata), rdata_raw, 0, 0, 0, 0, 0x40000040)
+
+    return bytes(hdr) + text + rdata
+
+
+FIXTURES = [
+    ("pe_fixture_arm64_dll",
+     "ARM64 DLL with imports, exports and CodeView record",
+     build_pe(imports=(b"KERNEL32.dll", b"VCRUNTIME140.dll"),
+              exports=(b"fixture_mul", b"fixture_add"), with_debug=True)),
+    ("pe_fixture_arm64_bare",
+     "ARM64 image without data directories",
+     build_pe()),
+    ("pe_fixture_x86_dll",
+     "32-bit (PE32) x86 DLL",
+     build_pe(machine=0x14C, magic=0x10B, imports=(b"KERNEL32.dll",))),
+]
+
+
+def main():
+    """write pe_fixtures.h next to this script"""
+    with open(__file__, encoding="utf-8") as f:
+        license_text = f.read().split('"""', 2)[2].split("\n\n")[1]
+    license_c = "\n".join("//" + line[1:] for line in license_text.splitlines())
+
+    out = ["#pragma once", license_c, "",
+           "// Generated by gen_pe_fixtures.py, do not edit.", "",
+           "#include <cstdint>", ""]
+    for name, desc, blob in FIXTURES:
+        out.append(f"// {desc}")
+        out.append(f"static const uint8_t {name}[] = {{")
+        for i in range(0, len(blob), 16):
+            out.append("\t" + " ".join(f"0x{b:02x}," for b in blob[i:i + 16]))
+        out.append("};")
+        out.append("")
+
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "pe_fixtures.h")
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
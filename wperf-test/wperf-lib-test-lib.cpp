@@ -31,7 +31,9 @@
 #include "pch.h"
 #include "CppUnitTest.h"
 
+#include <chrono>
 #include <set>
+#include <thread>
 #include "wperf-lib/wperf-lib.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -65,6 +67,14 @@ namespace wperftest
 		TEST_IGNORE()
 		END_TEST_METHOD_ATTRIBUTE()
 
+		BEGIN_TEST_METHOD_ATTRIBUTE(test_lib_session)
+		TEST_IGNORE()
+		END_TEST_METHOD_ATTRIBUTE()
+
+		BEGIN_TEST_METHOD_ATTRIBUTE(test_lib_region)
+		TEST_IGNORE()
+		END_TEST_METHOD_ATTRIBUTE()
+
 #endif
 
 		TEST_METHOD(test_lib_version)
@@ -175,5 +185,113 @@ namespace wperftest
 
 			Assert::IsTrue(wperf_close());
 		}
+
+		TEST_METHOD(test_lib_session)
+		{
+			Assert::IsTrue(wperf_init());
+			uint8_t cores[2] = { 0, 3 };
+			uint16_t events[2] = { 0x1B, 0x73 };
+			SESSION_CONF session_conf =
+			{
+				2, // num_cores
+				cores, // cores
+				2, // num_events
+				events, // events
+				{0/*num_groups*/, NULL/*num_group_events*/, NULL/*events*/}, // group_events
+				0, // num_metrics
+				NULL, // metric_events
+				false, // kernel_mode
+				10 // period
+			};
+
+			WPERF_SESSION session, other;
+			Assert::IsTrue(wperf_session_open(&session));
+			Assert::IsTrue(wperf_session_open(&other));
+			Assert::IsTrue(wperf_session_configure(session, &session_conf));
+			// Core 3 is already used by the first session
+			Assert::IsFalse(wperf_session_configure(other, &session_conf));
+			Assert::IsTrue(wperf_session_close(other));
+
+			Assert::IsTrue(wperf_session_start(session));
+
+			// Query number of snapshots: 2 cores x (cycle counter + 2 events)
+			int num_snapshots = 0;
+			Assert::IsFalse(wperf_session_read(session, SNAPSHOT_CUMULATIVE, NULL, 0, &num_snapshots));
+			Assert::AreEqual(6, num_snapshots);
+
+			SNAPSHOT_INFO snapshots[6];
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			Assert::IsTrue(wperf_session_read(session, SNAPSHOT_DELTA, snapshots, 6, &num_snapshots));
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+			Assert::IsTrue(wperf_session_read(session, SNAPSHOT_CUMULATIVE, snapshots, 6, &num_snapshots));
+
+			std::set<uint8_t> list_cores;
+			std::set<uint16_t> list_events;
+			for (int i = 0; i < num_snapshots; i++)
+			{
+				list_cores.insert(snapshots[i].core_idx);
+				list_events.insert(snapshots[i].event_idx);
+			}
+			Assert::AreEqual(static_cast<size_t>(2), list_cores.size());
+			Assert::AreEqual(static_cast<size_t>(3), list_events.size());
+
+			Assert::IsTrue(wperf_session_stop(session));
+			Assert::IsTrue(wperf_session_close(session));
+			Assert::IsTrue(wperf_close());
+		}
+
+		TEST_METHOD(test_lib_region)
+		{
+			Assert::IsTrue(wperf_init());
+			uint16_t events[2] = { 0x08, 0x03 };
+			REGION_CONF region_conf =
+			{
+				2, // num_events
+				events, // events
+				false, // kernel_mode
+				10 // period
+			};
+
+			Assert::IsTrue(wperf_region_init(&region_conf));
+			Assert::IsTrue(wperf_region_calibrate(100));
+
+			int outer, inner, again;
+			Assert::IsTrue(wperf_region_register(L"outer", &outer));
+			Assert::IsTrue(wperf_region_register(L"inner", &inner));
+			Assert::IsTrue(wperf_region_register(L"outer", &again));
+			Assert::AreEqual(outer, again);
+
+			volatile uint64_t sum = 0;
+			for (int i = 0; i < 100; i++)
+			{
+				Assert::IsTrue(wperf_region_begin(outer));
+				wperf_region_begin(inner);
+				for (int j = 0; j < 10000; j++)
+					sum += j;
+				wperf_region_end(inner);
+				wperf_region_end(outer);
+			}
+			// Regions have to be nested
+			Assert::IsTrue(wperf_region_begin(outer));
+			Assert::IsFalse(wperf_region_end(inner));
+			wperf_region_end(outer);
+
+			// Query number of results: 2 regions x (cycle counter + 2 events)
+			int num_regions = 0;
+			Assert::IsFalse(wperf_region_report(NULL, 0, &num_regions));
+			Assert::AreEqual(6, num_regions);
+
+			REGION_INFO regions[6];
+			Assert::IsTrue(wperf_region_report(regions, 6, &num_regions));
+			for (int i = 0; i < num_regions; i++)
+			{
+				Assert::AreEqual(static_cast<uint64_t>(regions[i].region_id == outer ? 101 : 100), regions[i].calls + regions[i].migrated);
+				Assert::IsTrue(regions[i].counter_value <= regions[i].raw_value);
+			}
+
+			Assert::IsTrue(wperf_region_close());
+			Assert::IsFalse(wperf_region_begin(outer));
+			Assert::IsTrue(wperf_close());
+		}
 	};
 }
@@ -0,0 +1,121 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <string>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/a64_decoder.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_a64_decoder)
+	{
+	public:
+
+		TEST_METHOD(test_a64_decoder_data_processing)
+		{
+			Assert::AreEqual(a64_decoder::to_string(0x91004020, 0), std::string("add x0, x1, #0x10"));
+			Assert::AreEqual(a64_decoder::to_string(0x8b020820, 0), std::string("add x0, x1, x2, lsl #2"));
+			Assert::AreEqual(a64_decoder::to_string(0x910003fd, 0), std::string("mov x29, sp"));
+			Assert::AreEqual(a64_decoder::to_string(0x7100041f, 0), std::string("cmp w0, #0x1"));
+			Assert::AreEqual(a64_decoder::to_string(0x1a9f17e0, 0), std::string("cset w0, eq"));
+			Assert::AreEqual(a64_decoder::to_string(0xd3441c20, 0), std::string("ubfx x0, x1, #4, #4"));
+			Assert::AreEqual(a64_decoder::to_string(0x12800000, 0), std::string("mov w0, #-0x1"));
+			Assert::AreEqual(a64_decoder::to_string(0x72a24680, 0), std::string("movk w0, #0x1234, lsl #16"));
+			Assert::AreEqual(a64_decoder::to_string(0x12001c00, 0), std::string("and w0, w0, #0xff"));
+		}
+
+		TEST_METHOD(test_a64_decoder_load_store)
+		{
+			Assert::AreEqual(a64_decoder::to_string(0xa9bf7bfd, 0), std::string("stp x29, x30, [sp, #-0x10]!"));
+			Assert::AreEqual(a64_decoder::to_string(0xa8c17bfd, 0), std::string("ldp x29, x30, [sp], #0x10"));
+			Assert::AreEqual(a64_decoder::to_string(0xf9400820, 0), std::string("ldr x0, [x1, #0x10]"));
+			Assert::AreEqual(a64_decoder::to_string(0xb8617800, 0), std::string("ldr w0, [x0, x1, lsl #2]"));
+		}
+
+		TEST_METHOD(test_a64_decoder_branches)
+		{
+			// Branch targets are absolute addresses, same as in llvm-objdump output
+			Assert::AreEqual(a64_decoder::to_string(0x14000004, 0x1000), std::string("b 0x1010"));
+			Assert::AreEqual(a64_decoder::to_string(0x54ffffc1, 0x1000), std::string("b.ne 0xff8"));
+			Assert::AreEqual(a64_decoder::to_string(0x94000040, 0x1000), std::string("bl 0x1100"));
+			Assert::AreEqual(a64_decoder::to_string(0x35000233, 0x1000), std::string("cbnz w19, 0x1044"));
+			Assert::AreEqual(a64_decoder::to_string(0x37180020, 0x1000), std::string("tbnz w0, #0x3, 0x1004"));
+			Assert::AreEqual(a64_decoder::to_string(0xf0000048, 0x1000), std::string("adrp x8, 0xc000"));
+			Assert::AreEqual(a64_decoder::to_string(0x5c000492, 0x1000), std::string("ldr d18, 0x1090"));
+			Assert::AreEqual(a64_decoder::to_string(0xd65f03c0, 0x1000), std::string("ret"));
+		}
+
+		TEST_METHOD(test_a64_decoder_system)
+		{
+			Assert::AreEqual(a64_decoder::to_string(0xd503201f, 0), std::string("nop"));
+			Assert::AreEqual(a64_decoder::to_string(0xd503233f, 0), std::string("paciasp"));
+			Assert::AreEqual(a64_decoder::to_string(0xd5033bbf, 0), std::string("dmb ish"));
+			Assert::AreEqual(a64_decoder::to_string(0xd53bd040, 0), std::string("mrs x0, TPIDR_EL0"));
+			Assert::AreEqual(a64_decoder::to_string(0x00000000, 0), std::string("udf #0x0"));
+		}
+
+		TEST_METHOD(test_a64_decoder_fp_simd)
+		{
+			Assert::AreEqual(a64_decoder::to_string(0x1e201000, 0), std::string("fmov s0, #2.00000000"));
+			Assert::AreEqual(a64_decoder::to_string(0x1e622820, 0), std::string("fadd d0, d1, d2"));
+			Assert::AreEqual(a64_decoder::to_string(0x4e208400, 0), std::string("add v0.16b, v0.16b, v0.16b"));
+			Assert::AreEqual(a64_decoder::to_string(0x4ea11c20, 0), std::string("mov v0.16b, v1.16b"));
+			Assert::AreEqual(a64_decoder::to_string(0x4f000400, 0), std::string("movi v0.4s, #0x0"));
+		}
+
+		TEST_METHOD(test_a64_decoder_unknown)
+		{
+			a64_decoder::instruction insn;
+
+			Assert::IsFalse(a64_decoder::decode(0xffffffff, 0x1000, insn));
+			Assert::AreEqual(insn.mnemonic, std::string("<unknown>"));
+			Assert::IsTrue(insn.operands.empty());
+			Assert::AreEqual(insn.encoding, uint32_t(0xffffffff));
+			Assert::AreEqual(insn.address, uint64_t(0x1000));
+		}
+
+		TEST_METHOD(test_a64_decoder_instruction_fields)
+		{
+			a64_decoder::instruction insn;
+
+			Assert::IsTrue(a64_decoder::decode(0xa9bf7bfd, 0x140013798, insn));
+			Assert::AreEqual(insn.mnemonic, std::string("stp"));
+			Assert::AreEqual(insn.operands, std::string("x29, x30, [sp, #-0x10]!"));
+			Assert::AreEqual(insn.encoding, uint32_t(0xa9bf7bfd));
+			Assert::AreEqual(insn.address, uint64_t(0x140013798));
+		}
+	};
+}
@@ -33,8 +33,10 @@
 
 #include <algorithm>
 #include <numeric>
+#include <vector>
 #include <windows.h>
 #include "wperf-common\inline.h"
+#include "wperf-common\pc_histogram.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -80,4 +82,69 @@ namespace wperftest_common
 			}
 		}
 	};
+
+	TEST_CLASS(wperftest_common_pc_histogram)
+	{
+	public:
+
+		TEST_METHOD(test_pc_histogram_add)
+		{
+			static PCHistogram hist = {};
+
+			Assert::IsTrue(pc_histogram_add(&hist, 0x7ff612341000, 3));
+			Assert::IsTrue(pc_histogram_add(&hist, 0x7ff612341000, 3));
+			Assert::IsTrue(pc_histogram_add(&hist, 0x7ff612341000, 31));	// Same PC, other counter
+			Assert::IsTrue(pc_histogram_add(&hist, 0x7ff612341004, 3));
+			Assert::AreEqual(hist.used, UINT32(3));
+
+			std::vector<PCHistogramEntry> out(PC_HISTOGRAM_SIZE);
+			UINT32 n = pc_histogram_drain(&hist, out.data(), PC_HISTOGRAM_SIZE);
+			Assert::AreEqual(n, UINT32(3));
+			Assert::AreEqual(hist.used, UINT32(0));
+
+			UINT32 total = 0;
+			for (UINT32 i = 0; i < n; i++)
+			{
+				total += out[i].count;
+				if (out[i].pc == 0x7ff612341000 && out[i].counter_idx == 3)
+					Assert::AreEqual(out[i].count, UINT32(2));
+			}
+			Assert::AreEqual(total, UINT32(4));
+
+			// Drained histogram is empty
+			Assert::AreEqual(pc_histogram_drain(&hist, out.data(), PC_HISTOGRAM_SIZE), UINT32(0));
+		}
+
+		TEST_METHOD(test_pc_histogram_full)
+		{
+			static PCHistogram hist = {};
+
+			UINT32 dropped = 0;
+			for (UINT64 pc = 0; pc < 2 * PC_HISTOGRAM_SIZE; pc++)
+				if (!pc_histogram_add(&hist, 0x140001000 + pc * 4, 0))
+					dropped++;
+
+			// Table never holds more than its size, everything else is reported as dropped
+			Assert::IsTrue(hist.used <= PC_HISTOGRAM_SIZE);
+			Assert::AreEqual(hist.used + dropped, UINT32(2 * PC_HISTOGRAM_SIZE));
+
+			std::vector<PCHistogramEntry> out(PC_HISTOGRAM_SIZE);
+			Assert::AreEqual(pc_histogram_drain(&hist, out.data(), PC_HISTOGRAM_SIZE), UINT32(2 * PC_HISTOGRAM_SIZE - dropped));
+		}
+
+		TEST_METHOD(test_pc_histogram_drain_partial)
+		{
+			static PCHistogram hist = {};
+
+			for (UINT64 pc = 0; pc < 10; pc++)
+				pc_histogram_add(&hist, 0x140001000 + pc * 4, 0);
+
+			PCHistogramEntry out[4];
+			Assert::AreEqual(pc_histogram_drain(&hist, out, 4), UINT32(4));
+			Assert::AreEqual(hist.used, UINT32(6));
+			Assert::AreEqual(pc_histogram_drain(&hist, out, 4), UINT32(4));
+			Assert::AreEqual(pc_histogram_drain(&hist, out, 4), UINT32(2));
+			Assert::AreEqual(hist.used, UINT32(0));
+		}
+	};
 }
@@ -108,15 +108,15 @@ namespace wperftest
 
 			Assert::IsTrue(drvconfig::set(L"count.period=10"));
 			Assert::IsTrue(drvconfig::get(L"count.period", value));
-			Assert::IsTrue(value == 10);
+			Assert::IsTrue(value == 10000);
 
 			Assert::IsTrue(drvconfig::set(L"count.period=50"));
 			Assert::IsTrue(drvconfig::get(L"count.period", value));
-			Assert::IsTrue(value == 50);
+			Assert::IsTrue(value == 50000);
 
 			Assert::IsTrue(drvconfig::set(L"count.period=144"));
 			Assert::IsTrue(drvconfig::get(L"count.period", value));
-			Assert::IsTrue(value == 144);
+			Assert::IsTrue(value == 144000);
 		}
 
 		TEST_METHOD(test_config_set_get)
@@ -126,15 +126,73 @@ namespace wperftest
 
 			Assert::IsTrue(drvconfig::set(L"count.period", std::wstring(L"10")));			
 			Assert::IsTrue(drvconfig::get(L"count.period", value));
-			Assert::IsTrue(value == 10);
+			Assert::IsTrue(value == 10000);
 
 			Assert::IsTrue(drvconfig::set(L"count.period", std::wstring(L"50")));
 			Assert::IsTrue(drvconfig::get(L"count.period", value));
-			Assert::IsTrue(value == 50);
+			Assert::IsTrue(value == 50000);
 
 			Assert::IsTrue(drvconfig::set(L"count.period", std::wstring(L"144")));
 			Assert::IsTrue(drvconfig::get(L"count.period", value));
-			Assert::IsTrue(value == 144);
+			Assert::IsTrue(value == 144000);
+		}
+
+		TEST_METHOD(test_config_set_get_units)
+		{
+			LONG value;
+			drvconfig::init();
+
+			Assert::IsTrue(drvconfig::set(L"count.period=500us"));
+			Assert::IsTrue(drvconfig::get(L"count.period", value));
+			Assert::IsTrue(value == 500);
+
+			Assert::IsTrue(drvconfig::set(L"count.period=2ms"));
+			Assert::IsTrue(drvconfig::get(L"count.period", value));
+			Assert::IsTrue(value == 2000);
+
+			Assert::IsTrue(drvconfig::set(L"count.period=3"));
+			Assert::IsTrue(drvconfig::get(L"count.period", value));
+			Assert::IsTrue(value == 3000);
+
+			Assert::IsFalse(drvconfig::set(L"count.period=1s"));
+			Assert::IsFalse(drvconfig::set(L"count.period=10 ms"));
+			Assert::IsTrue(drvconfig::get(L"count.period", value));
+			Assert::IsTrue(value == 3000);
+		}
+
+		TEST_METHOD(test_config_set_mux_weights)
+		{
+			std::wstring value;
+			std::vector<UINT8> weights;
+			drvconfig::init();
+
+			Assert::IsTrue(drvconfig::get(L"mux.weights", value));
+			Assert::IsTrue(value.empty());
+
+			Assert::IsTrue(drvconfig::set(L"mux.weights=4,1,255"));
+			Assert::IsTrue(drvconfig::get(L"mux.weights", value));
+			Assert::IsTrue(drvconfig::parse_weights(value, weights));
+			Assert::IsTrue(weights == std::vector<UINT8>({ 4, 1, 255 }));
+
+			Assert::IsFalse(drvconfig::set(L"mux.weights=0"));
+			Assert::IsFalse(drvconfig::set(L"mux.weights=256"));
+			Assert::IsFalse(drvconfig::set(L"mux.weights=1,,2"));
+			Assert::IsFalse(drvconfig::set(L"mux.weights=1,2,"));
+			Assert::IsFalse(drvconfig::set(L"mux.weights=-1"));
+			Assert::IsTrue(drvconfig::get(L"mux.weights", value));
+			Assert::IsTrue(value == L"4,1,255");
+		}
+
+		TEST_METHOD(test_config_update_ro)
+		{
+			LONG value;
+			drvconfig::init();
+
+			Assert::IsTrue(drvconfig::update(L"count.period_min", 50));
+			Assert::IsTrue(drvconfig::get(L"count.period_min", value));
+			Assert::IsTrue(value == 50);
+
+			Assert::IsFalse(drvconfig::update(L"count.no_such_config", 50));
 		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <sstream>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/ddr_bw_monitor.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_ddr_bw_monitor)
+	{
+	public:
+
+		TEST_METHOD(test_log_histogram_empty)
+		{
+			LogHistogram hist;
+			Assert::AreEqual(hist.Count(), uint64_t(0));
+			Assert::AreEqual(hist.Percentile(50.0), 0.0);
+			Assert::AreEqual(hist.Mean(), 0.0);
+		}
+
+		TEST_METHOD(test_log_histogram_percentile)
+		{
+			LogHistogram hist;
+			for (int i = 1; i <= 1000; i++)
+				hist.Add(i);
+
+			Assert::AreEqual(hist.Count(), uint64_t(1000));
+			Assert::AreEqual(hist.Mean(), 500.5);
+			Assert::AreEqual(hist.Percentile(0.0), 1.0);
+			Assert::AreEqual(hist.Percentile(100.0), 1000.0);
+			Assert::AreEqual(hist.Max(), 1000.0);
+			// Percentiles are within bucket resolution (~2.2%)
+			Assert::AreEqual(hist.Percentile(50.0), 500.0, 500.0 * 0.022);
+			Assert::AreEqual(hist.Percentile(90.0), 900.0, 900.0 * 0.022);
+			Assert::AreEqual(hist.Percentile(99.0), 990.0, 990.0 * 0.022);
+		}
+
+		TEST_METHOD(test_log_histogram_zero)
+		{
+			LogHistogram hist;
+			hist.Add(0.0);
+			hist.Add(0.0);
+			hist.Add(0.0);
+			hist.Add(5.0);
+
+			Assert::AreEqual(hist.Percentile(50.0), 0.0);
+			Assert::AreEqual(hist.Percentile(75.0), 0.0);
+			Assert::AreEqual(hist.Percentile(100.0), 5.0);
+		}
+
+		TEST_METHOD(test_ddr_bw_monitor_bandwidth)
+		{
+			// 128 bytes per `rdwr`
+			Assert::AreEqual(DdrBandwidthMonitor::Bandwidth(1000000, 1.0), 128.0);
+			Assert::AreEqual(DdrBandwidthMonitor::Bandwidth(1000000, 0.5), 256.0);
+			Assert::AreEqual(DdrBandwidthMonitor::Bandwidth(1000000, 0.0), 0.0);
+		}
+
+		TEST_METHOD(test_ddr_bw_monitor_update)
+		{
+			DdrBandwidthMonitor mon({ 0, 1 });
+			mon.Start(10.0, { 100, 200 });
+
+			// 10ms, ch0: 100000 rdwr, ch1: 300000 rdwr
+			Assert::IsTrue(mon.Update(10.01, { 100100, 300200 }));
+			const auto& s = mon.Last();
+			Assert::AreEqual(s.time, 10.01);
+			Assert::AreEqual(s.interval, 0.01, 1e-9);
+			Assert::AreEqual(s.channel.size(), size_t(2));
+			Assert::AreEqual(s.channel[0], 1280.0, 1e-6);
+			Assert::AreEqual(s.channel[1], 3840.0, 1e-6);
+			Assert::AreEqual(s.total, 5120.0, 1e-6);
+			Assert::AreEqual(s.imbalance, 1.5, 1e-9);	// 3840 / 2560
+
+			Assert::AreEqual(mon.Samples(), uint64_t(1));
+			Assert::AreEqual(mon.Share(0), 25.0);
+			Assert::AreEqual(mon.Share(1), 75.0);
+			Assert::AreEqual(mon.Duration(), 0.01, 1e-9);
+		}
+
+		TEST_METHOD(test_ddr_bw_monitor_stale)
+		{
+			DdrBandwidthMonitor mon({ 0, 1 }, 0.05);
+			mon.Start(0.0, { 0, 0 });
+
+			// Driver did not publish new values yet, read is merged into next sample
+			Assert::IsFalse(mon.Update(0.01, { 0, 0 }));
+			Assert::IsTrue(mon.Update(0.02, { 1000, 1000 }));
+			Assert::AreEqual(mon.Last().interval, 0.02, 1e-9);
+
+			// Nothing moved for `stale` seconds, idle sample
+			Assert::IsFalse(mon.Update(0.06, { 1000, 1000 }));
+			Assert::IsTrue(mon.Update(0.07, { 1000, 1000 }));
+			Assert::AreEqual(mon.Last().total, 0.0);
+			Assert::AreEqual(mon.Last().imbalance, 0.0);
+
+			Assert::AreEqual(mon.Samples(), uint64_t(2));
+			Assert::AreEqual(mon.Imbalance().Count(), uint64_t(1));	// Idle samples have no imbalance
+		}
+
+		TEST_METHOD(test_ddr_bw_monitor_reset)
+		{
+			DdrBandwidthMonitor mon({ 3 });
+			mon.Start(0.0, { 5000 });
+
+			// Counters went backwards (reset), new baseline
+			Assert::IsFalse(mon.Update(0.01, { 10 }));
+			Assert::IsTrue(mon.Update(0.02, { 1010 }));
+			Assert::AreEqual(mon.Last().interval, 0.01, 1e-9);
+			Assert::AreEqual(mon.Last().channel[0], DdrBandwidthMonitor::Bandwidth(1000, 0.01));
+
+			// Channel count mismatch and time going backwards are ignored
+			Assert::IsFalse(mon.Update(0.03, { 1, 2 }));
+			Assert::IsFalse(mon.Update(0.01, { 2000 }));
+		}
+
+		TEST_METHOD(test_ddr_bw_monitor_percentiles)
+		{
+			DdrBandwidthMonitor mon({ 0 });
+			mon.Start(0.0, { 0 });
+
+			uint64_t rdwr = 0;
+			for (int i = 1; i <= 100; i++)
+			{
+				rdwr += 1000 * i;
+				Assert::IsTrue(mon.Update(i * 0.001, { rdwr }));
+			}
+
+			// Sample i is 1000 * i rdwr in 1ms = 128 * i MB/s
+			Assert::AreEqual(mon.Total().Max(), 12800.0, 1e-6);
+			Assert::AreEqual(mon.Channel(0).Percentile(50.0), 6400.0, 6400.0 * 0.022);
+			Assert::AreEqual(mon.Channel(0).Percentile(99.0), 12672.0, 12672.0 * 0.022);
+			Assert::AreEqual(mon.Imbalance().Max(), 1.0);
+		}
+
+		TEST_METHOD(test_ddr_bw_monitor_csv)
+		{
+			DdrBandwidthMonitor mon({ 0, 2 });
+			mon.Start(1.0, { 0, 0 });
+			mon.Update(1.5, { 1000000, 3000000 });
+
+			std::wostringstream os;
+			mon.WriteCsvHeader(os);
+			mon.WriteCsvRow(os);
+
+			Assert::AreEqual(os.str(), std::wstring(
+				L"time (s),dmc 0 (MB/s),dmc 2 (MB/s),all (MB/s),imbalance\n"
+				L"1.500000,256.00,768.00,1024.00,1.500\n"));
+		}
+	};
+}
@@ -0,0 +1,115 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <sstream>
+#include <string>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/disassembler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_disassembler)
+	{
+	public:
+
+		TEST_METHOD(test_disassembly_cache_has)
+		{
+			DisassemblyCache cache;
+			Assert::IsFalse(cache.Has(L"a.exe", 0x1000, 0x1010));
+
+			cache.Insert(L"a.exe", 0x1000, 0x1020, {});
+			Assert::IsTrue(cache.Has(L"a.exe", 0x1000, 0x1020));
+			Assert::IsTrue(cache.Has(L"a.exe", 0x1008, 0x1010));
+			Assert::IsFalse(cache.Has(L"a.exe", 0x0ffc, 0x1010));
+			Assert::IsFalse(cache.Has(L"a.exe", 0x1010, 0x1024));
+			Assert::IsFalse(cache.Has(L"b.dll", 0x1000, 0x1010));
+		}
+
+		TEST_METHOD(test_disassembly_cache_get)
+		{
+			DisassemblyCache cache;
+			cache.Insert(L"a.exe", 0x1000, 0x100c, {
+				{ 0x1000, 0xd10043ff, L"sub   sp, sp, #0x10" },
+				{ 0x1004, 0xb9000fe0, L"str   w0, [sp, #0xc]" },
+				{ 0x1008, 0xd65f03c0, L"ret" },
+				});
+
+			auto insts = cache.Get(L"a.exe", 0x1004, 0x100c);
+			Assert::AreEqual(insts.size(), size_t(2));
+			Assert::AreEqual(insts[0].m_address, DWORD_PTR(0x1004));
+			Assert::AreEqual(insts[1].m_asm, std::wstring(L"ret"));
+
+			Assert::AreEqual(cache.Get(L"a.exe", 0x100c, 0x1010).size(), size_t(0));
+			Assert::AreEqual(cache.Get(L"b.dll", 0x1000, 0x100c).size(), size_t(0));
+			Assert::IsTrue(cache.IsModified(L"a.exe"));
+			Assert::IsFalse(cache.IsModified(L"b.dll"));
+		}
+
+		TEST_METHOD(test_disassembly_cache_save_load)
+		{
+			DisassemblyCache cache;
+			cache.Insert(L"a.exe", 0x1000, 0x1008, {
+				{ 0x1000, 0xd10043ff, L"sub   sp, sp, #0x10" },
+				{ 0x1004, 0xd65f03c0, L"ret" },
+				});
+
+			std::stringstream ss;
+			cache.Save(ss, L"a.exe");
+
+			DisassemblyCache loaded;
+			Assert::IsTrue(loaded.Load(ss, L"a.exe"));
+			Assert::IsTrue(loaded.Has(L"a.exe", 0x1000, 0x1008));
+			Assert::IsFalse(loaded.IsModified(L"a.exe"));
+
+			auto insts = loaded.Get(L"a.exe", 0x1000, 0x1008);
+			Assert::AreEqual(insts.size(), size_t(2));
+			Assert::AreEqual(insts[0].m_instruction, DWORD_PTR(0xd10043ff));
+			Assert::AreEqual(insts[0].m_asm, std::wstring(L"sub   sp, sp, #0x10"));
+			Assert::AreEqual(insts[1].m_asm, std::wstring(L"ret"));
+		}
+
+		TEST_METHOD(test_disassembly_cache_load_invalid)
+		{
+			DisassemblyCache cache;
+			std::stringstream bad_magic("wperf-dasm-cache 0\nR 1000 1008\n");
+			Assert::IsFalse(cache.Load(bad_magic, L"a.exe"));
+
+			std::stringstream bad_record("wperf-dasm-cache 1\nX 1000 1008\n");
+			Assert::IsFalse(cache.Load(bad_record, L"a.exe"));
+			Assert::IsFalse(cache.Has(L"a.exe", 0x1000, 0x1008));
+		}
+	};
+}
@@ -0,0 +1,97 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <sstream>
+#include <string>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/folded.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_folded)
+	{
+	public:
+
+		TEST_METHOD(test_folded_add_unique_stacks)
+		{
+			FoldedStacks fs;
+			fs.add(0x1b, { L"main", L"foo" });
+			fs.add(0x1b, { L"main", L"foo" });
+			fs.add(0x1b, { L"bar" }, 3);
+			fs.add(0x1b, {});
+
+			Assert::AreEqual(fs.size(0x1b), size_t(2));
+			Assert::AreEqual(fs.size(0x70), size_t(0));
+
+			std::stringstream ss;
+			fs.write(ss, 0x1b);
+			Assert::AreEqual(ss.str(), std::string("bar 3\nmain;foo 2\n"));
+		}
+
+		TEST_METHOD(test_folded_event_sources)
+		{
+			FoldedStacks fs;
+			fs.add(0x70, { L"foo" });
+			fs.add(0x1b, { L"foo" });
+			fs.add(0x70, { L"bar" });
+
+			std::vector<uint32_t> expected = { 0x1b, 0x70 };
+			Assert::IsTrue(fs.get_event_sources() == expected);
+
+			std::stringstream ss;
+			fs.write(ss, 0x70);
+			Assert::AreEqual(ss.str(), std::string("bar 1\nfoo 1\n"));
+
+			std::stringstream empty;
+			fs.write(empty, 0x11);
+			Assert::AreEqual(empty.str(), std::string(""));
+		}
+
+		TEST_METHOD(test_folded_sanitize_frame)
+		{
+			Assert::AreEqual(FoldedStacks::sanitize_frame(L"x_mul:python312_d.dll"), std::wstring(L"x_mul:python312_d.dll"));
+			Assert::AreEqual(FoldedStacks::sanitize_frame(L"a;b"), std::wstring(L"a:b"));
+			Assert::AreEqual(FoldedStacks::sanitize_frame(L"a\r\nb"), std::wstring(L"a  b"));
+			Assert::AreEqual(FoldedStacks::sanitize_frame(L""), std::wstring(L"unknown"));
+		}
+
+		TEST_METHOD(test_folded_gen_filename)
+		{
+			Assert::AreEqual(FoldedStacks::gen_filename(L"python_d", L"ld_spec"), std::wstring(L"python_d.ld_spec.folded"));
+			Assert::AreEqual(FoldedStacks::gen_filename(L"out\\python_d", L"cycle"), std::wstring(L"out\\python_d.cycle.folded"));
+		}
+	};
+}
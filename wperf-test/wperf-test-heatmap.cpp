@@ -0,0 +1,131 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <iomanip>
+#include <sstream>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/heatmap.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_heatmap)
+	{
+	public:
+
+		TEST_METHOD(test_heatmap_summarize)
+		{
+			CoreHeatmap::Summary s = CoreHeatmap::Summarize({ 5.0, 1.0, 4.0, 2.0, 3.0 });
+			Assert::AreEqual(s.min, 1.0);
+			Assert::AreEqual(s.median, 3.0);
+			Assert::AreEqual(s.p99, 5.0);
+			Assert::AreEqual(s.max, 5.0);
+			Assert::AreEqual(s.mean, 3.0);
+
+			std::vector<double> values;
+			for (int i = 1; i <= 200; i++)
+				values.push_back(i);
+			s = CoreHeatmap::Summarize(values);
+			Assert::AreEqual(s.median, 100.0);
+			Assert::AreEqual(s.p99, 198.0);
+		}
+
+		TEST_METHOD(test_heatmap_summarize_empty)
+		{
+			CoreHeatmap::Summary s = CoreHeatmap::Summarize({});
+			Assert::AreEqual(s.min, 0.0);
+			Assert::AreEqual(s.max, 0.0);
+			Assert::AreEqual(s.mean, 0.0);
+		}
+
+		TEST_METHOD(test_heatmap_add_interval)
+		{
+			CoreHeatmap heatmap({ 0, 2, 5 }, { L"ipc", L"backend_stalled_cycles" });
+
+			heatmap.AddInterval(0.1, { { 1.0, 2.0, 3.0 }, { 10.0, 20.0, 30.0 } });
+			heatmap.AddInterval(0.2, { { 3.0, 2.0, 1.0 }, { 50.0 } });	// Missing values are 0
+
+			Assert::AreEqual(heatmap.Intervals(), size_t(2));
+			Assert::AreEqual(heatmap.Time(1), 0.2);
+			Assert::AreEqual(heatmap.Value(0, 0, 2), 3.0);
+			Assert::AreEqual(heatmap.Value(0, 1, 0), 3.0);
+			Assert::AreEqual(heatmap.Value(1, 1, 0), 50.0);
+			Assert::AreEqual(heatmap.Value(1, 1, 1), 0.0);
+
+			Assert::AreEqual(heatmap.CoreMean(0, 0), 2.0);
+			Assert::AreEqual(heatmap.CoreMean(1, 2), 15.0);
+
+			CoreHeatmap::Summary s = heatmap.IntervalSummary(1, 0);
+			Assert::AreEqual(s.min, 10.0);
+			Assert::AreEqual(s.median, 20.0);
+			Assert::AreEqual(s.max, 30.0);
+
+			// Core means of ipc are 2.0, 2.0, 2.0
+			s = heatmap.CoreSummary(0);
+			Assert::AreEqual(s.min, 2.0);
+			Assert::AreEqual(s.max, 2.0);
+		}
+
+		TEST_METHOD(test_heatmap_csv)
+		{
+			CoreHeatmap heatmap({ 0, 1 }, { L"ipc", L"l1d_cache_mpki" });
+			heatmap.AddInterval(0.5, { { 1.5, 0.5 }, { 4.0, 8.0 } });
+
+			std::wostringstream os;
+			heatmap.WriteCsv(os);
+
+			Assert::AreEqual(os.str(), std::wstring(
+				L"metric,ipc\n"
+				L"time (s),core 0,core 1,min,median,p99\n"
+				L"0.500,1.500,0.500,0.500,0.500,1.500\n"
+				L"\n"
+				L"metric,l1d_cache_mpki\n"
+				L"time (s),core 0,core 1,min,median,p99\n"
+				L"0.500,4.000,8.000,4.000,4.000,8.000\n"));
+		}
+
+		TEST_METHOD(test_heatmap_csv_keeps_stream_format)
+		{
+			CoreHeatmap heatmap({ 0 }, { L"ipc" });
+			heatmap.AddInterval(0.5, { { 1.5 } });
+
+			std::wostringstream os;
+			os << std::scientific << std::setprecision(9);
+			heatmap.WriteCsv(os);
+
+			Assert::IsTrue((os.flags() & std::ios_base::floatfield) == std::ios_base::scientific);
+			Assert::AreEqual(os.precision(), std::streamsize(9));
+		}
+	};
+}
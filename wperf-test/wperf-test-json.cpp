@@ -190,5 +190,38 @@ namespace wperftest
 				Assert::AreEqual(std::string("{\"key1\":\"97\"}"), ss.str());
 			}
 		}
+
+		TEST_METHOD(test_json_escape)
+		{
+			{
+				std::wstringstream ss;
+				JSONEscape(ss, std::wstring(L"C:\\Windows\\System32\\ntoskrnl.exe"));
+				Assert::AreEqual(std::wstring(L"C:\\\\Windows\\\\System32\\\\ntoskrnl.exe"), ss.str());
+			}
+			{
+				std::wstringstream ss;
+				JSONEscape(ss, std::wstring(L"operator\"\"_km\r\n\tx"));
+				Assert::AreEqual(std::wstring(L"operator\\\"\\\"_km\\r\\n\\tx"), ss.str());
+			}
+			{
+				std::stringstream ss;
+				JSONEscape(ss, std::string("\x01" "a" "\x1f"));
+				Assert::AreEqual(std::string("\\u0001a\\u001f"), ss.str());
+			}
+			{
+				std::stringstream ss;
+				JSONEscape(ss, std::string(""));
+				Assert::AreEqual(std::string(""), ss.str());
+			}
+		}
+
+		TEST_METHOD(test_jsonobject_escape)
+		{
+			JSONObject<std::wstring, false, true, wchar_t> obj;
+			obj.m_map[L"pe file"] = L"C:\\a \"b\"\n";
+			std::wstringstream ss;
+			ss << obj;
+			Assert::AreEqual(std::wstring(L"{\"pe_file\":\"C:\\\\a \\\"b\\\"\\n\"}"), ss.str());
+		}
 	};
 }
@@ -0,0 +1,148 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <sstream>
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/json_writer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_json_writer)
+	{
+	public:
+
+		TEST_METHOD(test_utf8_encoder_ascii)
+		{
+			Utf8Encoder encoder;
+			std::string out;
+			std::wstring in = L"{\"core\": 1}";
+			encoder.Append(out, in.c_str(), in.size());
+			encoder.Finish(out);
+			Assert::AreEqual(std::string("{\"core\": 1}"), out);
+		}
+
+		TEST_METHOD(test_utf8_encoder_multibyte)
+		{
+			Utf8Encoder encoder;
+			std::string out;
+			std::wstring in = L"\u00e9\u20ac\U0001F600";	// 2, 3 and 4 byte sequences
+			encoder.Append(out, in.c_str(), in.size());
+			encoder.Finish(out);
+			Assert::AreEqual(std::string("\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"), out);
+		}
+
+		TEST_METHOD(test_utf8_encoder_split_surrogates)
+		{
+			Utf8Encoder encoder;
+			std::string out;
+			const wchar_t high = static_cast<wchar_t>(0xD83D);
+			const wchar_t low = static_cast<wchar_t>(0xDE00);
+			encoder.Append(out, &high, 1);
+			Assert::AreEqual(std::string(""), out);
+			encoder.Append(out, &low, 1);
+			encoder.Finish(out);
+			Assert::AreEqual(std::string("\xF0\x9F\x98\x80"), out);
+		}
+
+		TEST_METHOD(test_utf8_encoder_unpaired_surrogates)
+		{
+			{
+				Utf8Encoder encoder;
+				std::string out;
+				const wchar_t in[] = { static_cast<wchar_t>(0xD83D), L'a' };
+				encoder.Append(out, in, 2);
+				encoder.Finish(out);
+				Assert::AreEqual(std::string("\xEF\xBF\xBD" "a"), out);
+			}
+			{
+				Utf8Encoder encoder;
+				std::string out;
+				const wchar_t in[] = { static_cast<wchar_t>(0xDE00) };
+				encoder.Append(out, in, 1);
+				encoder.Finish(out);
+				Assert::AreEqual(std::string("\xEF\xBF\xBD"), out);
+			}
+			{
+				Utf8Encoder encoder;
+				std::string out;
+				const wchar_t in[] = { static_cast<wchar_t>(0xD83D) };
+				encoder.Append(out, in, 1);
+				encoder.Finish(out);
+				Assert::AreEqual(std::string("\xEF\xBF\xBD"), out);
+			}
+		}
+
+		TEST_METHOD(test_json_stream_buffer_wchar)
+		{
+			std::ostringstream sink;
+			{
+				JSONStreamBuffer<wchar_t> buffer(sink);
+				std::wostream os(&buffer);
+				os << L"{\"pe_file\": \"C:\\\\caf\u00e9.exe\"," << std::endl << L"\"count\": " << 42 << L"}";
+			}
+			Assert::AreEqual(std::string("{\"pe_file\": \"C:\\\\caf\xC3\xA9.exe\",\n\"count\": 42}"), sink.str());
+		}
+
+		TEST_METHOD(test_json_stream_buffer_large)
+		{
+			// Document larger than buffer is drained in chunks
+			const size_t size = 3 * JSONStreamBuffer<wchar_t>::m_BUFFER_SIZE + 7;
+			std::ostringstream sink;
+			{
+				JSONStreamBuffer<wchar_t> buffer(sink);
+				std::wostream os(&buffer);
+				for (size_t i = 0; i < size; i++)
+					os << L'\u00e9';
+			}
+			std::string expected;
+			for (size_t i = 0; i < size; i++)
+				expected += "\xC3\xA9";
+			Assert::AreEqual(expected.size(), sink.str().size());
+			Assert::IsTrue(expected == sink.str());
+		}
+
+		TEST_METHOD(test_json_stream_buffer_char)
+		{
+			std::ostringstream sink;
+			{
+				JSONStreamBuffer<char> buffer(sink);
+				std::ostream os(&buffer);
+				os << "{\"samples\": " << 10 << "}";
+			}
+			Assert::AreEqual(std::string("{\"samples\": 10}"), sink.str());
+		}
+	};
+}
@@ -221,5 +221,50 @@ namespace wperftest_metric
 			}
 		}
 
+		TEST_METHOD(test_metric_SY_Algorithm_calculations_lanes)
+		{
+			std::wstring formula_sy = L"stall_backend cpu_cycles / 100 *";
+
+			std::map<std::wstring, std::vector<double>> vars = {
+				{std::wstring(L"stall_backend"), { 10, 250, 7, 0 }},
+				{std::wstring(L"cpu_cycles"), { 100, 1000, 0, 50 }},	// 3rd lane divides by zero
+			};
+
+			std::vector<double> val_sy = metric_calculate_shunting_yard_expression(vars, formula_sy, 4);
+
+			Assert::AreEqual(val_sy.size(), size_t(4));
+			Assert::AreEqual(val_sy[0], 10.0);
+			Assert::AreEqual(val_sy[1], 25.0);
+			Assert::AreEqual(val_sy[2], 0.0);
+			Assert::AreEqual(val_sy[3], 0.0);
+
+			// Every lane gives the same result as scalar calculation
+			for (size_t i = 0; i < 4; i++)
+			{
+				std::map<std::wstring, double> vars_scalar = {
+					{std::wstring(L"stall_backend"), vars[L"stall_backend"][i]},
+					{std::wstring(L"cpu_cycles"), vars[L"cpu_cycles"][i]},
+				};
+				Assert::AreEqual(metric_calculate_shunting_yard_expression(vars_scalar, formula_sy), val_sy[i]);
+			}
+		}
+
+		TEST_METHOD(test_metric_SY_Algorithm_calculations_lanes_div_zero)
+		{
+			// Division by zero anywhere in the formula zeroes the lane, like scalar version
+			std::wstring formula_sy = L"a b / c +";
+
+			std::map<std::wstring, std::vector<double>> vars = {
+				{std::wstring(L"a"), { 1, 1 }},
+				{std::wstring(L"b"), { 0, 2 }},
+				{std::wstring(L"c"), { 5, 5 }},
+			};
+
+			std::vector<double> val_sy = metric_calculate_shunting_yard_expression(vars, formula_sy, 2);
+
+			Assert::AreEqual(val_sy[0], 0.0);
+			Assert::AreEqual(val_sy[1], 5.5);
+		}
+
 	};
 }
@@ -0,0 +1,126 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/module_map.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_module_map)
+	{
+		static ModuleMapEntry module(const wchar_t* name, uint64_t base, uint64_t size)
+		{
+			ModuleMapEntry e;
+			e.name = name;
+			e.path = std::wstring(L"C:\\Windows\\System32\\") + name;
+			e.base = base;
+			e.size = size;
+			return e;
+		}
+
+	public:
+
+		TEST_METHOD(test_module_map_first_snapshot)
+		{
+			ModuleMap map;
+			std::vector<size_t> added = map.Update(500, { module(L"ntdll.dll", 0x10000, 0x1000), module(L"KERNEL32.DLL", 0x20000, 0x2000) });
+
+			Assert::AreEqual(added.size(), size_t(2));
+			Assert::AreEqual(map.GetEntries().size(), size_t(2));
+
+			// Modules from first snapshot are loaded since the beginning
+			Assert::AreEqual(map.GetEntries()[0].load_time, uint64_t(0));
+			Assert::AreEqual(map.GetEntries()[0].unload_time, ModuleMap::m_LOADED);
+
+			const ModuleMapEntry* e = map.Find(0x20010, 0, 100);
+			Assert::IsNotNull(e);
+			Assert::AreEqual(e->name, std::wstring(L"KERNEL32.DLL"));
+
+			Assert::IsNull(map.Find(0x22000, 0, 100));		// Past end of module
+			Assert::IsNull(map.Find(0x0ffff, 0, 100));
+		}
+
+		TEST_METHOD(test_module_map_load)
+		{
+			ModuleMap map;
+			map.Update(100, { module(L"ntdll.dll", 0x10000, 0x1000) });
+			std::vector<size_t> added = map.Update(200, { module(L"ntdll.dll", 0x10000, 0x1000), module(L"plugin.dll", 0x30000, 0x1000) });
+
+			Assert::AreEqual(added.size(), size_t(1));
+			Assert::AreEqual(map.GetEntries()[added[0]].name, std::wstring(L"plugin.dll"));
+			Assert::AreEqual(map.GetEntries()[added[0]].load_time, uint64_t(200));
+
+			Assert::IsNull(map.Find(0x30000, 0, 100));						// Sampled before it was loaded
+			Assert::IsNotNull(map.Find(0x30000, 100, 200));					// Loaded during interval
+			Assert::IsNotNull(map.Find(0x30000, 200, 300));
+		}
+
+		TEST_METHOD(test_module_map_unload_reload)
+		{
+			ModuleMap map;
+			map.Update(100, { module(L"a.dll", 0x30000, 0x1000) });
+			map.Update(200, {});
+			map.Update(300, { module(L"b.dll", 0x30000, 0x2000) });
+
+			Assert::AreEqual(map.GetEntries().size(), size_t(2));
+			Assert::AreEqual(map.GetEntries()[0].unload_time, uint64_t(200));
+
+			Assert::AreEqual(map.Find(0x30000, 0, 100)->name, std::wstring(L"a.dll"));
+			Assert::AreEqual(map.Find(0x30000, 100, 200)->name, std::wstring(L"a.dll"));	// Unloaded during interval
+			Assert::IsNull(map.Find(0x30000, 200, 250));
+			Assert::AreEqual(map.Find(0x30000, 250, 300)->name, std::wstring(L"b.dll"));
+			Assert::AreEqual(map.Find(0x31000, 300, 400)->name, std::wstring(L"b.dll"));
+
+			// Both a.dll and b.dll were loaded at some point, the latest one wins
+			Assert::AreEqual(map.Find(0x30000, 0, 400)->name, std::wstring(L"b.dll"));
+		}
+
+		TEST_METHOD(test_module_map_rebase)
+		{
+			ModuleMap map;
+			map.Update(100, { module(L"a.dll", 0x30000, 0x1000) });
+			std::vector<size_t> added = map.Update(200, { module(L"a.dll", 0x50000, 0x1000) });
+
+			Assert::AreEqual(added.size(), size_t(1));
+			Assert::AreEqual(map.GetEntries()[0].unload_time, uint64_t(200));
+			Assert::AreEqual(map.Find(0x50010, 200, 300)->base, uint64_t(0x50000));
+			Assert::IsNull(map.Find(0x30010, 200, 300));
+		}
+	};
+}
@@ -0,0 +1,97 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/multiplex_scaling.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_multiplex_scaling)
+	{
+	public:
+
+		TEST_METHOD(test_multiplex_scaling_not_scaled)
+		{
+			// Event was counting all the time it was enabled
+			Assert::AreEqual(MultiplexScaling::ScaledValue(1234, 5000, 5000), uint64_t(1234));
+			Assert::AreEqual(MultiplexScaling::ScalingError(1234, 5000, 5000, 10, 0, 0), 0.0);
+		}
+
+		TEST_METHOD(test_multiplex_scaling_scaled_value)
+		{
+			Assert::AreEqual(MultiplexScaling::ScaledValue(1000, 4000, 1000), uint64_t(4000));
+			Assert::AreEqual(MultiplexScaling::ScaledValue(1000, 3000, 2000), uint64_t(1500));
+			// Timer rounds fallback: scheduled 2 out of 8 rounds
+			Assert::AreEqual(MultiplexScaling::ScaledValue(500, 8, 2), uint64_t(2000));
+			// Never counting
+			Assert::AreEqual(MultiplexScaling::ScaledValue(0, 4000, 0), uint64_t(0));
+		}
+
+		TEST_METHOD(test_multiplex_scaling_error_unknown)
+		{
+			// Never counting
+			Assert::AreEqual(MultiplexScaling::ScalingError(0, 4000, 0, 0, 0, 0), MultiplexScaling::m_UNKNOWN_ERROR);
+			// Single slice has no variance estimate
+			Assert::AreEqual(MultiplexScaling::ScalingError(100, 4000, 1000, 1, 10000, 0), MultiplexScaling::m_UNKNOWN_ERROR);
+		}
+
+		TEST_METHOD(test_multiplex_scaling_error_constant)
+		{
+			// 10 slices with 100 events each, counting 1/4 of time
+			Assert::AreEqual(MultiplexScaling::ScalingError(1000, 4000, 1000, 10, 10 * 100 * 100, 0), 0.0, 1e-9);
+			// Zero events
+			Assert::AreEqual(MultiplexScaling::ScalingError(0, 4000, 1000, 10, 0, 0), 0.0);
+		}
+
+		TEST_METHOD(test_multiplex_scaling_error_variable)
+		{
+			// 10 slices, 5 with 0 and 5 with 200 events, counting 1/4 of time (40 slices):
+			// s^2 = (200000 - 1000^2 / 10) / 9, SE = 40 * sqrt(s^2 / 10 * (1 - 10 / 40)),
+			// scaled = 4000, so relative error = 28.8675%
+			Assert::AreEqual(MultiplexScaling::ScalingError(1000, 4000, 1000, 10, 5 * 200 * 200, 0), 28.8675, 1e-4);
+			// Counting more of the time lowers the error
+			Assert::IsTrue(MultiplexScaling::ScalingError(1000, 2000, 1000, 10, 5 * 200 * 200, 0) < 28.8675);
+		}
+
+		TEST_METHOD(test_multiplex_scaling_error_128bit)
+		{
+			// 4 slices with 2^32 events each, sum of squares is 2^66 (HI = 4, LO = 0)
+			const uint64_t slice = 1ull << 32;
+			Assert::AreEqual(MultiplexScaling::ScalingError(4 * slice, 8000, 4000, 4, 0, 4), 0.0, 1e-9);
+			// 2 slices with 0 and 2 with 2^33 events, relative error is 100 * sqrt(1/6)
+			Assert::AreEqual(MultiplexScaling::ScalingError(4 * slice, 8000, 4000, 4, 0, 8), 40.8248, 1e-4);
+		}
+	};
+}
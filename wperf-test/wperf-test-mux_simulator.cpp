@@ -0,0 +1,148 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/mux_simulator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_mux_simulator)
+	{
+	public:
+
+		TEST_METHOD(test_mux_simulator_no_multiplex)
+		{
+			MuxSimulator sim(4);
+			sim.AddEvent();
+			sim.AddGroup(2);
+
+			MuxSimulationResult result;
+			Assert::IsTrue(sim.Run(100, result));
+			Assert::AreEqual(result.rounds, uint64_t(100));
+			Assert::AreEqual(result.programmed, uint64_t(3));
+			for (uint64_t scheduled : result.scheduled)
+				Assert::AreEqual(scheduled, uint64_t(100));
+		}
+
+		TEST_METHOD(test_mux_simulator_groups_coscheduled)
+		{
+			MuxSimulator sim(6);
+			sim.AddGroup(3);
+			sim.AddEvent();
+			sim.AddGroup(2);
+			sim.AddEvent();
+			sim.AddGroup(4);
+			sim.AddGroup(6);
+			sim.AddEvent();
+			sim.AddGroup(5);
+
+			MuxSimulationResult result;
+			Assert::IsTrue(sim.Run(1000, result));
+			Assert::IsTrue(result.groups_coscheduled);
+			Assert::IsTrue(result.counters_exclusive);
+			for (uint64_t scheduled : result.scheduled)
+				Assert::IsTrue(scheduled > 0);
+		}
+
+		TEST_METHOD(test_mux_simulator_fair_events)
+		{
+			MuxSimulator sim(4);
+			for (int i = 0; i < 10; i++)
+				sim.AddEvent();
+
+			MuxSimulationResult result;
+			Assert::IsTrue(sim.Run(1000, result));
+			for (uint64_t scheduled : result.scheduled)
+				Assert::AreEqual(static_cast<double>(scheduled), 400.0, 1.0);
+		}
+
+		TEST_METHOD(test_mux_simulator_fair_groups)
+		{
+			// Each group needs all counters, so only one group can count at a time
+			MuxSimulator sim(4);
+			sim.AddGroup(4);
+			sim.AddGroup(3);
+			sim.AddGroup(4);
+
+			MuxSimulationResult result;
+			Assert::IsTrue(sim.Run(999, result));
+			Assert::IsTrue(result.groups_coscheduled);
+			for (uint64_t scheduled : result.scheduled)
+				Assert::AreEqual(scheduled, uint64_t(333));
+		}
+
+		TEST_METHOD(test_mux_simulator_weights)
+		{
+			MuxSimulator sim(4);
+			sim.AddGroup(4, 2);
+			sim.AddGroup(4, 1);
+			sim.AddEvent(3);
+			sim.AddEvent(3);
+
+			MuxSimulationResult result;
+			Assert::IsTrue(sim.Run(900, result));
+			Assert::IsTrue(result.groups_coscheduled);
+
+			// Single events share one round together, so the units compete as 2:1:3
+			Assert::AreEqual(static_cast<double>(result.scheduled[0]), 300.0, 1.0);
+			Assert::AreEqual(static_cast<double>(result.scheduled[4]), 150.0, 1.0);
+			Assert::AreEqual(static_cast<double>(result.scheduled[8]), 450.0, 1.0);
+			Assert::AreEqual(result.scheduled[8], result.scheduled[9]);
+		}
+
+		TEST_METHOD(test_mux_simulator_reprogramming)
+		{
+			// Only one event rotates each round, others keep their counters
+			MuxSimulator sim(4);
+			for (int i = 0; i < 5; i++)
+				sim.AddEvent();
+
+			MuxSimulationResult result;
+			Assert::IsTrue(sim.Run(1000, result));
+			Assert::IsTrue(result.programmed <= 4 + 1000);
+			for (uint64_t scheduled : result.scheduled)
+				Assert::AreEqual(static_cast<double>(scheduled), 800.0, 1.0);
+		}
+
+		TEST_METHOD(test_mux_simulator_group_too_big)
+		{
+			MuxSimulator sim(4);
+			sim.AddEvent();
+			sim.AddGroup(5);
+
+			MuxSimulationResult result;
+			Assert::IsFalse(sim.Run(10, result));
+		}
+	};
+}
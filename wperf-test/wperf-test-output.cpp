@@ -1,100 +0,0 @@
-// BSD 3-Clause License
-//
-// Copyright (c) 2024, Arm Limited
-// All rights reserved.
-//
-// Redistribution and use in source and binary forms, with or without
-// modification, are permitted provided that the following conditions are met:
-//
-// 1. Redistributions of source code must retain the above copyright notice, this
-//    list of conditions and the following disclaimer.
-//
-// 2. Redistributions in binary form must reproduce the above copyright notice,
-//    this list of conditions and the following disclaimer in the documentation
-//    and/or other materials provided with the distribution.
-//
-// 3. Neither the name of the copyright holder nor the names of its
-//    contributors may be used to endorse or promote products derived from
-//    this software without specific prior written permission.
-//
-// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
-// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
-// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
-// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
-// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
-// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
-// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
-// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
-// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-
-#include <sstream>
-#include "pch.h"
-#include "CppUnitTest.h"
-
-#include "wperf/output.h"
-
-using namespace Microsoft::VisualStudio::CppUnitTestFramework;
-
-namespace wperftest
-{
-	template <typename CharType>
-	struct UnitTestOutputTraits : public TableOutputTraits<CharType>
-	{
-		typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
-	};
-
-	TEST_CLASS(wperftest_output)
-	{
-	public:
-		TEST_METHOD(test_output_escapestr_char)
-		{
-			using CharType = char;
-			using StringType = UnitTestOutputTraits<CharType>::StringType;
-
-			// Test empy string
-			{
-				StringType my_str = LITERALCONSTANTS_GET("");
-				OutputControl<CharType> oc;
-				Assert::AreEqual(my_str, oc.EscapeStr(my_str));
-			}
-			// Test single
-			{
-				StringType my_str = LITERALCONSTANTS_GET("\\");
-				OutputControl<CharType> oc;
-				Assert::AreEqual(StringType(LITERALCONSTANTS_GET("\\\\")), oc.EscapeStr(my_str));
-			}
-			// Test complex
-			{
-				StringType my_str = LITERALCONSTANTS_GET("/\\nobody\\expects\\the\\spanish\\inquisition/\\");
-				OutputControl<CharType> oc;
-				Assert::AreEqual(StringType(LITERALCONSTANTS_GET("/\\\\nobody\\\\expects\\\\the\\\\spanish\\\\inquisition/\\\\")), oc.EscapeStr(my_str));
-			}
-		}
-
-		TEST_METHOD(test_output_escapestr_wchar)
-		{
-			using CharType = wchar_t;
-			using StringType = UnitTestOutputTraits<CharType>::StringType;
-
-			// Test empy string
-			{
-				StringType my_str = LITERALCONSTANTS_GET("");
-				OutputControl<CharType> oc;
-				Assert::AreEqual(my_str, oc.EscapeStr(my_str));
-			}
-			// Test single
-			{
-				StringType my_str = LITERALCONSTANTS_GET("\\");
-				OutputControl<CharType> oc;
-				Assert::AreEqual(StringType(LITERALCONSTANTS_GET("\\\\")), oc.EscapeStr(my_str));
-			}
-			// Test complex
-			{
-				StringType my_str = LITERALCONSTANTS_GET("/\\nobody\\expects\\the\\spanish\\inquisition/\\");
-				OutputControl<CharType> oc;
-				Assert::AreEqual(StringType(LITERALCONSTANTS_GET("/\\\\nobody\\\\expects\\\\the\\\\spanish\\\\inquisition/\\\\")), oc.EscapeStr(my_str));
-			}
-		}
-	};
-}
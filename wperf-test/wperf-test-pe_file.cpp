@@ -30,10 +30,12 @@
 
 
 #include <string>
+#include <vector>
 
 #include "pch.h"
 #include "CppUnitTest.h"
 
+#include "wperf-common/macros.h"
 #include "wperf/pe_file.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -82,5 +84,59 @@ namespace wperftest
 			Assert::AreEqual(gen_pdb_name(L"api-ms-win-crt-runtime-l1-1.2.3.dll"), std::wstring(L"api-ms-win-crt-runtime-l1-1.2.3.pdb"));
 			Assert::AreEqual(gen_pdb_name(L".lots.of.dots.in.filename....dll"), std::wstring(L".lots.of.dots.in.filename....pdb"));
 		}
+
+		TEST_METHOD(test_find_image_symbol)
+		{
+			std::vector<SectionDesc> sec_info(2);
+			sec_info[0].idx = 0;
+			sec_info[0].offset = 0x1000;
+			sec_info[1].idx = 1;
+			sec_info[1].offset = 0x8000;
+
+			std::vector<FuncSymDesc> sym_info(3);
+			sym_info[0] = { 1, 0x100, 0x0, L"main" };
+			sym_info[1] = { 1, 0x40, 0x100, L"foo" };
+			sym_info[2] = { 2, 0x80, 0x20, L"bar" };
+
+			const uint64_t load_base = 0x140000000;
+			Assert::IsTrue(find_image_symbol(load_base + 0x1000, sym_info, sec_info, load_base) == &sym_info[0]);
+			Assert::IsTrue(find_image_symbol(load_base + 0x10FF, sym_info, sec_info, load_base) == &sym_info[0]);
+			Assert::IsTrue(find_image_symbol(load_base + 0x1100, sym_info, sec_info, load_base) == &sym_info[1]);
+			Assert::IsTrue(find_image_symbol(load_base + 0x8020, sym_info, sec_info, load_base) == &sym_info[2]);
+			Assert::IsNull(find_image_symbol(load_base + 0x1140, sym_info, sec_info, load_base));
+			Assert::IsNull(find_image_symbol(load_base + 0x8000, sym_info, sec_info, load_base));
+			Assert::IsNull(find_image_symbol(0x1000, sym_info, sec_info, load_base));
+		}
+
+		TEST_METHOD(test_add_resolved_sample)
+		{
+			std::vector<SampleDesc> resolved_samples;
+			SampleDesc sd;
+
+			sd.desc.name = L"foo";
+			add_resolved_sample(resolved_samples, sd, 0x08, 0x1000, 1, 100);
+			add_resolved_sample(resolved_samples, sd, 0x08, 0x1004, 2, 100);
+			add_resolved_sample(resolved_samples, sd, 0x08, 0x1000, 1, 200);
+			add_resolved_sample(resolved_samples, sd, CYCLE_EVT_IDX, 0x1000, 1, 300);
+			sd.desc.name = L"bar";
+			add_resolved_sample(resolved_samples, sd, 0x08, 0x2000, 3, 400);
+
+			Assert::AreEqual(resolved_samples.size(), size_t(3));
+
+			Assert::IsTrue(resolved_samples[0].desc.name == L"foo");
+			Assert::AreEqual(resolved_samples[0].event_src, uint32_t(0x08));
+			Assert::AreEqual(resolved_samples[0].freq, uint32_t(4));
+			Assert::AreEqual(resolved_samples[0].period, uint64_t(400));
+			Assert::AreEqual(resolved_samples[0].pc.size(), size_t(2));
+			Assert::AreEqual(resolved_samples[0].pc[0].second, uint64_t(2));
+			Assert::AreEqual(resolved_samples[0].pc[1].second, uint64_t(2));
+
+			Assert::AreEqual(resolved_samples[1].event_src, uint32_t(CYCLE_EVT_IDX));
+			Assert::AreEqual(resolved_samples[1].freq, uint32_t(1));
+
+			Assert::IsTrue(resolved_samples[2].desc.name == L"bar");
+			Assert::AreEqual(resolved_samples[2].freq, uint32_t(3));
+			Assert::AreEqual(resolved_samples[2].period, uint64_t(400));
+		}
 	};
 }
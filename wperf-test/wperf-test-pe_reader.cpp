@@ -0,0 +1,175 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/pe_reader.h"
+#include "fixtures/pe_fixtures.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_pe_reader)
+	{
+	public:
+
+		TEST_METHOD(test_pe_reader_headers)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_dll, sizeof pe_fixture_arm64_dll)), int(PeReader::PE_OK));
+			Assert::AreEqual(pe.m_machine, PeReader::m_MACHINE_ARM64);
+			Assert::AreEqual(pe.m_entry_point, uint32_t(0x1000));
+			Assert::AreEqual(pe.m_image_base, uint64_t(0x180000000));
+			Assert::AreEqual(pe.m_size_of_image, uint32_t(0x3000));
+			Assert::AreEqual(pe.m_time_date_stamp, uint32_t(0));
+		}
+
+		TEST_METHOD(test_pe_reader_sections)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_dll, sizeof pe_fixture_arm64_dll)), int(PeReader::PE_OK));
+			Assert::AreEqual(pe.m_sections.size(), size_t(2));
+
+			Assert::AreEqual(pe.m_sections[0].name, std::string(".text"));
+			Assert::AreEqual(pe.m_sections[0].virtual_address, uint32_t(0x1000));
+			Assert::AreEqual(pe.m_sections[0].virtual_size, uint32_t(8));
+			Assert::AreEqual(pe.m_sections[0].raw_offset, uint32_t(0x200));
+			Assert::AreEqual(pe.m_sections[0].raw_size, uint32_t(0x200));
+
+			Assert::AreEqual(pe.m_sections[1].name, std::string(".rdata"));
+			Assert::AreEqual(pe.m_sections[1].virtual_address, uint32_t(0x2000));
+			Assert::AreEqual(pe.m_sections[1].raw_offset, uint32_t(0x400));
+		}
+
+		TEST_METHOD(test_pe_reader_rva_to_offset)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_dll, sizeof pe_fixture_arm64_dll)), int(PeReader::PE_OK));
+
+			size_t offset = 0;
+			Assert::IsTrue(pe.RvaToOffset(0x1004, offset));
+			Assert::AreEqual(offset, size_t(0x204));
+			Assert::IsTrue(pe.RvaToOffset(0x3c, offset));
+			Assert::AreEqual(offset, size_t(0x3c));
+			Assert::IsFalse(pe.RvaToOffset(0x1200, offset));	// Past raw data of .text
+			Assert::IsFalse(pe.RvaToOffset(0x10000, offset));
+		}
+
+		TEST_METHOD(test_pe_reader_imports_exports)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_dll, sizeof pe_fixture_arm64_dll)), int(PeReader::PE_OK));
+
+			Assert::AreEqual(pe.m_imports.size(), size_t(2));
+			Assert::AreEqual(pe.m_imports[0], std::string("KERNEL32.dll"));
+			Assert::AreEqual(pe.m_imports[1], std::string("VCRUNTIME140.dll"));
+
+			Assert::AreEqual(pe.m_exports.size(), size_t(2));
+			Assert::AreEqual(pe.m_exports[0], std::string("fixture_add"));
+			Assert::AreEqual(pe.m_exports[1], std::string("fixture_mul"));
+		}
+
+		TEST_METHOD(test_pe_reader_codeview)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_dll, sizeof pe_fixture_arm64_dll)), int(PeReader::PE_OK));
+
+			Assert::IsTrue(pe.m_has_codeview);
+			Assert::AreEqual(pe.m_pdb_age, uint32_t(3));
+			Assert::AreEqual(pe.m_pdb_path, std::string("C:\\build\\fixture\\fixture.pdb"));
+			Assert::AreEqual(pe.GetPdbSignature(), std::string("1F2E3D4C5B6A79880123456789ABCDEF3"));
+		}
+
+		TEST_METHOD(test_pe_reader_no_directories)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_bare, sizeof pe_fixture_arm64_bare)), int(PeReader::PE_OK));
+			Assert::AreEqual(pe.m_sections.size(), size_t(2));
+			Assert::IsTrue(pe.m_imports.empty());
+			Assert::IsTrue(pe.m_exports.empty());
+			Assert::IsFalse(pe.m_has_codeview);
+			Assert::AreEqual(pe.GetPdbSignature(), std::string());
+		}
+
+		TEST_METHOD(test_pe_reader_not_64bit)
+		{
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_x86_dll, sizeof pe_fixture_x86_dll)), int(PeReader::PE_ERROR_NOT_64BIT));
+		}
+
+		TEST_METHOD(test_pe_reader_bad_signature)
+		{
+			std::vector<uint8_t> image(pe_fixture_arm64_dll, pe_fixture_arm64_dll + sizeof pe_fixture_arm64_dll);
+			PeReader pe;
+
+			image[0] = 'X';
+			Assert::AreEqual(int(pe.Parse(image.data(), image.size())), int(PeReader::PE_ERROR_FORMAT));
+
+			image[0] = 'M';
+			image[0x40] = 'X';		// "PE\0\0"
+			Assert::AreEqual(int(pe.Parse(image.data(), image.size())), int(PeReader::PE_ERROR_FORMAT));
+
+			Assert::AreEqual(int(pe.Parse(nullptr, 0)), int(PeReader::PE_ERROR_FORMAT));
+		}
+
+		TEST_METHOD(test_pe_reader_truncated)
+		{
+			// Image cut at any point must never be read past its end
+			for (size_t size = 0; size < sizeof pe_fixture_arm64_dll; size++)
+			{
+				std::vector<uint8_t> image(pe_fixture_arm64_dll, pe_fixture_arm64_dll + size);
+				PeReader pe;
+				PeReader::Status status = pe.Parse(image.data(), image.size());
+				if (size < 0x198)		// End of section table
+					Assert::AreEqual(int(status), int(PeReader::PE_ERROR_FORMAT));
+				else
+					Assert::AreEqual(int(status), int(PeReader::PE_OK));
+			}
+		}
+
+		TEST_METHOD(test_pe_reader_truncated_tables)
+		{
+			// Headers intact, .rdata cut off: tables are skipped
+			PeReader pe;
+			Assert::AreEqual(int(pe.Parse(pe_fixture_arm64_dll, 0x400)), int(PeReader::PE_OK));
+			Assert::AreEqual(pe.m_sections.size(), size_t(2));
+			Assert::IsTrue(pe.m_imports.empty());
+			Assert::IsTrue(pe.m_exports.empty());
+			Assert::IsFalse(pe.m_has_codeview);
+		}
+	};
+}
@@ -0,0 +1,396 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <windows.h>
+#include "wperf-common/iorequest.h"
+#include "wperf/pmu_simulator.h"
+#include "wperf/pmu_device.h"
+#include "wperf/spe_device.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	// Lock the simulator and assign core events EVENTS to all cores
+	static void sim_setup(pmu_simulator& sim, const std::vector<uint16_t>& events)
+	{
+		uint32_t returned = 0;
+		struct lock_request req = { LOCK_GET };
+		enum status_flag sts = STS_BUSY;
+		Assert::IsTrue(sim.io_control(PMU_CTL_LOCK_ACQUIRE, &req, sizeof(req), &sts, sizeof(sts), returned) == pmu_backend_status::ok);
+		Assert::IsTrue(sts == STS_LOCK_AQUIRED);
+
+		std::vector<uint8_t> buf(sizeof(struct pmu_ctl_evt_assign_hdr) + sizeof(struct evt_hdr) + events.size() * sizeof(uint16_t));
+		struct pmu_ctl_evt_assign_hdr* ctl = reinterpret_cast<struct pmu_ctl_evt_assign_hdr*>(buf.data());
+		ctl->core_idx = ALL_CORE;
+		struct evt_hdr* hdr = reinterpret_cast<struct evt_hdr*>(ctl + 1);
+		hdr->evt_class = EVT_CORE;
+		hdr->num = (UINT16)events.size();
+		std::copy(events.begin(), events.end(), reinterpret_cast<uint16_t*>(hdr + 1));
+		Assert::IsTrue(sim.io_control(PMU_CTL_ASSIGN_EVENTS, buf.data(), (uint32_t)buf.size(), nullptr, 0, returned) == pmu_backend_status::ok);
+	}
+
+	static struct pmu_ctl_hdr sim_ctl_hdr(uint8_t core_idx, uint32_t flags)
+	{
+		struct pmu_ctl_hdr ctl = {};
+		ctl.cores_idx.cores_count = 1;
+		ctl.cores_idx.cores_no[0] = core_idx;
+		ctl.flags = flags;
+		return ctl;
+	}
+
+	static ReadOut sim_read(pmu_simulator& sim, uint8_t core_idx)
+	{
+		uint32_t returned = 0;
+		struct pmu_ctl_hdr ctl = sim_ctl_hdr(core_idx, CTL_FLAG_CORE);
+		auto out = std::make_unique<ReadOut>();
+		Assert::IsTrue(sim.io_control(PMU_CTL_READ_COUNTING, &ctl, sizeof(ctl), out.get(), sizeof(ReadOut), returned) == pmu_backend_status::ok);
+		Assert::AreEqual(returned, (uint32_t)sizeof(ReadOut));
+		return *out;
+	}
+
+	TEST_CLASS(wperftest_pmu_simulator)
+	{
+	public:
+
+		TEST_METHOD(test_pmu_simulator_hw_cfg)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.core_num = 64;
+			cfg.gpc_num = 4;
+			pmu_simulator sim(cfg);
+
+			uint32_t returned = 0;
+			enum pmu_ctl_action action = PMU_CTL_QUERY_HW_CFG;
+			struct hw_cfg hw = {};
+			Assert::IsTrue(sim.io_control(PMU_CTL_QUERY_HW_CFG, &action, sizeof(action), &hw, sizeof(hw), returned) == pmu_backend_status::invalid_state);
+
+			sim_setup(sim, {});
+			Assert::IsTrue(sim.io_control(PMU_CTL_QUERY_HW_CFG, &action, sizeof(action), &hw, sizeof(hw), returned) == pmu_backend_status::ok);
+			Assert::AreEqual(returned, (uint32_t)sizeof(hw));
+			Assert::AreEqual((uint32_t)hw.core_num, uint32_t(64));
+			Assert::AreEqual((uint32_t)hw.gpc_num, uint32_t(4));
+			Assert::AreEqual((uint32_t)hw.counter_idx_map[3], uint32_t(3));
+			Assert::AreEqual((uint32_t)hw.part_id, uint32_t(0xD0C));
+			Assert::IsTrue(spe_device::is_spe_supported(hw.id_aa64dfr0_value) == spe_device::is_spe_supported(UINT64(1) << 32));
+		}
+
+		TEST_METHOD(test_pmu_simulator_core_num_clamped)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.core_num = 256;
+			pmu_simulator sim(cfg);
+			Assert::AreEqual(sim.get_cfg().core_num, uint32_t(MAX_PMU_CTL_CORES_COUNT - 1));
+		}
+
+		TEST_METHOD(test_pmu_simulator_counting)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.jitter = 0;
+			cfg.event_rates = { { 0x08, 1.5 }, { 0x11, 1.0 }, { 0x03, 0.01 } };
+			pmu_simulator sim(cfg);
+			sim_setup(sim, { 0x08, 0x11, 0x03 });
+
+			uint32_t returned = 0;
+			struct pmu_ctl_hdr ctl = sim_ctl_hdr(2, CTL_FLAG_CORE);
+			Assert::IsTrue(sim.io_control(PMU_CTL_START, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+			sim.run_rounds(2, 9);
+
+			ReadOut out = sim_read(sim, 2);         // Read runs one more round
+			Assert::AreEqual(out.evt_num, UINT32(4));
+			Assert::AreEqual(out.round, UINT64(10));
+			Assert::AreEqual(out.evts[0].event_idx, UINT32(CYCLE_EVENT_IDX));
+			Assert::AreEqual(out.evts[0].value, UINT64(10 * 1000000));
+			Assert::AreEqual(out.evts[1].value, UINT64(10 * 1500000));
+			Assert::AreEqual(out.evts[2].value, UINT64(10 * 1000000));
+			Assert::AreEqual(out.evts[3].value, UINT64(10 * 10000));
+			for (UINT32 i = 0; i < out.evt_num; i++)
+			{
+				Assert::AreEqual(out.evts[i].scheduled, UINT64(10));
+				Assert::AreEqual(out.evts[i].time_enabled, out.evts[i].time_running);
+			}
+
+			// Other cores were not started
+			Assert::AreEqual(sim_read(sim, 1).evts[1].value, UINT64(0));
+
+			Assert::IsTrue(sim.io_control(PMU_CTL_RESET, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+			Assert::IsTrue(sim.io_control(PMU_CTL_STOP, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+			out = sim_read(sim, 2);
+			Assert::AreEqual(out.round, UINT64(0));
+			Assert::AreEqual(out.evts[1].value, UINT64(0));
+			Assert::AreEqual(out.evts[1].event_idx, UINT32(0x08));
+		}
+
+		TEST_METHOD(test_pmu_simulator_overhead)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.core_num = 4;
+			pmu_simulator sim(cfg);
+			sim_setup(sim, { 0x08 });               // Lock and assign
+
+			uint32_t returned = 0;
+			struct pmu_ctl_hdr ctl = sim_ctl_hdr(1, CTL_FLAG_CORE);
+			Assert::IsTrue(sim.io_control(PMU_CTL_START, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+			sim.run_rounds(1, 5);
+
+			enum pmu_ctl_action action = PMU_CTL_QUERY_OVERHEAD;
+			auto out = std::make_unique<OverheadOut>();
+			Assert::IsTrue(sim.io_control(PMU_CTL_QUERY_OVERHEAD, &action, sizeof(action), out.get(), sizeof(OverheadOut) - 1, returned) == pmu_backend_status::failed);
+			Assert::IsTrue(sim.io_control(PMU_CTL_QUERY_OVERHEAD, &action, sizeof(action), out.get(), sizeof(OverheadOut), returned) == pmu_backend_status::ok);
+			Assert::AreEqual(returned, (uint32_t)sizeof(OverheadOut));
+			Assert::AreEqual(out->core_num, UINT32(4));
+			Assert::AreEqual(out->dpc[1].calls, UINT64(5));
+			Assert::AreEqual(out->dpc[0].calls, UINT64(0));
+			Assert::AreEqual(out->isr[1].calls, UINT64(0));
+
+			// Lock, assign, start and the failed query, the current query is not accounted yet
+			Assert::AreEqual(out->ioctl.calls, UINT64(4));
+			Assert::IsTrue(out->ioctl.max_ns <= out->ioctl.time_ns);
+		}
+
+		TEST_METHOD(test_pmu_simulator_multiplexing)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.jitter = 0;
+			cfg.gpc_num = 6;
+			cfg.rounds_per_read = 0;
+			pmu_simulator sim(cfg);
+
+			std::vector<uint16_t> events = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x08, 0x10, 0x11, 0x12, 0x13, 0x14 };
+			sim_setup(sim, events);
+
+			uint32_t returned = 0;
+			struct pmu_ctl_hdr ctl = sim_ctl_hdr(0, CTL_FLAG_CORE);
+			Assert::IsTrue(sim.io_control(PMU_CTL_START, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+			sim.run_rounds(0, 100);
+
+			ReadOut out = sim_read(sim, 0);
+			Assert::AreEqual(out.evts[0].scheduled, UINT64(100));
+			for (size_t i = 1; i <= events.size(); i++)
+			{
+				const struct pmu_event_usr& e = out.evts[i];
+				Assert::AreEqual(e.scheduled, UINT64(50));
+				Assert::AreEqual(e.time_enabled, UINT64(100) * cfg.cycles_per_round);
+				Assert::AreEqual(e.time_running * 2, e.time_enabled);
+
+				// Scaled estimate is exact for constant streams
+				const double expected = sim.get_event_rate(events[i - 1]) * cfg.cycles_per_round * 100;
+				const double scaled = (double)e.value * e.time_enabled / e.time_running;
+				Assert::IsTrue(std::abs(scaled - expected) <= 100.0 + expected * 1e-6);
+			}
+		}
+
+		TEST_METHOD(test_pmu_simulator_deterministic)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.core_num = 4;
+			ReadOut out[3];
+
+			for (int i = 0; i < 3; i++)
+			{
+				cfg.seed = i == 2 ? 42 : 1;
+				pmu_simulator sim(cfg);
+				sim_setup(sim, { 0x08, 0x11, 0x03, 0x04, 0x05, 0x06, 0x10, 0x12 });
+
+				uint32_t returned = 0;
+				struct pmu_ctl_hdr ctl = sim_ctl_hdr(3, CTL_FLAG_CORE);
+				Assert::IsTrue(sim.io_control(PMU_CTL_START, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+				sim.run_rounds(3, 20);
+				out[i] = sim_read(sim, 3);
+			}
+
+			for (UINT32 e = 0; e < out[0].evt_num; e++)
+			{
+				Assert::AreEqual(out[0].evts[e].value, out[1].evts[e].value);
+				Assert::AreEqual(out[0].evts[e].slice_sq_lo, out[1].evts[e].slice_sq_lo);
+			}
+			Assert::AreNotEqual(out[0].evts[1].value, out[2].evts[1].value);
+		}
+
+		TEST_METHOD(test_pmu_simulator_sampling)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.jitter = 0;
+			cfg.event_rates = { { 0x08, 1.0 } };
+			pmu_simulator sim(cfg);
+			sim_setup(sim, {});
+
+			uint32_t returned = 0;
+			std::vector<uint8_t> buf(sizeof(PMUSampleSetSrcHdr) + 2 * sizeof(SampleSrcDesc));
+			PMUSampleSetSrcHdr* src = reinterpret_cast<PMUSampleSetSrcHdr*>(buf.data());
+			src->core_idx = 1;
+			src->sources[0] = { CYCLE_EVT_IDX, 100000, 0 };
+			src->sources[1] = { 0x08, 500000, 0 };
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_SET_SRC, buf.data(), (uint32_t)buf.size(), nullptr, 0, returned) == pmu_backend_status::ok);
+
+			struct pmu_ctl_hdr ctl = sim_ctl_hdr(1, CTL_FLAG_CORE);
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_START, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+
+			struct PMUCtlGetSampleHdr hdr = { 1 };
+			auto payload = std::make_unique<PMUSamplePayload>();
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_GET, &hdr, sizeof(hdr), payload.get(), sizeof(PMUSamplePayload), returned) == pmu_backend_status::ok);
+
+			const UINT64 cycle_samples = cfg.cycles_per_round / 100000;
+			const UINT64 inst_samples = cfg.cycles_per_round / 500000;
+			Assert::AreEqual((UINT64)payload->size, cycle_samples + inst_samples);
+			for (UINT32 i = 0; i < payload->size; i++)
+			{
+				const FrameChain& frame = payload->payload[i];
+				Assert::IsTrue(frame.ov_flags == (1ULL << CYCLE_COUNTER_IDX) || frame.ov_flags == 1ULL);
+				Assert::AreEqual(frame.period, UINT32(frame.ov_flags == 1ULL ? 500000 : 100000));
+				Assert::IsTrue(frame.pc >= cfg.sample_pc_base && frame.pc < cfg.sample_pc_base + 4 * cfg.sample_pcs);
+			}
+
+			// Buffer holds SAMPLE_CHAIN_BUFFER_SIZE samples, the rest is dropped
+			sim.run_rounds(1, 20);
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_GET, &hdr, sizeof(hdr), payload.get(), sizeof(PMUSamplePayload), returned) == pmu_backend_status::ok);
+			Assert::AreEqual(payload->size, UINT32(SAMPLE_CHAIN_BUFFER_SIZE));
+
+			struct PMUSampleSummary summary = {};
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_STOP, &ctl, sizeof(ctl), &summary, sizeof(summary), returned) == pmu_backend_status::ok);
+			Assert::AreEqual(summary.sample_generated, 22 * (cycle_samples + inst_samples));
+			Assert::AreEqual(summary.sample_dropped, summary.sample_generated - (cycle_samples + inst_samples) - SAMPLE_CHAIN_BUFFER_SIZE);
+		}
+
+		TEST_METHOD(test_pmu_simulator_sampling_histogram)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.sample_pcs = 16;
+			pmu_simulator sim(cfg);
+			sim_setup(sim, {});
+
+			uint32_t returned = 0;
+			std::vector<uint8_t> buf(sizeof(PMUSampleSetSrcHdr) + sizeof(SampleSrcDesc));
+			PMUSampleSetSrcHdr* src = reinterpret_cast<PMUSampleSetSrcHdr*>(buf.data());
+			src->core_idx = 0;
+			src->sources[0] = { CYCLE_EVT_IDX, 1000, 0 };
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_SET_SRC, buf.data(), (uint32_t)buf.size(), nullptr, 0, returned) == pmu_backend_status::ok);
+
+			struct pmu_ctl_hdr ctl = sim_ctl_hdr(0, CTL_FLAG_CORE | CTL_FLAG_SAMPLE_HISTOGRAM);
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_START, &ctl, sizeof(ctl), nullptr, 0, returned) == pmu_backend_status::ok);
+			sim.run_rounds(0, 9);
+
+			struct PMUCtlGetSampleHdr hdr = { 0 };
+			auto histogram = std::make_unique<PMUSampleHistogramPayload>();
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_GET_HISTOGRAM, &hdr, sizeof(hdr), histogram.get(), sizeof(PMUSampleHistogramPayload), returned) == pmu_backend_status::ok);
+			Assert::IsTrue(histogram->size > 1 && histogram->size <= 16);
+
+			UINT64 total = 0;
+			for (UINT32 i = 0; i < histogram->size; i++)
+			{
+				Assert::AreEqual(histogram->payload[i].counter_idx, UINT32(CYCLE_COUNTER_IDX));
+				total += histogram->payload[i].count;
+			}
+
+			struct PMUSampleSummary summary = {};
+			Assert::IsTrue(sim.io_control(PMU_CTL_SAMPLE_STOP, &ctl, sizeof(ctl), &summary, sizeof(summary), returned) == pmu_backend_status::ok);
+			Assert::AreEqual(total, summary.sample_generated);
+			Assert::AreEqual(summary.sample_dropped, UINT64(0));
+		}
+
+		TEST_METHOD(test_pmu_simulator_spe)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.spe_records_per_get = 100;
+			pmu_simulator sim(cfg);
+			sim_setup(sim, {});
+
+			uint32_t returned = 0;
+			struct spe_ctl_hdr spe = {};
+			spe.cores_idx.cores_count = 1;
+			spe.cores_idx.cores_no[0] = 5;
+			spe.operation_filter = SPE_OPERATON_FILTER_LD;
+			Assert::IsTrue(sim.io_control(PMU_CTL_SPE_START, &spe, sizeof(struct pmu_ctl_hdr), nullptr, 0, returned) == pmu_backend_status::ok);
+
+			struct pmu_ctl_hdr ctl = sim_ctl_hdr(5, CTL_FLAG_SPE);
+			size_t size = 0;
+			Assert::IsTrue(sim.io_control(PMU_CTL_SPE_GET_SIZE, &ctl, sizeof(ctl), &size, sizeof(size), returned) == pmu_backend_status::ok);
+			Assert::IsTrue(size > 0);
+
+			std::vector<UINT8> buffer(size);
+			spe.buffer_size = size;
+			Assert::IsTrue(sim.io_control(PMU_CTL_SPE_GET_BUFFER, &spe, sizeof(spe), buffer.data(), (uint32_t)size, returned) == pmu_backend_status::ok);
+			Assert::AreEqual(returned, (uint32_t)size);
+
+			std::vector<FrameChain> samples;
+			std::map<UINT64, std::wstring> spe_events;
+			spe_device::get_samples(buffer, samples, spe_events);
+			Assert::AreEqual(samples.size(), size_t(100));
+			for (const auto& [idx, name] : spe_events)
+				Assert::AreEqual(name.rfind(L"LOAD_STORE_ATOMIC-LOAD-GP/", 0), size_t(0));
+		}
+
+		TEST_METHOD(test_pmu_simulator_pmu_device)
+		{
+			pmu_simulator_cfg cfg;
+			cfg.core_num = MAX_PMU_CTL_CORES_COUNT - 1;
+			cfg.has_spe = false;
+
+			pmu_device pdev;
+			pdev.init(std::make_unique<pmu_simulator>(cfg));
+			pdev.core_init();
+			pdev.dsu_init();
+			pdev.dmc_init();
+			Assert::AreEqual((uint32_t)pdev.core_num, cfg.core_num);
+			Assert::AreEqual((uint32_t)pdev.gpc_nums[EVT_CORE], (uint32_t)cfg.gpc_num);
+			Assert::IsFalse(pdev.m_has_dsu || pdev.m_has_dmc || pdev.m_has_spe);
+
+			std::vector<uint8_t> cores(cfg.core_num);
+			for (uint8_t i = 0; i < cores.size(); i++)
+				cores[i] = i;
+			pdev.post_init(cores, ALL_DMC_CHANNEL, false, CTL_FLAG_CORE);
+
+			std::map<enum evt_class, std::vector<struct evt_noted>> events;
+			for (uint16_t index : { 0x08, 0x11, 0x03, 0x04, 0x05, 0x06, 0x10, 0x12 })
+				events[EVT_CORE].push_back({ index, EVT_NORMAL, L"", EVT_NOTED_NO_GROUP, L"" });
+			pdev.events_assign(ALL_CORE, events, false);
+
+			pdev.reset(CTL_FLAG_CORE);
+			pdev.start(CTL_FLAG_CORE);
+			pdev.core_events_read();
+			pdev.stop(CTL_FLAG_CORE);
+
+			const ReadOut* outs = pdev.get_core_outs();
+			for (uint32_t i = 0; i < cfg.core_num; i++)
+			{
+				Assert::AreEqual(outs[i].evt_num, UINT32(9));
+				Assert::AreEqual(outs[i].round, UINT64(1));
+				Assert::IsTrue(outs[i].evts[0].value > 0);
+			}
+		}
+	};
+}
@@ -0,0 +1,290 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include <mutex>
+#include <thread>
+
+#include "wperf/region_profiler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_region_profiler)
+	{
+	public:
+
+		TEST_METHOD(test_region_thread_single)
+		{
+			RegionThread thread(2);
+			uint64_t begin[2] = { 100, 10 };
+			uint64_t end[2] = { 250, 40 };
+
+			Assert::IsTrue(thread.Begin(3, 1, begin));
+			Assert::AreEqual(thread.Depth(), size_t(1));
+			Assert::IsTrue(thread.End(3, 1, end));
+			Assert::AreEqual(thread.Depth(), size_t(0));
+
+			RegionTotals totals;
+			thread.Merge(3, totals);
+			Assert::AreEqual(totals.calls, uint64_t(1));
+			Assert::AreEqual(totals.migrated, uint64_t(0));
+			Assert::AreEqual(totals.nested, uint64_t(0));
+			Assert::AreEqual(totals.values[0], uint64_t(150));
+			Assert::AreEqual(totals.values[1], uint64_t(30));
+
+			// Other regions are untouched
+			RegionTotals other;
+			thread.Merge(4, other);
+			Assert::AreEqual(other.calls, uint64_t(0));
+			Assert::AreEqual(other.values[0], uint64_t(0));
+		}
+
+		TEST_METHOD(test_region_thread_accumulate)
+		{
+			RegionThread thread(1);
+			for (uint64_t i = 0; i < 10; i++)
+			{
+				uint64_t begin = i * 1000;
+				uint64_t end = begin + i;
+				Assert::IsTrue(thread.Begin(0, 2, &begin));
+				Assert::IsTrue(thread.End(0, 2, &end));
+			}
+
+			RegionTotals totals;
+			thread.Merge(0, totals);
+			Assert::AreEqual(totals.calls, uint64_t(10));
+			Assert::AreEqual(totals.values[0], uint64_t(45));
+
+			// Totals of many threads are summed
+			thread.Merge(0, totals);
+			Assert::AreEqual(totals.calls, uint64_t(20));
+			Assert::AreEqual(totals.values[0], uint64_t(90));
+		}
+
+		TEST_METHOD(test_region_thread_nested)
+		{
+			RegionThread thread(1);
+			uint64_t v[] = { 0, 10, 20, 30, 40, 50, 60 };
+
+			// outer { inner { innermost } inner }
+			Assert::IsTrue(thread.Begin(0, 0, &v[0]));
+			Assert::IsTrue(thread.Begin(1, 0, &v[1]));
+			Assert::IsTrue(thread.Begin(2, 0, &v[2]));
+			Assert::IsTrue(thread.End(2, 0, &v[3]));
+			Assert::IsTrue(thread.End(1, 0, &v[4]));
+			Assert::IsTrue(thread.Begin(1, 0, &v[5]));
+			Assert::IsTrue(thread.End(1, 0, &v[6]));
+			Assert::IsTrue(thread.End(0, 0, &v[6]));
+
+			RegionTotals outer, inner, innermost;
+			thread.Merge(0, outer);
+			thread.Merge(1, inner);
+			thread.Merge(2, innermost);
+
+			Assert::AreEqual(outer.calls, uint64_t(1));
+			Assert::AreEqual(outer.nested, uint64_t(3));
+			Assert::AreEqual(outer.values[0], uint64_t(60));
+			Assert::AreEqual(inner.calls, uint64_t(2));
+			Assert::AreEqual(inner.nested, uint64_t(1));
+			Assert::AreEqual(inner.values[0], uint64_t(40));
+			Assert::AreEqual(innermost.calls, uint64_t(1));
+			Assert::AreEqual(innermost.nested, uint64_t(0));
+			Assert::AreEqual(innermost.values[0], uint64_t(10));
+		}
+
+		TEST_METHOD(test_region_thread_mismatch)
+		{
+			RegionThread thread(1);
+			uint64_t v = 0;
+
+			Assert::IsFalse(thread.End(0, 0, &v));
+			Assert::IsTrue(thread.Begin(0, 0, &v));
+			Assert::IsFalse(thread.End(1, 0, &v));
+			Assert::AreEqual(thread.Depth(), size_t(1));
+			Assert::IsTrue(thread.End(0, 0, &v));
+
+			Assert::IsFalse(thread.Begin(RegionThread::m_MAX_REGIONS, 0, &v));
+		}
+
+		TEST_METHOD(test_region_thread_migrated)
+		{
+			RegionThread thread(1);
+			uint64_t begin = 100, end = 200;
+
+			Assert::IsTrue(thread.Begin(0, 1, &begin));
+			Assert::IsFalse(thread.End(0, 2, &end));
+			Assert::IsTrue(thread.Begin(0, RegionThread::m_NO_CORE, &begin));
+			Assert::IsFalse(thread.End(0, RegionThread::m_NO_CORE, &end));
+			Assert::IsTrue(thread.Begin(0, 1, &begin));
+			Assert::IsTrue(thread.End(0, 1, &end));
+
+			RegionTotals totals;
+			thread.Merge(0, totals);
+			Assert::AreEqual(totals.calls, uint64_t(1));
+			Assert::AreEqual(totals.migrated, uint64_t(2));
+			Assert::AreEqual(totals.values[0], uint64_t(100));
+		}
+
+		TEST_METHOD(test_region_thread_overflow)
+		{
+			RegionThread thread(1);
+			uint64_t v = 0;
+
+			for (size_t i = 0; i < RegionThread::m_MAX_DEPTH; i++)
+				Assert::IsTrue(thread.Begin(0, 0, &v));
+
+			// Regions which do not fit are ignored together with their ends
+			Assert::IsFalse(thread.Begin(1, 0, &v));
+			Assert::IsFalse(thread.Begin(1, 0, &v));
+			Assert::AreEqual(thread.Depth(), RegionThread::m_MAX_DEPTH + 2);
+			Assert::IsFalse(thread.End(1, 0, &v));
+			Assert::IsFalse(thread.End(1, 0, &v));
+
+			for (size_t i = 0; i < RegionThread::m_MAX_DEPTH; i++)
+				Assert::IsTrue(thread.End(0, 0, &v));
+			Assert::AreEqual(thread.Depth(), size_t(0));
+
+			RegionTotals totals;
+			thread.Merge(0, totals);
+			Assert::AreEqual(totals.calls, uint64_t(RegionThread::m_MAX_DEPTH));
+		}
+
+		TEST_METHOD(test_region_threads_reset)
+		{
+			RegionThreads threads;
+			RegionThreadSlot slot;
+			Assert::IsNull(threads.Current(slot));
+
+			RegionThread* thread = threads.Attach(slot, 1);
+			Assert::IsTrue(threads.Current(slot) == thread);
+			Assert::AreEqual(threads.Threads().size(), size_t(1));
+
+			// Released data stays valid for the thread which still holds it
+			threads.Reset();
+			Assert::IsNull(threads.Current(slot));
+			Assert::AreEqual(threads.Threads().size(), size_t(0));
+
+			uint64_t begin = 10, end = 15;
+			Assert::IsTrue(slot.data->Begin(0, 0, &begin));
+			Assert::IsTrue(slot.data->End(0, 0, &end));
+
+			RegionThread* next = threads.Attach(slot, 2);
+			Assert::IsTrue(threads.Current(slot) == next);
+			Assert::AreEqual(next->NumValues(), size_t(2));
+		}
+
+		TEST_METHOD(test_region_threads_reset_concurrent)
+		{
+			// Threads begin and end regions while their data is repeatedly released,
+			// as with wperf_region_close() / wperf_region_init() running on another thread.
+			RegionThreads threads;
+			std::mutex lock;
+			std::atomic<bool> stop = false;
+			std::atomic<uint64_t> pairs = 0;
+
+			auto worker = [&] {
+				RegionThreadSlot slot;
+				uint64_t local_pairs = 0;
+				while (!stop.load())
+				{
+					RegionThread* thread = threads.Current(slot);
+					if (!thread)
+					{
+						std::lock_guard<std::mutex> guard(lock);
+						thread = threads.Attach(slot, 2);
+					}
+
+					for (uint64_t i = 0; i < 100; i++)
+					{
+						uint64_t begin[2] = { i, i };
+						uint64_t end[2] = { i + 1, i + 2 };
+						if (thread->Begin(1, 0, begin) && thread->End(1, 0, end))
+							local_pairs++;
+					}
+				}
+				pairs += local_pairs;
+			};
+
+			std::vector<std::thread> workers;
+			for (int i = 0; i < 4; i++)
+				workers.emplace_back(worker);
+
+			for (int i = 0; i < 1000; i++)
+			{
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					RegionTotals totals;
+					for (const auto& thread : threads.Threads())
+						thread->Merge(1, totals);
+					threads.Reset();
+				}
+				std::this_thread::yield();
+			}
+
+			stop = true;
+			for (auto& t : workers)
+				t.join();
+
+			Assert::IsTrue(pairs.load() > 0);
+		}
+
+		TEST_METHOD(test_region_calibration_median)
+		{
+			Assert::AreEqual(RegionCalibration::Median({}), uint64_t(0));
+			Assert::AreEqual(RegionCalibration::Median({ 7 }), uint64_t(7));
+			Assert::AreEqual(RegionCalibration::Median({ 5, 1000000, 3, 4, 6 }), uint64_t(5));
+		}
+
+		TEST_METHOD(test_region_calibration_correct)
+		{
+			RegionCalibration calibration;
+			Assert::IsFalse(calibration.IsCalibrated());
+
+			calibration.self = { 100, 20 };
+			calibration.inner = { 300, 50 };
+			Assert::IsTrue(calibration.IsCalibrated());
+
+			RegionTotals totals;
+			totals.calls = 10;
+			totals.nested = 5;
+			totals.values = { 5000, 200 };
+			calibration.Correct(totals);
+
+			Assert::AreEqual(totals.values[0], uint64_t(5000 - 10 * 100 - 5 * 300));
+			// Overhead larger than counted value is clamped
+			Assert::AreEqual(totals.values[1], uint64_t(0));
+		}
+	};
+}
@@ -0,0 +1,111 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <map>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/sample_rate.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_sample_rate)
+	{
+	public:
+
+		TEST_METHOD(test_sample_rate_next_interval)
+		{
+			// 4000 samples in 1s with 0x10000 interval, target 1000Hz
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 4000, 1.0, 1000.0), uint32_t(0x40000));
+			// 500 samples in 1s, target 1000Hz
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 500, 1.0, 1000.0), uint32_t(0x8000));
+			// 2000 samples in 2s, target 1000Hz
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 2000, 2.0, 1000.0), uint32_t(0x10000));
+			// Within tolerance
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 1050, 1.0, 1000.0), uint32_t(0x10000));
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 950, 1.0, 1000.0), uint32_t(0x10000));
+			// Nothing elapsed
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 100, 0.0, 1000.0), uint32_t(0x10000));
+		}
+
+		TEST_METHOD(test_sample_rate_next_interval_clamp)
+		{
+			// Change is limited to m_MAX_STEP
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 100000, 1.0, 1000.0), uint32_t(0x40000));
+			Assert::AreEqual(SampleRateController::NextInterval(0x10000, 0, 1.0, 1000.0), uint32_t(0x4000));
+			// Interval stays in [m_MIN_INTERVAL, m_MAX_INTERVAL]
+			Assert::AreEqual(SampleRateController::NextInterval(2000, 0, 1.0, 1000.0), SampleRateController::m_MIN_INTERVAL);
+			Assert::AreEqual(SampleRateController::NextInterval(0xF0000000, 4000, 1.0, 1000.0), SampleRateController::m_MAX_INTERVAL);
+		}
+
+		TEST_METHOD(test_sample_rate_update)
+		{
+			SampleRateController rate(1000.0);
+			rate.SetInterval(0, 0x10000);
+			rate.SetInterval(31, 0x100000);
+
+			rate.AddSamples(0, 2000);
+			rate.AddSamples(31, 1000);
+			rate.AddSamples(5, 1000);	// Not sampled counter is ignored
+
+			std::map<uint32_t, uint32_t> changed = rate.Update(1.0);
+			Assert::AreEqual(changed.size(), size_t(1));
+			Assert::AreEqual(changed[0], uint32_t(0x20000));
+			Assert::AreEqual(rate.GetInterval(0), uint32_t(0x20000));
+			Assert::AreEqual(rate.GetInterval(31), uint32_t(0x100000));
+			Assert::AreEqual(rate.GetInterval(5), uint32_t(0));
+
+			// Sample counts are reset with each update
+			rate.AddSamples(31, 1000);
+			changed = rate.Update(1.0);
+			Assert::AreEqual(changed.size(), size_t(1));
+			Assert::AreEqual(changed[0], uint32_t(0x20000 / 4));
+		}
+
+		TEST_METHOD(test_sample_rate_converge)
+		{
+			// Event counts 10M events per second, target 1000 samples per second
+			const double events_per_sec = 10000000.0;
+			SampleRateController rate(1000.0);
+			rate.SetInterval(2, 0x4000000);
+
+			for (int i = 0; i < 10; i++)
+			{
+				rate.AddSamples(2, static_cast<uint64_t>(events_per_sec / rate.GetInterval(2)));
+				rate.Update(1.0);
+			}
+
+			Assert::AreEqual(static_cast<double>(rate.GetInterval(2)), events_per_sec / 1000.0, events_per_sec / 1000.0 * SampleRateController::m_TOLERANCE);
+		}
+	};
+}
@@ -0,0 +1,141 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/symbol_cache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_symbol_cache)
+	{
+		static SymbolCache make_cache()
+		{
+			SymbolCache cache;
+			cache.m_key = 0x1122334455667788ull;
+			cache.m_flags = SymbolCache::FLAG_SHORT_NAMES;
+			cache.m_functions.push_back({ 1, 0x40, 0x1000, L"x_mul", {
+				{ L"C:\\src\\longobject.c", 10, 1, 1, 1, 0x1000, 4, 0x2000, 0x140002000 },
+				{ L"C:\\src\\longobject.c", 11, 0, 1, 1, 0x1004, 8, 0x2004, 0x140002004 } } });
+			cache.m_functions.push_back({ 2, 0x10, 0x20, L"k_mul", { { L"C:\\src\\b.c", 1, 0, 0, 2, 0x20, 4, 0x3020, 0x140003020 } } });
+			cache.m_functions.push_back({ 2, 0x10, 0x40, L"no_lines", {} });
+			return cache;
+		}
+
+	public:
+
+		TEST_METHOD(test_symbol_cache_roundtrip)
+		{
+			SymbolCache cache = make_cache();
+			std::vector<uint8_t> buf = cache.Serialize();
+
+			SymbolCache loaded;
+			Assert::IsTrue(loaded.Deserialize(buf.data(), buf.size()));
+			Assert::AreEqual(loaded.m_key, uint64_t(0x1122334455667788ull));
+			Assert::AreEqual(loaded.m_flags, uint32_t(SymbolCache::FLAG_SHORT_NAMES));
+			Assert::AreEqual(loaded.m_functions.size(), size_t(3));
+
+			Assert::AreEqual(loaded.m_functions[0].name, std::wstring(L"x_mul"));
+			Assert::AreEqual(loaded.m_functions[0].offset, uint64_t(0x1000));
+			Assert::AreEqual(loaded.m_functions[0].lines.size(), size_t(2));
+			Assert::AreEqual(loaded.m_functions[0].lines[1].source_file, std::wstring(L"C:\\src\\longobject.c"));
+			Assert::AreEqual(loaded.m_functions[0].lines[1].line_num, uint32_t(11));
+			Assert::AreEqual(loaded.m_functions[0].lines[1].virtual_address, uint64_t(0x140002004));
+			Assert::AreEqual(loaded.m_functions[1].lines[0].rva, uint32_t(0x3020));
+			Assert::IsTrue(loaded.m_functions[2].lines.empty());
+
+			// Format is deterministic
+			Assert::IsTrue(loaded.Serialize() == buf);
+		}
+
+		TEST_METHOD(test_symbol_cache_layout)
+		{
+			std::vector<uint8_t> buf = make_cache().Serialize();
+
+			// Header, 3 function records, 3 line records and interned strings
+			const size_t strings = sizeof("x_mul") + sizeof("C:\\src\\longobject.c") + sizeof("k_mul") + sizeof("C:\\src\\b.c") + sizeof("no_lines");
+			Assert::AreEqual(buf.size(), SymbolCache::m_HEADER_SIZE + 3 * SymbolCache::m_FUNCTION_SIZE + 3 * SymbolCache::m_LINE_SIZE + strings);
+
+			// Little-endian key at offset 16
+			Assert::AreEqual(buf[16], uint8_t(0x88));
+			Assert::AreEqual(buf[23], uint8_t(0x11));
+		}
+
+		TEST_METHOD(test_symbol_cache_non_ascii)
+		{
+			SymbolCache cache;
+			cache.m_functions.push_back({ 1, 4, 0, L"f\u00fcnf", { { L"C:\\\u00e9t\u00e9.c", 1, 0, 1, 1, 0, 4, 0, 0 } } });
+			std::vector<uint8_t> buf = cache.Serialize();
+
+			SymbolCache loaded;
+			Assert::IsTrue(loaded.Deserialize(buf.data(), buf.size()));
+			Assert::AreEqual(loaded.m_functions[0].name, std::wstring(L"f\u00fcnf"));
+			Assert::AreEqual(loaded.m_functions[0].lines[0].source_file, std::wstring(L"C:\\\u00e9t\u00e9.c"));
+		}
+
+		TEST_METHOD(test_symbol_cache_invalid)
+		{
+			std::vector<uint8_t> buf = make_cache().Serialize();
+			SymbolCache loaded;
+
+			// Truncated data
+			for (size_t size = 0; size < buf.size(); size++)
+				Assert::IsFalse(loaded.Deserialize(buf.data(), size));
+
+			// Bad magic
+			std::vector<uint8_t> bad_magic = buf;
+			bad_magic[0] = 'X';
+			Assert::IsFalse(loaded.Deserialize(bad_magic.data(), bad_magic.size()));
+
+			// Unsupported version
+			std::vector<uint8_t> bad_version = buf;
+			bad_version[8] = 0xff;
+			Assert::IsFalse(loaded.Deserialize(bad_version.data(), bad_version.size()));
+
+			// Line index of first function out of range
+			std::vector<uint8_t> bad_line = buf;
+			bad_line[SymbolCache::m_HEADER_SIZE + 20] = 0xff;
+			Assert::IsFalse(loaded.Deserialize(bad_line.data(), bad_line.size()));
+		}
+
+		TEST_METHOD(test_symbol_cache_gen_filename)
+		{
+			std::wstring filename = SymbolCache::GenFilename(L"c:\\cache", L"c:\\build\\python312.pdb", 0xab);
+			Assert::AreEqual(filename, std::wstring(L"c:\\cache\\python312.pdb.00000000000000ab.sym"));
+		}
+	};
+}
@@ -0,0 +1,122 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <string>
+#include <vector>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/top_aggregator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	TEST_CLASS(wperftest_top_aggregator)
+	{
+	public:
+
+		TEST_METHOD(test_top_aggregator_add)
+		{
+			TopAggregator top;
+			top.Add(0x11, L"foo");
+			top.Add(0x11, L"bar");
+			top.Add(0x11, L"foo");
+			top.Add(0x08, L"baz", 4.0);
+
+			Assert::AreEqual(top.GetEvents().size(), size_t(2));
+			Assert::AreEqual(top.GetTotal(0x11), 3.0, 0.0001);
+			Assert::AreEqual(top.GetTotal(0x08), 4.0, 0.0001);
+			Assert::AreEqual(top.GetTotal(0x1b), 0.0, 0.0001);
+			Assert::AreEqual(top.GetSize(), size_t(3));
+
+			std::vector<TopEntry> entries = top.Top(0x11, 10);
+			Assert::AreEqual(entries.size(), size_t(2));
+			Assert::AreEqual(entries[0].symbol, std::wstring(L"foo"));
+			Assert::AreEqual(entries[0].weight, 2.0, 0.0001);
+			Assert::AreEqual(entries[1].symbol, std::wstring(L"bar"));
+
+			Assert::IsTrue(top.Top(0x1b, 10).empty());
+		}
+
+		TEST_METHOD(test_top_aggregator_top_n)
+		{
+			TopAggregator top;
+			top.Add(0x11, L"c", 1.0);
+			top.Add(0x11, L"a", 3.0);
+			top.Add(0x11, L"d", 3.0);
+			top.Add(0x11, L"b", 2.0);
+
+			std::vector<TopEntry> entries = top.Top(0x11, 3);
+			Assert::AreEqual(entries.size(), size_t(3));
+			Assert::AreEqual(entries[0].symbol, std::wstring(L"a"));	// Equal weights are ordered by name
+			Assert::AreEqual(entries[1].symbol, std::wstring(L"d"));
+			Assert::AreEqual(entries[2].symbol, std::wstring(L"b"));
+		}
+
+		TEST_METHOD(test_top_aggregator_decay)
+		{
+			TopAggregator top(2.0);
+			top.Add(0x11, L"old", 8.0);
+			top.Decay(4.0);						// Two half-lives
+			top.Add(0x11, L"new", 3.0);
+
+			Assert::AreEqual(top.GetTotal(0x11), 5.0, 0.0001);
+			std::vector<TopEntry> entries = top.Top(0x11, 10);
+			Assert::AreEqual(entries[0].symbol, std::wstring(L"new"));
+			Assert::AreEqual(entries[1].weight, 2.0, 0.0001);
+		}
+
+		TEST_METHOD(test_top_aggregator_decay_prune)
+		{
+			TopAggregator top(1.0);
+			top.Add(0x11, L"foo");
+			top.Add(0x08, L"bar", 1000.0);
+			top.Decay(10.0);					// 1/1024 of weight is left
+
+			Assert::AreEqual(top.GetSize(), size_t(1));
+			Assert::AreEqual(top.GetEvents().size(), size_t(1));
+			Assert::AreEqual(top.GetEvents()[0], uint32_t(0x08));
+			Assert::AreEqual(top.GetTotal(0x11), 0.0, 0.0001);
+		}
+
+		TEST_METHOD(test_top_aggregator_no_decay)
+		{
+			TopAggregator top;
+			top.Add(0x11, L"foo", 5.0);
+			top.Decay(1000.0);
+
+			Assert::AreEqual(top.GetTotal(0x11), 5.0, 0.0001);
+			Assert::AreEqual(TopAggregator::DecayFactor(1.0, 0.0), 1.0, 0.0001);
+			Assert::AreEqual(TopAggregator::DecayFactor(3.0, 3.0), 0.5, 0.0001);
+		}
+	};
+}
@@ -0,0 +1,177 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "pch.h"
+#include "CppUnitTest.h"
+
+#include "wperf/topdown.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace wperftest
+{
+	// Subset of neoverse-n2 Telemetry Solution metrics
+	static const std::map<std::wstring, std::vector<std::wstring>> n2_groups_of_metrics = {
+		{ L"Topdown_L1", { L"frontend_bound", L"backend_bound", L"retiring", L"bad_speculation" } },
+		{ L"Cycle_Accounting", { L"frontend_stalled_cycles", L"backend_stalled_cycles" } },
+		{ L"Branch_Effectiveness", { L"branch_mpki", L"branch_misprediction_ratio" } },
+		{ L"L1D_Cache_Effectiveness", { L"l1d_cache_mpki", L"l1d_cache_miss_ratio" } },
+		{ L"L2_Cache_Effectiveness", { L"l2_cache_mpki", L"l2_cache_miss_ratio" } },
+		{ L"Operation_Mix", { L"load_percentage", L"store_percentage" } },
+	};
+
+	static const std::map<std::wstring, std::vector<std::wstring>> n2_metric_events = {
+		{ L"frontend_bound", { L"br_mis_pred", L"cpu_cycles", L"stall_slot_frontend" } },
+		{ L"backend_bound", { L"br_mis_pred", L"cpu_cycles", L"stall_slot_backend" } },
+		{ L"retiring", { L"cpu_cycles", L"op_retired", L"op_spec", L"stall_slot" } },
+		{ L"bad_speculation", { L"br_mis_pred", L"cpu_cycles", L"op_retired", L"op_spec", L"stall_slot" } },
+		{ L"frontend_stalled_cycles", { L"cpu_cycles", L"stall_frontend" } },
+		{ L"backend_stalled_cycles", { L"cpu_cycles", L"stall_backend" } },
+		{ L"branch_mpki", { L"br_mis_pred_retired", L"inst_retired" } },
+		{ L"branch_misprediction_ratio", { L"br_mis_pred_retired", L"br_retired" } },
+		{ L"l1d_cache_mpki", { L"inst_retired", L"l1d_cache_refill" } },
+		{ L"l1d_cache_miss_ratio", { L"l1d_cache", L"l1d_cache_refill" } },
+		{ L"l2_cache_mpki", { L"inst_retired", L"l2d_cache_refill" } },
+		{ L"l2_cache_miss_ratio", { L"l2d_cache", L"l2d_cache_refill" } },
+		{ L"load_percentage", { L"inst_spec", L"ld_spec" } },
+		{ L"store_percentage", { L"inst_spec", L"st_spec" } },
+	};
+
+	TEST_CLASS(wperftest_topdown)
+	{
+	public:
+
+		TEST_METHOD(test_topdown_pack_reuse)
+		{
+			std::vector<std::vector<std::wstring>> groups;
+			std::vector<size_t> assignment;
+
+			TopdownPlan::Pack({ { L"a", L"b" }, { L"a", L"b", L"c" }, { L"b", L"c" } }, 3, groups, assignment);
+
+			Assert::AreEqual(groups.size(), size_t(1));
+			Assert::AreEqual(groups[0].size(), size_t(3));
+			Assert::AreEqual(assignment[0], size_t(0));
+			Assert::AreEqual(assignment[1], size_t(0));
+			Assert::AreEqual(assignment[2], size_t(0));
+		}
+
+		TEST_METHOD(test_topdown_pack_counters)
+		{
+			std::vector<std::vector<std::wstring>> groups;
+			std::vector<size_t> assignment;
+
+			TopdownPlan::Pack({ { L"a", L"b" }, { L"c", L"d" }, { L"a", L"e" } }, 3, groups, assignment);
+
+			// { a, b, e } and { c, d }
+			Assert::AreEqual(groups.size(), size_t(2));
+			Assert::AreEqual(assignment[0], assignment[2]);
+			Assert::AreNotEqual(assignment[0], assignment[1]);
+			for (const auto& group : groups)
+				Assert::IsTrue(group.size() <= 3);
+
+			// Set larger than counters gets its own group
+			TopdownPlan::Pack({ { L"x", L"y", L"z", L"w" } }, 3, groups, assignment);
+			Assert::AreEqual(groups.size(), size_t(3));
+			Assert::AreEqual(groups[2].size(), size_t(4));
+		}
+
+		TEST_METHOD(test_topdown_plan_l1)
+		{
+			TopdownPlan plan(n2_groups_of_metrics, n2_metric_events, 6);
+
+			Assert::IsFalse(plan.Empty());
+			Assert::IsTrue(plan.Stage1Group() == L"Topdown_L1");
+			Assert::AreEqual(plan.Stage1().size(), size_t(4));
+
+			// frontend_bound -> L2 (L1I, ITLB and LL not available in this product)
+			Assert::IsTrue(plan.Stage1()[0].metric == L"frontend_bound");
+			Assert::AreEqual(plan.Stage1()[0].groups.size(), size_t(1));
+			Assert::IsTrue(plan.Stage1()[0].groups[0] == L"L2_Cache_Effectiveness");
+
+			// bad_speculation -> Branch_Effectiveness
+			Assert::IsTrue(plan.Stage1()[3].groups[0] == L"Branch_Effectiveness");
+
+			// Stage 1 first, stage 2 metrics counted once
+			Assert::AreEqual(plan.Metrics().size(), size_t(12));
+			Assert::IsTrue(plan.Metrics()[0] == L"frontend_bound");
+
+			// Every metric has all its events in its event group which fits counters
+			for (const auto& metric : plan.Metrics())
+			{
+				const auto& group = plan.EventGroups()[plan.EventGroupOf(metric)].events;
+				Assert::IsTrue(group.size() <= 6);
+				for (const auto& event : n2_metric_events.at(metric))
+					Assert::IsTrue(std::find(group.begin(), group.end(), event) != group.end());
+			}
+
+			// 17 distinct events, stage 1 alone needs 7
+			Assert::IsTrue(plan.EventGroups().size() <= 5);
+		}
+
+		TEST_METHOD(test_topdown_plan_cycle_accounting)
+		{
+			auto groups_of_metrics = n2_groups_of_metrics;
+			groups_of_metrics.erase(L"Topdown_L1");
+
+			TopdownPlan plan(groups_of_metrics, n2_metric_events, 6);
+
+			Assert::IsTrue(plan.Stage1Group() == L"Cycle_Accounting");
+			Assert::AreEqual(plan.Stage1().size(), size_t(2));
+			Assert::IsTrue(plan.Stage1()[1].metric == L"backend_stalled_cycles");
+
+			// backend_stalled_cycles -> L1D, L2, Operation_Mix
+			Assert::AreEqual(plan.Stage1()[1].groups.size(), size_t(3));
+			Assert::IsTrue(plan.Stage1()[1].groups[2] == L"Operation_Mix");
+
+			// Both stage 1 metrics fit one event group
+			Assert::AreEqual(plan.EventGroupOf(L"frontend_stalled_cycles"), plan.EventGroupOf(L"backend_stalled_cycles"));
+		}
+
+		TEST_METHOD(test_topdown_plan_empty)
+		{
+			TopdownPlan plan({ { L"General", { L"ipc" } } }, { { L"ipc", { L"cpu_cycles", L"inst_retired" } } }, 6);
+
+			Assert::IsTrue(plan.Empty());
+			Assert::IsTrue(plan.Metrics().empty());
+			Assert::IsTrue(plan.EventGroups().empty());
+		}
+
+		TEST_METHOD(test_topdown_event_group_id)
+		{
+			TopdownPlan plan(n2_groups_of_metrics, n2_metric_events, 6);
+
+			Assert::AreEqual(plan.EventGroupIndex(3), SIZE_MAX);
+			plan.SetEventGroupId(1, 3);
+			Assert::AreEqual(plan.EventGroupIndex(3), size_t(1));
+		}
+	};
+}
@@ -37,6 +37,7 @@
 #include <string>
 #include <unordered_map>
 #include <numeric>
+#include <stdexcept>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -839,5 +840,40 @@ namespace wperftest
 			Assert::AreEqual(ConvertNumberWithUnit(double(60), std::wstring(L"d"), unitMap), double(5184000));
 			Assert::AreEqual(ConvertNumberWithUnit(double(2.5), std::wstring(L"h"), unitMap), double(9000));
 		}
+
+		TEST_METHOD(test_Fnv1aHash)
+		{
+			Assert::AreEqual(Fnv1aHash("", 0), uint64_t(0xcbf29ce484222325));
+			Assert::AreEqual(Fnv1aHash("a", 1), uint64_t(0xaf63dc4c8601ec8c));
+			Assert::AreEqual(Fnv1aHash("foobar", 6), uint64_t(0x85944171f73967e8));
+
+			// Hashing in chunks gives the same result
+			Assert::AreEqual(Fnv1aHash("bar", 3, Fnv1aHash("foo", 3)), Fnv1aHash("foobar", 6));
+		}
+
+		TEST_METHOD(test_ParallelForEach)
+		{
+			std::vector<size_t> out(1000);
+			ParallelForEach(out.size(), [&](size_t i) { out[i] = i * 2; });
+			for (size_t i = 0; i < out.size(); i++)
+				Assert::AreEqual(out[i], i * 2);
+
+			// Single worker runs in calling thread
+			size_t calls = 0;
+			ParallelForEach(5, [&](size_t) { calls++; }, 1);
+			Assert::AreEqual(calls, size_t(5));
+
+			ParallelForEach(0, [](size_t) { Assert::Fail(); });
+		}
+
+		TEST_METHOD(test_ParallelForEach_exception)
+		{
+			Assert::ExpectException<std::runtime_error>([]() {
+				ParallelForEach(100, [](size_t i) {
+					if (i == 37)
+						throw std::runtime_error("item failed");
+				}, 4);
+			});
+		}
 	};
 }
@@ -0,0 +1,1250 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstdio>
+#include "a64_decoder.h"
+
+namespace a64_decoder
+{
+    namespace
+    {
+        inline uint32_t bits(uint32_t v, int hi, int lo)
+        {
+            return (v >> lo) & ((1u << (hi - lo + 1)) - 1);
+        }
+
+        inline uint32_t bit(uint32_t v, int n)
+        {
+            return (v >> n) & 1;
+        }
+
+        inline int64_t sign_extend(uint64_t v, int width)
+        {
+            uint64_t m = 1ull << (width - 1);
+            v &= (width == 64) ? ~0ull : ((1ull << width) - 1);
+            return static_cast<int64_t>((v ^ m) - m);
+        }
+
+        std::string hex(uint64_t v)
+        {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "0x%llx", static_cast<unsigned long long>(v));
+            return buf;
+        }
+
+        std::string imm(int64_t v)
+        {
+            if (v < 0)
+                return "#-" + hex(static_cast<uint64_t>(-v));
+            return "#" + hex(static_cast<uint64_t>(v));
+        }
+
+        std::string dec(int64_t v)
+        {
+            return "#" + std::to_string(v);
+        }
+
+        // General purpose register, n == 31 is SP (when SP is true) or ZR
+        std::string reg(uint32_t n, bool is64, bool sp = false)
+        {
+            if (n == 31)
+                return sp ? (is64 ? "sp" : "wsp") : (is64 ? "xzr" : "wzr");
+            return (is64 ? "x" : "w") + std::to_string(n);
+        }
+
+        // Scalar FP/SIMD register, SIZE_LOG2 0:b, 1:h, 2:s, 3:d, 4:q
+        std::string vreg(uint32_t n, uint32_t size_log2)
+        {
+            static const char* prefix = "bhsdq";
+            return std::string(1, prefix[size_log2]) + std::to_string(n);
+        }
+
+        // Vector register with arrangement, e.g. v0.4s
+        std::string vreg(uint32_t n, const char* arrangement)
+        {
+            return "v" + std::to_string(n) + "." + arrangement;
+        }
+
+        const char* cond_name(uint32_t c)
+        {
+            static const char* names[] = { "eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+                                           "hi", "ls", "ge", "lt", "gt", "le", "al", "nv" };
+            return names[c & 0xf];
+        }
+
+        const char* shift_name(uint32_t s)
+        {
+            static const char* names[] = { "lsl", "lsr", "asr", "ror" };
+            return names[s & 3];
+        }
+
+        const char* extend_name(uint32_t option)
+        {
+            static const char* names[] = { "uxtb", "uxth", "uxtw", "uxtx", "sxtb", "sxth", "sxtw", "sxtx" };
+            return names[option & 7];
+        }
+
+        // Memory operand with immediate offset: [xN], [xN, #imm], [xN, #imm]! or [xN], #imm
+        enum class index_mode { offset, pre, post };
+
+        std::string mem(uint32_t rn, int64_t offset, index_mode mode)
+        {
+            std::string base = reg(rn, true, true);
+            switch (mode)
+            {
+            case index_mode::pre:
+                return "[" + base + ", " + imm(offset) + "]!";
+            case index_mode::post:
+                return "[" + base + "], " + imm(offset);
+            default:
+                if (offset == 0)
+                    return "[" + base + "]";
+                return "[" + base + ", " + imm(offset) + "]";
+            }
+        }
+
+        bool set(instruction& insn, const std::string& mnemonic, const std::string& operands = "")
+        {
+            insn.mnemonic = mnemonic;
+            insn.operands = operands;
+            return true;
+        }
+
+        int highest_set_bit(uint32_t v)
+        {
+            for (int i = 31; i >= 0; i--)
+                if (v & (1u << i))
+                    return i;
+            return -1;
+        }
+
+        // DecodeBitMasks() from Arm ARM, returns false for reserved encodings
+        bool decode_bit_masks(uint32_t n, uint32_t imms, uint32_t immr, bool is64, uint64_t& result)
+        {
+            int len = highest_set_bit((n << 6) | (~imms & 0x3f));
+            if (len < 1)
+                return false;
+
+            uint32_t levels = (1u << len) - 1;
+            if ((imms & levels) == levels)
+                return false;
+
+            uint32_t s = imms & levels;
+            uint32_t r = immr & levels;
+            uint32_t esize = 1u << len;
+            uint64_t emask = (esize == 64) ? ~0ull : ((1ull << esize) - 1);
+            uint64_t welem = (s + 1 == 64) ? ~0ull : ((1ull << (s + 1)) - 1);
+            uint64_t elem = r ? (((welem >> r) | (welem << (esize - r))) & emask) : welem;
+
+            result = 0;
+            for (uint32_t i = 0; i < (is64 ? 64u : 32u); i += esize)
+                result |= elem << i;
+            return true;
+        }
+
+        bool move_wide_preferred(bool sf, uint32_t n, uint32_t imms, uint32_t immr)
+        {
+            const uint32_t width = sf ? 64 : 32;
+
+            if (sf && n != 1)
+                return false;
+            if (!sf && !(n == 0 && (imms & 0x20) == 0))
+                return false;
+            if (imms < 16)
+                return ((16 - (immr % 16)) % 16) <= (15 - imms);
+            if (imms >= width - 15)
+                return (immr % 16) <= (imms - (width - 15));
+            return false;
+        }
+
+        // VFPExpandImm() for FMOV (immediate)
+        double fp_expand_imm(uint32_t imm8)
+        {
+            int exp = static_cast<int>(sign_extend(bits(imm8, 6, 4), 3)) + 1;
+            double value = (16.0 + bits(imm8, 3, 0)) / 16.0;
+            while (exp > 0) { value *= 2.0; exp--; }
+            while (exp < 0) { value /= 2.0; exp++; }
+            return bit(imm8, 7) ? -value : value;
+        }
+
+        std::string fp_imm(uint32_t imm8)
+        {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "#%.8f", fp_expand_imm(imm8));
+            return buf;
+        }
+
+        //
+        // Data processing - immediate
+        //
+        bool decode_dp_imm(uint32_t w, uint64_t address, instruction& insn)
+        {
+            const bool sf = bit(w, 31);
+            const uint32_t rd = bits(w, 4, 0), rn = bits(w, 9, 5);
+
+            switch (bits(w, 25, 23))
+            {
+            case 0: case 1:     // PC-rel. addressing
+            {
+                int64_t offset = sign_extend((bits(w, 23, 5) << 2) | bits(w, 30, 29), 21);
+                if (bit(w, 31))
+                    return set(insn, "adrp", reg(rd, true) + ", " + hex((address & ~0xfffull) + (offset << 12)));
+                return set(insn, "adr", reg(rd, true) + ", " + hex(address + offset));
+            }
+            case 2:             // Add/subtract (immediate)
+            {
+                const bool op = bit(w, 30), s = bit(w, 29), sh = bit(w, 22);
+                const uint32_t imm12 = bits(w, 21, 10);
+                std::string operand = imm(imm12) + (sh ? ", lsl #12" : "");
+
+                if (!op && !s && !sh && imm12 == 0 && (rd == 31 || rn == 31))
+                    return set(insn, "mov", reg(rd, sf, true) + ", " + reg(rn, sf, true));
+                if (s && rd == 31)
+                    return set(insn, op ? "cmp" : "cmn", reg(rn, sf, true) + ", " + operand);
+
+                std::string mnemonic = std::string(op ? "sub" : "add") + (s ? "s" : "");
+                return set(insn, mnemonic, reg(rd, sf, !s) + ", " + reg(rn, sf, true) + ", " + operand);
+            }
+            case 4:             // Logical (immediate)
+            {
+                const uint32_t opc = bits(w, 30, 29), n = bit(w, 22);
+                const uint32_t immr = bits(w, 21, 16), imms = bits(w, 15, 10);
+                uint64_t value;
+
+                if (!sf && n)
+                    return false;
+                if (!decode_bit_masks(n, imms, immr, sf, value))
+                    return false;
+
+                if (opc == 3 && rd == 31)
+                    return set(insn, "tst", reg(rn, sf) + ", #" + hex(value));
+                if (opc == 1 && rn == 31 && !move_wide_preferred(sf, n, imms, immr))
+                    return set(insn, "mov", reg(rd, sf, true) + ", " + imm(sf ? static_cast<int64_t>(value) : static_cast<int32_t>(value)));
+
+                static const char* names[] = { "and", "orr", "eor", "ands" };
+                return set(insn, names[opc], reg(rd, sf, opc != 3) + ", " + reg(rn, sf) + ", #" + hex(value));
+            }
+            case 5:             // Move wide (immediate)
+            {
+                const uint32_t opc = bits(w, 30, 29), hw = bits(w, 22, 21);
+                const uint64_t imm16 = bits(w, 20, 5);
+                const uint32_t shift = hw * 16;
+
+                if (opc == 1 || (!sf && hw > 1))
+                    return false;
+
+                if (opc == 2 && !(imm16 == 0 && hw != 0))
+                {
+                    uint64_t value = imm16 << shift;
+                    return set(insn, "mov", reg(rd, sf) + ", " + imm(sf ? static_cast<int64_t>(value) : static_cast<int32_t>(value)));
+                }
+                if (opc == 0 && !(imm16 == 0 && hw != 0) && (sf || imm16 != 0xffff))
+                {
+                    uint64_t value = ~(imm16 << shift);
+                    return set(insn, "mov", reg(rd, sf) + ", " + imm(sf ? static_cast<int64_t>(value) : static_cast<int32_t>(value)));
+                }
+
+                static const char* names[] = { "movn", "", "movz", "movk" };
+                return set(insn, names[opc], reg(rd, sf) + ", " + imm(imm16) + (hw ? ", lsl " + dec(shift) : ""));
+            }
+            case 6:             // Bitfield
+            {
+                const uint32_t opc = bits(w, 30, 29), n = bit(w, 22);
+                const uint32_t immr = bits(w, 21, 16), imms = bits(w, 15, 10);
+                const uint32_t width = sf ? 64 : 32;
+
+                if (opc == 3 || n != sf || (!sf && (immr > 31 || imms > 31)))
+                    return false;
+
+                const std::string dst = reg(rd, sf), src = reg(rn, sf);
+
+                if (opc == 1)   // BFM
+                {
+                    if (imms < immr)
+                    {
+                        std::string ops = dec((width - immr) % width) + ", " + dec(imms + 1);
+                        if (rn == 31)
+                            return set(insn, "bfc", dst + ", " + ops);
+                        return set(insn, "bfi", dst + ", " + src + ", " + ops);
+                    }
+                    if (rn == 31 && immr == 0)
+                        return set(insn, "bfc", dst + ", #0, " + dec(imms + 1));
+                    return set(insn, "bfxil", dst + ", " + src + ", " + dec(immr) + ", " + dec(imms - immr + 1));
+                }
+
+                const bool is_signed = (opc == 0);
+                if (immr == 0)
+                {
+                    const char* ext = nullptr;
+                    if (imms == 7)
+                        ext = is_signed ? "sxtb" : (sf ? nullptr : "uxtb");
+                    else if (imms == 15)
+                        ext = is_signed ? "sxth" : (sf ? nullptr : "uxth");
+                    else if (imms == 31 && sf && is_signed)
+                        ext = "sxtw";
+                    if (ext)
+                        return set(insn, ext, dst + ", " + reg(rn, false));
+                }
+
+                if (!is_signed && imms != width - 1 && imms + 1 == immr)
+                    return set(insn, "lsl", dst + ", " + src + ", " + dec(width - 1 - imms));
+                if (imms == width - 1)
+                    return set(insn, is_signed ? "asr" : "lsr", dst + ", " + src + ", " + dec(immr));
+                if (immr > imms)
+                    return set(insn, is_signed ? "sbfiz" : "ubfiz", dst + ", " + src + ", " + dec(width - immr) + ", " + dec(imms + 1));
+                return set(insn, is_signed ? "sbfx" : "ubfx", dst + ", " + src + ", " + dec(immr) + ", " + dec(imms - immr + 1));
+            }
+            case 7:             // Extract
+            {
+                const uint32_t rm = bits(w, 20, 16), imms = bits(w, 15, 10);
+
+                if (bits(w, 30, 29) != 0 || bit(w, 22) != sf || bit(w, 21) || (!sf && imms > 31))
+                    return false;
+                if (rn == rm)
+                    return set(insn, "ror", reg(rd, sf) + ", " + reg(rn, sf) + ", " + imm(imms));
+                return set(insn, "extr", reg(rd, sf) + ", " + reg(rn, sf) + ", " + reg(rm, sf) + ", " + imm(imms));
+            }
+            }
+            return false;
+        }
+
+        //
+        // Branches, exception generating and system instructions
+        //
+        std::string sysreg_name(uint32_t op0, uint32_t op1, uint32_t crn, uint32_t crm, uint32_t op2)
+        {
+            struct sysreg { uint32_t enc; const char* name; };
+            static const sysreg names[] = {
+                { 0xc000, "MIDR_EL1" },     { 0xc005, "MPIDR_EL1" },    { 0xc212, "CurrentEL" },
+                { 0xda10, "NZCV" },         { 0xda11, "DAIF" },         { 0xda20, "FPCR" },
+                { 0xda21, "FPSR" },         { 0xde82, "TPIDR_EL0" },    { 0xde83, "TPIDRRO_EL0" },
+                { 0xc684, "TPIDR_EL1" },    { 0xdf00, "CNTFRQ_EL0" },   { 0xdf01, "CNTPCT_EL0" },
+                { 0xdf02, "CNTVCT_EL0" },   { 0xdce8, "PMCCNTR_EL0" },  { 0xdce0, "PMCR_EL0" },
+                { 0xdcea, "PMXEVCNTR_EL0" },{ 0xdce9, "PMXEVTYPER_EL0" },{ 0xdce5, "PMSELR_EL0" },
+                { 0xc006, "REVIDR_EL1" },   { 0xd801, "CTR_EL0" },
+                { 0xd807, "DCZID_EL0" },    { 0xc081, "ACTLR_EL1" },    { 0xc080, "SCTLR_EL1" },
+                { 0xc200, "SPSR_EL1" },     { 0xc201, "ELR_EL1" },      { 0xc208, "SP_EL0" },
+                { 0xe208, "SP_EL1" },       { 0xc600, "VBAR_EL1" },     { 0xc100, "TTBR0_EL1" },
+                { 0xc101, "TTBR1_EL1" },    { 0xc102, "TCR_EL1" },      { 0xc290, "ESR_EL1" },
+                { 0xc300, "FAR_EL1" },      { 0xc3a0, "PAR_EL1" },
+            };
+
+            const uint32_t enc = (op0 << 14) | (op1 << 11) | (crn << 7) | (crm << 3) | op2;
+            for (const auto& r : names)
+                if (r.enc == enc)
+                    return r.name;
+
+            return "S" + std::to_string(op0) + "_" + std::to_string(op1) + "_C" + std::to_string(crn)
+                + "_C" + std::to_string(crm) + "_" + std::to_string(op2);
+        }
+
+        const char* barrier_option(uint32_t crm)
+        {
+            static const char* names[] = { nullptr, "oshld", "oshst", "osh", nullptr, "nshld", "nshst", "nsh",
+                                           nullptr, "ishld", "ishst", "ish", nullptr, "ld", "st", "sy" };
+            return names[crm & 0xf];
+        }
+
+        bool decode_hint(uint32_t crm_op2, instruction& insn)
+        {
+            switch (crm_op2)
+            {
+            case 0: return set(insn, "nop");
+            case 1: return set(insn, "yield");
+            case 2: return set(insn, "wfe");
+            case 3: return set(insn, "wfi");
+            case 4: return set(insn, "sev");
+            case 5: return set(insn, "sevl");
+            case 7: return set(insn, "xpaclri");
+            case 8: return set(insn, "pacia1716");
+            case 10: return set(insn, "pacib1716");
+            case 12: return set(insn, "autia1716");
+            case 14: return set(insn, "autib1716");
+            case 16: return set(insn, "esb");
+            case 17: return set(insn, "psb", "csync");
+            case 20: return set(insn, "csdb");
+            case 24: return set(insn, "paciaz");
+            case 25: return set(insn, "paciasp");
+            case 26: return set(insn, "pacibz");
+            case 27: return set(insn, "pacibsp");
+            case 28: return set(insn, "autiaz");
+            case 29: return set(insn, "autiasp");
+            case 30: return set(insn, "autibz");
+            case 31: return set(insn, "autibsp");
+            case 32: return set(insn, "bti");
+            case 34: return set(insn, "bti", "c");
+            case 36: return set(insn, "bti", "j");
+            case 38: return set(insn, "bti", "jc");
+            }
+            return set(insn, "hint", imm(crm_op2));
+        }
+
+        bool decode_branch_sys(uint32_t w, uint64_t address, instruction& insn)
+        {
+            // Unconditional branch (immediate)
+            if (bits(w, 30, 26) == 0x05)
+            {
+                int64_t offset = sign_extend(bits(w, 25, 0), 26) * 4;
+                return set(insn, bit(w, 31) ? "bl" : "b", hex(address + offset));
+            }
+
+            // Compare and branch (immediate)
+            if (bits(w, 30, 25) == 0x1a)
+            {
+                int64_t offset = sign_extend(bits(w, 23, 5), 19) * 4;
+                return set(insn, bit(w, 24) ? "cbnz" : "cbz", reg(bits(w, 4, 0), bit(w, 31)) + ", " + hex(address + offset));
+            }
+
+            // Test and branch (immediate)
+            if (bits(w, 30, 25) == 0x1b)
+            {
+                const uint32_t b = (bit(w, 31) << 5) | bits(w, 23, 19);
+                int64_t offset = sign_extend(bits(w, 18, 5), 14) * 4;
+                return set(insn, bit(w, 24) ? "tbnz" : "tbz", reg(bits(w, 4, 0), bit(w, 31)) + ", " + imm(b) + ", " + hex(address + offset));
+            }
+
+            // Conditional branch (immediate)
+            if (bits(w, 31, 24) == 0x54 && !bit(w, 4))
+            {
+                int64_t offset = sign_extend(bits(w, 23, 5), 19) * 4;
+                return set(insn, std::string("b.") + cond_name(bits(w, 3, 0)), hex(address + offset));
+            }
+
+            // Exception generation
+            if (bits(w, 31, 24) == 0xd4)
+            {
+                const uint32_t opc = bits(w, 23, 21), ll = bits(w, 1, 0);
+                const uint32_t value = bits(w, 20, 5);
+                const std::string imm16 = value ? imm(value) : "#0";
+
+                if (bits(w, 4, 2) != 0)
+                    return false;
+                if (opc == 0 && ll == 1) return set(insn, "svc", imm16);
+                if (opc == 0 && ll == 2) return set(insn, "hvc", imm16);
+                if (opc == 0 && ll == 3) return set(insn, "smc", imm16);
+                if (opc == 1 && ll == 0) return set(insn, "brk", imm16);
+                if (opc == 2 && ll == 0) return set(insn, "hlt", imm16);
+                return false;
+            }
+
+            // System instructions
+            if (bits(w, 31, 22) == 0x354)
+            {
+                const bool l = bit(w, 21);
+                const uint32_t op0 = bits(w, 20, 19), op1 = bits(w, 18, 16), crn = bits(w, 15, 12);
+                const uint32_t crm = bits(w, 11, 8), op2 = bits(w, 7, 5), rt = bits(w, 4, 0);
+
+                if (!l && op0 == 0 && op1 == 3 && crn == 2 && rt == 31)
+                    return decode_hint((crm << 3) | op2, insn);
+
+                if (!l && op0 == 0 && op1 == 3 && crn == 3 && rt == 31)
+                {
+                    switch (op2)
+                    {
+                    case 2:
+                        return set(insn, "clrex", crm == 15 ? "" : imm(crm));
+                    case 4:
+                    case 5:
+                        if (op2 == 4 && crm == 0)
+                            return set(insn, "ssbb");
+                        if (op2 == 4 && crm == 4)
+                            return set(insn, "pssbb");
+                        return set(insn, op2 == 4 ? "dsb" : "dmb", barrier_option(crm) ? barrier_option(crm) : imm(crm));
+                    case 6:
+                        return set(insn, "isb", crm == 15 ? "" : imm(crm));
+                    case 7:
+                        if (crm == 0)
+                            return set(insn, "sb");
+                        return false;
+                    }
+                    return false;
+                }
+
+                // MSR (immediate) for PSTATE.DAIF
+                if (!l && op0 == 0 && op1 == 3 && crn == 4 && rt == 31 && (op2 == 6 || op2 == 7))
+                    return set(insn, "msr", std::string(op2 == 6 ? "DAIFSet" : "DAIFClr") + ", " + imm(crm));
+
+                if (op0 >= 2)
+                {
+                    if (l)
+                        return set(insn, "mrs", reg(rt, true) + ", " + sysreg_name(op0, op1, crn, crm, op2));
+                    return set(insn, "msr", sysreg_name(op0, op1, crn, crm, op2) + ", " + reg(rt, true));
+                }
+                return false;
+            }
+
+            // Unconditional branch (register)
+            if (bits(w, 31, 25) == 0x6b)
+            {
+                const uint32_t opc = bits(w, 24, 21), op2 = bits(w, 20, 16), op3 = bits(w, 15, 10);
+                const uint32_t rn = bits(w, 9, 5), op4 = bits(w, 4, 0);
+
+                if (op2 != 0x1f)
+                    return false;
+
+                if (op3 == 0 && op4 == 0)
+                {
+                    switch (opc)
+                    {
+                    case 0: return set(insn, "br", reg(rn, true));
+                    case 1: return set(insn, "blr", reg(rn, true));
+                    case 2: return set(insn, "ret", rn == 30 ? "" : reg(rn, true));
+                    case 4: if (rn == 31) return set(insn, "eret"); break;
+                    case 5: if (rn == 31) return set(insn, "drps"); break;
+                    }
+                    return false;
+                }
+
+                if (opc == 2 && rn == 31 && op4 == 31 && (op3 == 2 || op3 == 3))
+                    return set(insn, op3 == 2 ? "retaa" : "retab");
+                return false;
+            }
+
+            return false;
+        }
+
+        //
+        // Loads and stores
+        //
+
+        // Mnemonic for load/store register (GPR), "" if unallocated
+        const char* ldst_name(uint32_t size, uint32_t opc, const char* variant)
+        {
+            static const char* names[4][4] = {
+                { "strb", "ldrb", "ldrsb", "ldrsb" },
+                { "strh", "ldrh", "ldrsh", "ldrsh" },
+                { "str",  "ldr",  "ldrsw", "" },
+                { "str",  "ldr",  "prfm",  "" },
+            };
+            static const char* unscaled[4][4] = {
+                { "sturb", "ldurb", "ldursb", "ldursb" },
+                { "sturh", "ldurh", "ldursh", "ldursh" },
+                { "stur",  "ldur",  "ldursw", "" },
+                { "stur",  "ldur",  "prfum",  "" },
+            };
+            static const char* unprivileged[4][4] = {
+                { "sttrb", "ldtrb", "ldtrsb", "ldtrsb" },
+                { "sttrh", "ldtrh", "ldtrsh", "ldtrsh" },
+                { "sttr",  "ldtr",  "ldtrsw", "" },
+                { "sttr",  "ldtr",  "",       "" },
+            };
+
+            if (variant[0] == 'u')
+                return unscaled[size][opc];
+            if (variant[0] == 't')
+                return unprivileged[size][opc];
+            return names[size][opc];
+        }
+
+        // Destination (transfer) register of load/store register (GPR)
+        std::string ldst_rt(uint32_t rt, uint32_t size, uint32_t opc)
+        {
+            if (opc == 2)               // Sign extend to 64-bit
+                return reg(rt, true);
+            return reg(rt, size == 3 && opc < 2);
+        }
+
+        std::string prfop(uint32_t rt)
+        {
+            static const char* type[] = { "pld", "pli", "pst" };
+            static const char* target[] = { "l1", "l2", "l3" };
+            static const char* policy[] = { "keep", "strm" };
+
+            if (bits(rt, 4, 3) == 3 || bits(rt, 2, 1) == 3)
+                return imm(rt);
+            return std::string(type[bits(rt, 4, 3)]) + target[bits(rt, 2, 1)] + policy[bit(rt, 0)];
+        }
+
+        bool decode_ldst_reg(uint32_t w, instruction& insn)
+        {
+            const uint32_t size = bits(w, 31, 30), opc = bits(w, 23, 22);
+            const bool v = bit(w, 26);
+            const uint32_t rn = bits(w, 9, 5), rt = bits(w, 4, 0);
+            const char* variant = "";
+            std::string mnemonic, rt_str, addr;
+            uint32_t scale = size;
+
+            if (v)
+            {
+                // SIMD&FP: opc<1> with size 00 selects 128-bit Q register
+                if (bit(opc, 1))
+                {
+                    if (size != 0)
+                        return false;
+                    scale = 4;
+                }
+                mnemonic = bit(opc, 0) ? "ldr" : "str";
+                rt_str = vreg(rt, scale);
+            }
+
+            if (bit(w, 24))     // Unsigned immediate
+            {
+                if (!v)
+                {
+                    mnemonic = ldst_name(size, opc, variant);
+                    rt_str = (mnemonic == "prfm") ? prfop(rt) : ldst_rt(rt, size, opc);
+                }
+                addr = mem(rn, static_cast<int64_t>(bits(w, 21, 10)) << scale, index_mode::offset);
+            }
+            else if (!bit(w, 21))
+            {
+                const int64_t imm9 = sign_extend(bits(w, 20, 12), 9);
+                index_mode mode = index_mode::offset;
+
+                switch (bits(w, 11, 10))
+                {
+                case 0: variant = "u"; break;
+                case 1: mode = index_mode::post; break;
+                case 2: variant = "t"; if (v) return false; break;
+                case 3: mode = index_mode::pre; break;
+                }
+
+                if (!v)
+                {
+                    mnemonic = ldst_name(size, opc, variant);
+                    if (mnemonic == "prfm" && mode != index_mode::offset)
+                        return false;
+                    rt_str = (mnemonic == "prfum") ? prfop(rt) : ldst_rt(rt, size, opc);
+                }
+                else if (variant[0] == 'u')
+                    mnemonic = bit(opc, 0) ? "ldur" : "stur";
+                addr = mem(rn, imm9, mode);
+            }
+            else if (bits(w, 11, 10) == 2)  // Register offset
+            {
+                const uint32_t rm = bits(w, 20, 16), option = bits(w, 15, 13);
+                const bool s = bit(w, 12);
+
+                if (!bit(option, 1))
+                    return false;
+
+                if (!v)
+                {
+                    mnemonic = ldst_name(size, opc, variant);
+                    rt_str = (mnemonic == "prfm") ? prfop(rt) : ldst_rt(rt, size, opc);
+                }
+
+                addr = "[" + reg(rn, true, true) + ", " + reg(rm, bit(option, 0));
+                if (option == 3)
+                    addr += s ? ", lsl " + dec(scale) : "";
+                else
+                    addr += std::string(", ") + extend_name(option) + (s ? " " + dec(scale) : "");
+                addr += "]";
+            }
+            else
+                return false;   // Atomic memory operations, pointer authentication loads
+
+            if (mnemonic.empty())
+                return false;
+            return set(insn, mnemonic, rt_str + ", " + addr);
+        }
+
+        bool decode_ldst(uint32_t w, uint64_t address, instruction& insn)
+        {
+            const bool v = bit(w, 26);
+            const uint32_t rn = bits(w, 9, 5), rt = bits(w, 4, 0);
+
+            // Load/store exclusive and ordered
+            if (bits(w, 29, 24) == 0x08)
+            {
+                const uint32_t size = bits(w, 31, 30), rs = bits(w, 20, 16), rt2 = bits(w, 14, 10);
+                const bool o2 = bit(w, 23), l = bit(w, 22), o1 = bit(w, 21), o0 = bit(w, 15);
+                const char* suffix = size == 0 ? "b" : (size == 1 ? "h" : "");
+                const std::string rt_str = reg(rt, size == 3);
+                const std::string addr = "[" + reg(rn, true, true) + "]";
+
+                if (o1 || rt2 != 31)
+                    return false;   // Pairs and compare and swap
+                if (!o2)
+                {
+                    if (l && rs != 31)
+                        return false;
+                    if (l)
+                        return set(insn, std::string(o0 ? "ldaxr" : "ldxr") + suffix, rt_str + ", " + addr);
+                    return set(insn, std::string(o0 ? "stlxr" : "stxr") + suffix, reg(rs, false) + ", " + rt_str + ", " + addr);
+                }
+                if (rs != 31)
+                    return false;
+                if (l)
+                    return set(insn, std::string(o0 ? "ldar" : "ldlar") + suffix, rt_str + ", " + addr);
+                return set(insn, std::string(o0 ? "stlr" : "stllr") + suffix, rt_str + ", " + addr);
+            }
+
+            // Load register (literal)
+            if (bits(w, 29, 27) == 3 && bits(w, 25, 24) == 0)
+            {
+                const uint32_t opc = bits(w, 31, 30);
+                const std::string target = hex(address + sign_extend(bits(w, 23, 5), 19) * 4);
+
+                if (v)
+                {
+                    if (opc == 3)
+                        return false;
+                    return set(insn, "ldr", vreg(rt, opc + 2) + ", " + target);
+                }
+                switch (opc)
+                {
+                case 0: return set(insn, "ldr", reg(rt, false) + ", " + target);
+                case 1: return set(insn, "ldr", reg(rt, true) + ", " + target);
+                case 2: return set(insn, "ldrsw", reg(rt, true) + ", " + target);
+                case 3: return set(insn, "prfm", prfop(rt) + ", " + target);
+                }
+            }
+
+            // Load/store pair
+            if (bits(w, 29, 27) == 5)
+            {
+                const uint32_t opc = bits(w, 31, 30), type = bits(w, 24, 23), rt2 = bits(w, 14, 10);
+                const bool l = bit(w, 22);
+                const int64_t imm7 = sign_extend(bits(w, 21, 15), 7);
+                std::string mnemonic = l ? "ldp" : "stp";
+                std::string r1, r2;
+                uint32_t scale;
+
+                if (opc == 3)
+                    return false;
+
+                if (v)
+                {
+                    scale = 2 + opc;
+                    r1 = vreg(rt, scale);
+                    r2 = vreg(rt2, scale);
+                }
+                else
+                {
+                    if (opc == 1)
+                    {
+                        if (!l || type == 0)
+                            return false;   // STGP
+                        mnemonic = "ldpsw";
+                    }
+                    scale = (opc == 2) ? 3 : 2;
+                    r1 = reg(rt, opc == 2 || opc == 1);
+                    r2 = reg(rt2, opc == 2 || opc == 1);
+                }
+
+                if (type == 0)
+                    mnemonic = l ? "ldnp" : "stnp";
+
+                static const index_mode modes[] = { index_mode::offset, index_mode::post, index_mode::offset, index_mode::pre };
+                return set(insn, mnemonic, r1 + ", " + r2 + ", " + mem(rn, imm7 * (1ll << scale), modes[type]));
+            }
+
+            // Load/store register
+            if (bits(w, 29, 27) == 7)
+                return decode_ldst_reg(w, insn);
+
+            return false;
+        }
+
+        //
+        // Data processing - register
+        //
+        bool decode_dp_reg(uint32_t w, instruction& insn)
+        {
+            const bool sf = bit(w, 31);
+            const uint32_t rd = bits(w, 4, 0), rn = bits(w, 9, 5), rm = bits(w, 20, 16);
+            const uint32_t op1 = bit(w, 28), op2 = bits(w, 24, 21);
+
+            if (!op1 && !bit(op2, 3))       // Logical (shifted register)
+            {
+                const uint32_t opc = bits(w, 30, 29), shift = bits(w, 23, 22), imm6 = bits(w, 15, 10);
+                const bool n = bit(w, 21);
+
+                if (!sf && imm6 > 31)
+                    return false;
+
+                std::string shifted = reg(rm, sf) + (shift || imm6 ? ", " + std::string(shift_name(shift)) + " " + dec(imm6) : "");
+
+                if (opc == 1 && rn == 31)
+                {
+                    if (!n && !shift && !imm6)
+                        return set(insn, "mov", reg(rd, sf) + ", " + reg(rm, sf));
+                    if (n)
+                        return set(insn, "mvn", reg(rd, sf) + ", " + shifted);
+                }
+                if (opc == 3 && !n && rd == 31)
+                    return set(insn, "tst", reg(rn, sf) + ", " + shifted);
+
+                static const char* names[2][4] = { { "and", "orr", "eor", "ands" }, { "bic", "orn", "eon", "bics" } };
+                return set(insn, names[n][opc], reg(rd, sf) + ", " + reg(rn, sf) + ", " + shifted);
+            }
+
+            if (!op1 && bit(op2, 3) && !bit(op2, 0))    // Add/subtract (shifted register)
+            {
+                const bool op = bit(w, 30), s = bit(w, 29);
+                const uint32_t shift = bits(w, 23, 22), imm6 = bits(w, 15, 10);
+
+                if (shift == 3 || (!sf && imm6 > 31))
+                    return false;
+
+                std::string shifted = reg(rm, sf) + (shift || imm6 ? ", " + std::string(shift_name(shift)) + " " + dec(imm6) : "");
+
+                if (s && rd == 31)
+                    return set(insn, op ? "cmp" : "cmn", reg(rn, sf) + ", " + shifted);
+                if (op && rn == 31)
+                    return set(insn, s ? "negs" : "neg", reg(rd, sf) + ", " + shifted);
+
+                std::string mnemonic = std::string(op ? "sub" : "add") + (s ? "s" : "");
+                return set(insn, mnemonic, reg(rd, sf) + ", " + reg(rn, sf) + ", " + shifted);
+            }
+
+            if (!op1 && bit(op2, 3) && bit(op2, 0))     // Add/subtract (extended register)
+            {
+                const bool op = bit(w, 30), s = bit(w, 29);
+                const uint32_t option = bits(w, 15, 13), imm3 = bits(w, 12, 10);
+
+                if (bits(w, 23, 22) != 0 || imm3 > 4)
+                    return false;
+
+                std::string ext;
+                const bool is_lsl = (rd == 31 && !s) || rn == 31;
+                if (is_lsl && option == (sf ? 3u : 2u))
+                    ext = imm3 ? ", lsl " + dec(imm3) : "";
+                else
+                    ext = std::string(", ") + extend_name(option) + (imm3 ? " " + dec(imm3) : "");
+
+                std::string extended = reg(rm, sf && bits(option, 1, 0) == 3) + ext;
+
+                if (s && rd == 31)
+                    return set(insn, op ? "cmp" : "cmn", reg(rn, sf, true) + ", " + extended);
+
+                std::string mnemonic = std::string(op ? "sub" : "add") + (s ? "s" : "");
+                return set(insn, mnemonic, reg(rd, sf, !s) + ", " + reg(rn, sf, true) + ", " + extended);
+            }
+
+            if (op1 && op2 == 0 && bits(w, 15, 10) == 0)   // Add/subtract with carry
+            {
+                const bool op = bit(w, 30), s = bit(w, 29);
+
+                if (op && rn == 31)
+                    return set(insn, s ? "ngcs" : "ngc", reg(rd, sf) + ", " + reg(rm, sf));
+
+                std::string mnemonic = std::string(op ? "sbc" : "adc") + (s ? "s" : "");
+                return set(insn, mnemonic, reg(rd, sf) + ", " + reg(rn, sf) + ", " + reg(rm, sf));
+            }
+
+            if (op1 && op2 == 2)        // Conditional compare
+            {
+                if (!bit(w, 29) || bit(w, 10) || bit(w, 4))
+                    return false;
+
+                std::string operand = bit(w, 11) ? imm(rm) : reg(rm, sf);
+                return set(insn, bit(w, 30) ? "ccmp" : "ccmn",
+                    reg(rn, sf) + ", " + operand + ", " + imm(bits(w, 3, 0)) + ", " + cond_name(bits(w, 15, 12)));
+            }
+
+            if (op1 && op2 == 4)        // Conditional select
+            {
+                const uint32_t op = (bit(w, 30) << 1) | bit(w, 10), cond = bits(w, 15, 12);
+
+                if (bit(w, 29) || bit(w, 11))
+                    return false;
+
+                const bool invertible = (cond & 0xe) != 0xe;
+                const char* inv = cond_name(cond ^ 1);
+
+                if (op == 1 && invertible && rm == rn)
+                {
+                    if (rn == 31)
+                        return set(insn, "cset", reg(rd, sf) + ", " + inv);
+                    return set(insn, "cinc", reg(rd, sf) + ", " + reg(rn, sf) + ", " + inv);
+                }
+                if (op == 2 && invertible && rm == rn)
+                {
+                    if (rn == 31)
+                        return set(insn, "csetm", reg(rd, sf) + ", " + inv);
+                    return set(insn, "cinv", reg(rd, sf) + ", " + reg(rn, sf) + ", " + inv);
+                }
+                if (op == 3 && invertible && rm == rn)
+                    return set(insn, "cneg", reg(rd, sf) + ", " + reg(rn, sf) + ", " + inv);
+
+                static const char* names[] = { "csel", "csinc", "csinv", "csneg" };
+                return set(insn, names[op], reg(rd, sf) + ", " + reg(rn, sf) + ", " + reg(rm, sf) + ", " + cond_name(cond));
+            }
+
+            if (op1 && op2 == 6)        // Data-processing (1 and 2 source)
+            {
+                const uint32_t opcode = bits(w, 15, 10);
+
+                if (bit(w, 29))
+                    return false;
+
+                if (bit(w, 30))         // 1 source
+                {
+                    if (rm != 0)
+                        return false;
+                    switch (opcode)
+                    {
+                    case 0: return set(insn, "rbit", reg(rd, sf) + ", " + reg(rn, sf));
+                    case 1: return set(insn, "rev16", reg(rd, sf) + ", " + reg(rn, sf));
+                    case 2: return set(insn, sf ? "rev32" : "rev", reg(rd, sf) + ", " + reg(rn, sf));
+                    case 3: if (sf) return set(insn, "rev", reg(rd, sf) + ", " + reg(rn, sf)); break;
+                    case 4: return set(insn, "clz", reg(rd, sf) + ", " + reg(rn, sf));
+                    case 5: return set(insn, "cls", reg(rd, sf) + ", " + reg(rn, sf));
+                    }
+                    return false;
+                }
+
+                const std::string ops = reg(rd, sf) + ", " + reg(rn, sf) + ", " + reg(rm, sf);
+                switch (opcode)
+                {
+                case 2: return set(insn, "udiv", ops);
+                case 3: return set(insn, "sdiv", ops);
+                case 8: return set(insn, "lsl", ops);
+                case 9: return set(insn, "lsr", ops);
+                case 10: return set(insn, "asr", ops);
+                case 11: return set(insn, "ror", ops);
+                }
+                return false;
+            }
+
+            if (op1 && bit(op2, 3))     // Data-processing (3 source)
+            {
+                const uint32_t op31 = bits(w, 23, 21), ra = bits(w, 14, 10);
+                const bool o0 = bit(w, 15);
+
+                if (bits(w, 30, 29) != 0)
+                    return false;
+
+                if (op31 == 0)
+                {
+                    if (ra == 31)
+                        return set(insn, o0 ? "mneg" : "mul", reg(rd, sf) + ", " + reg(rn, sf) + ", " + reg(rm, sf));
+                    return set(insn, o0 ? "msub" : "madd", reg(rd, sf) + ", " + reg(rn, sf) + ", " + reg(rm, sf) + ", " + reg(ra, sf));
+                }
+
+                if (!sf)
+                    return false;
+
+                if ((op31 == 2 || op31 == 6) && !o0 && ra == 31)
+                    return set(insn, op31 == 2 ? "smulh" : "umulh", reg(rd, true) + ", " + reg(rn, true) + ", " + reg(rm, true));
+
+                if (op31 == 1 || op31 == 5)
+                {
+                    const bool u = (op31 == 5);
+                    const std::string srcs = reg(rn, false) + ", " + reg(rm, false);
+                    if (ra == 31)
+                        return set(insn, std::string(u ? "u" : "s") + (o0 ? "mnegl" : "mull"), reg(rd, true) + ", " + srcs);
+                    return set(insn, std::string(u ? "u" : "s") + (o0 ? "msubl" : "maddl"), reg(rd, true) + ", " + srcs + ", " + reg(ra, true));
+                }
+                return false;
+            }
+
+            return false;
+        }
+
+        //
+        // Scalar floating-point and Advanced SIMD
+        //
+
+        // FP scalar size (log2 bytes) from ptype field, 0 if reserved
+        uint32_t fp_size(uint32_t ptype)
+        {
+            static const uint32_t sizes[] = { 2, 3, 0, 1 };
+            return sizes[ptype & 3];
+        }
+
+        bool decode_fp(uint32_t w, instruction& insn)
+        {
+            const uint32_t ptype = bits(w, 23, 22), rd = bits(w, 4, 0), rn = bits(w, 9, 5), rm = bits(w, 20, 16);
+            const uint32_t sz = fp_size(ptype);
+
+            if (bits(w, 30, 29) != 0 || ptype == 2)
+                return false;
+
+            // Floating-point data-processing (3 source)
+            if (bits(w, 28, 24) == 0x1f)
+            {
+                static const char* names[] = { "fmadd", "fmsub", "fnmadd", "fnmsub" };
+                const uint32_t op = (bit(w, 21) << 1) | bit(w, 15);
+
+                if (bit(w, 31))
+                    return false;
+                return set(insn, names[op], vreg(rd, sz) + ", " + vreg(rn, sz) + ", " + vreg(rm, sz) + ", " + vreg(bits(w, 14, 10), sz));
+            }
+
+            if (bits(w, 28, 24) != 0x1e || !bit(w, 21))
+                return false;   // Conversion between floating-point and fixed-point
+
+            if (bits(w, 15, 10) == 0)   // Conversion between floating-point and integer
+            {
+                const bool sf = bit(w, 31);
+                const uint32_t rmode = bits(w, 20, 19), opcode = bits(w, 18, 16);
+
+                if (opcode == 6 || opcode == 7)
+                {
+                    if (rmode != 0 || (sf ? ptype == 0 : ptype == 1))
+                        return false;
+                    if (opcode == 6)
+                        return set(insn, "fmov", reg(rd, sf) + ", " + vreg(rn, sz));
+                    return set(insn, "fmov", vreg(rd, sz) + ", " + reg(rn, sf));
+                }
+
+                if (opcode == 2 || opcode == 3)
+                {
+                    if (rmode != 0)
+                        return false;
+                    return set(insn, opcode == 2 ? "scvtf" : "ucvtf", vreg(rd, sz) + ", " + reg(rn, sf));
+                }
+
+                if (opcode >= 4 && rmode != 0)
+                    return false;
+
+                static const char* names[4][3] = {
+                    { "fcvtn", "", "fcvta" }, { "fcvtp", "", "" }, { "fcvtm", "", "" }, { "fcvtz", "", "" },
+                };
+                const std::string mnemonic = std::string(names[rmode][opcode >> 1]) + (bit(opcode, 0) ? "u" : "s");
+                return set(insn, mnemonic, reg(rd, sf) + ", " + vreg(rn, sz));
+            }
+
+            if (bit(w, 31))
+                return false;
+
+            if (bits(w, 14, 10) == 0x10)    // Floating-point data-processing (1 source)
+            {
+                const uint32_t opcode = bits(w, 20, 15);
+                static const char* names[] = { "fmov", "fabs", "fneg", "fsqrt" };
+
+                if (opcode < 4)
+                    return set(insn, names[opcode], vreg(rd, sz) + ", " + vreg(rn, sz));
+                if ((opcode & 0x3c) == 4)   // FCVT
+                {
+                    const uint32_t dst = opcode & 3;
+                    if (dst == 2 || dst == ptype)
+                        return false;
+                    return set(insn, "fcvt", vreg(rd, fp_size(dst)) + ", " + vreg(rn, sz));
+                }
+                static const char* rint[] = { "frintn", "frintp", "frintm", "frintz", "frinta", "", "frintx", "frinti" };
+                if (opcode >= 8 && opcode <= 15 && opcode != 13)
+                    return set(insn, rint[opcode - 8], vreg(rd, sz) + ", " + vreg(rn, sz));
+                return false;
+            }
+
+            if (bits(w, 13, 10) == 8)       // Floating-point compare
+            {
+                const uint32_t opcode2 = bits(w, 4, 0);
+
+                if (bits(w, 15, 14) != 0 || (opcode2 & 7) != 0)
+                    return false;
+
+                const char* mnemonic = bit(opcode2, 4) ? "fcmpe" : "fcmp";
+                if (bit(opcode2, 3))
+                    return set(insn, mnemonic, vreg(rn, sz) + ", #0.0");
+                return set(insn, mnemonic, vreg(rn, sz) + ", " + vreg(rm, sz));
+            }
+
+            if (bits(w, 12, 10) == 4)       // Floating-point immediate
+            {
+                if (bits(w, 9, 5) != 0)
+                    return false;
+                return set(insn, "fmov", vreg(rd, sz) + ", " + fp_imm(bits(w, 20, 13)));
+            }
+
+            if (bits(w, 11, 10) == 2)       // Floating-point data-processing (2 source)
+            {
+                static const char* names[] = { "fmul", "fdiv", "fadd", "fsub", "fmax", "fmin", "fmaxnm", "fminnm", "fnmul" };
+                const uint32_t opcode = bits(w, 15, 12);
+
+                if (opcode > 8)
+                    return false;
+                return set(insn, names[opcode], vreg(rd, sz) + ", " + vreg(rn, sz) + ", " + vreg(rm, sz));
+            }
+
+            if (bits(w, 11, 10) == 3)       // Floating-point conditional select
+                return set(insn, "fcsel", vreg(rd, sz) + ", " + vreg(rn, sz) + ", " + vreg(rm, sz) + ", " + cond_name(bits(w, 15, 12)));
+
+            if (bits(w, 11, 10) == 1)       // Floating-point conditional compare
+            {
+                return set(insn, bit(w, 4) ? "fccmpe" : "fccmp",
+                    vreg(rn, sz) + ", " + vreg(rm, sz) + ", " + imm(bits(w, 3, 0)) + ", " + cond_name(bits(w, 15, 12)));
+            }
+
+            return false;
+        }
+
+        const char* arrangement(uint32_t size, bool q)
+        {
+            static const char* names[] = { "8b", "16b", "4h", "8h", "2s", "4s", "1d", "2d" };
+            return names[((size & 3) << 1) | (q ? 1 : 0)];
+        }
+
+        bool decode_simd(uint32_t w, instruction& insn)
+        {
+            const bool q = bit(w, 30), u = bit(w, 29);
+            const uint32_t rd = bits(w, 4, 0), rn = bits(w, 9, 5), rm = bits(w, 20, 16);
+
+            if (bit(w, 31))
+                return false;
+
+            // Advanced SIMD three same
+            if (bits(w, 28, 24) == 0x0e && bit(w, 21) && bit(w, 10))
+            {
+                const uint32_t size = bits(w, 23, 22), opcode = bits(w, 15, 11);
+                const std::string ops = ", " + vreg(rn, arrangement(size, q)) + ", " + vreg(rm, arrangement(size, q));
+
+                if (opcode == 0x03)     // Logical, size selects operation
+                {
+                    const char* a = q ? "16b" : "8b";
+                    static const char* names[2][4] = { { "and", "bic", "orr", "orn" }, { "eor", "bsl", "bit", "bif" } };
+
+                    if (!u && size == 2 && rn == rm)
+                        return set(insn, "mov", vreg(rd, a) + ", " + vreg(rn, a));
+                    return set(insn, names[u][size], vreg(rd, a) + ", " + vreg(rn, a) + ", " + vreg(rm, a));
+                }
+
+                if (opcode == 0x10 && (size != 3 || q))
+                    return set(insn, u ? "sub" : "add", vreg(rd, arrangement(size, q)) + ops);
+
+                if (opcode == 0x13 && size != 3 && (!u || size == 0))
+                    return set(insn, u ? "pmul" : "mul", vreg(rd, arrangement(size, q)) + ops);
+
+                // Floating-point, sz is size<0>
+                const uint32_t sz = bit(size, 0);
+                if (sz && !q)
+                    return false;
+
+                const char* fa = sz ? "2d" : (q ? "4s" : "2s");
+                const std::string fops = vreg(rd, fa) + ", " + vreg(rn, fa) + ", " + vreg(rm, fa);
+
+                if (!u && opcode == 0x1a)
+                    return set(insn, bit(size, 1) ? "fsub" : "fadd", fops);
+                if (u && !bit(size, 1) && opcode == 0x1b)
+                    return set(insn, "fmul", fops);
+                if (u && !bit(size, 1) && opcode == 0x1f)
+                    return set(insn, "fdiv", fops);
+                return false;
+            }
+
+            // Advanced SIMD copy, DUP (general)
+            if (bits(w, 29, 21) == 0x070 && bits(w, 15, 10) == 0x03)
+            {
+                const uint32_t imm5 = bits(w, 20, 16);
+                uint32_t size = 0;
+
+                while (size < 4 && !bit(imm5, size))
+                    size++;
+                if (size > 3 || imm5 != (1u << size) || (size == 3 && !q))
+                    return false;
+                return set(insn, "dup", vreg(rd, arrangement(size, q)) + ", " + reg(rn, size == 3));
+            }
+
+            // Advanced SIMD modified immediate
+            if (bits(w, 28, 19) == 0x1e0 && bits(w, 11, 10) == 1)
+            {
+                const uint32_t cmode = bits(w, 15, 12);
+                const uint32_t imm8 = (bits(w, 18, 16) << 5) | bits(w, 9, 5);
+                const char* mnemonic = u ? "mvni" : "movi";
+
+                if ((cmode & 0x9) == 0)         // 32-bit shifted immediate
+                {
+                    const uint32_t amount = bits(cmode, 2, 1) * 8;
+                    return set(insn, mnemonic, vreg(rd, q ? "4s" : "2s") + ", " + imm(imm8) + (amount ? ", lsl " + dec(amount) : ""));
+                }
+                if ((cmode & 0xd) == 0x8)       // 16-bit shifted immediate
+                {
+                    const uint32_t amount = bit(cmode, 1) * 8;
+                    return set(insn, mnemonic, vreg(rd, q ? "8h" : "4h") + ", " + imm(imm8) + (amount ? ", lsl " + dec(amount) : ""));
+                }
+                if ((cmode & 0xe) == 0xc)       // 32-bit shifting ones
+                    return set(insn, mnemonic, vreg(rd, q ? "4s" : "2s") + ", " + imm(imm8) + ", msl " + dec(bit(cmode, 0) ? 16 : 8));
+
+                if (cmode == 0xe && !u)
+                    return set(insn, "movi", vreg(rd, q ? "16b" : "8b") + ", " + imm(imm8));
+
+                if (cmode == 0xe && u)          // 64-bit, each bit of imm8 expands to a byte
+                {
+                    uint64_t value = 0;
+                    for (int i = 0; i < 8; i++)
+                        if (bit(imm8, i))
+                            value |= 0xffull << (i * 8);
+
+                    char buf[32];
+                    snprintf(buf, sizeof(buf), "#%#016llx", static_cast<unsigned long long>(value));
+                    return set(insn, "movi", (q ? vreg(rd, "2d") : vreg(rd, 3)) + ", " + buf);
+                }
+
+                if (cmode == 0xf && !bit(w, 11))
+                {
+                    if (!u)
+                        return set(insn, "fmov", vreg(rd, q ? "4s" : "2s") + ", " + fp_imm(imm8));
+                    if (q)
+                        return set(insn, "fmov", vreg(rd, "2d") + ", " + fp_imm(imm8));
+                }
+                return false;
+            }
+
+            return false;
+        }
+    }
+
+    bool decode(uint32_t encoding, uint64_t address, instruction& insn)
+    {
+        bool decoded = false;
+
+        insn.address = address;
+        insn.encoding = encoding;
+        insn.mnemonic.clear();
+        insn.operands.clear();
+
+        const uint32_t op0 = bits(encoding, 28, 25);
+
+        if (bits(encoding, 31, 16) == 0)    // Permanently undefined
+        {
+            const uint32_t imm16 = bits(encoding, 15, 0);
+            decoded = set(insn, "udf", imm(imm16));
+        }
+        else if ((op0 & 0xe) == 0x8)
+            decoded = decode_dp_imm(encoding, address, insn);
+        else if ((op0 & 0xe) == 0xa)
+            decoded = decode_branch_sys(encoding, address, insn);
+        else if ((op0 & 0x5) == 0x4)
+            decoded = decode_ldst(encoding, address, insn);
+        else if ((op0 & 0x7) == 0x5)
+            decoded = decode_dp_reg(encoding, insn);
+        else if ((op0 & 0x7) == 0x7)
+            decoded = decode_fp(encoding, insn) || decode_simd(encoding, insn);
+
+        if (!decoded)
+        {
+            insn.mnemonic = "<unknown>";
+            insn.operands.clear();
+        }
+        return decoded;
+    }
+
+    std::string to_string(uint32_t encoding, uint64_t address)
+    {
+        instruction insn;
+        decode(encoding, address, insn);
+        return insn.operands.empty() ? insn.mnemonic : insn.mnemonic + " " + insn.operands;
+    }
+}
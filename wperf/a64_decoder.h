@@ -0,0 +1,59 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstdint>
+#include <string>
+
+/// <summary>
+/// Built-in AArch64 (A64) instruction decoder used by annotate mode
+/// (see `BuiltinDisassembler`). It decodes integer, load/store, branch,
+/// system, scalar floating-point and a subset of Advanced SIMD
+/// instructions. Output syntax follows LLVM's disassembler, branch and
+/// literal targets are printed as absolute addresses.
+/// </summary>
+namespace a64_decoder
+{
+    struct instruction
+    {
+        uint64_t address{};
+        uint32_t encoding{};
+        std::string mnemonic;   // e.g. "ldr"
+        std::string operands;   // e.g. "x0, [x1, #0x10]"
+    };
+
+    // Decode one instruction. Returns false for encodings we do not
+    // support, in which case mnemonic is set to "<unknown>".
+    bool decode(uint32_t encoding, uint64_t address, instruction& insn);
+
+    // Decode and return text form, e.g. "add x0, x1, #0x10"
+    std::string to_string(uint32_t encoding, uint64_t address);
+}
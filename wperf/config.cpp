@@ -29,6 +29,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
+#include <climits>
 #include "config.h"
 
 
@@ -41,11 +42,64 @@ namespace drvconfig {
         data.clear();
 
         // Read-write configuration values
-        data[std::wstring(L"count.period")] = { PMU_CTL_START_PERIOD, DRVCONFIG_RW, std::wstring(L"ms") };
+        data[std::wstring(L"count.period")] = { PMU_CTL_START_PERIOD, DRVCONFIG_RW, std::wstring(L"us") };
+        data[std::wstring(L"mux.weights")] = { std::wstring(L""), DRVCONFIG_RW, std::wstring(L"") };
 
-        // Read-only configuration values
-        data[std::wstring(L"count.period_max")] = { PMU_CTL_START_PERIOD, DRVCONFIG_RO, std::wstring(L"ms") };
-        data[std::wstring(L"count.period_min")] = { PMU_CTL_START_PERIOD_MIN, DRVCONFIG_RO, std::wstring(L"ms") };
+        // Read-only configuration values, driver may update them, see update()
+        data[std::wstring(L"count.period_max")] = { PMU_CTL_START_PERIOD, DRVCONFIG_RO, std::wstring(L"us") };
+        data[std::wstring(L"count.period_min")] = { PMU_CTL_START_PERIOD_MIN, DRVCONFIG_RO, std::wstring(L"us") };
+    }
+
+    // Time values are kept in microseconds. Plain number is in milliseconds, as it always
+    // was, `ms` and `us` suffixes are also accepted, e.g. `2ms` or `500us`.
+    static bool parse_long(const std::wstring& value, const std::wstring& unit, LONG& out)
+    {
+        size_t pos = 0;
+        LONG number = std::stol(value, &pos);
+        std::wstring suffix = value.substr(pos);
+
+        if (unit == L"us")
+        {
+            if (suffix == L"us")
+                out = number;
+            else if ((suffix.empty() || suffix == L"ms") && number <= LONG_MAX / 1000 && number >= LONG_MIN / 1000)
+                out = number * 1000;
+            else
+                return false;
+        }
+        else if (suffix.empty() || suffix == unit)
+            out = number;
+        else
+            return false;
+
+        return true;
+    }
+
+    // Comma separated list of multiplexing weights (1-255), e.g. `4,1,2`
+    bool parse_weights(const std::wstring& value, std::vector<UINT8>& weights)
+    {
+        weights.clear();
+
+        size_t start = 0;
+        while (start <= value.size())
+        {
+            size_t end = value.find(L',', start);
+            if (end == std::wstring::npos)
+                end = value.size();
+
+            std::wstring token = value.substr(start, end - start);
+            if (token.empty() || token.find_first_not_of(L"0123456789") != std::wstring::npos || token.size() > 3)
+                return false;
+
+            unsigned long weight = std::stoul(token);
+            if (weight == 0 || weight > UINT8_MAX)
+                return false;
+
+            weights.push_back(static_cast<UINT8>(weight));
+            start = end + 1;
+        }
+
+        return true;
     }
 
     bool set(std::wstring name, std::wstring value)
@@ -58,10 +112,20 @@ namespace drvconfig {
 
                 if (config.access == DRVCONFIG_RW)
                 {
+                    LONG number = 0;
                     if (std::holds_alternative<LONG>(config.value))
-                        config.value = std::stol(value);
+                    {
+                        if (!parse_long(value, config.unit, number))
+                            return false;
+                        config.value = number;
+                    }
                     else if (std::holds_alternative<std::wstring>(config.value))
+                    {
+                        std::vector<UINT8> weights;
+                        if (key == L"mux.weights" && !parse_weights(value, weights))
+                            return false;
                         config.value = value;
+                    }
                     else
                         return false;
                 }
@@ -72,6 +136,16 @@ namespace drvconfig {
         return false;
     }
 
+    // Update value also for read-only config, e.g. with value reported by the driver
+    bool update(std::wstring name, LONG value)
+    {
+        if (data.count(name) == 0 || !std::holds_alternative<LONG>(data[name].value))
+            return false;
+
+        data[name].value = value;
+        return true;
+    }
+
     // Set config from wide-string L"NAME=VALUE"
     bool set(std::wstring config_str)
     {
@@ -57,6 +57,8 @@ namespace drvconfig {
     void init();
     bool set(std::wstring config_str);
     bool set(std::wstring name, std::wstring value);
+    bool update(std::wstring name, LONG value);
+    bool parse_weights(const std::wstring& value, std::vector<UINT8>& weights);
     void get_configs(std::vector<std::wstring>& config_strs);
     template<typename T>
     bool get(std::wstring name, T& value)
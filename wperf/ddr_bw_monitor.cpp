@@ -0,0 +1,214 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "ddr_bw_monitor.h"
+
+LogHistogram::LogHistogram() : m_buckets(m_SUB_BUCKETS * m_OCTAVES + 1, 0)
+{
+}
+
+void LogHistogram::Add(double value)
+{
+    if (value < 0.0)
+        value = 0.0;
+
+    size_t idx = 0;
+    if (value >= m_MIN)
+    {
+        idx = static_cast<size_t>(std::log2(value / m_MIN) * m_SUB_BUCKETS) + 1;
+        idx = (std::min)(idx, m_buckets.size() - 1);
+    }
+
+    m_buckets[idx]++;
+    m_min = m_count ? (std::min)(m_min, value) : value;
+    m_max = m_count ? (std::max)(m_max, value) : value;
+    m_sum += value;
+    m_count++;
+}
+
+/// <summary>
+/// Return value below which P percent of added values fall. Result is the
+/// geometric middle of the bucket holding that value, clamped to the range
+/// of added values so P0 and P100 are exact.
+/// </summary>
+double LogHistogram::Percentile(double p) const
+{
+    if (m_count == 0)
+        return 0.0;
+
+    p = (std::max)(0.0, (std::min)(100.0, p));
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * m_count));
+    rank = (std::max)(rank, uint64_t(1));
+
+    if (rank == 1)
+        return m_min;
+    if (rank == m_count)
+        return m_max;
+
+    uint64_t seen = 0;
+    for (size_t idx = 0; idx < m_buckets.size(); idx++)
+    {
+        seen += m_buckets[idx];
+        if (seen < rank)
+            continue;
+
+        if (idx == 0)
+            return m_min;
+
+        double middle = m_MIN * std::exp2((idx - 0.5) / m_SUB_BUCKETS);
+        return (std::max)(m_min, (std::min)(m_max, middle));
+    }
+
+    return m_max;
+}
+
+DdrBandwidthMonitor::DdrBandwidthMonitor(const std::vector<uint32_t>& channels, double stale)
+    : m_channels(channels), m_stale(stale)
+{
+    Start(0.0, std::vector<uint64_t>(channels.size(), 0));
+}
+
+/// <summary>
+/// Start new monitoring window with counters read at TIME. Statistics of the
+/// previous window are dropped.
+/// </summary>
+void DdrBandwidthMonitor::Start(double time, const std::vector<uint64_t>& rdwr)
+{
+    m_prev = rdwr;
+    m_prev.resize(m_channels.size(), 0);
+    m_rdwr.assign(m_channels.size(), 0);
+    m_start_time = time;
+    m_prev_time = time;
+    m_last = Sample();
+    m_channel_hist.assign(m_channels.size(), LogHistogram());
+    m_total = LogHistogram();
+    m_imbalance = LogHistogram();
+}
+
+/// <summary>
+/// Feed `rdwr` totals of all channels read at TIME (seconds, same clock as
+/// passed to Start()). Returns true if a new sample was taken, see Last().
+/// </summary>
+bool DdrBandwidthMonitor::Update(double time, const std::vector<uint64_t>& rdwr)
+{
+    const double interval = time - m_prev_time;
+
+    if (interval <= 0.0 || rdwr.size() != m_channels.size())
+        return false;
+
+    bool changed = false;
+    for (size_t i = 0; i < rdwr.size(); i++)
+    {
+        if (rdwr[i] < m_prev[i])
+        {
+            // Counters were reset under us, count from here
+            m_prev = rdwr;
+            m_prev_time = time;
+            return false;
+        }
+
+        changed |= rdwr[i] != m_prev[i];
+    }
+
+    if (!changed && interval < m_stale)
+        return false;
+
+    Sample sample;
+    sample.time = time;
+    sample.interval = interval;
+
+    double busiest = 0.0;
+    for (size_t i = 0; i < rdwr.size(); i++)
+    {
+        const uint64_t delta = rdwr[i] - m_prev[i];
+        const double bw = Bandwidth(delta, interval);
+
+        sample.channel.push_back(bw);
+        sample.total += bw;
+        busiest = (std::max)(busiest, bw);
+
+        m_rdwr[i] += delta;
+        m_channel_hist[i].Add(bw);
+    }
+
+    if (sample.total > 0.0)
+    {
+        sample.imbalance = busiest / (sample.total / rdwr.size());
+        m_imbalance.Add(sample.imbalance);
+    }
+
+    m_total.Add(sample.total);
+
+    m_prev = rdwr;
+    m_prev_time = time;
+    m_last = sample;
+    return true;
+}
+
+double DdrBandwidthMonitor::Share(size_t idx) const
+{
+    uint64_t all = 0;
+    for (uint64_t v : m_rdwr)
+        all += v;
+
+    return all ? 100.0 * m_rdwr[idx] / all : 0.0;
+}
+
+double DdrBandwidthMonitor::Bandwidth(uint64_t rdwr, double interval)
+{
+    return interval > 0.0 ? rdwr * m_BYTES_PER_RDWR / 1000.0 / 1000.0 / interval : 0.0;
+}
+
+void DdrBandwidthMonitor::WriteCsvHeader(std::wostream& os) const
+{
+    os << L"time (s),";
+    for (uint32_t ch : m_channels)
+        os << L"dmc " << ch << L" (MB/s),";
+    os << L"all (MB/s),imbalance" << std::endl;
+}
+
+void DdrBandwidthMonitor::WriteCsvRow(std::wostream& os) const
+{
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    os << std::fixed << std::setprecision(6) << m_last.time << L",";
+    os << std::setprecision(2);
+    for (double bw : m_last.channel)
+        os << bw << L",";
+    os << m_last.total << L"," << std::setprecision(3) << m_last.imbalance << std::endl;
+
+    os.flags(flags);
+    os.precision(precision);
+}
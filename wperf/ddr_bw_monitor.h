@@ -0,0 +1,123 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/// <summary>
+/// Histogram with logarithmic buckets (m_SUB_BUCKETS per power of two) used
+/// to get percentiles of a long run without keeping every sample. Relative
+/// error of a percentile is below 2.2%, memory does not depend on the number
+/// of samples. Values below m_MIN (including zero) share the first bucket.
+/// </summary>
+class LogHistogram
+{
+public:
+    LogHistogram();
+
+    void Add(double value);
+    double Percentile(double p) const;  // p in [0, 100]
+    uint64_t Count() const { return m_count; }
+    double Mean() const { return m_count ? m_sum / m_count : 0.0; }
+    double Max() const { return m_max; }
+
+    static constexpr double m_MIN = 0.01;
+    static constexpr uint32_t m_SUB_BUCKETS = 16;
+    static constexpr uint32_t m_OCTAVES = 28;
+
+private:
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count = 0;
+    double m_sum = 0.0;
+    double m_min = 0.0;
+    double m_max = 0.0;
+};
+
+/// <summary>
+/// Continuous DDR bandwidth monitor (`wperf stat --ddr-monitor`). Caller
+/// periodically reads `rdwr` totals of DMC channels and feeds them with the
+/// time of the read to Update(). Each update which advanced counters becomes
+/// a sample: bandwidth of every channel and all channels together in MB/s and
+/// channel imbalance, i.e. busiest channel bandwidth divided by the mean
+/// channel bandwidth (1.0 means traffic is evenly spread). Samples are kept
+/// only in histograms so the monitor can run for hours at a high rate.
+///
+/// Driver publishes DMC counters from its counting timer, reads done more
+/// often than that return the same totals. Such reads are merged into the
+/// next sample, unless nothing changed for `stale` seconds (idle memory).
+/// </summary>
+class DdrBandwidthMonitor
+{
+public:
+    struct Sample
+    {
+        double time = 0.0;              // Time of the read which closed this sample
+        double interval = 0.0;          // Seconds covered by this sample
+        std::vector<double> channel;    // MB/s of each channel
+        double total = 0.0;             // MB/s of all channels
+        double imbalance = 0.0;         // Busiest channel / mean channel bandwidth, 0 if idle
+    };
+
+    DdrBandwidthMonitor(const std::vector<uint32_t>& channels, double stale = 0.0);
+
+    void Start(double time, const std::vector<uint64_t>& rdwr);
+    bool Update(double time, const std::vector<uint64_t>& rdwr);
+
+    const Sample& Last() const { return m_last; }
+    const std::vector<uint32_t>& Channels() const { return m_channels; }
+    uint64_t Samples() const { return m_total.Count(); }
+    double Duration() const { return m_prev_time - m_start_time; }
+
+    const LogHistogram& Channel(size_t idx) const { return m_channel_hist[idx]; }
+    const LogHistogram& Total() const { return m_total; }
+    const LogHistogram& Imbalance() const { return m_imbalance; }
+    double Share(size_t idx) const;     // Percent of bytes moved by channel
+
+    void WriteCsvHeader(std::wostream& os) const;
+    void WriteCsvRow(std::wostream& os) const;
+
+    static double Bandwidth(uint64_t rdwr, double interval);
+
+    static constexpr double m_BYTES_PER_RDWR = 128.0;   // Same scale as `ddr_bw` metric
+
+private:
+    std::vector<uint32_t> m_channels;   // DMC channel indexes
+    std::vector<uint64_t> m_prev;       // `rdwr` totals at previous sample
+    std::vector<uint64_t> m_rdwr;       // `rdwr` count per channel since Start()
+    double m_stale;
+    double m_start_time = 0.0;
+    double m_prev_time = 0.0;
+    Sample m_last;
+    std::vector<LogHistogram> m_channel_hist;
+    LogHistogram m_total;
+    LogHistogram m_imbalance;
+};
@@ -28,6 +28,9 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include "disassembler.h"
 
 DWORD WINAPI ReadStdOut(LPVOID lpParam)
@@ -36,7 +39,7 @@ DWORD WINAPI ReadStdOut(LPVOID lpParam)
 
     DWORD dwRead;
     CHAR chBuf[BUFSIZE]{ 0 };
-    Disassembler* disassembler = (Disassembler*)lpParam;
+    ProcessDisassembler* disassembler = (ProcessDisassembler*)lpParam;
 
     for (;;)
     {
@@ -62,7 +65,7 @@ DWORD WINAPI ReadStdOut(LPVOID lpParam)
     return 0;
 }
 
-VOID Disassembler::Spawn(const std::wstring& command)
+VOID ProcessDisassembler::Spawn(const std::wstring& command)
 {
     SECURITY_ATTRIBUTES saAttr{ 0 };
 
@@ -111,14 +114,16 @@ VOID Disassembler::Spawn(const std::wstring& command)
     }
 }
 
-VOID Disassembler::Disassemble(const std::wstring& target)
+VOID ProcessDisassembler::Run(const std::wstring& command)
 {
     DWORD threadId;
-    std::wstringstream commandline;
 
-    commandline << m_command << TEXT(" ") << m_commandLine << TEXT(" ") << target;
+    Spawn(command);
 
-    Spawn(commandline.str());
+    // Child process has its own copy of this handle. Close ours so reader
+    // thread gets ERROR_BROKEN_PIPE when child exits and we can wait for it.
+    CloseHandle(m_hChildStd_OUT_Wr);
+    m_hChildStd_OUT_Wr = NULL;
 
     m_processOutput.clear();
     m_thread = CreateThread(NULL, 0, ReadStdOut, (LPVOID)this, 0, &threadId);
@@ -128,26 +133,274 @@ VOID Disassembler::Disassemble(const std::wstring& target)
     }
 
     WaitForSingleObject(m_piProcInfo.hProcess, INFINITE);
+    WaitForSingleObject(m_thread, INFINITE);
+
+    CloseHandle(m_thread);
+    m_thread = NULL;
+    CloseHandle(m_piProcInfo.hProcess);
+    CloseHandle(m_piProcInfo.hThread);
+    m_piProcInfo = { 0 };
+    CloseHandle(m_hChildStd_OUT_Rd);
+    CloseHandle(m_hChildStd_IN_Wr);
+    CloseHandle(m_hChildStd_IN_Rd);
+    m_hChildStd_OUT_Rd = m_hChildStd_IN_Wr = m_hChildStd_IN_Rd = NULL;
 }
 
-VOID Disassembler::Disassemble(uint64_t from, uint64_t to, const std::wstring& target)
+VOID ProcessDisassembler::Disassemble(const std::wstring& target)
+{
+    std::wstringstream commandline;
+
+    commandline << m_command << TEXT(" ") << m_commandLine << TEXT(" ") << target;
+
+    Run(commandline.str());
+}
+
+VOID ProcessDisassembler::Disassemble(uint64_t from, uint64_t to, const std::wstring& target)
 {
-    DWORD threadId;
     std::wstringstream commandline;
 
     commandline << m_command << L" " << m_commandLine << L" " <<
         m_commandLineFrom << L"0x" << std::hex << from << L" " << m_commandLineTo << L"0x" << to << L" " << target;
 
-    //std::wcout << commandline.str() << std::endl;
+    Run(commandline.str());
+}
 
-    Spawn(commandline.str());
+/// <summary>
+/// Returns true if range [FROM, TO) of TARGET was already disassembled.
+/// </summary>
+bool DisassemblyCache::Has(const std::wstring& target, DWORD_PTR from, DWORD_PTR to) const
+{
+    auto t = m_targets.find(target);
+    if (t == m_targets.end())
+        return false;
 
-    m_processOutput.clear();
-    m_thread = CreateThread(NULL, 0, ReadStdOut, (LPVOID)this, 0, &threadId);
-    if (m_thread == NULL)
+    const auto& ranges = t->second.m_ranges;
+    auto it = ranges.upper_bound(from);     // First range starting after FROM
+    if (it == ranges.begin())
+        return false;
+    --it;
+    return it->first <= from && to <= it->second;
+}
+
+/// <summary>
+/// Store disassembled range [FROM, TO) of TARGET.
+/// </summary>
+void DisassemblyCache::Insert(const std::wstring& target, DWORD_PTR from, DWORD_PTR to, const std::vector<DisassembledInstruction>& source)
+{
+    TargetCache& tc = m_targets[target];
+
+    if (tc.m_ranges.count(from) == 0 || tc.m_ranges[from] < to)
+        tc.m_ranges[from] = to;
+
+    for (const auto& inst : source)
+        tc.m_source[inst.m_address] = inst;
+
+    tc.m_modified = true;
+}
+
+/// <summary>
+/// Returns all cached instructions from range [FROM, TO) of TARGET.
+/// </summary>
+std::vector<DisassembledInstruction> DisassemblyCache::Get(const std::wstring& target, DWORD_PTR from, DWORD_PTR to) const
+{
+    std::vector<DisassembledInstruction> result;
+
+    auto t = m_targets.find(target);
+    if (t == m_targets.end())
+        return result;
+
+    const auto& source = t->second.m_source;
+    for (auto it = source.lower_bound(from); it != source.end() && it->first < to; ++it)
+        result.push_back(it->second);
+
+    return result;
+}
+
+bool DisassemblyCache::IsModified(const std::wstring& target) const
+{
+    auto t = m_targets.find(target);
+    return t != m_targets.end() && t->second.m_modified;
+}
+
+std::vector<std::wstring> DisassemblyCache::GetTargets() const
+{
+    std::vector<std::wstring> result;
+    for (const auto& [target, _] : m_targets)
+        result.push_back(target);
+    return result;
+}
+
+/// <summary>
+/// Write cache of TARGET to OS. Cache file format (text, one record per line):
+///
+///     wperf-dasm-cache 1
+///     R <from> <to>
+///     I <address> <instruction> <disassembly>
+///
+/// All numbers are hexadecimal.
+/// </summary>
+void DisassemblyCache::Save(std::ostream& os, const std::wstring& target) const
+{
+    os << m_FILE_MAGIC << "\n";
+
+    auto t = m_targets.find(target);
+    if (t == m_targets.end())
+        return;
+
+    os << std::hex;
+    for (const auto& [from, to] : t->second.m_ranges)
+        os << "R " << from << " " << to << "\n";
+
+    for (const auto& [address, inst] : t->second.m_source)
+        os << "I " << address << " " << inst.m_instruction << " " << MultiByteFromWideString(inst.m_asm.c_str()) << "\n";
+    os << std::dec;
+}
+
+/// <summary>
+/// Read cache of TARGET from IS. Returns false if IS content is not a valid cache.
+/// </summary>
+bool DisassemblyCache::Load(std::istream& is, const std::wstring& target)
+{
+    std::string line;
+    if (!std::getline(is, line) || line != m_FILE_MAGIC)
+        return false;
+
+    TargetCache tc;
+    while (std::getline(is, line))
     {
-        throw std::exception("Error creating thread");
+        std::istringstream ss(line);
+        std::string type;
+        DWORD_PTR a = 0, b = 0;
+
+        ss >> type >> std::hex >> a >> b;
+        if (ss.fail())
+            return false;
+
+        if (type == "R")
+        {
+            tc.m_ranges[a] = b;
+        }
+        else if (type == "I")
+        {
+            std::string dasm;
+            ss.get();   // Skip one separator, disassembly may start with white space
+            std::getline(ss, dasm);
+            tc.m_source[a] = DisassembledInstruction{ a, b, WideStringFromMultiByte(dasm.c_str()) };
+        }
+        else
+            return false;
     }
 
-    WaitForSingleObject(m_piProcInfo.hProcess, INFINITE);
+    m_targets[target] = tc;
+    return true;
+}
+
+bool DisassemblyCache::Save(const std::wstring& filename, const std::wstring& target) const
+{
+    std::ofstream file(std::filesystem::path(filename), std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    Save(file, target);
+    return !file.fail();
+}
+
+bool DisassemblyCache::Load(const std::wstring& filename, const std::wstring& target)
+{
+    std::ifstream file(std::filesystem::path(filename), std::ios::in);
+    if (!file.is_open())
+        return false;
+
+    return Load(file, target);
+}
+
+/// <summary>
+/// Generate cache file name for TARGET disassembled with BACKEND in directory
+/// DIR. File name contains BACKEND, as backends format instructions differently,
+/// and hash of TARGET build identity (PDB signature, link time stamp and image
+/// size from PE headers) so we never use cache of a different build, e.g.:
+///
+///     c:\cache\python312_d.dll.builtin.6ed0a9c5d4c2b3a1.dasm
+/// </summary>
+std::wstring DisassemblyCache::GenFilename(const std::wstring& dir, const std::wstring& target, const std::wstring& backend)
+{
+    const PeFileMetaData& metadata = get_pe_file_metadata(target);
+
+    uint64_t key = Fnv1aHash(metadata.pdb_signature.data(), metadata.pdb_signature.size() * sizeof(wchar_t));
+    key = Fnv1aHash(&metadata.time_date_stamp, sizeof(metadata.time_date_stamp), key);
+    key = Fnv1aHash(&metadata.size_of_image, sizeof(metadata.size_of_image), key);
+
+    std::wstring name = std::filesystem::path(target).filename();
+    return GetFullFilePath(dir, name + L"." + backend + L"." + IntToHexWideStringNoPrefix(key, 16) + L".dasm");
+}
+
+const BuiltinDisassembler::Image& BuiltinDisassembler::GetImage(const std::wstring& target)
+{
+    auto it = m_images.find(target);
+    if (it != m_images.end())
+        return it->second;
+
+    const PeFileMetaData& metadata = get_pe_file_metadata(target);
+    Image& image = m_images[target];
+    image.m_image_base = metadata.image_base;
+    image.m_sections = metadata.sec_info;
+    return image;
+}
+
+/// <summary>
+/// Decode instructions in range [FROM, TO) of virtual addresses of TARGET.
+/// Range is read from the section of the PE file which contains FROM.
+/// </summary>
+VOID BuiltinDisassembler::Disassemble(uint64_t from, uint64_t to, const std::wstring& target)
+{
+    m_output.clear();
+
+    const Image& image = GetImage(target);
+    if (from < image.m_image_base || to <= from)
+        return;
+
+    const uint64_t rva = from - image.m_image_base;
+    for (const auto& sec : image.m_sections)
+    {
+        if (rva < sec.offset || rva >= sec.offset + sec.raw_size)
+            continue;
+
+        const uint64_t size = std::min<uint64_t>(to - from, sec.offset + sec.raw_size - rva);
+        std::vector<uint8_t> code(static_cast<size_t>(size));
+        std::ifstream is(std::filesystem::path(target), std::ios::binary);
+
+        is.seekg(sec.raw_offset + (rva - sec.offset));
+        is.read(reinterpret_cast<char*>(code.data()), code.size());
+        code.resize(static_cast<size_t>(is.gcount()));
+
+        Decode(code.data(), code.size(), from, m_output);
+        break;
+    }
+}
+
+VOID BuiltinDisassembler::ParseOutput(std::vector<DisassembledInstruction>& source)
+{
+    source.insert(source.end(), m_output.begin(), m_output.end());
+}
+
+/// <summary>
+/// Decode SIZE bytes of CODE located at virtual ADDRESS. Output has the same
+/// format as output of `LLVMDisassembler::ParseOutput()`.
+/// </summary>
+VOID BuiltinDisassembler::Decode(const uint8_t* code, size_t size, uint64_t address, std::vector<DisassembledInstruction>& source)
+{
+    for (size_t i = 0; i + 4 <= size; i += 4)
+    {
+        const uint32_t encoding = code[i] | (code[i + 1] << 8) | (code[i + 2] << 16) | (static_cast<uint32_t>(code[i + 3]) << 24);
+        a64_decoder::instruction insn;
+        std::wstringstream dasmstream;
+
+        a64_decoder::decode(encoding, address + i, insn);
+        if (insn.operands.size())
+            dasmstream << std::setw(5) << std::left << WideStringFromMultiByte(insn.mnemonic.c_str()) << " " << WideStringFromMultiByte(insn.operands.c_str());
+        else
+            dasmstream << std::left << WideStringFromMultiByte(insn.mnemonic.c_str());
+
+        source.push_back(DisassembledInstruction{ (address + i) & 0xFFFFFF, encoding, dasmstream.str() });
+    }
 }
@@ -30,9 +30,12 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <windows.h>
 #include <exception>
+#include <map>
 #include <sstream>
 #include <vector>
+#include "a64_decoder.h"
 #include "output.h"
+#include "pe_file.h"
 #include "utils.h"
 
 DWORD WINAPI ReadStdOut(LPVOID lpParam);
@@ -62,7 +65,60 @@ public:
     }
 };
 
+/// <summary>
+/// Address indexed cache of disassembled instructions, per target (PE file).
+/// We disassemble whole address ranges (e.g. functions) once and serve all
+/// smaller (e.g. source line) range queries from the cache.
+/// Cache can be stored on disk and reloaded, see `save()` and `load()`.
+/// </summary>
+class DisassemblyCache
+{
+    struct TargetCache
+    {
+        std::map<DWORD_PTR, DWORD_PTR> m_ranges;                // [from] -> to, disassembled ranges
+        std::map<DWORD_PTR, DisassembledInstruction> m_source;  // [address] -> instruction
+        bool m_modified = false;
+    };
+
+    std::map<std::wstring, TargetCache> m_targets;
+
+public:
+    bool Has(const std::wstring& target, DWORD_PTR from, DWORD_PTR to) const;
+    void Insert(const std::wstring& target, DWORD_PTR from, DWORD_PTR to, const std::vector<DisassembledInstruction>& source);
+    std::vector<DisassembledInstruction> Get(const std::wstring& target, DWORD_PTR from, DWORD_PTR to) const;
+    bool IsModified(const std::wstring& target) const;
+    std::vector<std::wstring> GetTargets() const;
+
+    void Save(std::ostream& os, const std::wstring& target) const;
+    bool Load(std::istream& is, const std::wstring& target);
+    bool Save(const std::wstring& filename, const std::wstring& target) const;
+    bool Load(const std::wstring& filename, const std::wstring& target);
+
+    static std::wstring GenFilename(const std::wstring& dir, const std::wstring& target, const std::wstring& backend);
+
+    static constexpr const char* m_FILE_MAGIC = "wperf-dasm-cache 1";
+};
+
+/// <summary>
+/// Disassembler backend interface. Call `Disassemble()` for a range of
+/// virtual addresses of TARGET, then collect instructions with `ParseOutput()`.
+/// </summary>
 class Disassembler
+{
+public:
+    virtual ~Disassembler() {}
+
+    virtual VOID Close() {}
+    virtual VOID Disassemble(uint64_t from, uint64_t to, const std::wstring& target) = 0;
+    virtual VOID ParseOutput(std::vector<DisassembledInstruction>& source) = 0;
+    virtual BOOL CheckCommand() = 0;
+    virtual std::wstring GetCommand() = 0;
+};
+
+/// <summary>
+/// Disassembler which spawns external tool and captures its standard output.
+/// </summary>
+class ProcessDisassembler : public Disassembler
 {
     std::wstring m_command;
     std::wstring m_commandLine;
@@ -103,13 +159,14 @@ class Disassembler
     }
 
     VOID Spawn(const std::wstring& command);
+    VOID Run(const std::wstring& command);
 public:
-    Disassembler(const std::wstring& cmd,
+    ProcessDisassembler(const std::wstring& cmd,
         const std::wstring& cmdline,
         const std::wstring& cmdFrom,
         const std::wstring& cmdTo) : m_command(cmd), m_commandLine(cmdline), m_commandLineFrom(cmdFrom), m_commandLineTo(cmdTo) {}
 
-    VOID Close()
+    VOID Close() override
     {
         CloseHandle(m_piProcInfo.hProcess);
         CloseHandle(m_piProcInfo.hThread);
@@ -123,9 +180,9 @@ public:
     }
 
     VOID Disassemble(const std::wstring& target);
-    VOID Disassemble(uint64_t from, uint64_t to, const std::wstring& target);
+    VOID Disassemble(uint64_t from, uint64_t to, const std::wstring& target) override;
 
-    BOOL CheckCommand()
+    BOOL CheckCommand() override
     {
         try {
             Spawn(m_command);
@@ -141,7 +198,7 @@ public:
         return true;
     }
 
-    std::wstring GetCommand()
+    std::wstring GetCommand() override
     {
         return m_command;
     }
@@ -151,12 +208,12 @@ public:
     HANDLE m_hChildStd_OUT_Rd = NULL;
 };
 
-class LLVMDisassembler : public Disassembler
+class LLVMDisassembler : public ProcessDisassembler
 {
 public:
-    LLVMDisassembler() : Disassembler(L"llvm-objdump", L"--disassemble --disassemble-zeroes", L"--start-address=", L"--stop-address=") {}
+    LLVMDisassembler() : ProcessDisassembler(L"llvm-objdump", L"--disassemble --disassemble-zeroes", L"--start-address=", L"--stop-address=") {}
 
-    VOID ParseOutput(std::vector<DisassembledInstruction>& source)
+    VOID ParseOutput(std::vector<DisassembledInstruction>& source) override
     {
         std::vector<std::wstring> lines;
 
@@ -205,3 +262,37 @@ public:
         }
     }
 };
+
+/// <summary>
+/// In-process AArch64 disassembler. Reads code directly from PE file sections
+/// and decodes it with `a64_decoder`, no external tools are needed.
+/// </summary>
+class BuiltinDisassembler : public Disassembler
+{
+    struct Image
+    {
+        uint64_t m_image_base{};
+        std::vector<SectionDesc> m_sections;
+    };
+
+    std::map<std::wstring, Image> m_images;                 // [target] -> parsed PE file
+    std::vector<DisassembledInstruction> m_output;
+
+    const Image& GetImage(const std::wstring& target);
+
+public:
+    VOID Disassemble(uint64_t from, uint64_t to, const std::wstring& target) override;
+    VOID ParseOutput(std::vector<DisassembledInstruction>& source) override;
+
+    BOOL CheckCommand() override
+    {
+        return true;
+    }
+
+    std::wstring GetCommand() override
+    {
+        return L"builtin";
+    }
+
+    static VOID Decode(const uint8_t* code, size_t size, uint64_t address, std::vector<DisassembledInstruction>& source);
+};
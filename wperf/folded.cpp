@@ -0,0 +1,115 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "folded.h"
+#include "exception.h"
+#include "utils.h"
+
+/// <summary>
+/// Add one stack to sample source EVENT_SRC. FRAMES are ordered from the
+/// outermost caller to the sampled function (leaf). Stacks are folded
+/// into one `frame;frame;frame` key so memory grows only with number of
+/// unique stacks, not with number of samples.
+/// </summary>
+void FoldedStacks::add(uint32_t event_src, const std::vector<std::wstring>& frames, uint64_t count)
+{
+    if (frames.empty())
+        return;
+
+    std::wstring key;
+    for (const auto& frame : frames)
+    {
+        if (key.size())
+            key += L';';
+        key += sanitize_frame(frame);
+    }
+
+    m_stacks[event_src][key] += count;
+}
+
+void FoldedStacks::write(std::ostream& os, uint32_t event_src) const
+{
+    if (m_stacks.count(event_src) == 0)
+        return;
+
+    for (const auto& [stack, count] : m_stacks.at(event_src))
+        os << MultiByteFromWideString(stack.c_str()) << " " << count << "\n";
+}
+
+void FoldedStacks::write(const std::wstring& filename, uint32_t event_src) const
+{
+    std::ofstream outfile(std::filesystem::path(filename), std::ios::out | std::ios::trunc);
+    if (!outfile.is_open())
+        throw fatal_exception("Can't open folded stacks output file");
+
+    write(outfile, event_src);
+    outfile.close();
+}
+
+std::vector<uint32_t> FoldedStacks::get_event_sources() const
+{
+    std::vector<uint32_t> result;
+    for (const auto& [event_src, _] : m_stacks)
+        result.push_back(event_src);
+    return result;
+}
+
+size_t FoldedStacks::size(uint32_t event_src) const
+{
+    if (m_stacks.count(event_src) == 0)
+        return 0;
+    return m_stacks.at(event_src).size();
+}
+
+/// <summary>
+/// Folded format uses ';' to separate frames and last ' ' to separate
+/// the count. Frame names must not contain ';' or new lines.
+/// </summary>
+std::wstring FoldedStacks::sanitize_frame(const std::wstring& frame)
+{
+    std::wstring result = frame;
+    std::replace(result.begin(), result.end(), L';', L':');
+    std::replace(result.begin(), result.end(), L'\n', L' ');
+    std::replace(result.begin(), result.end(), L'\r', L' ');
+    return result.size() ? result : std::wstring(L"unknown");
+}
+
+/// <summary>
+/// Generate output file name for given sample source, e.g.:
+///     prefix=`python`, event_name=`ld_spec` -> `python.ld_spec.folded`
+/// </summary>
+std::wstring FoldedStacks::gen_filename(const std::wstring& prefix, const std::wstring& event_name)
+{
+    return prefix + L"." + event_name + L".folded";
+}
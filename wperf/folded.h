@@ -0,0 +1,59 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <windows.h>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Collects sampled call stacks in "folded" form (as consumed by flame graph
+/// tools), e.g. `caller;callee 42`. Each unique stack is stored only once,
+/// together with its hit count, per sample source (event index).
+/// </summary>
+class FoldedStacks
+{
+public:
+    void add(uint32_t event_src, const std::vector<std::wstring>& frames, uint64_t count = 1);
+    void write(std::ostream& os, uint32_t event_src) const;
+    void write(const std::wstring& filename, uint32_t event_src) const;
+
+    std::vector<uint32_t> get_event_sources() const;
+    size_t size(uint32_t event_src) const;
+
+    static std::wstring sanitize_frame(const std::wstring& frame);
+    static std::wstring gen_filename(const std::wstring& prefix, const std::wstring& event_name);
+
+private:
+    std::map<uint32_t, std::map<std::wstring, uint64_t>> m_stacks;  // [event_src][folded stack] -> count
+};
@@ -0,0 +1,162 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "heatmap.h"
+
+CoreHeatmap::CoreHeatmap(const std::vector<uint32_t>& cores, const std::vector<std::wstring>& metrics)
+    : m_cores(cores), m_metrics(metrics), m_columns(cores.size() * metrics.size())
+{
+}
+
+/// <summary>
+/// Add one interval ending at TIME (seconds). VALUES hold a vector of values
+/// of all cores (in Cores() order) for every metric (in Metrics() order).
+/// Missing values are stored as 0.
+/// </summary>
+void CoreHeatmap::AddInterval(double time, const std::vector<std::vector<double>>& values)
+{
+    m_times.push_back(time);
+
+    for (size_t m = 0; m < m_metrics.size(); m++)
+        for (size_t c = 0; c < m_cores.size(); c++)
+        {
+            double value = m < values.size() && c < values[m].size() ? values[m][c] : 0.0;
+            m_columns[m * m_cores.size() + c].push_back(static_cast<float>(value));
+        }
+}
+
+double CoreHeatmap::Value(size_t metric, size_t interval, size_t core) const
+{
+    return Column(metric, core)[interval];
+}
+
+double CoreHeatmap::CoreMean(size_t metric, size_t core) const
+{
+    const std::vector<float>& column = Column(metric, core);
+    if (column.empty())
+        return 0.0;
+
+    double sum = 0.0;
+    for (float v : column)
+        sum += v;
+
+    return sum / column.size();
+}
+
+CoreHeatmap::Summary CoreHeatmap::IntervalSummary(size_t metric, size_t interval) const
+{
+    std::vector<double> values;
+    for (size_t c = 0; c < m_cores.size(); c++)
+        values.push_back(Value(metric, interval, c));
+
+    return Summarize(values);
+}
+
+CoreHeatmap::Summary CoreHeatmap::CoreSummary(size_t metric) const
+{
+    std::vector<double> values;
+    for (size_t c = 0; c < m_cores.size(); c++)
+        values.push_back(CoreMean(metric, c));
+
+    return Summarize(values);
+}
+
+CoreHeatmap::Summary CoreHeatmap::Summarize(std::vector<double> values)
+{
+    Summary s;
+
+    if (values.empty())
+        return s;
+
+    std::sort(values.begin(), values.end());
+
+    // Nearest rank percentile
+    auto percentile = [&values](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+        return values[(std::max)(rank, size_t(1)) - 1];
+    };
+
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+
+    s.min = values.front();
+    s.median = percentile(50.0);
+    s.p99 = percentile(99.0);
+    s.max = values.back();
+    s.mean = sum / values.size();
+    return s;
+}
+
+/// <summary>
+/// Write heatmap as CSV, one block per metric. Rows are intervals and columns
+/// are cores, followed by min / median / p99 across cores in that interval:
+///
+///     metric,ipc
+///     time (s),core 0,core 1,...,min,median,p99
+///     0.100,1.234,0.870,...
+/// </summary>
+void CoreHeatmap::WriteCsv(std::wostream& os) const
+{
+    const std::ios_base::fmtflags flags = os.flags();
+    const std::streamsize precision = os.precision();
+
+    os << std::fixed;
+
+    for (size_t m = 0; m < m_metrics.size(); m++)
+    {
+        if (m)
+            os << std::endl;
+
+        os << L"metric," << m_metrics[m] << std::endl;
+
+        os << L"time (s),";
+        for (uint32_t core : m_cores)
+            os << L"core " << core << L",";
+        os << L"min,median,p99" << std::endl;
+
+        for (size_t i = 0; i < m_times.size(); i++)
+        {
+            os << std::setprecision(3) << m_times[i] << L",";
+            for (size_t c = 0; c < m_cores.size(); c++)
+                os << Value(m, i, c) << L",";
+
+            Summary s = IntervalSummary(m, i);
+            os << s.min << L"," << s.median << L"," << s.p99 << std::endl;
+        }
+    }
+
+    os.flags(flags);
+    os.precision(precision);
+}
@@ -0,0 +1,84 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Per core x per interval matrix of metrics for `wperf stat --heatmap`.
+/// Every interval caller adds values of all metrics for all cores at once
+/// (see AddInterval()). Values are kept in columns, one per (metric, core)
+/// pair, as floats so long runs on many cores stay compact.
+///
+/// Summaries are min / median / p99 / max / mean (nearest rank percentiles)
+/// of a set of values, e.g. across cores in one interval, or across cores of
+/// their means over the whole run.
+/// </summary>
+class CoreHeatmap
+{
+public:
+    struct Summary
+    {
+        double min = 0.0;
+        double median = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+    };
+
+    CoreHeatmap(const std::vector<uint32_t>& cores, const std::vector<std::wstring>& metrics);
+
+    void AddInterval(double time, const std::vector<std::vector<double>>& values);     // values[metric][core]
+
+    size_t Intervals() const { return m_times.size(); }
+    const std::vector<uint32_t>& Cores() const { return m_cores; }
+    const std::vector<std::wstring>& Metrics() const { return m_metrics; }
+    double Time(size_t interval) const { return m_times[interval]; }
+    double Value(size_t metric, size_t interval, size_t core) const;
+
+    Summary IntervalSummary(size_t metric, size_t interval) const;  // Across cores in one interval
+    Summary CoreSummary(size_t metric) const;                       // Across cores of their mean over all intervals
+    double CoreMean(size_t metric, size_t core) const;
+
+    void WriteCsv(std::wostream& os) const;
+
+    static Summary Summarize(std::vector<double> values);
+
+private:
+    const std::vector<float>& Column(size_t metric, size_t core) const { return m_columns[metric * m_cores.size() + core]; }
+
+    std::vector<uint32_t> m_cores;
+    std::vector<std::wstring> m_metrics;
+    std::vector<double> m_times;                // Time of every interval end, in seconds
+    std::vector<std::vector<float>> m_columns;  // [metric * cores + core] -> value per interval
+};
@@ -38,6 +38,53 @@
 #include "outpututil.h"
 #include "utils.h"
 
+/*
+JSONEscape writes STR as contents of a JSON string (without enclosing quotes) escaping it in one pass. Runs of
+characters which do not need escaping are written directly to OS, so no temporary copy of STR is created.
+Quotes, backslashes and control characters are escaped as required by RFC 8259.
+*/
+template <typename CharType>
+void JSONEscape(std::basic_ostream<CharType>& os, const std::basic_string<CharType>& str)
+{
+    typedef std::make_unsigned_t<CharType> UnsignedCharType;
+    static const char hex[] = "0123456789abcdef";
+
+    const CharType* data = str.data();
+    size_t run = 0;     // Beginning of the current run of characters not requiring escaping
+
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        const CharType* escaped = nullptr;
+        switch (data[i])
+        {
+        case '"':  escaped = LITERALCONSTANTS_GET("\\\""); break;
+        case '\\': escaped = LITERALCONSTANTS_GET("\\\\"); break;
+        case '\n': escaped = LiteralConstants<CharType>::m_newline_escaped; break;
+        case '\t': escaped = LiteralConstants<CharType>::m_tab_escaped; break;
+        case '\r': escaped = LITERALCONSTANTS_GET("\\r"); break;
+        case '\b': escaped = LITERALCONSTANTS_GET("\\b"); break;
+        case '\f': escaped = LITERALCONSTANTS_GET("\\f"); break;
+        default:
+            if (static_cast<UnsignedCharType>(data[i]) >= 0x20)
+                continue;
+        }
+
+        os.write(data + run, i - run);
+        if (escaped)
+        {
+            os << escaped;
+        }
+        else {  // Other control characters as \u00XX
+            const unsigned c = static_cast<UnsignedCharType>(data[i]);
+            os << LITERALCONSTANTS_GET("\\u00");
+            os.put(static_cast<CharType>(hex[c >> 4]));
+            os.put(static_cast<CharType>(hex[c & 0xF]));
+        }
+        run = i + 1;
+    }
+    os.write(data + run, str.size() - run);
+}
+
 /* 
 The JSON implementation bases itself on the JSON definition from JavaScript where it is defined as a dictionary with keys and values.
 The values themselves can be either arrays, raw values or recursively contain JSON Objects. Each key/value pair is defined as a 
@@ -86,7 +133,9 @@ public:
             }
             StringType newKey(key);
             std::replace(newKey.begin(), newKey.end(), ' ', '_');
-            os << LiteralConstants<CharType>::m_quotes << newKey << LiteralConstants<CharType>::m_quotes << LiteralConstants<CharType>::m_colon;
+            os << LiteralConstants<CharType>::m_quotes;
+            JSONEscape(os, newKey);
+            os << LiteralConstants<CharType>::m_quotes << LiteralConstants<CharType>::m_colon;
             if constexpr(isContainer)
             {
                 os << LiteralConstants<CharType>::m_bracket_open;
@@ -120,19 +169,7 @@ public:
                     }
 
                     if constexpr (std::is_same_v<ValueType, StringType>)
-                    {
-                        // Escape new lines '\n' with '\\n'
-                        StringType val_no_n = ReplaceAllTokensInString(val,
-                            StringType(LiteralConstants<CharType>::m_newline),
-                            StringType(LiteralConstants<CharType>::m_newline_escaped));
-
-                        // Escape tabs '\t' with '\\t'
-                        StringType val_no_nt = ReplaceAllTokensInString(val_no_n,
-                            StringType(LiteralConstants<CharType>::m_tab),
-                            StringType(LiteralConstants<CharType>::m_tab_escaped));
-
-                        os << val_no_nt;    // No tabs and newlines in JSON string
-                    }
+                        JSONEscape(os, val);
                     else
                         os << val;
 
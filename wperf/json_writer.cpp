@@ -0,0 +1,107 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "json_writer.h"
+
+void Utf8Encoder::AppendCodePoint(std::string& out, uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+void Utf8Encoder::Append(std::string& out, const wchar_t* str, size_t len)
+{
+    out.reserve(out.size() + len);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        const uint32_t c = static_cast<uint32_t>(str[i]);
+
+        if (c < 0x80 && m_high_surrogate == 0)     // Fast path, most of JSON is ASCII
+        {
+            out.push_back(static_cast<char>(c));
+            continue;
+        }
+
+        if (c >= 0xDC00 && c <= 0xDFFF)     // Low surrogate
+        {
+            if (m_high_surrogate)
+            {
+                AppendCodePoint(out, 0x10000 + ((m_high_surrogate - 0xD800) << 10) + (c - 0xDC00));
+                m_high_surrogate = 0;
+            }
+            else {
+                AppendCodePoint(out, m_REPLACEMENT_CHARACTER);
+            }
+            continue;
+        }
+
+        if (m_high_surrogate)               // High surrogate not followed by low surrogate
+        {
+            AppendCodePoint(out, m_REPLACEMENT_CHARACTER);
+            m_high_surrogate = 0;
+        }
+
+        if (c >= 0xD800 && c <= 0xDBFF)     // High surrogate, wait for low one
+            m_high_surrogate = c;
+        else if (c > 0x10FFFF)
+            AppendCodePoint(out, m_REPLACEMENT_CHARACTER);
+        else
+            AppendCodePoint(out, c);
+    }
+}
+
+void Utf8Encoder::Finish(std::string& out)
+{
+    if (m_high_surrogate)
+    {
+        AppendCodePoint(out, m_REPLACEMENT_CHARACTER);
+        m_high_surrogate = 0;
+    }
+}
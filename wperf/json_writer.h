@@ -0,0 +1,129 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// <summary>
+/// Incremental UTF-8 encoder of wide strings. Wide characters are UTF-16
+/// code units on Windows, surrogate pairs may be split between two calls
+/// of Append(). Unpaired surrogates are encoded as U+FFFD.
+/// </summary>
+class Utf8Encoder
+{
+public:
+    void Append(std::string& out, const wchar_t* str, size_t len);
+    void Finish(std::string& out);
+
+    static constexpr uint32_t m_REPLACEMENT_CHARACTER = 0xFFFD;
+
+private:
+    static void AppendCodePoint(std::string& out, uint32_t cp);
+
+    uint32_t m_high_surrogate = 0;      // Pending high surrogate, 0 if none
+};
+
+/// <summary>
+/// Stream buffer used to stream JSON documents straight into their final
+/// destination (stdout or --output file). Characters are collected in a fixed
+/// size buffer which, when full, is encoded to UTF-8 and written to SINK.
+/// This way JSON document is never materialised as a whole in memory.
+/// </summary>
+template <typename CharType>
+class JSONStreamBuffer : public std::basic_streambuf<CharType>
+{
+    typedef std::basic_streambuf<CharType> BaseType;
+    typedef typename BaseType::int_type int_type;
+    typedef typename BaseType::traits_type traits_type;
+
+public:
+    explicit JSONStreamBuffer(std::ostream& sink) : m_sink(sink), m_buffer(m_BUFFER_SIZE)
+    {
+        this->setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    ~JSONStreamBuffer()
+    {
+        Drain(true);
+        m_sink.flush();
+    }
+
+    JSONStreamBuffer(const JSONStreamBuffer&) = delete;
+    JSONStreamBuffer& operator=(const JSONStreamBuffer&) = delete;
+
+    static constexpr size_t m_BUFFER_SIZE = 16 * 1024;     // In characters
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        Drain(false);
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *this->pptr() = traits_type::to_char_type(ch);
+            this->pbump(1);
+        }
+        return m_sink ? traits_type::not_eof(ch) : traits_type::eof();
+    }
+
+    // Serialisers use std::endl a lot, draining on each flush would defeat
+    // buffering. Buffer is drained when full and when streaming is finished.
+    int sync() override
+    {
+        return m_sink ? 0 : -1;
+    }
+
+private:
+    void Drain(bool last)
+    {
+        const size_t len = static_cast<size_t>(this->pptr() - this->pbase());
+        if constexpr (std::is_same_v<CharType, char>)
+        {
+            m_sink.write(m_buffer.data(), len);
+        }
+        else {
+            m_utf8.clear();
+            m_encoder.Append(m_utf8, m_buffer.data(), len);
+            if (last)
+                m_encoder.Finish(m_utf8);
+            m_sink.write(m_utf8.data(), m_utf8.size());
+        }
+        this->setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    }
+
+    std::ostream& m_sink;
+    std::vector<CharType> m_buffer;
+    std::string m_utf8;                 // Reused between Drain() calls
+    Utf8Encoder m_encoder;
+};
@@ -30,6 +30,11 @@
 
 #include <Windows.h>
 #include <sysinfoapi.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <cmath>
 #if defined(ENABLE_ETW_TRACING_APP)
 #include "wperf-etw.h"
 #endif
@@ -50,6 +55,9 @@
 #include "config.h"
 #include "perfdata.h"
 #include "disassembler.h"
+#include "folded.h"
+#include "top_aggregator.h"
+#include "sample_rate.h"
 
 static bool no_ctrl_c = true;
 
@@ -86,7 +94,7 @@ wmain(
     pmu_device pmu_device;
     wstr_vec raw_args;
 
-    LLVMDisassembler disassembler;
+    std::unique_ptr<Disassembler> disassembler;
     bool spawned_process = false;
     HANDLE process_handle = NULL;
     PROCESS_INFORMATION pi;
@@ -301,6 +309,12 @@ wmain(
 
             pmu_device.timeline_header(request.ioctl_events);
 
+            if (request.ddr_monitor_interval > 0.0 && (enable_bits & CTL_FLAG_DMC))
+                pmu_device.ddr_monitor_init(request.ddr_monitor_interval);
+
+            if (request.heatmap_interval > 0.0 && (enable_bits & CTL_FLAG_CORE))
+                pmu_device.heatmap_init(request.heatmap_interval, request.ioctl_events[EVT_CORE]);
+
             int64_t counting_duration_iter = request.count_duration > 0 ?
                 static_cast<int64_t>(request.count_duration * 10) : _I64_MAX;
 
@@ -346,6 +360,12 @@ wmain(
 
                 pmu_device.start(enable_bits);
 
+                if (pmu_device.ddr_monitor_p())
+                    pmu_device.ddr_monitor_start();
+
+                if (pmu_device.heatmap_p())
+                    pmu_device.heatmap_start();
+
                 m_out.GetOutputStream() << L"counting ... -";
 
                 int progress_map_index = 0;
@@ -357,7 +377,10 @@ wmain(
                 {
                     m_out.GetOutputStream() << L'\b' << progress_map[progress_map_index % 4];
                     t_count1--;
-                    Sleep(100);
+                    if (pmu_device.ddr_monitor_p() || pmu_device.heatmap_p())
+                        pmu_device.monitor_sleep(100);
+                    else
+                        Sleep(100);
                     progress_map_index++;
 
                     if (do_count_process_spawn && GetExitCodeProcess(process_handle, &image_exit_code))
@@ -370,12 +393,19 @@ wmain(
 
                 SYSTEMTIME timestamp_b;
                 GetSystemTime(&timestamp_b);
+                const auto post_processing_start = std::chrono::steady_clock::now();
 
                 if (enable_bits & CTL_FLAG_CORE)
                 {
                     pmu_device.core_events_read();
                     pmu_device.print_core_stat(request.ioctl_events[EVT_CORE]);
                     pmu_device.print_core_metrics(request.ioctl_events[EVT_CORE]);
+
+                    if (pmu_device.heatmap_p())
+                        pmu_device.print_heatmap();
+
+                    if (request.topdown)
+                        pmu_device.print_topdown(*request.topdown, request.ioctl_events[EVT_CORE]);
                 }
 
                 if (enable_bits & CTL_FLAG_DSU)
@@ -388,11 +418,21 @@ wmain(
                 {
                     pmu_device.dmc_events_read();
                     pmu_device.print_dmc_stat(request.ioctl_events[EVT_DMC_CLK], request.ioctl_events[EVT_DMC_CLKDIV2], request.report_ddr_bw_metric);
+
+                    if (pmu_device.ddr_monitor_p())
+                        pmu_device.print_ddr_monitor();
                 }
 
                 const double  duration = timestamps_to_duration(timestamp_a, timestamp_b);
                 m_globalJSON.m_duration = duration;
 
+                if (enable_bits & CTL_FLAG_CORE)
+                {
+                    const auto post_processing_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - post_processing_start).count();
+                    pmu_device.print_overhead(duration, static_cast<uint64_t>(post_processing_ns));
+                }
+
                 if (!request.do_timeline)
                 {
                     m_out.GetOutputStream() << std::endl;
@@ -447,7 +487,7 @@ wmain(
             if (request.do_timeline)
                 m_out.Print(m_globalTimelineJSON);
         }
-        else if (request.do_sample || request.do_record)
+        else if (request.do_sample || request.do_record || request.do_top)
         {
             enable_bits = 0;
             if(request.m_sampling_with_spe)
@@ -489,9 +529,14 @@ wmain(
 
             if (request.do_disassembly)
             {
-                if (!disassembler.CheckCommand())
+                if (request.disassembler == L"llvm")
+                    disassembler = std::make_unique<LLVMDisassembler>();
+                else
+                    disassembler = std::make_unique<BuiltinDisassembler>();
+
+                if (!disassembler->CheckCommand())
                 {
-                    m_out.GetErrorOutputStream() << L"Error executing disassembler `" << disassembler.GetCommand() << L"`. Is it on PATH?" << std::endl;
+                    m_out.GetErrorOutputStream() << L"Error executing disassembler `" << disassembler->GetCommand() << L"`. Is it on PATH?" << std::endl;
                     m_out.GetErrorOutputStream() << L"note: wperf uses LLVM's objdump. You can install Visual Studio 'C++ Clang Compiler...' and 'MSBuild support for LLVM'" << std::endl;
                     throw fatal_exception("Failed to call disassembler!");
                 }
@@ -524,7 +569,10 @@ wmain(
             uint64_t static_entry_point, image_base;
 
             parse_pe_file(request.sample_pe_file, static_entry_point, image_base, sec_info, sec_import);
-            parse_pdb_file(request.sample_pdb_file, sym_info, request.sample_display_short);
+            std::future<void> image_symbols = std::async(std::launch::async, [&]() {
+                parse_pdb_file(request.sample_pdb_file, sym_info, request.sample_display_short, request.symbol_cache_dir,
+                               get_pe_file_metadata(request.sample_pe_file).pdb_signature);
+            });
 
             uint32_t stop_bits = CTL_FLAG_CORE;
 
@@ -546,17 +594,16 @@ wmain(
 
             std::map<std::wstring, PeFileMetaData> dll_metadata;        // [pe_name] -> PeFileMetaData
             std::map<std::wstring, ModuleMetaData> modules_metadata;    // [mod_name] -> ModuleMetaData
+            ModuleMap module_map;                                       // Modules loaded over time, by address
 
-            const size_t hMods_size = sizeof(HMODULE) * MAX_MODULES;
-            auto hMods = std::make_unique<HMODULE[]>(MAX_MODULES);     // HMODULE hMods[1024];
-            DWORD cbNeeded;
             DWORD pid;
             TCHAR imageFileName[MAX_PATH];
 
             //If the user asked to record we should spawn the process ourselves.
             if (request.do_record)
             {
-                SpawnProcess(request.sample_pe_file.c_str(), request.record_commandline.c_str(), &pi, request.record_spawn_delay);
+                // Do not wait for the process here, `record_spawn_delay` is applied to module enumeration only
+                SpawnProcess(request.sample_pe_file.c_str(), request.record_commandline.c_str(), &pi, 0);
                 pid = GetProcessId(pi.hProcess);
                 process_handle = pi.hProcess;
 
@@ -588,149 +635,257 @@ wmain(
 
             if (request.do_export_perf_data)
             {
-                perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, request.sample_image_name);
+                perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, request.sample_image_name, UINT64(0));
             }
 
-            if (EnumProcessModules(process_handle, hMods.get(), hMods_size, &cbNeeded))
+            // Register modules ADDED to `module_map` (by its snapshot taken at TIME).
+            auto add_modules = [&](const std::vector<size_t>& added, uint64_t time)
             {
-                for (auto i = 0; i < (cbNeeded / sizeof(HMODULE)); i++)
+                for (size_t idx : added)
                 {
-                    TCHAR szModName[MAX_PATH];
-                    TCHAR lpszBaseName[MAX_PATH];
-
-                    std::wstring name;
-                    if (GetModuleBaseNameW(process_handle, hMods[i], lpszBaseName, MAX_PATH))
+                    const ModuleMapEntry& mod = module_map.GetEntries()[idx];
+                    ModuleMetaData& mmd = modules_metadata[mod.name];
+                    mmd.mod_name = mod.name;
+                    mmd.mod_path = mod.path;
+                    mmd.handle = reinterpret_cast<HMODULE>(mod.base);
+                    mmd.mod_baseOfDll = get_pe_file_metadata(mod.path).image_base;
+
+                    if (request.do_export_perf_data)
                     {
-                        name = lpszBaseName;
-                        modules_metadata[name].mod_name = name;
+                        std::wstring mod_path = mod.path;
+                        perfDataWriter.RegisterEvent(PerfDataWriter::MMAP, pid, mod.base, mod.size, mod_path, 0, time);
                     }
+                }
+            };
+
+            // Sampling starts right after the process is spawned (or found), so we do not
+            // miss its start-up. Modules of the process are enumerated and their symbols
+            // are loaded in the background. Samples are resolved once both are complete.
+            // Modules loaded later are tracked with snapshots taken every time samples are read.
+            // Event is declared before the background task so it outlives it also when we throw.
+            std::unique_ptr<std::remove_pointer_t<HANDLE>, decltype(&CloseHandle)> sampling_stopped(
+                CreateEvent(NULL, TRUE, FALSE, NULL), &CloseHandle);
+            MODULEINFO modinfo{};
+            bool has_modinfo = false;
+            DWORD modinfo_error = 0;
+
+            std::future<void> modules_symbols = std::async(std::launch::async, [&]() {
+                // Give spawned process time to load its modules
+                if (request.do_record)
+                    WaitForSingleObject(sampling_stopped.get(), request.record_spawn_delay);
+
+                std::vector<ModuleMapEntry> snapshot;
+                if (GetProcessModules(process_handle, snapshot))
+                    add_modules(module_map.Update(0, snapshot), 0);
+
+                load_modules_symbols(modules_metadata, dll_metadata, request.sample_display_short, request.symbol_cache_dir);
+
+                HMODULE module_handle;
+                if (request.do_record)
+                {
+                    module_handle = GetModule(process_handle, imageFileName);
+                }
+                else {
+                    module_handle = GetModule(process_handle, request.sample_image_name);
+                }
+
+                has_modinfo = GetModuleInformation(process_handle, module_handle, &modinfo, sizeof(MODULEINFO));
+                if (!has_modinfo)
+                    modinfo_error = GetLastError();
+            });
+
+            // Resolve ADDR to function symbol in image (executable) or in one of its modules.
+            auto resolve_address = [&](uint64_t addr, uint64_t begin, uint64_t end, SampleDesc& sd) -> bool
+            {
+                bool found = false;
+
+                // Search in symbol table for image (executable)
+                if (const FuncSymDesc* sym = find_image_symbol(addr, sym_info, sec_info, image_base + runtime_vaddr_delta))
+                {
+                    sd.desc = *sym;
+                    sd.module = 0;
+                    found = true;
+                }
 
-                    // Get the full path to the module's file.
-                    if (GetModuleFileNameEx(process_handle, hMods[i], szModName, sizeof(szModName) / sizeof(TCHAR)))
+                // Nothing was found in base images, let's search inside modules loaded with
+                // images (such as DLLs) at the time sample was taken, that is in time
+                // interval (BEGIN, END].
+                // Note: at this point:
+                //  `module_map` contains all modules loaded with image (executable) over time
+                //  `modules_metadata` contains e.g. symbols of image modules loaded which had
+                //                     PDB files present and we were able to load them.
+                if (!found)
+                {
+                    const ModuleMapEntry* mod = module_map.Find(addr, begin, end);
+                    if (mod && modules_metadata.count(mod->name) && dll_metadata.count(mod->name))
                     {
-                        uint64_t mod_base = 0;
-                        std::wstring mod_path = szModName;
-                        modules_metadata[name].mod_path = mod_path;
-                        modules_metadata[name].handle = hMods[i];
-                        
-                        parse_pe_file(mod_path, mod_base);
-                        modules_metadata[name].mod_baseOfDll = mod_base;
+                        ModuleMetaData& mmd = modules_metadata[mod->name];
+                        const std::vector<SectionDesc>& mod_sec_info = dll_metadata[mod->name].sec_info;
+
+                        for (const auto& b : mmd.sym_info)
+                        {
+                            if (!b.sec_idx || b.sec_idx > mod_sec_info.size()) // We may not be able to decode all symbols at this time, so we skip
+                                continue;
 
-                        MODULEINFO modinfo;
-                        if (GetModuleInformation(process_handle, hMods[i], &modinfo, sizeof(MODULEINFO)))
-                        {                            
-                            if (request.do_export_perf_data)
+                            const uint64_t sym_base = mod->base + mod_sec_info[b.sec_idx - 1].offset + b.offset;
+                            if (addr >= sym_base && addr < sym_base + b.size)
                             {
-                                perfDataWriter.RegisterEvent(PerfDataWriter::MMAP, pid, reinterpret_cast<UINT64>(modinfo.lpBaseOfDll), modinfo.SizeOfImage, mod_path, 0);
+                                sd.desc = b;
+                                sd.desc.name = b.name + L":" + mod->name;
+                                sd.desc.sname = b.name;
+                                sd.module = &mmd;
+                                found = true;
+                                break;
                             }
                         }
-                        else {
-                            m_out.GetErrorOutputStream() << "Failed to get module " << szModName << " information" << std::endl;
-                        }
-
                     }
                 }
-            }
 
-            if (request.do_verbose)
+                return found;
+            };
+
+            SYSTEMTIME timestamp_a;
+            SYSTEMTIME timestamp_b;
+            std::chrono::steady_clock::time_point post_processing_start;
+            
+            std::vector<FrameChain> raw_samples;
+            std::vector<uint32_t> raw_weights;      // Histogram sampling: how many times each of `raw_samples` was sampled
+            std::vector<std::pair<size_t, uint64_t>> sample_batches;   // [end of batch in `raw_samples`, time it was read]
+            const auto sampling_start = std::chrono::steady_clock::now();
+            auto sampling_time = [&]() -> uint64_t {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sampling_start).count();
+            };
+
+            // `wperf top`: samples read since previous refresh are resolved and added to
+            // `top_aggregator` (which ages older ones), then hottest functions are printed.
+            // Samples are dropped once aggregated so memory use does not grow over time.
+            TopAggregator top_aggregator(request.top_decay);
+            std::map<std::wstring, bool> top_symbol_shown;  // [symbol name] -> passes `--symbol` filter
+            uint64_t top_refresh_time = 0;                  // Time of previous refresh
+            bool top_symbols_ready = false;
+            auto top_refresh = [&](uint64_t now)
             {
-                m_out.GetOutputStream() << L"================================" << std::endl;
-                std::vector<GlobalStringType> col_name, col_path;
-                std::vector<ULONGLONG> col_address;
-                
-                m_globalSamplingJSON.m_verbose = true;
-                m_globalSamplingJSON.m_modules_table.PresetHeaders();
-                
-                for (const auto& [key, value] : modules_metadata)
+                // Samples are kept until image and its modules can be resolved
+                if (!top_symbols_ready)
                 {
-                    m_out.GetOutputStream() << std::setw(32) << key
-                        << std::setw(32) << IntToHexWideString((ULONGLONG)value.handle, 20)
-                        << L"          " << value.mod_path << std::endl;
-                    col_name.push_back(key);
-                    col_address.push_back(reinterpret_cast<ULONGLONG>(value.handle));
-                    col_path.push_back(value.mod_path);
+                    if (modules_symbols.wait_for(std::chrono::seconds(0)) != std::future_status::ready
+                        || image_symbols.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                        return;
 
+                    if (has_modinfo)
+                        runtime_vaddr_delta = (UINT64)modinfo.EntryPoint - (image_base + static_entry_point);
+                    top_symbols_ready = true;
                 }
-                m_globalSamplingJSON.m_modules_table.Insert(col_name, col_address, col_path);
-            }
 
-            for (auto& [key, value] : modules_metadata)
-            {
-                std::wstring pdb_path = gen_pdb_name(value.mod_path);
-                std::ifstream ifile(pdb_path);
-                if (ifile) {
-                    PeFileMetaData pefile_metadata;
-                    parse_pe_file(value.mod_path, pefile_metadata);
-                    pefile_metadata.pdb_file = pdb_path;
-                    dll_metadata[value.mod_name] = pefile_metadata;
-                    
-                    parse_pdb_file(pdb_path, value.sym_info, request.sample_display_short);
-                    ifile.close();
+                top_aggregator.Decay(static_cast<double>(now - top_refresh_time) / 1e9);
+
+                uint64_t top_samples = 0;
+                size_t batch_idx = 0;
+                for (size_t sample_idx = 0; sample_idx < raw_samples.size(); sample_idx++)
+                {
+                    const FrameChain& a = raw_samples[sample_idx];
+                    SampleDesc sd;
+
+                    while (sample_batches[batch_idx].first <= sample_idx)
+                        batch_idx++;
+                    const uint64_t end = sample_batches[batch_idx].second;
+                    const uint64_t begin = batch_idx == 0 ? top_refresh_time : sample_batches[batch_idx - 1].second;
+
+                    const uint32_t weight = raw_weights.empty() ? 1 : raw_weights[sample_idx];
+                    top_samples += weight;
+
+                    if (!resolve_address(a.pc, begin, end, sd))
+                        sd.desc.name = L"unknown";
+
+                    if (request.do_symbol && top_symbol_shown.count(sd.desc.name) == 0)
+                        top_symbol_shown[sd.desc.name] = request.check_symbol_arg(sd.desc.sname, request.symbol_arg);
+
+                    for (auto const& [mapped_counter_idx, counter_idx] : pmu_device.counter_idx_unmap)
+                    {
+                        if (!(a.ov_flags & (1i64 << (UINT64)mapped_counter_idx)))
+                            continue;
+
+                        const uint32_t event_src = counter_idx == 31 ? CYCLE_EVT_IDX : request.ioctl_events_sample[counter_idx].index;
+                        top_aggregator.Add(event_src, sd.desc.name, request.sample_frequency ? a.period : weight);
+                    }
                 }
-            }
 
-            if (request.do_verbose)
-            {
-                m_out.GetOutputStream() << L"================================" << std::endl;
-                for (const auto& [key, value] : dll_metadata)
+                WPerfTopJSON<GlobalCharType> top_json;
+                top_json.m_time = static_cast<double>(now) / 1e9;
+                top_json.m_decay = request.top_decay;
+                top_json.m_samples = top_samples;
+
+                m_out.GetOutputStream() << std::endl << L"time: " << DoubleToWideString(top_json.m_time) << L"s, samples: "
+                    << std::dec << top_samples << std::endl;
+
+                for (uint32_t event_src : top_aggregator.GetEvents())
                 {
-                    m_out.GetOutputStream() << std::setw(32) << key
-                        << L"          " << value.pe_name << std::endl;
-                    TableOutput<SamplingModuleInfoOutputTraits<GlobalCharType>, GlobalCharType> module_info_table(m_outputType);                    
-                    module_info_table.PresetHeaders();
-                    module_info_table.InsertExtra(L"module", key);
-                    module_info_table.InsertExtra(L"pe_name", value.pe_name);
-                    module_info_table.InsertExtra(L"pdb_file", value.pdb_file);
-                    std::vector<GlobalStringType> col_name;
-                    std::vector<uint64_t> col_offset, col_virtual_size;
-                    for (auto& sec : value.sec_info)
+                    const double total = top_aggregator.GetTotal(event_src);
+                    std::vector<std::wstring> col_symbol;
+                    std::vector<double> col_overhead;
+                    std::vector<uint32_t> col_count;
+
+                    for (const auto& e : top_aggregator.Top(event_src, request.do_symbol ? SIZE_MAX : request.sample_display_row))
                     {
-                        m_out.GetOutputStream() << std::setw(32) << sec.name
-                            << std::setw(32) << IntToHexWideString(sec.offset, 20)
-                            << std::setw(32) << IntToHexWideString(sec.virtual_size)
-                            << std::endl;
-                        col_name.push_back(sec.name);
-                        col_offset.push_back(sec.offset);
-                        col_virtual_size.push_back(sec.virtual_size);
+                        if (col_symbol.size() == request.sample_display_row)
+                            break;
+                        if (request.do_symbol && !top_symbol_shown[e.symbol])
+                            continue;
+
+                        col_overhead.push_back(e.weight * 100 / total);
+                        col_count.push_back(static_cast<uint32_t>(std::llround(e.weight)));
+                        col_symbol.push_back(e.symbol);
                     }
-                    module_info_table.Insert(col_name, col_offset, col_virtual_size);
-                    m_globalSamplingJSON.m_modules_info_vector.push_back(module_info_table);
+
+                    const std::wstring event_name = pmu_events::get_event_name(static_cast<uint16_t>(event_src));
+                    m_out.GetOutputStream() << L"======================== sample source: " << event_name
+                        << L", top " << std::dec << request.sample_display_row << L" hot functions ========================" << std::endl;
+
+                    TableOutput<SamplingOutputTraitsL, GlobalCharType> table(m_outputType);
+                    table.PresetHeaders();
+                    table.SetAlignment(0, ColumnAlignL::RIGHT);
+                    table.SetAlignment(1, ColumnAlignL::RIGHT);
+                    table.Insert(col_overhead, col_count, col_symbol);
+                    table.InsertExtra(L"interval", request.sampling_inverval[event_src]);
+                    table.InsertExtra(L"printed_sample_num", static_cast<uint64_t>(col_symbol.size()));
+                    m_out.Print(table);
+                    table.m_event = event_name;
+                    top_json.m_events.push_back(std::make_pair(event_name, table));
                 }
-            }
 
-            HMODULE module_handle;
-            if (request.do_record)
-            {
-                module_handle = GetModule(process_handle, imageFileName);
-            }
-            else {
-                module_handle = GetModule(process_handle, request.sample_image_name);
-            }
-            
-            MODULEINFO modinfo;
-            bool ret = GetModuleInformation(process_handle, module_handle, &modinfo, sizeof(MODULEINFO));
-            if (!ret)
-            {
-                m_out.GetOutputStream() << L"failed to query base address of '" << request.sample_image_name << L"' with " << std::hex << GetLastError() << "\n";
-            }
-            else
+                m_out.Print(top_json);
+
+                raw_samples.clear();
+                raw_weights.clear();
+                sample_batches.clear();
+                top_refresh_time = now;
+            };
+
+            // Frequency mode (-F): sampled counters get their intervals adjusted once a second.
+            // Counters are assigned to sample sources the same way driver does it (PMU_CTL_SAMPLE_SET_SRC).
+            SampleRateController sample_rate(request.sample_frequency);
+            uint64_t sample_rate_time = 0;
+            if (request.sample_frequency)
             {
-                runtime_vaddr_delta = (UINT64)modinfo.EntryPoint - (image_base + static_entry_point);
-                m_out.GetOutputStream() << L"base address of '" << request.sample_image_name
-                    << L"': 0x" << std::hex << (UINT64)modinfo.EntryPoint
-                    << L", runtime delta: 0x" << runtime_vaddr_delta << std::endl;
+                uint8_t gpc_num = 0;
+                for (const auto& src : request.ioctl_events_sample)
+                {
+                    if (src.index == CYCLE_EVT_IDX)
+                    {
+                        sample_rate.SetInterval(CYCLE_COUNTER_IDX, src.interval);
+                        continue;
+                    }
 
-                m_globalSamplingJSON.m_base_address = reinterpret_cast<UINT64>(modinfo.EntryPoint);
-                m_globalSamplingJSON.m_runtime_delta = runtime_vaddr_delta;
+                    for (auto const& [mapped_counter_idx, counter_idx] : pmu_device.counter_idx_unmap)
+                        if (counter_idx == gpc_num && mapped_counter_idx != CYCLE_COUNTER_IDX)
+                            sample_rate.SetInterval(mapped_counter_idx, src.interval);
+                    gpc_num++;
+                }
 
-                if (request.do_export_perf_data)
-                    perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, request.sample_image_name);
+                if (request.ioctl_events_sample.empty())
+                    sample_rate.SetInterval(CYCLE_COUNTER_IDX, SAMPLE_SRC_DEFAULT_INTERVAL);
             }
 
-            SYSTEMTIME timestamp_a;
-            SYSTEMTIME timestamp_b;
-            
-            std::vector<FrameChain> raw_samples;
             {
                 DWORD image_exit_code = 0;
 
@@ -744,9 +899,10 @@ wmain(
                     pmu_device.start(enable_bits);
                     pmu_device.spe_start(request.m_sampling_flags);
                 }
-                else pmu_device.start_sample();
+                else pmu_device.start_sample(request.do_sample_histogram);
 
-                m_out.GetOutputStream() << L"sampling ...";
+                if (!request.do_top)
+                    m_out.GetOutputStream() << L"sampling ...";
 
                 
                 GetSystemTime(&timestamp_a);
@@ -756,20 +912,62 @@ wmain(
                     t_count1--;
                     Sleep(100);
 
-                    if ((t_count1 % 10) == 0)
-                    {                        
-                        if(request.m_sampling_with_spe)
+                    // `top` and frequency mode drain samples every iteration so driver buffers do not
+                    // fill up, module snapshots are taken once a second in all modes.
+                    const bool poll_modules = (t_count1 % 10) == 0;
+                    if (poll_modules || request.do_top || request.sample_frequency)
+                    {
+                        const size_t polled_from = raw_samples.size();
+
+                        if (request.m_sampling_with_spe)
                         {
                             if (pmu_device.spe_get())
                                 m_out.GetOutputStream() << L".";
                             else
                                 m_out.GetOutputStream() << L"e";
                         } else {
-                            if (pmu_device.get_sample(raw_samples))
-                                m_out.GetOutputStream() << L".";
-                            else
-                                m_out.GetOutputStream() << L"e";
+                            const bool has_samples = request.do_sample_histogram ?
+                                pmu_device.get_sample_histogram(raw_samples, raw_weights) : pmu_device.get_sample(raw_samples);
+                            if (!request.do_top && poll_modules)
+                                m_out.GetOutputStream() << (has_samples ? L"." : L"e");
                         }
+
+                        const uint64_t now = sampling_time();
+                        sample_batches.push_back(std::make_pair(raw_samples.size(), now));
+
+                        if (request.sample_frequency)
+                        {
+                            for (size_t i = polled_from; i < raw_samples.size(); i++)
+                                for (uint32_t counter_idx = 0; counter_idx <= CYCLE_COUNTER_IDX; counter_idx++)
+                                    if (raw_samples[i].ov_flags & (1ULL << counter_idx))
+                                        sample_rate.AddSamples(counter_idx);
+
+                            if (poll_modules)
+                            {
+                                std::map<uint32_t, uint32_t> intervals = sample_rate.Update(static_cast<double>(now - sample_rate_time) / 1e9);
+                                if (intervals.size())
+                                    pmu_device.set_sample_interval(intervals);
+                                sample_rate_time = now;
+                            }
+                        }
+
+                        // Initial module list is owned by the background task until it is done
+                        if (poll_modules && modules_symbols.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                        {
+                            std::vector<ModuleMapEntry> snapshot;
+                            if (GetProcessModules(process_handle, snapshot))
+                            {
+                                std::vector<size_t> added = module_map.Update(now, snapshot);
+                                add_modules(added, now);
+
+                                // `top` resolves samples while sampling, so symbols are needed right away
+                                if (request.do_top && added.size())
+                                    load_modules_symbols(modules_metadata, dll_metadata, request.sample_display_short, request.symbol_cache_dir);
+                            }
+                        }
+
+                        if (request.do_top && now - top_refresh_time >= static_cast<uint64_t>(request.top_refresh * 1e9))
+                            top_refresh(now);
                     }
 
                     if (GetExitCodeProcess(process_handle, &image_exit_code))
@@ -779,8 +977,10 @@ wmain(
                 while (t_count1 > 0 && no_ctrl_c);
 
                 GetSystemTime(&timestamp_b);
+                post_processing_start = std::chrono::steady_clock::now();
 
-                m_out.GetOutputStream() << " done!" << std::endl;
+                if (!request.do_top)
+                    m_out.GetOutputStream() << " done!" << std::endl;
 
                 if(request.m_sampling_with_spe)
                 {
@@ -802,6 +1002,90 @@ wmain(
                     << L" exited with code " << IntToHexWideString(image_exit_code) << std::endl;
             }
 
+            SetEvent(sampling_stopped.get());
+            modules_symbols.get();
+            image_symbols.get();
+            sampling_stopped.reset();
+
+            // `top` has already printed its results, refresh by refresh
+            if (request.do_top)
+            {
+                CloseHandle(process_handle);
+                goto clean_exit;
+            }
+
+            // Load symbols of modules loaded during sampling
+            load_modules_symbols(modules_metadata, dll_metadata, request.sample_display_short, request.symbol_cache_dir);
+
+            if (request.do_verbose)
+            {
+                m_out.GetOutputStream() << L"================================" << std::endl;
+                std::vector<GlobalStringType> col_name, col_path;
+                std::vector<ULONGLONG> col_address;
+                
+                m_globalSamplingJSON.m_verbose = true;
+                m_globalSamplingJSON.m_modules_table.PresetHeaders();
+                
+                for (const auto& [key, value] : modules_metadata)
+                {
+                    m_out.GetOutputStream() << std::setw(32) << key
+                        << std::setw(32) << IntToHexWideString((ULONGLONG)value.handle, 20)
+                        << L"          " << value.mod_path << std::endl;
+                    col_name.push_back(key);
+                    col_address.push_back(reinterpret_cast<ULONGLONG>(value.handle));
+                    col_path.push_back(value.mod_path);
+
+                }
+                m_globalSamplingJSON.m_modules_table.Insert(col_name, col_address, col_path);
+            }
+
+            if (request.do_verbose)
+            {
+                m_out.GetOutputStream() << L"================================" << std::endl;
+                for (const auto& [key, value] : dll_metadata)
+                {
+                    m_out.GetOutputStream() << std::setw(32) << key
+                        << L"          " << value.pe_name << std::endl;
+                    TableOutput<SamplingModuleInfoOutputTraits<GlobalCharType>, GlobalCharType> module_info_table(m_outputType);                    
+                    module_info_table.PresetHeaders();
+                    module_info_table.InsertExtra(L"module", key);
+                    module_info_table.InsertExtra(L"pe_name", value.pe_name);
+                    module_info_table.InsertExtra(L"pdb_file", value.pdb_file);
+                    std::vector<GlobalStringType> col_name;
+                    std::vector<uint64_t> col_offset, col_virtual_size;
+                    for (auto& sec : value.sec_info)
+                    {
+                        m_out.GetOutputStream() << std::setw(32) << sec.name
+                            << std::setw(32) << IntToHexWideString(sec.offset, 20)
+                            << std::setw(32) << IntToHexWideString(sec.virtual_size)
+                            << std::endl;
+                        col_name.push_back(sec.name);
+                        col_offset.push_back(sec.offset);
+                        col_virtual_size.push_back(sec.virtual_size);
+                    }
+                    module_info_table.Insert(col_name, col_offset, col_virtual_size);
+                    m_globalSamplingJSON.m_modules_info_vector.push_back(module_info_table);
+                }
+            }
+
+            if (!has_modinfo)
+            {
+                m_out.GetOutputStream() << L"failed to query base address of '" << request.sample_image_name << L"' with " << std::hex << modinfo_error << "\n";
+            }
+            else
+            {
+                runtime_vaddr_delta = (UINT64)modinfo.EntryPoint - (image_base + static_entry_point);
+                m_out.GetOutputStream() << L"base address of '" << request.sample_image_name
+                    << L"': 0x" << std::hex << (UINT64)modinfo.EntryPoint
+                    << L", runtime delta: 0x" << runtime_vaddr_delta << std::endl;
+
+                m_globalSamplingJSON.m_base_address = reinterpret_cast<UINT64>(modinfo.EntryPoint);
+                m_globalSamplingJSON.m_runtime_delta = runtime_vaddr_delta;
+
+                if (request.do_export_perf_data)
+                    perfDataWriter.RegisterEvent(PerfDataWriter::COMM, pid, request.sample_image_name, UINT64(0));
+            }
+
             if (request.do_record)
             {
                 TerminateProcess(pi.hProcess, 0);
@@ -831,82 +1115,41 @@ wmain(
                 spe_device::get_samples(pmu_device.m_spe_buffer, raw_samples, spe_event_map);
             }
 
+            // Samples read after last batch (e.g. SPE samples which are all decoded at the end)
+            if (sample_batches.empty() || sample_batches.back().first != raw_samples.size())
+                sample_batches.push_back(std::make_pair(raw_samples.size(), sampling_time()));
+
             std::vector<SampleDesc> resolved_samples;
+            FoldedStacks folded_stacks;
 
-            for (const auto& a : raw_samples)
+            std::map<uint64_t, uint64_t> pc_time;      // [pc] -> time it was last sampled at
+            size_t batch_idx = 0;
+            for (size_t sample_idx = 0; sample_idx < raw_samples.size(); sample_idx++)
             {
-                bool found = false;
+                const FrameChain& a = raw_samples[sample_idx];
                 SampleDesc sd;
-                uint64_t sec_base = 0;
 
-                // Search in symbol table for image (executable)
-                for (const auto& b : sym_info)
-                {
-                    for (const auto& c : sec_info)
-                    {
-                        assert(b.sec_idx);
-                        if (c.idx == (b.sec_idx - 1))
-                        {
-                            sec_base = image_base + c.offset + runtime_vaddr_delta;
-                            break;
-                        }
-                    }
+                while (sample_batches[batch_idx].first <= sample_idx)
+                    batch_idx++;
+                const uint64_t end = sample_batches[batch_idx].second;
+                const uint64_t begin = (batch_idx == 0 || request.m_sampling_with_spe) ? 0 : sample_batches[batch_idx - 1].second;
+                const uint32_t weight = raw_weights.empty() ? 1 : raw_weights[sample_idx];
+                pc_time[a.pc] = end;
 
-                    if (a.pc >= (b.offset + sec_base) && a.pc < (b.offset + sec_base + b.size))
-                    {
-                        sd.desc = b;
-                        sd.module = 0;
-                        found = true;
-                        break;
-                    }
-                }
+                if (!resolve_address(a.pc, begin, end, sd))
+                    sd.desc.name = L"unknown";
 
-                // Nothing was found in base images, let's search inside modules loaded with
-                // images (such as DLLs).
-                // Note: at this point:
-                //  `dll_metadata` contains names of all modules loaded with image (executable)
-                //  `modules_metadata` contains e.g. symbols of image modules loaded which had
-                //                     PDB files present and we were able to load them.
-                if (!found)
+                // Two-level stack: caller (resolved from LR) and sampled function (PC).
+                // Note: SPE samples do not carry LR, these will have one frame only.
+                std::vector<std::wstring> frames;
+                if (request.do_export_folded)
                 {
-                    sec_base = 0;
-
-                    for (const auto& [key, value] : dll_metadata)
-                    {
-                        if (modules_metadata.count(key))
-                        {
-                            ModuleMetaData& mmd = modules_metadata[key];
-
-                            for (auto& b : mmd.sym_info)
-                                for (const auto& c : value.sec_info)
-                                    {
-                                        if (!b.sec_idx) // We may not be able to decode all symbols at this time, so we skip
-                                            continue;
-
-                                        if (c.idx == (b.sec_idx - 1))
-                                        {
-                                            sec_base = (UINT64)mmd.handle + c.offset;
-                                            break;
-                                        }
-                                    }
-
-                            for (const auto& b : mmd.sym_info)
-                                if (a.pc >= (b.offset + sec_base) && a.pc < (b.offset + sec_base + b.size))
-                                {
-                                    sd.desc = b;
-                                    sd.desc.name = b.name + L":" + key;
-                                    sd.desc.sname = b.name;
-                                    sd.module = &mmd;
-                                    found = true;
-                                    break;
-                                }
-                        }
-                    }
+                    SampleDesc caller;
+                    if (a.lr && resolve_address(a.lr, begin, end, caller) && caller.desc.name != sd.desc.name)
+                        frames.push_back(caller.desc.name);
+                    frames.push_back(sd.desc.name);
                 }
 
-                if (!found)
-                    sd.desc.name = L"unknown";
-
                 /* `counter_idx_unmap` carries all the information we need to translate GPCs to event numbers.
                 *    We just loop through it, which represents available GPCs.
                 */
@@ -925,7 +1168,6 @@ wmain(
                         spe_gone = true;
                     }
 
-                    bool inserted = false;
                     uint32_t event_src;
                     if(!request.m_sampling_with_spe)
                     {
@@ -937,38 +1179,10 @@ wmain(
                         event_src = a.spe_event_idx;
                     }
 
-                    for (auto& c : resolved_samples)
-                    {
-                        if (c.desc.name == sd.desc.name && c.event_src == event_src)
-                        {
-                            c.freq++;
-                            bool pc_found = false;
-                            for (int i = 0; i < c.pc.size(); i++)
-                            {
-                                if (c.pc[i].first == a.pc)
-                                {
-                                    c.pc[i].second += 1;
-                                    pc_found = true;
-                                    break;
-                                }
-                            }
+                    if (request.do_export_folded)
+                        folded_stacks.add(event_src, frames, request.sample_frequency ? a.period : weight);
 
-                            if (!pc_found)
-                                c.pc.push_back(std::make_pair(a.pc, 1));
-
-                            inserted = true;
-                            break;
-                        }
-                    }
-
-                    if (!inserted)
-                    {
-                        sd.freq = 1;
-                        sd.event_src = event_src;
-                        sd.pc.clear();
-                        sd.pc.push_back(std::make_pair(a.pc, 1));
-                        resolved_samples.push_back(sd);
-                    }
+                    add_resolved_sample(resolved_samples, sd, event_src, a.pc, weight, a.period);
                 }
             }
 
@@ -978,24 +1192,36 @@ wmain(
             if (resolved_samples.size() > 0)
                 prev_evt_src = resolved_samples[0].event_src;
 
-            std::vector<uint64_t> total_samples;
-            uint64_t acc = 0;
+            std::vector<uint64_t> total_samples, total_periods;
+            uint64_t acc = 0, acc_period = 0;
             for (const auto& a : resolved_samples)
             {
                 if (a.event_src != prev_evt_src)
                 {
                     prev_evt_src = a.event_src;
                     total_samples.push_back(acc);
+                    total_periods.push_back(acc_period);
                     acc = 0;
+                    acc_period = 0;
                 }
 
                 acc += a.freq;
+                acc_period += a.period;
             }
             total_samples.push_back(acc);
+            total_periods.push_back(acc_period);
+
+            // In frequency mode (-F) samples are taken with different intervals, so overhead
+            // is a share of sampled events (sum of sample periods) and not a share of samples.
+            auto overhead = [&](uint64_t freq, uint64_t period, int32_t group) -> double {
+                if (request.sample_frequency && total_periods[group])
+                    return (double)period * 100 / (double)total_periods[group];
+                return (double)freq * 100 / (double)total_samples[group];
+            };
 
             int32_t group_idx = -1;
             prev_evt_src = CYCLE_EVT_IDX - 1;
-            uint64_t printed_sample_num = 0, printed_sample_freq = 0;
+            uint64_t printed_sample_num = 0, printed_sample_freq = 0, printed_sample_period = 0;
             std::vector<std::wstring> col_symbol;
             std::vector<double> col_overhead;
             std::vector<uint32_t> col_count;
@@ -1004,6 +1230,9 @@ wmain(
                 std::variant<TableOutput<SamplingAnnotateOutputTraitsL<false>, GlobalCharType>,
                              TableOutput<SamplingAnnotateOutputTraitsL<true>, GlobalCharType>>>> annotateTables;
             std::vector<uint64_t> col_pcs, col_pcs_count;
+            DisassemblyCache dasm_cache;
+            std::map<std::wstring, std::wstring> dasm_cache_files;  // [target] -> on-disk cache file name
+            PdbLineReader line_reader;                              // Line tables are read only for hot functions
             for (auto &a : resolved_samples)
             {
                 if (a.event_src != prev_evt_src)
@@ -1039,7 +1268,7 @@ wmain(
                     {
                         const int total_width = PrettyTable<wchar_t>::m_LEFT_MARGIN + PrettyTable<wchar_t>::m_COLUMN_SEPARATOR + static_cast<int>(strlen("overhead"));
                         m_out.GetOutputStream()
-                            << DoubleToWideStringExt((double)printed_sample_freq * 100 / (double)total_samples[group_idx], 2, total_width) << L"%"
+                            << DoubleToWideStringExt(overhead(printed_sample_freq, printed_sample_period, group_idx), 2, total_width) << L"%"
                             << IntToDecWideString(printed_sample_freq, 6)
                             << std::wstring(PrettyTable<wchar_t>::m_COLUMN_SEPARATOR, L' ') << L"top " << std::dec << printed_sample_num << L" in total" << std::endl;
                         m_out.GetOutputStream() << std::endl;
@@ -1056,6 +1285,7 @@ wmain(
 
                     printed_sample_num = 0;
                     printed_sample_freq = 0;
+                    printed_sample_period = 0;
                     group_idx++;
                 }
 
@@ -1063,7 +1293,7 @@ wmain(
                 {
                     const int total_width = PrettyTable<wchar_t>::m_LEFT_MARGIN + PrettyTable<wchar_t>::m_COLUMN_SEPARATOR + static_cast<int>(strlen("overhead"));
                     m_out.GetOutputStream()
-                        << DoubleToWideStringExt((double)printed_sample_freq * 100 / (double)total_samples[group_idx], 2, total_width) << L"%"
+                        << DoubleToWideStringExt(overhead(printed_sample_freq, printed_sample_period, group_idx), 2, total_width) << L"%"
                         << IntToDecWideString(printed_sample_freq, 6)
                         << std::wstring(PrettyTable<wchar_t>::m_COLUMN_SEPARATOR, L' ') << L"top " << std::dec << request.sample_display_row << L" in total" << std::endl;
                     printed_sample_num++;
@@ -1075,7 +1305,7 @@ wmain(
 
                 if ( !request.do_symbol || request.check_symbol_arg(a.desc.sname, request.symbol_arg))
                 {
-                    col_overhead.push_back(((double)a.freq * 100 / (double)total_samples[group_idx]));// +L"%");
+                    col_overhead.push_back(overhead(a.freq, a.period, group_idx));
                     col_count.push_back(a.freq);
                     col_symbol.push_back(a.desc.name);
                 }
@@ -1104,7 +1334,7 @@ wmain(
                             UINT64 mod_vaddr_delta = (UINT64)a.module->handle;
                             addr = (sample.first - mod_vaddr_delta) & 0xFFFFFF;
                         }
-                        perfDataWriter.RegisterEvent(PerfDataWriter::SAMPLE, pid, sample.first, request.cores_idx[0], a.event_src);
+                        perfDataWriter.RegisterEvent(PerfDataWriter::SAMPLE, pid, sample.first, request.cores_idx[0], a.event_src, pc_time[sample.first]);
                     }
                 }
 
@@ -1112,12 +1342,13 @@ wmain(
                 {
 
                     std::map <MapKey, uint64_t, decltype(MapComp)> hotspots(MapComp);
-                    std::map <std::tuple<uint64_t, uint64_t>, std::tuple<std::vector<std::wstring>, std::vector<std::wstring>>> disassemble_map;
                     std::vector<std::wstring> col_source_file, col_inst_addr;
                     std::vector< TableOutput<DisassemblyOutputTraitsL, GlobalCharType>> col_dasm;
                     std::vector<uint64_t> col_line_number, col_hits;
                     if(a.desc.name != L"unknown")
                     {
+                        line_reader.ReadLines(a.module == NULL ? request.sample_pdb_file : gen_pdb_name(a.module->mod_path), a.desc);
+
                         m_out.GetOutputStream() << a.desc.name << std::endl;
                         for (const auto& sample : a.pc)
                         {
@@ -1144,30 +1375,43 @@ wmain(
                                     if(request.do_disassembly)
                                     {
                                         std::wstringstream addr_stream;
-                                        std::vector<DisassembledInstruction> lineAsm{ 0 };
                                         uint64_t base = a.module == NULL ? image_base : a.module->mod_baseOfDll;
                                         std::wstring& target = a.module == NULL ? request.sample_pe_file : a.module->mod_path;
                                         addr_stream << std::hex << addr;
 
-                                        if (disassemble_map.find(std::make_tuple(line.virtualAddress, base)) == disassemble_map.end())
+                                        const DWORD_PTR line_from = line.virtualAddress;
+                                        const DWORD_PTR line_to = line.virtualAddress + line.length;
+
+                                        if (request.disassembly_cache_dir.size() && dasm_cache_files.count(target) == 0)
                                         {
-                                            disassembler.Disassemble(line.virtualAddress + base, line.virtualAddress + line.length + base, target);
-                                            disassembler.ParseOutput(lineAsm);
+                                            dasm_cache_files[target] = DisassemblyCache::GenFilename(request.disassembly_cache_dir, target, request.disassembler);
+                                            dasm_cache.Load(dasm_cache_files[target], target);
+                                        }
 
-                                            for (const auto& inst : lineAsm)
+                                        if (!dasm_cache.Has(target, line_from, line_to))
+                                        {
+                                            // Disassemble whole function once, other hot lines of this function
+                                            // will be served from the cache.
+                                            DWORD_PTR func_from = line_from, func_to = line_to;
+                                            for (const auto& l : a.desc.lines)
                                             {
-                                                std::wstringstream to_hex;
-                                                to_hex << std::hex << inst.m_address;
-
-                                                col_dasm_instr.push_back(inst.m_asm);
-                                                col_dasm_addr.push_back(to_hex.str());
+                                                func_from = min(func_from, static_cast<DWORD_PTR>(l.virtualAddress));
+                                                func_to = max(func_to, static_cast<DWORD_PTR>(l.virtualAddress + l.length));
                                             }
 
-                                            disassemble_map[std::make_tuple(line.virtualAddress, base)] = std::make_tuple(col_dasm_addr, col_dasm_instr);//dasm_str;
-                                        } else {
-                                            auto& elem = disassemble_map[std::make_tuple(line.virtualAddress, base)];
-                                            col_dasm_addr = std::get<0>(elem);
-                                            col_dasm_instr = std::get<1>(elem);
+                                            std::vector<DisassembledInstruction> funcAsm;
+                                            disassembler->Disassemble(func_from + base, func_to + base, target);
+                                            disassembler->ParseOutput(funcAsm);
+                                            dasm_cache.Insert(target, func_from, func_to, funcAsm);
+                                        }
+
+                                        for (const auto& inst : dasm_cache.Get(target, line_from, line_to))
+                                        {
+                                            std::wstringstream to_hex;
+                                            to_hex << std::hex << inst.m_address;
+
+                                            col_dasm_instr.push_back(inst.m_asm);
+                                            col_dasm_addr.push_back(to_hex.str());
                                         }
 
                                         hex_ip = addr_stream.str();
@@ -1177,7 +1421,7 @@ wmain(
                                     std::wstringstream str_addr;
                                     str_addr << std::hex << addr;
 
-                                    MapKey cur = std::make_tuple(line.source_file, line.lineNum, dasmTable, hex_ip);
+                                    MapKey cur = std::make_tuple(*line.source_file, line.lineNum, dasmTable, hex_ip);
 
                                     if (auto el = hotspots.find(cur); el == hotspots.end())
                                     {
@@ -1242,12 +1486,35 @@ wmain(
                 }
 
                 printed_sample_freq += a.freq;
+                printed_sample_period += a.period;
                 printed_sample_num++;
             }
             
             if (request.do_export_perf_data)
                 perfDataWriter.Write();
 
+            for (const auto& [target, filename] : dasm_cache_files)
+                if (dasm_cache.IsModified(target) && !dasm_cache.Save(filename, target))
+                    m_out.GetErrorOutputStream() << L"warning: can't store disassembly cache file '" << filename << L"'" << std::endl;
+
+            if (request.do_export_folded)
+            {
+                std::wstring prefix = std::filesystem::path(request.sample_image_name).stem();
+                if (request.m_cwd.size())
+                    prefix = GetFullFilePath(request.m_cwd, prefix);
+
+                for (const auto event_src : folded_stacks.get_event_sources())
+                {
+                    std::wstring event_name = request.m_sampling_with_spe ? spe_event_map[event_src]
+                        : std::wstring(pmu_events::get_event_name(static_cast<uint16_t>(event_src)));
+                    std::wstring filename = FoldedStacks::gen_filename(prefix, event_name);
+
+                    folded_stacks.write(filename, event_src);
+                    m_out.GetOutputStream() << L"folded stacks for '" << event_name << L"' written to "
+                        << filename << std::endl;
+                }
+            }
+
             TableOutput<SamplingOutputTraitsL, GlobalCharType> table(m_outputType);
             table.PresetHeaders();
             table.SetAlignment(0, ColumnAlignL::RIGHT);
@@ -1267,19 +1534,11 @@ wmain(
             m_globalSamplingJSON.m_map[table.m_event] = std::make_tuple(table, annotateTables,pcs_table);
             m_globalSamplingJSON.m_sample_display_row = request.sample_display_row;
 
-            if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-            {
-                if (request.m_sampling_with_spe)
-                    m_out.Print(m_globalSamplingJSON, m_globalJSON);
-                else
-                    m_out.Print(m_globalSamplingJSON);
-            }
-
             if (printed_sample_num > 0 && printed_sample_num < request.sample_display_row)
             {
                 const int total_width = PrettyTable<wchar_t>::m_LEFT_MARGIN + PrettyTable<wchar_t>::m_COLUMN_SEPARATOR + static_cast<int>(strlen("overhead"));
                 m_out.GetOutputStream()
-                    << DoubleToWideStringExt((double)printed_sample_freq * 100 / (double)total_samples[group_idx], 2, total_width) << L"%"
+                    << DoubleToWideStringExt(overhead(printed_sample_freq, printed_sample_period, group_idx), 2, total_width) << L"%"
                     << IntToDecWideString(printed_sample_freq, 6)
                     << std::wstring(PrettyTable<wchar_t>::m_COLUMN_SEPARATOR, L' ') <<  L"top " << std::dec << printed_sample_num << L" in total" << std::endl;
             }
@@ -1287,6 +1546,18 @@ wmain(
             const double  duration = timestamps_to_duration(timestamp_a, timestamp_b);
             m_globalJSON.m_duration = duration;
 
+            const auto post_processing_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - post_processing_start).count();
+            pmu_device.print_overhead(duration, static_cast<uint64_t>(post_processing_ns), true);
+
+            if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
+            {
+                if (request.m_sampling_with_spe)
+                    m_out.Print(m_globalSamplingJSON, m_globalJSON);
+                else
+                    m_out.Print(m_globalSamplingJSON);
+            }
+
             if (!request.do_timeline)
             {
                 m_out.GetOutputStream() << std::endl;
@@ -1327,6 +1598,7 @@ clean_exit:
         CloseHandle(pi.hThread);
         CloseHandle(process_handle);
     }
-    disassembler.Close();
+    if (disassembler)
+        disassembler->Close();
     return exit_code;
 }
@@ -143,3 +143,66 @@ double metric_calculate_shunting_yard_expression(const std::map<std::wstring, do
 
     return stack.top();
 }
+
+/// <summary>
+/// Calculate SY formula for LANES sets of variables at once (e.g. one per core),
+/// VARS maps variable name to its LANES values. Formula is tokenized once and
+/// every operator is applied to whole lanes, so loops below vectorize.
+/// Same as scalar version lanes which divide by zero evaluate to 0.
+/// </summary>
+std::vector<double> metric_calculate_shunting_yard_expression(const std::map<std::wstring, std::vector<double>>& vars,
+    const std::wstring& formula_sy, size_t lanes)
+{
+    std::wstring token;
+    std::wistringstream ss(formula_sy);
+
+    std::stack<std::vector<double>> stack;
+    std::vector<uint8_t> div_zero(lanes, 0);
+
+    while (std::getline(ss, token, L' '))
+    {
+        if (metris_token_is_operator(token))
+        {
+            std::vector<double> y = std::move(stack.top()); stack.pop();
+            std::vector<double>& x = stack.top();  // x OP y, result in x
+
+            switch (token[0])
+            {
+            case L'*':
+                for (size_t i = 0; i < lanes; i++)
+                    x[i] *= y[i];
+                break;
+            case L'/':
+                for (size_t i = 0; i < lanes; i++)
+                {
+                    div_zero[i] |= y[i] == 0;
+                    x[i] = y[i] == 0 ? 0 : x[i] / y[i];
+                }
+                break;
+            case L'+':
+                for (size_t i = 0; i < lanes; i++)
+                    x[i] += y[i];
+                break;
+            case L'-':
+                for (size_t i = 0; i < lanes; i++)
+                    x[i] -= y[i];
+                break;
+            }
+        }
+        else
+        {
+            auto it = vars.find(token);
+            if (it != vars.end() && it->second.size() == lanes)
+                stack.push(it->second);
+            else
+                stack.push(std::vector<double>(lanes, _wtof(token.c_str())));
+        }
+    }
+
+    std::vector<double> result = stack.size() ? stack.top() : std::vector<double>(lanes, 0);
+    for (size_t i = 0; i < lanes; i++)
+        if (div_zero[i])
+            result[i] = 0;
+
+    return result;
+}
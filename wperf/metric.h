@@ -58,3 +58,5 @@ std::wstring metric_gen_metric_based_on_gpc_num(std::wstring name, uint8_t gpc_n
 // Shunting Yard Algorithm calculation
 bool metris_token_is_operator(const std::wstring op);
 double metric_calculate_shunting_yard_expression(const std::map<std::wstring, double>& vars, const std::wstring& formula_sy);
+std::vector<double> metric_calculate_shunting_yard_expression(const std::map<std::wstring, std::vector<double>>& vars,
+    const std::wstring& formula_sy, size_t lanes);
@@ -0,0 +1,103 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include "module_map.h"
+
+/// <summary>
+/// Merge SNAPSHOT of modules taken at TIME into the map. Modules from the
+/// very first snapshot are considered loaded since time 0, as we do not know
+/// when exactly they were loaded. Modules loaded before which are not present
+/// in SNAPSHOT are marked as unloaded at TIME.
+/// Returns indexes (see GetEntries()) of modules which are new in SNAPSHOT.
+/// </summary>
+std::vector<size_t> ModuleMap::Update(uint64_t time, const std::vector<ModuleMapEntry>& snapshot)
+{
+    std::vector<size_t> added;
+    std::vector<bool> seen(m_entries.size(), false);
+    const uint64_t load_time = m_has_snapshot ? time : 0;
+
+    for (const auto& mod : snapshot)
+    {
+        bool found = false;
+        for (size_t i = 0; i < m_entries.size(); i++)
+        {
+            const ModuleMapEntry& e = m_entries[i];
+            if (e.unload_time == m_LOADED && e.base == mod.base && e.size == mod.size && e.path == mod.path)
+            {
+                seen[i] = true;
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            ModuleMapEntry e = mod;
+            e.load_time = load_time;
+            e.unload_time = m_LOADED;
+            added.push_back(m_entries.size());
+            m_entries.push_back(e);
+        }
+    }
+
+    for (size_t i = 0; i < seen.size(); i++)
+    {
+        if (!seen[i] && m_entries[i].unload_time == m_LOADED)
+            m_entries[i].unload_time = time;
+    }
+
+    m_has_snapshot = true;
+    return added;
+}
+
+/// <summary>
+/// Find module which contains ADDR and was loaded at some point of time
+/// interval (BEGIN, END]. If more modules match (module was replaced within
+/// the interval) the most recently loaded one is returned.
+/// </summary>
+const ModuleMapEntry* ModuleMap::Find(uint64_t addr, uint64_t begin, uint64_t end) const
+{
+    const ModuleMapEntry* found = nullptr;
+
+    for (const auto& e : m_entries)
+    {
+        if (addr < e.base || addr - e.base >= e.size)
+            continue;
+
+        if (e.load_time > end || e.unload_time <= begin)
+            continue;
+
+        if (!found || e.load_time >= found->load_time)
+            found = &e;
+    }
+    return found;
+}
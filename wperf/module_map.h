@@ -0,0 +1,68 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ModuleMapEntry
+{
+    std::wstring name;
+    std::wstring path;
+    uint64_t base{};
+    uint64_t size{};
+    uint64_t load_time{};       // Time of first snapshot module was seen in
+    uint64_t unload_time{};     // Time of first snapshot module was missing from, see ModuleMap::m_LOADED
+};
+
+/// <summary>
+/// Time versioned map of modules loaded into a process. Map is built from
+/// periodic snapshots of the process module list. Each module (path loaded
+/// at base address) gets a lifetime [load_time, unload_time) so addresses
+/// sampled at a given time are resolved against the modules which were
+/// loaded at that time, also when a module is unloaded and another (or the
+/// same) module is loaded at its address later.
+/// </summary>
+class ModuleMap
+{
+public:
+    std::vector<size_t> Update(uint64_t time, const std::vector<ModuleMapEntry>& snapshot);
+    const ModuleMapEntry* Find(uint64_t addr, uint64_t begin, uint64_t end) const;
+    const std::vector<ModuleMapEntry>& GetEntries() const { return m_entries; }
+
+    static constexpr uint64_t m_LOADED = UINT64_MAX;
+
+private:
+    std::vector<ModuleMapEntry> m_entries;
+    bool m_has_snapshot = false;
+};
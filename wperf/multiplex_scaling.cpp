@@ -0,0 +1,77 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+
+#include "multiplex_scaling.h"
+
+uint64_t MultiplexScaling::ScaledValue(uint64_t value, uint64_t time_enabled, uint64_t time_running)
+{
+    if (time_running == 0)
+        return 0;
+
+    if (time_running >= time_enabled)
+        return value;
+
+    return static_cast<uint64_t>(static_cast<double>(value) * (static_cast<double>(time_enabled) / static_cast<double>(time_running)));
+}
+
+/// <summary>
+/// Relative standard error (in %) of ScaledValue(). Event which was counting
+/// all the time it was enabled is not scaled so there is no error. With less
+/// than two slices variance can't be estimated and m_UNKNOWN_ERROR is returned.
+/// </summary>
+double MultiplexScaling::ScalingError(uint64_t value, uint64_t time_enabled, uint64_t time_running,
+                                      uint64_t slices, uint64_t slice_sq_lo, uint64_t slice_sq_hi)
+{
+    if (time_running >= time_enabled)
+        return 0.0;
+
+    if (time_running == 0 || slices < 2)
+        return m_UNKNOWN_ERROR;
+
+    if (value == 0)
+        return 0.0;
+
+    const double k = static_cast<double>(slices);
+    const double n = k * static_cast<double>(time_enabled) / static_cast<double>(time_running);
+    const double sum = static_cast<double>(value);
+    const double sum_sq = std::ldexp(static_cast<double>(slice_sq_hi), 64) + static_cast<double>(slice_sq_lo);
+
+    // Sample variance of per-slice counts, rounding may make it slightly negative.
+    const double variance = std::max((sum_sq - sum * sum / k) / (k - 1.0), 0.0);
+
+    // Standard error of N * mean with finite population correction.
+    const double std_error = n * std::sqrt(variance / k * std::max(1.0 - k / n, 0.0));
+    const double scaled = sum * n / k;
+
+    return 100.0 * std_error / scaled;
+}
@@ -0,0 +1,54 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+
+/// <summary>
+/// Scaling of counts of multiplexed events. Driver accounts for every event
+/// cycles it was enabled (TIME_ENABLED) and cycles it was actually counting on
+/// a hardware counter (TIME_RUNNING), like Linux perf does. Count is scaled by
+/// TIME_ENABLED / TIME_RUNNING.
+///
+/// Scaling error is an estimate of relative standard error of scaled count.
+/// Each of SLICES multiplexing slices in which event was counting is treated
+/// as a sample (without replacement) of all slices event was enabled in.
+/// Variance of per-slice counts comes from the sum of their squares which is
+/// accumulated by the driver in 128 bits (SLICE_SQ_HI:SLICE_SQ_LO).
+/// </summary>
+class MultiplexScaling
+{
+public:
+    static uint64_t ScaledValue(uint64_t value, uint64_t time_enabled, uint64_t time_running);
+    static double ScalingError(uint64_t value, uint64_t time_enabled, uint64_t time_running,
+                               uint64_t slices, uint64_t slice_sq_lo, uint64_t slice_sq_hi);
+
+    static constexpr double m_UNKNOWN_ERROR = 100.0;    // Error (in %) reported when there is not enough data to estimate it
+};
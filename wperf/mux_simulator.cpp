@@ -0,0 +1,98 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <memory>
+
+#include "wperf-common/base_types.h"
+#include "wperf-common/mux_scheduler.h"
+#include "mux_simulator.h"
+
+void MuxSimulator::AddEvent(uint8_t weight)
+{
+    m_groups.push_back(0);
+    m_weights.push_back(weight);
+}
+
+void MuxSimulator::AddGroup(uint8_t size, uint8_t weight)
+{
+    m_last_group = m_last_group == UINT8_MAX ? 1 : m_last_group + 1;
+    for (uint8_t i = 0; i < size; i++)
+    {
+        m_groups.push_back(m_last_group);
+        m_weights.push_back(i == 0 ? weight : 0);
+    }
+}
+
+/// <summary>
+/// Schedule ROUNDS rounds and collect per event coverage in RESULT.
+/// </summary>
+/// <returns>FALSE if scheduler rejected event list (e.g. group does not fit in counters)</returns>
+bool MuxSimulator::Run(uint64_t rounds, MuxSimulationResult& result) const
+{
+    auto s = std::make_unique<MuxScheduler>();
+    const uint32_t events_num = static_cast<uint32_t>(m_groups.size());
+
+    if (!mux_init(s.get(), events_num, m_groups.data(), m_weights.data(), m_counters))
+        return false;
+
+    result = MuxSimulationResult();
+    result.scheduled.resize(events_num);
+
+    for (uint64_t round = 0; round < rounds; round++)
+    {
+        result.programmed += mux_schedule(s.get());
+        result.rounds++;
+
+        std::vector<bool> counter_used(m_counters);
+        for (uint32_t e = 0; e < events_num; e++)
+        {
+            const uint8_t counter = s->event_counter[e];
+            if (counter == MUX_NO_COUNTER)
+                continue;
+
+            if (counter >= m_counters || counter_used[counter])
+                result.counters_exclusive = false;
+            else
+                counter_used[counter] = true;
+
+            result.scheduled[e]++;
+        }
+
+        for (uint32_t e = 1; e < events_num; e++)
+        {
+            const bool e_scheduled = s->event_counter[e] != MUX_NO_COUNTER;
+            const bool prev_scheduled = s->event_counter[e - 1] != MUX_NO_COUNTER;
+            if (m_groups[e] && m_groups[e] == m_groups[e - 1] && e_scheduled != prev_scheduled)
+                result.groups_coscheduled = false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <vector>
+
+struct MuxSimulationResult
+{
+    uint64_t rounds{};
+    uint64_t programmed{};                  // Counters programmed with new event, first round included
+    std::vector<uint64_t> scheduled;        // [event] -> number of rounds event was counting
+    bool groups_coscheduled = true;         // Events of each group were always scheduled together
+    bool counters_exclusive = true;         // No counter was given to two events in the same round
+};
+
+/// <summary>
+/// User space model of core event multiplexing done by the driver (see
+/// wperf-common/mux_scheduler.h, the same code runs here and in the DPC).
+/// Events and groups are added in the order they are sent to the driver,
+/// Run() schedules given number of rounds and checks every round that
+/// groups are scheduled as a whole and counters are not shared.
+/// </summary>
+class MuxSimulator
+{
+public:
+    MuxSimulator(uint32_t counters) : m_counters(counters) {}
+
+    void AddEvent(uint8_t weight = 1);
+    void AddGroup(uint8_t size, uint8_t weight = 1);
+    bool Run(uint64_t rounds, MuxSimulationResult& result) const;
+    size_t GetEventsNum() const { return m_groups.size(); }
+
+private:
+    std::vector<uint8_t> m_groups;          // [event] -> unit id (0 - not grouped), as in pmu_ctl_evt_assign_hdr
+    std::vector<uint8_t> m_weights;         // [event] -> weight of unit starting with event
+    uint32_t m_counters;
+    uint8_t m_last_group = 0;
+};
@@ -29,9 +29,11 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <fstream>
 #include <variant>
 #include "prettytable.h"
 #include "json.h"
+#include "json_writer.h"
 
 template <typename PresetTable, typename CharType>
 class TableOutput;
@@ -95,19 +97,23 @@ struct GroupsOfMetricOutputTraits : public TableOutputTraits<CharType>
     inline const static CharType* key = LITERALCONSTANTS_GET("Predefined Groups of Metrics");
 };
 
-template <typename CharType, bool isMultiplexed = true>
+// `scaling error` is relative standard error of `scaled value` in percent. It is only
+// available where driver accounts multiplexing time in cycles (core PMU).
+template <typename CharType, bool isMultiplexed = true, bool hasScalingError = false>
 struct PerformanceCounterOutputTraits : public TableOutputTraits<CharType>
 {
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
-    inline const static std::tuple<uint64_t, StringType, StringType, StringType, StringType, uint64_t> columns;
-    inline const static int size = std::conditional_t<isMultiplexed, Integer<6>, Integer<4>>::value;
-    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+    inline const static std::tuple<uint64_t, StringType, StringType, StringType, StringType, uint64_t, double> columns;
+    inline const static int size = std::conditional_t<isMultiplexed,
+        std::conditional_t<hasScalingError, Integer<7>, Integer<6>>, Integer<4>>::value;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
         std::make_tuple(LITERALCONSTANTS_GET("counter value"),
             LITERALCONSTANTS_GET("event name"),
             LITERALCONSTANTS_GET("event idx"),
             LITERALCONSTANTS_GET("event note"),
             LITERALCONSTANTS_GET("multiplexed"),
-            LITERALCONSTANTS_GET("scaled value"));
+            LITERALCONSTANTS_GET("scaled value"),
+            LITERALCONSTANTS_GET("scaling error"));
     inline const static CharType* key = LITERALCONSTANTS_GET("Performance counter");
 };
 
@@ -183,6 +189,98 @@ struct DDRMetricOutputTraits : public TableOutputTraits<CharType>
     inline const static CharType* key = LITERALCONSTANTS_GET("DDR Metrics");
 };
 
+// Summary of continuous DDR bandwidth monitor (`--ddr-monitor`), bandwidth in MB/s.
+// `share` is percent of all DDR traffic which went through the channel.
+template <typename CharType>
+struct DdrMonitorOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<StringType, uint64_t, double, double, double, double, double, double> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("channel"),
+            LITERALCONSTANTS_GET("samples"),
+            LITERALCONSTANTS_GET("avg"),
+            LITERALCONSTANTS_GET("p50"),
+            LITERALCONSTANTS_GET("p90"),
+            LITERALCONSTANTS_GET("p99"),
+            LITERALCONSTANTS_GET("max"),
+            LITERALCONSTANTS_GET("share"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("DDR Bandwidth Monitor");
+};
+
+// Channel imbalance of DDR bandwidth monitor: busiest channel / mean channel bandwidth.
+template <typename CharType>
+struct DdrImbalanceOutputTraits : public TableOutputTraits<CharType>
+{
+    inline const static std::tuple<uint64_t, double, double, double, double, double> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("samples"),
+            LITERALCONSTANTS_GET("avg"),
+            LITERALCONSTANTS_GET("p50"),
+            LITERALCONSTANTS_GET("p90"),
+            LITERALCONSTANTS_GET("p99"),
+            LITERALCONSTANTS_GET("max"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("DDR Channel Imbalance");
+};
+
+// Per core heatmap (`--heatmap`) summary: distribution across cores of metric
+// value averaged over all intervals. `core` is the core with highest average.
+template <typename CharType>
+struct HeatmapOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<StringType, uint64_t, double, double, double, double, StringType> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("metric"),
+            LITERALCONSTANTS_GET("intervals"),
+            LITERALCONSTANTS_GET("min"),
+            LITERALCONSTANTS_GET("median"),
+            LITERALCONSTANTS_GET("p99"),
+            LITERALCONSTANTS_GET("max"),
+            LITERALCONSTANTS_GET("core"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("Core Heatmap");
+};
+
+// Arm Topdown tree (`--topdown`), one row per metric. Stage 2 rows follow
+// their stage 1 `parent` metric.
+template <typename CharType>
+struct TopdownOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<uint64_t, StringType, StringType, StringType, double, StringType> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("stage"),
+            LITERALCONSTANTS_GET("parent"),
+            LITERALCONSTANTS_GET("group"),
+            LITERALCONSTANTS_GET("metric"),
+            LITERALCONSTANTS_GET("value"),
+            LITERALCONSTANTS_GET("unit"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("Topdown");
+};
+
+// Self-overhead of driver code paths and wperf itself, see PMU_CTL_QUERY_OVERHEAD.
+// `overhead` is time spent in the path in percent of time elapsed.
+template <typename CharType>
+struct OverheadOutputTraits : public TableOutputTraits<CharType>
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+    inline const static std::tuple<StringType, StringType, uint64_t, uint64_t, uint64_t, uint64_t, double> columns;
+    inline const static std::tuple<CharType*, CharType*, CharType*, CharType*, CharType*, CharType*, CharType*> headers =
+        std::make_tuple(LITERALCONSTANTS_GET("path"),
+            LITERALCONSTANTS_GET("core"),
+            LITERALCONSTANTS_GET("calls"),
+            LITERALCONSTANTS_GET("total ns"),
+            LITERALCONSTANTS_GET("avg ns"),
+            LITERALCONSTANTS_GET("max ns"),
+            LITERALCONSTANTS_GET("overhead"));
+    inline const static int size = std::tuple_size_v<decltype(headers)>;
+    inline const static CharType* key = LITERALCONSTANTS_GET("Profiler Overhead");
+};
+
 template <typename CharType>
 struct TestOutputTraits : public TableOutputTraits<CharType>
 {
@@ -464,6 +562,7 @@ struct WPerfStatJSON
 {
     using PerformanceCounterOutputTraitsTO = TableOutput<PerformanceCounterOutputTraits<CharType, false>, CharType>;
     using MultiplexingPerformanceCounterOutputTraitsTO = TableOutput<PerformanceCounterOutputTraits<CharType, true>, CharType>;
+    using ScaledPerformanceCounterOutputTraitsTO = TableOutput<PerformanceCounterOutputTraits<CharType, true, true>, CharType>;
 
     using SystemwidePerformanceCounterOutputTraitsTO = TableOutput<SystemwidePerformanceCounterOutputTraits<CharType, false>, CharType>;
     using MultiplexedSystemwidePerformanceCounterOutputTraitsTO = TableOutput<SystemwidePerformanceCounterOutputTraits<CharType, true>, CharType>;
@@ -471,21 +570,28 @@ struct WPerfStatJSON
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ostream, std::wostream> OutputStream;
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::stringstream, std::wstringstream> StringStream;
 
-    std::vector<std::variant<PerformanceCounterOutputTraitsTO, MultiplexingPerformanceCounterOutputTraitsTO>> m_corePerformanceTables;
+    std::vector<std::variant<PerformanceCounterOutputTraitsTO, MultiplexingPerformanceCounterOutputTraitsTO, ScaledPerformanceCounterOutputTraitsTO>> m_corePerformanceTables;
     std::vector<std::variant<PerformanceCounterOutputTraitsTO, MultiplexingPerformanceCounterOutputTraitsTO>> m_DSUPerformanceTables;
     std::variant<SystemwidePerformanceCounterOutputTraitsTO, MultiplexedSystemwidePerformanceCounterOutputTraitsTO> m_coreOverall, m_DSUOverall;
     TableOutput<L3CacheMetricOutputTraits<CharType>, CharType> m_DSUL3metric;
     TableOutput<TelemetrySolutionMetricOutputTraits<CharType>, CharType> m_TSmetric;
     TableOutput<PMUPerformanceCounterOutputTraits<CharType>, CharType> m_pmu;
     TableOutput<DDRMetricOutputTraits<CharType>, CharType> m_DMCDDDR;
+    TableOutput<OverheadOutputTraits<CharType>, CharType> m_overhead;
+    bool m_hasOverhead = false;         // `m_overhead` is printed only when it was collected
+    TableOutput<DdrMonitorOutputTraits<CharType>, CharType> m_ddrMonitor;
+    TableOutput<DdrImbalanceOutputTraits<CharType>, CharType> m_ddrImbalance;
+    bool m_hasDdrMonitor = false;       // `m_ddrMonitor` and `m_ddrImbalance` are printed only with `--ddr-monitor`
+    TableOutput<HeatmapOutputTraits<CharType>, CharType> m_heatmap;
+    bool m_hasHeatmap = false;          // `m_heatmap` is printed only with `--heatmap`
+    TableOutput<TopdownOutputTraits<CharType>, CharType> m_topdown;
+    bool m_hasTopdown = false;          // `m_topdown` is printed only with `--topdown`
     bool m_multiplexing = false;
     bool m_kernel = false;
     double m_duration = 0.f;
 
-    StringStream Print()
+    void Print(OutputStream& os)
     {
-        StringStream os;
-        enum TableType jsonType = TableType::JSON;
         os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
         {
             os << LITERALCONSTANTS_GET("\"core\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
@@ -513,20 +619,20 @@ struct WPerfStatJSON
                 else {
                     isFirst = false;
                 }
-                std::visit([&os, &jsonType](auto&& arg) {
+                std::visit([&os](auto&& arg) {
                     arg.m_tableJSON.m_isEmbedded = true;
                     os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
                     os << LiteralConstants<CharType>::m_quotes << LITERALCONSTANTS_GET("core_number") <<  LiteralConstants<CharType>::m_quotes << LiteralConstants<CharType>::m_colon << arg.m_core;
-                    os << LiteralConstants<CharType>::m_comma << arg.Print(jsonType).str() << std::endl;
+                    os << LiteralConstants<CharType>::m_comma << arg << std::endl;
                     os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
                 }, table);                
             }
             os << LiteralConstants<CharType>::m_bracket_close << std::endl;
             os << LiteralConstants<CharType>::m_comma << std::endl;
 
-            std::visit([&os, &jsonType](auto&& arg) { os << LITERALCONSTANTS_GET("\"overall\": ") << arg.Print(jsonType).str() << std::endl; }, m_coreOverall);
+            std::visit([&os](auto&& arg) { os << LITERALCONSTANTS_GET("\"overall\": ") << arg << std::endl; }, m_coreOverall);
             os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"ts_metric\": ") << m_TSmetric.Print(jsonType).str() << std::endl;
+            os << LITERALCONSTANTS_GET("\"ts_metric\": ") << m_TSmetric << std::endl;
             os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
         }
         os << LiteralConstants<CharType>::m_comma << std::endl;
@@ -542,28 +648,40 @@ struct WPerfStatJSON
                 else {
                     isFirst = false;
                 }
-                std::visit([&os, &jsonType](auto&& arg) {
-                    os << LiteralConstants<CharType>::m_quotes << arg.m_core << LiteralConstants<CharType>::m_quotes;
-                    os << LiteralConstants<CharType>::m_colon << arg.Print(jsonType).str() << std::endl;
+                std::visit([&os](auto&& arg) {
+                    os << LiteralConstants<CharType>::m_quotes;
+                    JSONEscape(os, arg.m_core);
+                    os << LiteralConstants<CharType>::m_quotes;
+                    os << LiteralConstants<CharType>::m_colon << arg << std::endl;
                 }, table);
             }
             if (!m_DSUPerformanceTables.empty())
                 os << LiteralConstants<CharType>::m_comma << std::endl;
 
-            os << LITERALCONSTANTS_GET("\"l3metric\": ") << m_DSUL3metric.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
-            std::visit([&os, &jsonType](auto&& arg) { os << LITERALCONSTANTS_GET("\"overall\": ") << arg.Print(jsonType).str() << std::endl; }, m_DSUOverall);
+            os << LITERALCONSTANTS_GET("\"l3metric\": ") << m_DSUL3metric << LiteralConstants<CharType>::m_comma << std::endl;
+            std::visit([&os](auto&& arg) { os << LITERALCONSTANTS_GET("\"overall\": ") << arg << std::endl; }, m_DSUOverall);
             os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
         }
         os << LiteralConstants<CharType>::m_comma << std::endl;
         {
             os << LITERALCONSTANTS_GET("\"dmc\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-            os << LITERALCONSTANTS_GET("\"pmu\": ") << m_pmu.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"ddr\": ") << m_DMCDDDR.Print(jsonType).str() << std::endl;
+            os << LITERALCONSTANTS_GET("\"pmu\": ") << m_pmu << LiteralConstants<CharType>::m_comma << std::endl;
+            os << LITERALCONSTANTS_GET("\"ddr\": ") << m_DMCDDDR << std::endl;
+            if (m_hasDdrMonitor)
+            {
+                os << LiteralConstants<CharType>::m_comma << LITERALCONSTANTS_GET("\"monitor\": ") << m_ddrMonitor << std::endl;
+                os << LiteralConstants<CharType>::m_comma << LITERALCONSTANTS_GET("\"imbalance\": ") << m_ddrImbalance << std::endl;
+            }
             os << LiteralConstants<CharType>::m_cbracket_close << LiteralConstants<CharType>::m_comma << std::endl;
         }
+        if (m_hasTopdown)
+            os << LITERALCONSTANTS_GET("\"topdown\": ") << m_topdown << LiteralConstants<CharType>::m_comma << std::endl;
+        if (m_hasHeatmap)
+            os << LITERALCONSTANTS_GET("\"heatmap\": ") << m_heatmap << LiteralConstants<CharType>::m_comma << std::endl;
+        if (m_hasOverhead)
+            os << LITERALCONSTANTS_GET("\"overhead\": ") << m_overhead << LiteralConstants<CharType>::m_comma << std::endl;
         os << LITERALCONSTANTS_GET("\"Time_elapsed\": ") << m_duration << std::endl;
         os << LiteralConstants<CharType>::m_cbracket_close;
-        return os;
     }
 };
 
@@ -587,11 +705,8 @@ struct WPerfListJSON
     std::variant<GroupsOfMetricOutputTraitsTO, VerboseGroupsOfMetricOutputTraitsTO> m_GroupsOfMetrics;
     bool isVerbose = false;
 
-    StringStream Print()
+    void Print(OutputStream& os)
     {
-        StringStream os;
-        enum TableType jsonType = TableType::JSON;
-
         std::visit([](auto&& arg) {
             arg.m_tableJSON.m_isEmbedded = true;
             }, m_Events);
@@ -606,20 +721,19 @@ struct WPerfListJSON
 
         os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
 
-        std::visit([&os, &jsonType](auto&& arg) {
-            os << arg.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
+        std::visit([&os](auto&& arg) {
+            os << arg << LiteralConstants<CharType>::m_comma << std::endl;
             }, m_Events);
 
-        std::visit([&os, &jsonType](auto&& arg) {
-            os << arg.Print(jsonType).str() << LiteralConstants<CharType>::m_comma << std::endl;
+        std::visit([&os](auto&& arg) {
+            os << arg << LiteralConstants<CharType>::m_comma << std::endl;
             }, m_Metrics);
 
-        std::visit([&os, &jsonType](auto&& arg) {
-            os << arg.Print(jsonType).str() << std::endl;
+        std::visit([&os](auto&& arg) {
+            os << arg << std::endl;
             }, m_GroupsOfMetrics);
 
         os << LiteralConstants<CharType>::m_cbracket_close;
-        return os;
     }
 };
 
@@ -641,6 +755,8 @@ struct WPerfSamplingJSON
     
     Modules m_modules_table;
     ModulesInfo m_modules_info_vector;
+    TableOutput<OverheadOutputTraits<CharType>, CharType> m_overhead;
+    bool m_hasOverhead = false;         // `m_overhead` is printed only when it was collected
 
     StringType m_pdb_file;
     StringType m_pe_file;
@@ -653,16 +769,18 @@ struct WPerfSamplingJSON
 
     bool m_verbose = false;
 
-    StringStream Print()
+    void Print(OutputStream& os)
     {
-        StringStream os{};
-        enum TableType jsonType = TableType::JSON;
         os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
         {
             os << LITERALCONSTANTS_GET("\"sampling\": ") << LiteralConstants<CharType>::m_cbracket_open << std::endl;
-            os << LITERALCONSTANTS_GET("\"pe_file\": ") << LiteralConstants<CharType>::m_quotes <<  m_pe_file << LiteralConstants<CharType>::m_quotes;
+            os << LITERALCONSTANTS_GET("\"pe_file\": ") << LiteralConstants<CharType>::m_quotes;
+            JSONEscape(os, m_pe_file);
+            os << LiteralConstants<CharType>::m_quotes;
             os << LiteralConstants<CharType>::m_comma << std::endl;
-            os << LITERALCONSTANTS_GET("\"pdb_file\": ") << LiteralConstants<CharType>::m_quotes << m_pdb_file << LiteralConstants<CharType>::m_quotes;
+            os << LITERALCONSTANTS_GET("\"pdb_file\": ") << LiteralConstants<CharType>::m_quotes;
+            JSONEscape(os, m_pdb_file);
+            os << LiteralConstants<CharType>::m_quotes;
             os << LiteralConstants<CharType>::m_comma << std::endl;
             os << LITERALCONSTANTS_GET("\"sample_display_row\": ") << m_sample_display_row;
             os << LiteralConstants<CharType>::m_comma << std::endl;
@@ -674,12 +792,14 @@ struct WPerfSamplingJSON
             os << LiteralConstants<CharType>::m_comma << std::endl;
             os << LITERALCONSTANTS_GET("\"runtime_delta\": ") << m_runtime_delta;
             os << LiteralConstants<CharType>::m_comma << std::endl;
+            if (m_hasOverhead)
+                os << LITERALCONSTANTS_GET("\"overhead\": ") << m_overhead << LiteralConstants<CharType>::m_comma << std::endl;
             
             if (m_verbose)
             {
                 bool isFirst = true;
                 m_modules_table.m_tableJSON.m_isEmbedded = true;
-                os << m_modules_table.Print(jsonType).str();
+                os << m_modules_table;
                 os << LiteralConstants<CharType>::m_comma << std::endl;
                 os << LITERALCONSTANTS_GET("\"modules_info\": ");
                 os << LiteralConstants<CharType>::m_bracket_open;
@@ -691,7 +811,7 @@ struct WPerfSamplingJSON
                     } else {
                         isFirst = false;
                     }
-                    os << value.Print(jsonType).str();
+                    os << value;
                 }
                 os << LiteralConstants<CharType>::m_bracket_close;                
                 os << LiteralConstants<CharType>::m_comma << std::endl;
@@ -713,15 +833,17 @@ struct WPerfSamplingJSON
                 os << LITERALCONSTANTS_GET("{\"type\":");
                 std::get<0>(value).m_tableJSON.m_isEmbedded = true;
 
-                os << LiteralConstants<CharType>::m_quotes << key << LiteralConstants<CharType>::m_quotes;
+                os << LiteralConstants<CharType>::m_quotes;
+                JSONEscape(os, key);
+                os << LiteralConstants<CharType>::m_quotes;
                 os << LiteralConstants<CharType>::m_comma;
 
-                os << std::get<0>(value).Print(jsonType).str();
+                os << std::get<0>(value);
                 os << LiteralConstants<CharType>::m_comma << std::endl;
                 if (m_verbose)
                 {
                     std::get<2>(value).m_tableJSON.m_isEmbedded = true;
-                    os << std::get<2>(value).Print(jsonType).str();
+                    os << std::get<2>(value);
                     os << LiteralConstants<CharType>::m_comma << std::endl;
                 }
                 os << LITERALCONSTANTS_GET("\"annotate\": ");    
@@ -729,7 +851,7 @@ struct WPerfSamplingJSON
                 bool isFirstInside = true;
                 for(auto &[function_name, table] : std::get<1>(value))
                 {
-                    std::visit([&os, &jsonType](auto&& arg) { arg.m_tableJSON.m_isEmbedded = true; }, table);
+                    std::visit([&os](auto&& arg) { arg.m_tableJSON.m_isEmbedded = true; }, table);
 
                     if(!isFirstInside)
                     {
@@ -740,9 +862,11 @@ struct WPerfSamplingJSON
                     }
                     os << LiteralConstants<CharType>::m_cbracket_open;
                     os << LITERALCONSTANTS_GET("\"function_name\": ");
-                    os << LiteralConstants<CharType>::m_quotes << function_name << LiteralConstants<CharType>::m_quotes;
+                    os << LiteralConstants<CharType>::m_quotes;
+                    JSONEscape(os, function_name);
+                    os << LiteralConstants<CharType>::m_quotes;
                     os << LiteralConstants<CharType>::m_comma << std::endl;
-                    std::visit([&os, &jsonType](auto&& arg) { os << arg.Print(jsonType).str(); }, table);
+                    std::visit([&os](auto&& arg) { os << arg; }, table);
                     os << LiteralConstants<CharType>::m_cbracket_close;
                     
                 }
@@ -753,7 +877,58 @@ struct WPerfSamplingJSON
             os << LiteralConstants<CharType>::m_cbracket_close << std::endl;
         }
         os << LiteralConstants<CharType>::m_cbracket_close;
-        return os;
+    }
+};
+
+/* `wperf top` prints one JSON object (one line) per refresh so output can be
+   consumed as JSON lines stream, e.g. by dashboards. */
+template <typename CharType>
+struct WPerfTopJSON
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ostream, std::wostream> OutputStream;
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
+
+    using Samples = TableOutput<SamplingOutputTraits<CharType>, CharType>;
+    std::vector<std::pair<StringType, Samples>> m_events;    // [event name, hot functions]
+
+    double m_time = 0.0;            // Seconds since sampling started
+    double m_decay = 0.0;           // Half-life of sample weights (seconds), 0 means no decay
+    uint64_t m_samples = 0;         // Samples read since previous refresh
+
+    void Print(OutputStream& os)
+    {
+        const auto flags = os.flags();
+        const auto precision = os.precision();
+        os << LiteralConstants<CharType>::m_cbracket_open;
+        os << LITERALCONSTANTS_GET("\"time\": ") << std::fixed << std::setprecision(2) << m_time;
+        os << LiteralConstants<CharType>::m_comma;
+        os << LITERALCONSTANTS_GET("\"decay\": ") << std::fixed << std::setprecision(2) << m_decay;
+        os.flags(flags);            // Tables below are printed with default formatting
+        os.precision(precision);
+        os << LiteralConstants<CharType>::m_comma;
+        os << LITERALCONSTANTS_GET("\"samples\": ") << m_samples;
+        os << LiteralConstants<CharType>::m_comma;
+        os << LITERALCONSTANTS_GET("\"events\": [");
+
+        bool isFirst = true;
+        for (auto& [key, value] : m_events)
+        {
+            if (!isFirst)
+                os << LiteralConstants<CharType>::m_comma;
+            else
+                isFirst = false;
+
+            os << LITERALCONSTANTS_GET("{\"type\":");
+            value.m_tableJSON.m_isEmbedded = true;
+            os << LiteralConstants<CharType>::m_quotes;
+            JSONEscape(os, key);
+            os << LiteralConstants<CharType>::m_quotes;
+            os << LiteralConstants<CharType>::m_comma;
+            os << value;
+            os << LiteralConstants<CharType>::m_cbracket_close;
+        }
+        os << LiteralConstants<CharType>::m_bracket_close;
+        os << LiteralConstants<CharType>::m_cbracket_close;
     }
 };
 
@@ -770,9 +945,10 @@ struct WPerfTimelineJSON
     double m_count_interval = 0.f;  //  -i <sec>
     int m_count_timeline = 0;       //  -n N
 
-    StringStream Print()
+    void Print(OutputStream& os)
     {
-        StringStream os;
+        const auto flags = os.flags();
+        const auto precision = os.precision();
         os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
         {
             os << LITERALCONSTANTS_GET("\"count_duration\": ")
@@ -787,6 +963,9 @@ struct WPerfTimelineJSON
                 << std::fixed << std::setprecision(2) << m_count_timeline
                 << LiteralConstants<CharType>::m_comma << std::endl;;
 
+            os.flags(flags);        // Timeline entries are printed with default formatting
+            os.precision(precision);
+
             os << LITERALCONSTANTS_GET("\"timeline\": ");
             os << LiteralConstants<CharType>::m_bracket_open << std::endl;
 
@@ -798,13 +977,48 @@ struct WPerfTimelineJSON
                 else
                     isFirst = false;
 
-                os << table.Print().str();
+                table.Print(os);
             }
             os << LiteralConstants<CharType>::m_bracket_close << std::endl;
         }
 
         os << LiteralConstants<CharType>::m_cbracket_close;
-        return os;
+    }
+};
+
+// Code region instrumentation report of wperf-lib, see wperf_region_print(). Each region
+// is a stat table of its events with region name, calls and migrated pairs as extra fields.
+template <typename CharType>
+struct WPerfRegionJSON
+{
+    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ostream, std::wostream> OutputStream;
+
+    using PerformanceCounterOutputTraitsTO = TableOutput<PerformanceCounterOutputTraits<CharType, false>, CharType>;
+    std::vector<PerformanceCounterOutputTraitsTO> m_regionTables;
+    bool m_kernel = false;
+    bool m_calibrated = false;  // Counter values have instrumentation overhead subtracted
+
+    void Print(OutputStream& os)
+    {
+        os << LiteralConstants<CharType>::m_cbracket_open << std::endl;
+        os << LITERALCONSTANTS_GET("\"Kernel_mode\": ") << (m_kernel ? LITERALCONSTANTS_GET("true") : LITERALCONSTANTS_GET("false"));
+        os << LiteralConstants<CharType>::m_comma << std::endl;
+        os << LITERALCONSTANTS_GET("\"Calibrated\": ") << (m_calibrated ? LITERALCONSTANTS_GET("true") : LITERALCONSTANTS_GET("false"));
+        os << LiteralConstants<CharType>::m_comma << std::endl;
+        os << LITERALCONSTANTS_GET("\"regions\": ") << LiteralConstants<CharType>::m_bracket_open << std::endl;
+
+        bool isFirst = true;
+        for (auto& table : m_regionTables)
+        {
+            if (!isFirst)
+                os << LiteralConstants<CharType>::m_comma << std::endl;
+            else
+                isFirst = false;
+
+            os << table;
+        }
+        os << LiteralConstants<CharType>::m_bracket_close << std::endl;
+        os << LiteralConstants<CharType>::m_cbracket_close;
     }
 };
 
@@ -816,7 +1030,6 @@ struct OutputControl
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::string, std::wstring> StringType;
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ostream, std::wostream> OutputStream;
     typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::stringstream, std::wstringstream> StringStream;
-    typedef typename std::conditional_t<std::is_same_v<CharType, char>, std::ofstream, std::wofstream> FileStream;
 
     bool m_isQuiet = false;
     bool m_shouldWriteToFile = false;
@@ -859,157 +1072,114 @@ struct OutputControl
         }
     }
 
-    StringType EscapeStr(StringType& str)
+    // Streams JSON document written by PRINT (callable taking OutputStream&) to stdout or to the --output file.
+    // Document is encoded to UTF-8 as it is written, see JSONStreamBuffer. JSON results are printed even in
+    // quiet mode, quiet mode only suppresses human readable output.
+    template <typename F>
+    void PrintJSON_(F print, bool append = false)
     {
-        StringType res = LITERALCONSTANTS_GET("");
-        StringType::size_type n = str.find('\\');
-        StringType::size_type lastn = 0;
-
-        while (n != StringType::npos)
+        if (!m_shouldWriteToFile)
         {
-            res += str.substr(lastn, n - lastn) + LITERALCONSTANTS_GET("\\");
-            lastn = n;
-            n = str.find(L'\\', lastn + 1);
+            std::wcout.flush();     // Keep order with human readable output printed so far
+            std::cout.clear();
+            JSONStreamBuffer<CharType> buffer(std::cout);
+            OutputStream os(&buffer);
+            print(os);
         }
-        res += str.substr(lastn, str.size() - lastn);
-        return res;
-    }
-
-    void Print_(StringType& str)
-    {
-        StringType eStr = str;
-        bool curIsQuiet = m_isQuiet;
-        //If the user requested to be quiet but to output JSON results we disable quiet mode just
-        //to output the JSON tables and then reenable it afterwards.
-        if ((m_outputType == TableType::JSON || m_outputType == TableType::ALL) && m_isQuiet)
-        {
-            m_isQuiet = false;
-            eStr = EscapeStr(str);
-        }
-
-        GetOutputStream() << eStr;
-
-        if ((m_outputType == TableType::JSON || m_outputType == TableType::ALL) && curIsQuiet)
-        {
-            m_isQuiet = true;
+        else {
+            std::ofstream file;
+            file.open(m_filename, std::fstream::out | (append ? std::fstream::app : std::fstream::trunc));
+            if (file.is_open())
+            {
+                JSONStreamBuffer<CharType> buffer(file);
+                OutputStream os(&buffer);
+                print(os);
+            }
+            else {
+                GetErrorOutputStream() << LITERALCONSTANTS_GET("Unable to open ") << m_filename << std::endl;
+            }
         }
     }
 
-    void OutputToFile(StringType& str)
+    bool IsJSONRequested() const
     {
-        FileStream file;
-        file.open(m_filename, std::fstream::out | std::fstream::trunc);
-        if (file.is_open())
-        {
-            file << EscapeStr(str);
-            file.close();
-        }
-        else {
-            GetErrorOutputStream() << LITERALCONSTANTS_GET("Unable to open ") << m_filename << std::endl;
-        }
+        return m_outputType == TableType::JSON || m_outputType == TableType::ALL;
     }
 
     template <typename T>
     void Print(TableOutput<T, CharType>& table, bool printJson = false, TableType type = TableType::PRETTY)
     {
-        if(type == TableType::MAN){
-            StringType s = table.Print(TableType::MAN).str();
-            GetOutputStream() << s;
-        }
-        else {
-            StringType s = table.Print(TableType::PRETTY).str();
-            GetOutputStream() << s;
+        // Tables are rendered straight into the output stream and not at all in quiet mode
+        if (!m_isQuiet)
+        {
+            if (type == TableType::MAN)
+                table.m_tablePretty.GetManOutputStream(GetOutputStream(), table.m_tablePretty);
+            else
+                GetOutputStream() << table.m_tablePretty;
         }
-        if ((m_outputType == TableType::JSON || m_outputType == TableType::ALL) && printJson)
+        if (IsJSONRequested() && printJson)
         {
-            StringType sj = table.Print(TableType::JSON).str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(sj);
-            }
-            else {
-                OutputToFile(sj);
-            }
+            PrintJSON_([&table](OutputStream& os) { os << table; });
         }
     }
 
     void Print(WPerfStatJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-        {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
-        }
+        if (IsJSONRequested())
+            PrintJSON_([&table](OutputStream& os) { table.Print(os); });
     }
 
     void Print(WPerfListJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-        {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
-        }
+        if (IsJSONRequested())
+            PrintJSON_([&table](OutputStream& os) { table.Print(os); });
     }
 
     void Print(WPerfSamplingJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
-        {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
-        }
+        if (IsJSONRequested())
+            PrintJSON_([&table](OutputStream& os) { table.Print(os); });
     }
 
     /* When SPE is used we also enable the PMU to gather diagnosticis data. 
     Here we print a special sampling/counting output keeping each one of them still compatible with the sample/count schema. */
     void Print(WPerfSamplingJSON<CharType>& tableSampling, WPerfStatJSON<CharType>& tableStat)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
+        if (IsJSONRequested())
         {
-            StringType sSampling = tableSampling.Print().str();
-            StringType sStat = tableStat.Print().str();
-
-            StringType s = L"{\"sampling\":" + sSampling + L",\n\"counting\":" + sStat + L"}";
-
-            if (!m_shouldWriteToFile)
-            {
-                Print_(s);
-            }
-            else {
-                OutputToFile(s);
-            }
+            PrintJSON_([&tableSampling, &tableStat](OutputStream& os) {
+                os << LITERALCONSTANTS_GET("{\"sampling\":");
+                tableSampling.Print(os);
+                os << LITERALCONSTANTS_GET(",\n\"counting\":");
+                tableStat.Print(os);
+                os << LiteralConstants<CharType>::m_cbracket_close;
+            });
         }
     }
 
-    void Print(WPerfTimelineJSON<CharType>& table)
+    // Each refresh of `wperf top` is one line, with --output lines are appended to the file.
+    void Print(WPerfTopJSON<CharType>& table)
     {
-        if (m_outputType == TableType::JSON || m_outputType == TableType::ALL)
+        if (IsJSONRequested())
         {
-            StringType s = table.Print().str();
-            if (!m_shouldWriteToFile)
-                Print_(s);
-            else
-                OutputToFile(s);
+            PrintJSON_([&table](OutputStream& os) {
+                table.Print(os);
+                os << LITERALCONSTANTS_GET("\n");
+            }, true);
         }
     }
+
+    void Print(WPerfTimelineJSON<CharType>& table)
+    {
+        if (IsJSONRequested())
+            PrintJSON_([&table](OutputStream& os) { table.Print(os); });
+    }
+
+    void Print(WPerfRegionJSON<CharType>& table)
+    {
+        if (IsJSONRequested())
+            PrintJSON_([&table](OutputStream& os) { table.Print(os); });
+    }
 };
 
 // Handy aliases, the L at the end of each stands for local.
@@ -1020,8 +1190,8 @@ using ColumnAlignL = enum PrettyTable<GlobalCharType>::ColumnAlign;
 template <bool isVerbose>
 using PredefinedEventsOutputTraitsL = PredefinedEventsOutputTraits<GlobalCharType, isVerbose>;
 
-template <bool isMultiplexing>
-using PerformanceCounterOutputTraitsL = PerformanceCounterOutputTraits<GlobalCharType, isMultiplexing>;
+template <bool isMultiplexing, bool hasScalingError = false>
+using PerformanceCounterOutputTraitsL = PerformanceCounterOutputTraits<GlobalCharType, isMultiplexing, hasScalingError>;
 
 template <bool isMultiplexing>
 using SystemwidePerformanceCounterOutputTraitsL = SystemwidePerformanceCounterOutputTraits<GlobalCharType, isMultiplexing>;
@@ -1031,6 +1201,11 @@ using TelemetrySolutionMetricOutputTraitsL = TelemetrySolutionMetricOutputTraits
 using PMUPerformanceCounterOutputTraitsL = PMUPerformanceCounterOutputTraits<GlobalCharType>;
 using DDRMetricOutputTraitsL = DDRMetricOutputTraits<GlobalCharType>;
 using TestOutputTraitsL = TestOutputTraits<GlobalCharType>;
+using OverheadOutputTraitsL = OverheadOutputTraits<GlobalCharType>;
+using DdrMonitorOutputTraitsL = DdrMonitorOutputTraits<GlobalCharType>;
+using DdrImbalanceOutputTraitsL = DdrImbalanceOutputTraits<GlobalCharType>;
+using HeatmapOutputTraitsL = HeatmapOutputTraits<GlobalCharType>;
+using TopdownOutputTraitsL = TopdownOutputTraits<GlobalCharType>;
 using DisassemblyOutputTraitsL = DisassemblyOutputTraits<GlobalCharType>;
 using ManOutputTraitsL = ManOutputTraits<GlobalCharType>;
 template <bool isVerbose>
@@ -28,16 +28,23 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <cassert>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 #include <atlbase.h>
 
 #include "exception.h"
 #include "wperf-common\macros.h"
 #include "output.h"
 #include "utils.h"
+#include "mapped_file.h"
 #include "pe_file.h"
+#include "pe_reader.h"
+#include "symbol_cache.h"
 
 
 std::wstring gen_pdb_name(std::wstring str)
@@ -45,137 +52,135 @@ std::wstring gen_pdb_name(std::wstring str)
     return ReplaceFileExtension(str, L"pdb");
 }
 
-void parse_pe_file(std::wstring pe_file, PeFileMetaData& pefile_metadata)
+/// <summary>
+/// Returns metadata of PE_FILE. File is memory mapped and parsed only once,
+/// subsequent calls for the same file return cached metadata.
+/// </summary>
+const PeFileMetaData& get_pe_file_metadata(const std::wstring& pe_file)
 {
-    pefile_metadata.pe_name = pe_file;
-
-    parse_pe_file(pe_file,
-        pefile_metadata.static_entry_point,
-        pefile_metadata.image_base,
-        pefile_metadata.sec_info,
-        pefile_metadata.sec_import);
-}
+    static std::map<std::wstring, PeFileMetaData> pe_files;
+    static std::mutex pe_files_mutex;
 
+    std::lock_guard<std::mutex> lock(pe_files_mutex);
 
-void parse_pe_file(const std::wstring& pe_file, uint64_t& image_base)
-{
-    std::ifstream pe_file_stream(pe_file, std::ios::binary);
-    // make sure we have enough space for maximum read
-    std::streamsize buf_size = sizeof(IMAGE_DOS_HEADER) > sizeof(IMAGE_NT_HEADERS)
-        ? sizeof(IMAGE_DOS_HEADER) : sizeof(IMAGE_NT_HEADERS);
+    auto it = pe_files.find(pe_file);
+    if (it != pe_files.end())
+        return it->second;
 
-    std::unique_ptr<char[]> hdr_buf = std::make_unique<char[]>(buf_size);
-    pe_file_stream.read(hdr_buf.get(), sizeof(IMAGE_DOS_HEADER));
+    PeReader pe;
+    PeReader::Status status;
+    {
+        MappedFile file(pe_file);
+        status = pe.Parse(file.data(), file.size());
+    }
 
-    PIMAGE_DOS_HEADER dos_hdr = reinterpret_cast<PIMAGE_DOS_HEADER>(hdr_buf.get());
-    if (dos_hdr->e_magic != IMAGE_DOS_SIGNATURE)
+    if (status == PeReader::PE_ERROR_FORMAT)
     {
         m_out.GetOutputStream() << pe_file << std::endl;
         throw fatal_exception("PE file specified is not in valid PE format");
     }
 
-    std::streampos pos = dos_hdr->e_lfanew;
-    pe_file_stream.seekg(pos);
-    pe_file_stream.read(hdr_buf.get(), sizeof(IMAGE_NT_HEADERS));
-    PIMAGE_NT_HEADERS nt_hdr = reinterpret_cast<PIMAGE_NT_HEADERS>(hdr_buf.get());
-    if (nt_hdr->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    if (status == PeReader::PE_ERROR_NOT_64BIT)
     {
         throw fatal_exception("PE file specified is not 64bit format");
     }
 
-    image_base = nt_hdr->OptionalHeader.ImageBase;
-    //std::cout << "static entry: 0x" << std::hex << static_entry_point << ", image_base: 0x" << image_base << std::endl;
-    pe_file_stream.close();
-}
+    PeFileMetaData& metadata = pe_files[pe_file];
+    metadata.pe_name = pe_file;
+    metadata.static_entry_point = pe.m_entry_point;
+    metadata.image_base = pe.m_image_base;
+    metadata.time_date_stamp = pe.m_time_date_stamp;
+    metadata.size_of_image = pe.m_size_of_image;
 
-void parse_pe_file(std::wstring pe_file, uint64_t& static_entry_point, uint64_t& image_base, std::vector<SectionDesc>& sec_info, std::vector<std::wstring>& sec_import)
-{
-    std::ifstream pe_file_stream(pe_file, std::ios::binary);
-    // make sure we have enough space for maximum read
-    std::streamsize buf_size = sizeof(IMAGE_DOS_HEADER) > sizeof(IMAGE_NT_HEADERS)
-        ? sizeof(IMAGE_DOS_HEADER) : sizeof(IMAGE_NT_HEADERS);
-
-    std::unique_ptr<char[]> hdr_buf = std::make_unique<char[]>(buf_size);
-    pe_file_stream.read(hdr_buf.get(), sizeof(IMAGE_DOS_HEADER));
-
-    PIMAGE_DOS_HEADER dos_hdr = reinterpret_cast<PIMAGE_DOS_HEADER>(hdr_buf.get());
-    if (dos_hdr->e_magic != IMAGE_DOS_SIGNATURE)
+    for (uint32_t i = 0; i < pe.m_sections.size(); i++)
     {
-        m_out.GetOutputStream() << pe_file << std::endl;
-        throw fatal_exception("PE file specified is not in valid PE format");
+        const PeReaderSection& sec = pe.m_sections[i];
+        metadata.sec_info.push_back({ i, sec.virtual_address, sec.virtual_size, std::wstring(sec.name.begin(), sec.name.end()),
+                                      sec.raw_offset, sec.raw_size });
     }
 
-    std::streampos pos = dos_hdr->e_lfanew;
-    pe_file_stream.seekg(pos);
-    pe_file_stream.read(hdr_buf.get(), sizeof(IMAGE_NT_HEADERS));
-    PIMAGE_NT_HEADERS nt_hdr = reinterpret_cast<PIMAGE_NT_HEADERS>(hdr_buf.get());
-    if (nt_hdr->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR64_MAGIC)
+    for (const auto& name : pe.m_imports)
+        metadata.sec_import.push_back(std::wstring(name.begin(), name.end()));
+
+    for (const auto& name : pe.m_exports)
+        metadata.sec_export.push_back(std::wstring(name.begin(), name.end()));
+
+    if (pe.m_has_codeview)
     {
-        throw fatal_exception("PE file specified is not 64bit format");
+        metadata.debug_pdb_path = WideStringFromMultiByte(pe.m_pdb_path.c_str());
+        const std::string signature = pe.GetPdbSignature();
+        metadata.pdb_signature = std::wstring(signature.begin(), signature.end());
     }
 
-    static_entry_point = nt_hdr->OptionalHeader.AddressOfEntryPoint;
-    image_base = nt_hdr->OptionalHeader.ImageBase;
-    //std::cout << "static entry: 0x" << std::hex << static_entry_point << ", image_base: 0x" << image_base << std::endl;
+    return metadata;
+}
 
-    buf_size = sizeof(IMAGE_SECTION_HEADER) * nt_hdr->FileHeader.NumberOfSections;
-    std::unique_ptr<char[]> sec_buf = std::make_unique<char[]>(buf_size);
-    pos += FIELD_OFFSET(IMAGE_NT_HEADERS, OptionalHeader) + std::streampos(nt_hdr->FileHeader.SizeOfOptionalHeader);
-    pe_file_stream.seekg(pos);
-    pe_file_stream.read(sec_buf.get(), buf_size);
+void parse_pe_file(std::wstring pe_file, PeFileMetaData& pefile_metadata)
+{
+    pefile_metadata = get_pe_file_metadata(pe_file);
+}
 
-    ULONGLONG importDirectoryRVA = nt_hdr->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress;
-    PIMAGE_SECTION_HEADER importSection = NULL;
+void parse_pe_file(const std::wstring& pe_file, uint64_t& image_base)
+{
+    image_base = get_pe_file_metadata(pe_file).image_base;
+}
 
-    PIMAGE_SECTION_HEADER sections = reinterpret_cast<PIMAGE_SECTION_HEADER>(sec_buf.get());
-    for (uint32_t i = 0; i < nt_hdr->FileHeader.NumberOfSections; i++)
-    {
-        char section_name[16] = { 0 };
-        memcpy_s(section_name, sizeof section_name, sections[i].Name, IMAGE_SIZEOF_SHORT_NAME);
+void parse_pe_file(std::wstring pe_file, uint64_t& static_entry_point, uint64_t& image_base, std::vector<SectionDesc>& sec_info, std::vector<std::wstring>& sec_import)
+{
+    const PeFileMetaData& metadata = get_pe_file_metadata(pe_file);
 
-        std::string name(section_name);
-        SectionDesc sec_desc = { i, sections[i].VirtualAddress, sections[i].Misc.VirtualSize, std::wstring(name.begin(), name.end()) };
-        sec_info.push_back(sec_desc);
-        //std::cout << "addr: 0x" << std::hex << sec_desc.offset << ", name: " <<  sec_desc.name << std::endl;
+    static_entry_point = metadata.static_entry_point;
+    image_base = metadata.image_base;
+    sec_info.insert(sec_info.end(), metadata.sec_info.begin(), metadata.sec_info.end());
+    sec_import.insert(sec_import.end(), metadata.sec_import.begin(), metadata.sec_import.end());
+}
 
-        ULONGLONG section_vaddr_with_size = (ULONGLONG)sections[i].VirtualAddress + sections[i].Misc.VirtualSize;
-        if (importDirectoryRVA >= sections[i].VirtualAddress && importDirectoryRVA < section_vaddr_with_size) {
-            importSection = sections + i;
-        }
-    }
+/// <summary>
+/// Returns interned copy of source file NAME. Many lines (of many functions)
+/// share the same source file, so we store each file name only once.
+/// Returned pointer is valid until the end of the program.
+/// </summary>
+const std::wstring* intern_source_file(const std::wstring& name)
+{
+    static std::unordered_set<std::wstring> source_files;
+    static std::mutex source_files_mutex;
+
+    std::lock_guard<std::mutex> lock(source_files_mutex);
+    return &*source_files.insert(name).first;
+}
 
-    /** DLL IMPORTS **/
-    if (importSection)
+static void sym_info_from_cache(const SymbolCache& cache, std::vector<FuncSymDesc>& sym_info)
+{
+    for (const auto& f : cache.m_functions)
     {
-        pos = importSection->PointerToRawData;
-        pe_file_stream.seekg(0, pe_file_stream.end);
-        std::streampos length = pe_file_stream.tellg();
-        std::streampos length_to_read = length - pos;
-        pe_file_stream.seekg(pos);
-
-        std::unique_ptr<char[]> import_buf = std::make_unique<char[]>(length_to_read);
-        pe_file_stream.read(import_buf.get(), length_to_read);
-        PIMAGE_IMPORT_DESCRIPTOR importDescriptor = (PIMAGE_IMPORT_DESCRIPTOR)(import_buf.get() + (nt_hdr->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress - importSection->VirtualAddress));
-
-        for (; importDescriptor->Name != 0; importDescriptor++) {
-            std::string name = import_buf.get() + (importDescriptor->Name - importSection->VirtualAddress);
-            sec_import.push_back(std::wstring(name.begin(), name.end()));
-            // std::cout << "dll: " << name << std::endl;
-        }
+        FuncSymDesc sym_desc = { f.sec_idx, f.size, f.offset, f.name };
+        for (const auto& l : f.lines)
+            sym_desc.lines.push_back(LineNumberDesc{ intern_source_file(l.source_file), l.line_num, l.col_num, static_cast<BOOL>(l.is_statement),
+                                                     l.address_section, l.address_offset, l.length, l.rva, l.virtual_address });
+        sym_desc.lines_loaded = true;
+        sym_info.push_back(sym_desc);
     }
-
-    pe_file_stream.close();
 }
 
-void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, bool sample_display_short)
+static void sym_info_to_cache(const std::vector<FuncSymDesc>& sym_info, SymbolCache& cache)
 {
-    // Init DIA COM
-    IDiaDataSource* DiaDataSource;
-    IDiaSession* DiaSession;
-    IDiaSymbol* DiaSymbol;
+    for (const auto& sym : sym_info)
+    {
+        SymbolCacheFunction f = { sym.sec_idx, sym.size, sym.offset, sym.name };
+        for (const auto& l : sym.lines)
+            f.lines.push_back(SymbolCacheLine{ *l.source_file, l.lineNum, l.colNum, static_cast<uint32_t>(l.isStatement),
+                                               l.addressSection, l.addressOffset, l.length, l.rva, l.virtualAddress });
+        cache.m_functions.push_back(f);
+    }
+}
 
-    HRESULT status = CoInitialize(NULL);
-    status = CoCreateInstance(__uuidof(DiaSource), NULL,
+/// <summary>
+/// Load PDB_FILE with DIA and open new session. Caller must Release() both
+/// DATA_SOURCE and SESSION. COM must be initialized.
+/// </summary>
+static void open_pdb_session(const std::wstring& pdb_file, IDiaDataSource*& DiaDataSource, IDiaSession*& DiaSession)
+{
+    HRESULT status = CoCreateInstance(__uuidof(DiaSource), NULL,
         CLSCTX_INPROC_SERVER, __uuidof(IDiaDataSource), (void**)&DiaDataSource);
 
     if (status != S_OK)
@@ -200,6 +205,46 @@ void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, b
     status = DiaDataSource->openSession(&DiaSession);
     if (status < 0)
         throw fatal_exception("openSession failed for DiaSession");
+}
+
+/// <summary>
+/// Read all functions from PDB_FILE. Line tables are not read here (see
+/// `PdbLineReader`) unless SYMBOL_CACHE_DIR is set. In that case symbols
+/// (with line tables) are loaded from the on-disk cache of PDB with
+/// PDB_SIGNATURE (GUID and age from image CodeView record, see
+/// `PeFileMetaData::pdb_signature`), otherwise PDB is parsed with DIA and
+/// cache file is updated. Images without CodeView record are not cached.
+/// </summary>
+void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, bool sample_display_short,
+                    const std::wstring& symbol_cache_dir, const std::wstring& pdb_signature)
+{
+    SymbolCache cache;
+    std::wstring cache_file;
+
+    if (symbol_cache_dir.size() && pdb_signature.size())
+    {
+        cache.m_key = Fnv1aHash(pdb_signature.data(), pdb_signature.size() * sizeof(wchar_t));
+        cache.m_flags = sample_display_short ? SymbolCache::FLAG_SHORT_NAMES : 0;
+
+        if (cache.m_key)
+        {
+            SymbolCache cached;
+            cache_file = SymbolCache::GenFilename(symbol_cache_dir, pdb_file, cache.m_key);
+            if (cached.Load(cache_file) && cached.m_key == cache.m_key && cached.m_flags == cache.m_flags)
+            {
+                sym_info_from_cache(cached, sym_info);
+                return;
+            }
+        }
+    }
+
+    // Init DIA COM
+    IDiaDataSource* DiaDataSource;
+    IDiaSession* DiaSession;
+    IDiaSymbol* DiaSymbol;
+
+    HRESULT status = CoInitialize(NULL);
+    open_pdb_session(pdb_file, DiaDataSource, DiaSession);
 
     status = DiaSession->get_globalScope(&DiaSymbol);
     if (status != S_OK)
@@ -259,7 +304,8 @@ void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, b
                         if (symbol->get_addressSection(&sec_idx) == S_OK && symbol->get_addressOffset(&sec_off) == S_OK)
                         {
                             FuncSymDesc sym_desc = { sec_idx, static_cast<uint32_t>(func_len), sec_off, func_name_wstr };
-                            read_function_lines(sym_desc, symbol, DiaSession);
+                            if (cache_file.size())
+                                read_function_lines(sym_desc, DiaSession);
                             sym_info.push_back(sym_desc);
                         }
                     }
@@ -277,17 +323,52 @@ void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, b
     DiaSession->Release();
     DiaDataSource->Release();
     CoUninitialize();
+
+    if (cache_file.size())
+    {
+        sym_info_to_cache(sym_info, cache);
+        if (!cache.Save(cache_file))
+            m_out.GetErrorOutputStream() << L"warning: can't write symbol cache file '" << cache_file << L"'" << std::endl;
+    }
 }
 
-void read_function_lines(FuncSymDesc& funcSymDesc, IDiaSymbol* pSymbol, IDiaSession* pSession)
+/// <summary>
+/// Read PE metadata and symbols of all modules in MODULES_METADATA which have
+/// PDB file next to them. Modules are loaded concurrently on worker threads,
+/// each worker has its own DIA session and writes only to its own module's
+/// `sym_info`. PE metadata is merged into DLL_METADATA afterwards.
+/// Modules already present in DLL_METADATA are not loaded again, so this
+/// can be called again when new modules are added to MODULES_METADATA.
+/// </summary>
+void load_modules_symbols(std::map<std::wstring, ModuleMetaData>& modules_metadata, std::map<std::wstring, PeFileMetaData>& dll_metadata,
+                          bool sample_display_short, const std::wstring& symbol_cache_dir)
 {
-    ULONGLONG length = 0;
-    DWORD     isect = 0;
-    DWORD     offset = 0;
+    std::vector<ModuleMetaData*> modules;
+    for (auto& [key, value] : modules_metadata)
+    {
+        if (!dll_metadata.count(value.mod_name) && std::filesystem::exists(gen_pdb_name(value.mod_path)))
+            modules.push_back(&value);
+    }
+
+    std::vector<PeFileMetaData> pe_metadata(modules.size());
+    ParallelForEach(modules.size(), [&](size_t i) {
+        ModuleMetaData& module = *modules[i];
+        pe_metadata[i] = get_pe_file_metadata(module.mod_path);
+        pe_metadata[i].pdb_file = gen_pdb_name(module.mod_path);
+        parse_pdb_file(pe_metadata[i].pdb_file, module.sym_info, sample_display_short, symbol_cache_dir, pe_metadata[i].pdb_signature);
+    });
+
+    for (size_t i = 0; i < modules.size(); i++)
+        dll_metadata[modules[i]->mod_name] = pe_metadata[i];
+}
 
-    pSymbol->get_addressSection(&isect);
-    pSymbol->get_addressOffset(&offset);
-    pSymbol->get_length(&length);
+void read_function_lines(FuncSymDesc& funcSymDesc, IDiaSession* pSession)
+{
+    const ULONGLONG length = funcSymDesc.size;
+    const DWORD     isect = funcSymDesc.sec_idx;
+    const DWORD     offset = static_cast<DWORD>(funcSymDesc.offset);
+
+    funcSymDesc.lines_loaded = true;
     if (isect != 0 && length > 0)
     {
         CComPtr<IDiaEnumLineNumbers> pLines;
@@ -338,7 +419,7 @@ void read_function_lines(FuncSymDesc& funcSymDesc, IDiaSymbol* pSymbol, IDiaSess
                         }
 
                         funcSymDesc.lines.push_back(LineNumberDesc{
-                            std::wstring(fName),
+                            intern_source_file(file_name_wstr),
                             linenum,
                             colnum,
                             isStatement,
@@ -355,6 +436,63 @@ void read_function_lines(FuncSymDesc& funcSymDesc, IDiaSymbol* pSymbol, IDiaSess
     std::sort(funcSymDesc.lines.begin(), funcSymDesc.lines.end(), [](LineNumberDesc& a, LineNumberDesc& b) -> bool { return a.lineNum < b.lineNum; });
 }
 
+// Returns symbol of image (executable) loaded at LOAD_BASE which ADDR belongs to, or nullptr.
+const FuncSymDesc* find_image_symbol(uint64_t addr, const std::vector<FuncSymDesc>& sym_info, const std::vector<SectionDesc>& sec_info, uint64_t load_base)
+{
+    uint64_t sec_base = 0;
+
+    for (const auto& b : sym_info)
+    {
+        for (const auto& c : sec_info)
+        {
+            assert(b.sec_idx);
+            if (c.idx == (b.sec_idx - 1))
+            {
+                sec_base = load_base + c.offset;
+                break;
+            }
+        }
+
+        if (addr >= (b.offset + sec_base) && addr < (b.offset + sec_base + b.size))
+            return &b;
+    }
+
+    return nullptr;
+}
+
+// Adds sample of resolved symbol SD to RESOLVED_SAMPLES, samples of the same symbol and
+// event source are merged and their hits are counted per PC.
+void add_resolved_sample(std::vector<SampleDesc>& resolved_samples, SampleDesc& sd, uint32_t event_src, uint64_t pc, uint32_t weight, uint64_t period)
+{
+    for (auto& c : resolved_samples)
+    {
+        if (c.desc.name == sd.desc.name && c.event_src == event_src)
+        {
+            c.freq += weight;
+            c.period += period;
+
+            for (auto& p : c.pc)
+            {
+                if (p.first == pc)
+                {
+                    p.second += weight;
+                    return;
+                }
+            }
+
+            c.pc.push_back(std::make_pair(pc, weight));
+            return;
+        }
+    }
+
+    sd.freq = weight;
+    sd.period = period;
+    sd.event_src = event_src;
+    sd.pc.clear();
+    sd.pc.push_back(std::make_pair(pc, weight));
+    resolved_samples.push_back(sd);
+}
+
 bool sort_samples(const SampleDesc& a, const SampleDesc& b)
 {
     if (a.event_src != b.event_src)
@@ -368,6 +506,10 @@ bool sort_samples(const SampleDesc& a, const SampleDesc& b)
         return a.event_src < b.event_src;
     }
 
+    // Samples of one source taken with different intervals (-F) are ordered by event count
+    if (a.period != b.period)
+        return a.period > b.period;
+
     return a.freq > b.freq;
 }
 
@@ -375,3 +517,52 @@ bool sort_pcs(const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t,
 {
     return a.second > b.second;
 }
+
+PdbLineReader::~PdbLineReader()
+{
+    for (auto& [pdb_file, session] : m_sessions)
+    {
+        session.second->Release();
+        session.first->Release();
+    }
+
+    if (m_sessions.size())
+        CoUninitialize();
+}
+
+/// <summary>
+/// Read line table of FUNC (function from PDB_FILE) if not read already.
+/// Line tables are kept per function, callers often hold their own copy of
+/// FUNC (e.g. one per sampled event). DIA session for each PDB file is opened
+/// once and kept open.
+/// </summary>
+void PdbLineReader::ReadLines(const std::wstring& pdb_file, FuncSymDesc& func)
+{
+    if (func.lines_loaded)
+        return;
+
+    auto key = std::make_tuple(pdb_file, func.sec_idx, func.offset);
+    auto lines = m_lines.find(key);
+    if (lines != m_lines.end())
+    {
+        func.lines = lines->second;
+        func.lines_loaded = true;
+        return;
+    }
+
+    auto it = m_sessions.find(pdb_file);
+    if (it == m_sessions.end())
+    {
+        IDiaDataSource* DiaDataSource;
+        IDiaSession* DiaSession;
+
+        if (m_sessions.empty())
+            CoInitialize(NULL);
+
+        open_pdb_session(pdb_file, DiaDataSource, DiaSession);
+        it = m_sessions.emplace(pdb_file, std::make_pair(DiaDataSource, DiaSession)).first;
+    }
+
+    read_function_lines(func, it->second.second);
+    m_lines.emplace(std::move(key), func.lines);
+}
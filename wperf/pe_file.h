@@ -30,7 +30,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <windows.h>
+#include <map>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include "dia2.h"
@@ -41,11 +43,13 @@ typedef struct _SectionDesc
     uint64_t offset{};
     uint64_t virtual_size{};
     std::wstring name;
+    uint64_t raw_offset{};      // PointerToRawData, file offset of section data
+    uint64_t raw_size{};        // SizeOfRawData
 } SectionDesc;
 
 typedef struct _LineNumberDesc
 {
-    std::wstring source_file;
+    const std::wstring* source_file{};      // Interned, see intern_source_file()
     DWORD lineNum{};
     DWORD colNum{};
     BOOL isStatement{};
@@ -64,6 +68,7 @@ typedef struct _FuncSymDesc
     std::wstring name;      // Name of the whole symbol, e.g. x_mul:python312.dll
     std::wstring sname;     // Symbol name only
     std::vector<LineNumberDesc> lines;
+    bool lines_loaded{};    // Line table is read on demand, see PdbLineReader
 } FuncSymDesc;
 
 typedef struct _ModuleMetaData
@@ -78,6 +83,7 @@ typedef struct _ModuleMetaData
 typedef struct _SampleDesc
 {
     uint32_t freq{};
+    uint64_t period{};      // Sum of sampling intervals of samples (estimated event count), see `-F`
     FuncSymDesc desc;
     ModuleMetaData* module{};
     uint32_t event_src{};
@@ -90,16 +96,45 @@ typedef struct _PeFileMetaData
     std::wstring pdb_file;
     uint64_t static_entry_point{};
     uint64_t image_base{};
+    uint32_t time_date_stamp{};     // Link time stamp, with `size_of_image` identifies the build
+    uint32_t size_of_image{};
     std::vector<SectionDesc> sec_info;
     std::vector<std::wstring> sec_import;
+    std::vector<std::wstring> sec_export;
+    std::wstring debug_pdb_path;    // PDB path from CodeView debug record
+    std::wstring pdb_signature;     // PDB GUID and age, symbol server format
 } PeFileMetaData;
 
 std::wstring gen_pdb_name(std::wstring str);
-void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, bool sample_display_short);
+void parse_pdb_file(std::wstring pdb_file, std::vector<FuncSymDesc>& sym_info, bool sample_display_short,
+                    const std::wstring& symbol_cache_dir = L"", const std::wstring& pdb_signature = L"");
+void load_modules_symbols(std::map<std::wstring, ModuleMetaData>& modules_metadata, std::map<std::wstring, PeFileMetaData>& dll_metadata,
+                          bool sample_display_short, const std::wstring& symbol_cache_dir = L"");
+const PeFileMetaData& get_pe_file_metadata(const std::wstring& pe_file);
 void parse_pe_file(const std::wstring& pe_file, uint64_t& image_base);
 void parse_pe_file(std::wstring pe_file, uint64_t& static_entry_point, uint64_t& image_base, std::vector<SectionDesc>& sec_info, std::vector<std::wstring>& sec_import);
 void parse_pe_file(std::wstring pe_file, PeFileMetaData& pefile_metadata);
+const FuncSymDesc* find_image_symbol(uint64_t addr, const std::vector<FuncSymDesc>& sym_info, const std::vector<SectionDesc>& sec_info, uint64_t load_base);
+void add_resolved_sample(std::vector<SampleDesc>& resolved_samples, SampleDesc& sd, uint32_t event_src, uint64_t pc, uint32_t weight, uint64_t period);
 bool sort_samples(const SampleDesc& a, const SampleDesc& b);
 bool sort_pcs(const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b);
 
-void read_function_lines(FuncSymDesc& funcSymDesc, IDiaSymbol* pSymbol, IDiaSession* pSession);
\ No newline at end of file
+void read_function_lines(FuncSymDesc& funcSymDesc, IDiaSession* pSession);
+const std::wstring* intern_source_file(const std::wstring& name);
+
+/// <summary>
+/// Reads line tables of functions on demand, e.g. only for functions which
+/// are in the top-N sampling results. Loading line tables of all functions
+/// in big modules is slow and takes a lot of memory. Each function is read
+/// from DIA once, even if it is hot for several events.
+/// </summary>
+class PdbLineReader
+{
+    std::map<std::wstring, std::pair<IDiaDataSource*, IDiaSession*>> m_sessions;   // [pdb_file] -> DIA session
+    std::map<std::tuple<std::wstring, uint32_t, uint64_t>, std::vector<LineNumberDesc>> m_lines;   // [pdb_file, sec_idx, offset] -> line table
+
+public:
+    ~PdbLineReader();
+
+    void ReadLines(const std::wstring& pdb_file, FuncSymDesc& func);
+};
\ No newline at end of file
@@ -0,0 +1,307 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include "pe_reader.h"
+
+namespace
+{
+    // Offsets of PE structures, see "PE Format" in Microsoft docs
+    constexpr uint16_t DOS_SIGNATURE = 0x5A4D;                 // "MZ"
+    constexpr uint32_t NT_SIGNATURE = 0x00004550;              // "PE\0\0"
+    constexpr uint16_t OPTIONAL_HDR64_MAGIC = 0x20B;
+    constexpr size_t DOS_E_LFANEW = 0x3C;
+    constexpr size_t FILE_HEADER_SIZE = 20;
+    constexpr size_t OPT64_NUMBER_OF_RVA_AND_SIZES = 108;
+    constexpr size_t OPT64_DATA_DIRECTORY = 112;
+    constexpr size_t SECTION_HEADER_SIZE = 40;
+    constexpr size_t IMPORT_DESCRIPTOR_SIZE = 20;
+    constexpr size_t EXPORT_DIRECTORY_SIZE = 40;
+    constexpr size_t DEBUG_DIRECTORY_SIZE = 28;
+    constexpr uint32_t DEBUG_TYPE_CODEVIEW = 2;
+    constexpr uint32_t CV_SIGNATURE_RSDS = 0x53445352;        // "RSDS"
+
+    constexpr uint32_t DIRECTORY_ENTRY_EXPORT = 0;
+    constexpr uint32_t DIRECTORY_ENTRY_IMPORT = 1;
+    constexpr uint32_t DIRECTORY_ENTRY_DEBUG = 6;
+
+    // Upper bounds for tables walked until terminator or count, guards against corrupted files
+    constexpr size_t MAX_IMPORTS = 4096;
+    constexpr size_t MAX_EXPORTS = 1 << 20;
+
+    uint16_t get16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t get32(const uint8_t* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint64_t get64(const uint8_t* p)
+    {
+        return get32(p) | (static_cast<uint64_t>(get32(p + 4)) << 32);
+    }
+
+    bool in_bounds(size_t size, size_t offset, size_t len)
+    {
+        return offset <= size && len <= size - offset;
+    }
+}
+
+/// <summary>
+/// Parse PE image from DATA of SIZE bytes (whole file). DATA is not
+/// referenced after this function returns.
+/// </summary>
+PeReader::Status PeReader::Parse(const uint8_t* data, size_t size)
+{
+    *this = PeReader();
+    m_data = data;
+    m_size = size;
+
+    Status status = PE_ERROR_FORMAT;
+
+    do
+    {
+        if (!in_bounds(size, 0, DOS_E_LFANEW + 4) || get16(data) != DOS_SIGNATURE)
+            break;
+
+        const size_t nt_off = get32(data + DOS_E_LFANEW);
+        if (!in_bounds(size, nt_off, 4 + FILE_HEADER_SIZE + 2) || get32(data + nt_off) != NT_SIGNATURE)
+            break;
+
+        const uint8_t* file_hdr = data + nt_off + 4;
+        m_machine = get16(file_hdr);
+        const uint16_t number_of_sections = get16(file_hdr + 2);
+        m_time_date_stamp = get32(file_hdr + 4);
+        const uint16_t size_of_optional_header = get16(file_hdr + 16);
+
+        const size_t opt_off = nt_off + 4 + FILE_HEADER_SIZE;
+        if (get16(data + opt_off) != OPTIONAL_HDR64_MAGIC)
+        {
+            status = PE_ERROR_NOT_64BIT;
+            break;
+        }
+
+        if (size_of_optional_header < OPT64_DATA_DIRECTORY || !in_bounds(size, opt_off, size_of_optional_header))
+            break;
+
+        const uint8_t* opt_hdr = data + opt_off;
+        m_entry_point = get32(opt_hdr + 16);
+        m_image_base = get64(opt_hdr + 24);
+        m_size_of_image = get32(opt_hdr + 56);
+        m_size_of_headers = get32(opt_hdr + 60);
+
+        const size_t sec_off = opt_off + size_of_optional_header;
+        if (!in_bounds(size, sec_off, size_t(number_of_sections) * SECTION_HEADER_SIZE))
+            break;
+
+        for (uint16_t i = 0; i < number_of_sections; i++)
+        {
+            const uint8_t* sec = data + sec_off + i * SECTION_HEADER_SIZE;
+            PeReaderSection section;
+            section.name.assign(reinterpret_cast<const char*>(sec), strnlen(reinterpret_cast<const char*>(sec), 8));
+            section.virtual_size = get32(sec + 8);
+            section.virtual_address = get32(sec + 12);
+            section.raw_size = get32(sec + 16);
+            section.raw_offset = get32(sec + 20);
+            m_sections.push_back(section);
+        }
+
+        // Data directories are optional, only parse these present in the header
+        uint32_t number_of_dirs = get32(opt_hdr + OPT64_NUMBER_OF_RVA_AND_SIZES);
+        const uint32_t dirs_in_header = static_cast<uint32_t>((size_of_optional_header - OPT64_DATA_DIRECTORY) / 8);
+        if (number_of_dirs > dirs_in_header)
+            number_of_dirs = dirs_in_header;
+
+        auto dir = [&](uint32_t idx, uint32_t& rva, uint32_t& len) {
+            rva = len = 0;
+            if (idx >= number_of_dirs)
+                return false;
+            rva = get32(opt_hdr + OPT64_DATA_DIRECTORY + idx * 8);
+            len = get32(opt_hdr + OPT64_DATA_DIRECTORY + idx * 8 + 4);
+            return rva != 0;
+        };
+
+        uint32_t rva, len;
+        if (dir(DIRECTORY_ENTRY_IMPORT, rva, len))
+            ParseImports(rva, len);
+        if (dir(DIRECTORY_ENTRY_EXPORT, rva, len))
+            ParseExports(rva, len);
+        if (dir(DIRECTORY_ENTRY_DEBUG, rva, len))
+            ParseDebug(rva, len);
+
+        status = PE_OK;
+    } while (false);
+
+    m_data = nullptr;
+    m_size = 0;
+    return status;
+}
+
+/// <summary>
+/// Translate relative virtual address RVA to file OFFSET.
+/// Returns false if RVA is not backed by file data.
+/// </summary>
+bool PeReader::RvaToOffset(uint32_t rva, size_t& offset) const
+{
+    if (rva < m_size_of_headers)
+    {
+        offset = rva;
+        return true;
+    }
+
+    for (const auto& sec : m_sections)
+    {
+        if (rva >= sec.virtual_address && rva - sec.virtual_address < sec.raw_size)
+        {
+            offset = size_t(sec.raw_offset) + (rva - sec.virtual_address);
+            return true;
+        }
+    }
+    return false;
+}
+
+/// <summary>
+/// PDB signature in symbol server format: GUID as 32 hex digits
+/// followed by age in hex, e.g. `1F2E3D4C5B6A79880123456789ABCDEF1`.
+/// Empty if image has no CodeView record.
+/// </summary>
+std::string PeReader::GetPdbSignature() const
+{
+    if (!m_has_codeview)
+        return std::string();
+
+    std::ostringstream sig;
+    sig << std::hex << std::uppercase << std::setfill('0')
+        << std::setw(8) << get32(m_pdb_guid)
+        << std::setw(4) << get16(m_pdb_guid + 4)
+        << std::setw(4) << get16(m_pdb_guid + 6);
+    for (int i = 8; i < 16; i++)
+        sig << std::setw(2) << static_cast<uint32_t>(m_pdb_guid[i]);
+    sig << std::setw(0) << m_pdb_age;
+    return sig.str();
+}
+
+bool PeReader::ReadString(size_t offset, std::string& str) const
+{
+    if (offset >= m_size)
+        return false;
+
+    const char* begin = reinterpret_cast<const char*>(m_data + offset);
+    const void* end = memchr(begin, 0, m_size - offset);
+    if (!end)
+        return false;
+
+    str.assign(begin, static_cast<const char*>(end));
+    return true;
+}
+
+void PeReader::ParseImports(uint32_t rva, uint32_t size)
+{
+    (void)size;     // Import table is terminated with zeroed descriptor
+
+    size_t offset;
+    if (!RvaToOffset(rva, offset))
+        return;
+
+    for (size_t i = 0; i < MAX_IMPORTS && in_bounds(m_size, offset, IMPORT_DESCRIPTOR_SIZE); i++, offset += IMPORT_DESCRIPTOR_SIZE)
+    {
+        const uint32_t name_rva = get32(m_data + offset + 12);
+        if (name_rva == 0)
+            break;
+
+        size_t name_offset;
+        std::string name;
+        if (RvaToOffset(name_rva, name_offset) && ReadString(name_offset, name))
+            m_imports.push_back(name);
+    }
+}
+
+void PeReader::ParseExports(uint32_t rva, uint32_t size)
+{
+    (void)size;
+
+    size_t offset;
+    if (!RvaToOffset(rva, offset) || !in_bounds(m_size, offset, EXPORT_DIRECTORY_SIZE))
+        return;
+
+    const uint32_t number_of_names = get32(m_data + offset + 24);
+    const uint32_t address_of_names = get32(m_data + offset + 32);
+
+    size_t names_offset;
+    if (number_of_names == 0 || number_of_names > MAX_EXPORTS
+        || !RvaToOffset(address_of_names, names_offset)
+        || !in_bounds(m_size, names_offset, size_t(number_of_names) * 4))
+        return;
+
+    for (uint32_t i = 0; i < number_of_names; i++)
+    {
+        size_t name_offset;
+        std::string name;
+        if (RvaToOffset(get32(m_data + names_offset + i * 4), name_offset) && ReadString(name_offset, name))
+            m_exports.push_back(name);
+    }
+}
+
+void PeReader::ParseDebug(uint32_t rva, uint32_t size)
+{
+    size_t offset;
+    if (!RvaToOffset(rva, offset))
+        return;
+
+    for (uint32_t i = 0; i < size / DEBUG_DIRECTORY_SIZE && in_bounds(m_size, offset, DEBUG_DIRECTORY_SIZE); i++, offset += DEBUG_DIRECTORY_SIZE)
+    {
+        const uint8_t* entry = m_data + offset;
+        const uint32_t type = get32(entry + 12);
+        const uint32_t size_of_data = get32(entry + 16);
+        const uint32_t pointer_to_raw_data = get32(entry + 24);
+
+        // RSDS record: signature, GUID, age, zero terminated PDB path
+        if (type != DEBUG_TYPE_CODEVIEW || size_of_data < 24 || !in_bounds(m_size, pointer_to_raw_data, size_of_data))
+            continue;
+
+        const uint8_t* cv = m_data + pointer_to_raw_data;
+        if (get32(cv) != CV_SIGNATURE_RSDS)
+            continue;
+
+        memcpy(m_pdb_guid, cv + 4, sizeof m_pdb_guid);
+        m_pdb_age = get32(cv + 20);
+        const char* path = reinterpret_cast<const char*>(cv + 24);
+        m_pdb_path.assign(path, strnlen(path, size_of_data - 24));
+        m_has_codeview = true;
+        break;
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct PeReaderSection
+{
+    std::string name;
+    uint32_t virtual_address{};
+    uint32_t virtual_size{};
+    uint32_t raw_offset{};      // PointerToRawData
+    uint32_t raw_size{};        // SizeOfRawData
+};
+
+/// <summary>
+/// Parser of PE32+ images which works on a (memory mapped) view of the whole
+/// file. It reads headers, section table, names of imported DLLs, names of
+/// exported symbols and CodeView (RSDS) debug record with PDB GUID, age and path.
+///
+/// All offsets read from the file are bounds checked against the view, so
+/// parsing truncated or corrupted files is safe.
+///
+/// PE structures are decoded field by field from the mapped bytes.
+/// </summary>
+class PeReader
+{
+public:
+    enum Status
+    {
+        PE_OK = 0,
+        PE_ERROR_FORMAT,        // Not a PE file, or headers are truncated
+        PE_ERROR_NOT_64BIT,     // Optional header is not PE32+
+    };
+
+    uint16_t m_machine = 0;
+    uint32_t m_entry_point = 0;     // AddressOfEntryPoint (RVA)
+    uint64_t m_image_base = 0;
+    uint32_t m_size_of_image = 0;
+    uint32_t m_time_date_stamp = 0; // Link time stamp from file header
+    std::vector<PeReaderSection> m_sections;
+    std::vector<std::string> m_imports;     // Names of imported DLLs
+    std::vector<std::string> m_exports;     // Names of exported symbols
+
+    bool m_has_codeview = false;
+    uint8_t m_pdb_guid[16] = {};
+    uint32_t m_pdb_age = 0;
+    std::string m_pdb_path;
+
+    Status Parse(const uint8_t* data, size_t size);
+    bool RvaToOffset(uint32_t rva, size_t& offset) const;
+    std::string GetPdbSignature() const;
+
+    static constexpr uint16_t m_MACHINE_ARM64 = 0xAA64;
+    static constexpr uint16_t m_MACHINE_AMD64 = 0x8664;
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    uint32_t m_size_of_headers = 0;
+
+    bool ReadString(size_t offset, std::string& str) const;
+    void ParseImports(uint32_t rva, uint32_t size);
+    void ParseExports(uint32_t rva, uint32_t size);
+    void ParseDebug(uint32_t rva, uint32_t size);
+};
@@ -124,7 +124,17 @@ size_t PerfDataWriter::WriteDataSection(size_t offset)
 	return written;
 }
 
-PerfDataWriter::PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring& command)
+perfdata::perf_data_sample_id PerfDataWriter::get_sample_id(DWORD pid, UINT64 time)
+{
+	perfdata::perf_data_sample_id sample_id { 0 };
+	sample_id.pid = pid;
+	sample_id.tid = pid;
+	sample_id.time = time;
+	sample_id.id = m_sampling_events.empty() ? 0 : m_sampling_events[0];
+	return sample_id;
+}
+
+PerfDataWriter::PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring& command, UINT64 time)
 {
 	PerfDataWriter::PerfEvent var;
 	perfdata::perf_data_comm_event event { 0 };
@@ -136,12 +146,13 @@ PerfDataWriter::PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring
 
 	std::string token = MultiByteFromWideString(command.c_str());
 	memcpy(event.comm, token.c_str(), sizeof(char) * min(token.length(), 16));
+	event.sample_id = get_sample_id(pid, time);
 
 	var = event;
 	return var;
 }
 
-PerfDataWriter::PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type)
+PerfDataWriter::PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type, UINT64 time)
 {
 	PerfDataWriter::PerfEvent var;
 	perfdata::perf_data_sample_event event {0};
@@ -150,6 +161,7 @@ PerfDataWriter::PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip,
 	event.header.misc = PERF_RECORD_MISC_USER;
 	event.pid = pid;
 	event.tid = pid;
+	event.time = time;
 	event.cpu = cpu;
 	event.ip = ip;
 	event.id = event_type;
@@ -158,14 +170,15 @@ PerfDataWriter::PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip,
 	return var;
 }
 
-PerfDataWriter::PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff)
+PerfDataWriter::PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff, UINT64 time)
 {
 	PerfDataWriter::PerfEvent var;
 	perfdata::perf_data_mmap_event event{ 0 };
 
 	std::string token = MultiByteFromWideString(filename.c_str());
+	const size_t filename_size = GET_64ALIGNED_SIZE(min(token.size() + 1, PATH_MAX));
 
-	event.header.size = sizeof(event) - sizeof(event.filename) + static_cast<UINT16>(GET_64ALIGNED_SIZE(token.size()+1));
+	event.header.size = static_cast<UINT16>(sizeof(event) - sizeof(event.filename) + filename_size + sizeof(perfdata::perf_data_sample_id));
 	event.header.type = perfdata::PERF_RECORD_MMAP;
 	event.header.misc = PERF_RECORD_MISC_USER;
 	event.pid = pid;
@@ -174,8 +187,12 @@ PerfDataWriter::PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr,
 	event.len = len;
 	event.pgoff = pgoff;
 
-	memset(event.filename, 0, sizeof(char) * PATH_MAX);
-	memcpy(event.filename, token.c_str(), sizeof(char) * min(token.size()+1, PATH_MAX));
+	memset(event.filename, 0, sizeof(event.filename));
+	memcpy(event.filename, token.c_str(), sizeof(char) * min(token.size(), PATH_MAX - 1));
+
+	// Variable size event, sample_id follows (aligned) file name
+	perfdata::perf_data_sample_id sample_id = get_sample_id(pid, time);
+	memcpy(event.filename + filename_size, &sample_id, sizeof(sample_id));
 	
 	var = event;
 	return var;
@@ -662,16 +662,27 @@ namespace perfdata
 		perf_data_string* data;
 	};
 
+	// Trailer of non-sample events, see `sample_id_all` (must match sample_type
+	// we set in PerfDataWriter::RegisterSampleEvent).
+	struct perf_data_sample_id {
+		UINT32 pid, tid;
+		UINT64 time;
+		UINT64 id;
+		UINT32 cpu, res;
+	};
+
 	struct perf_data_comm_event {
 		struct perf_event_header header;
 		UINT32 pid, tid;
 		char comm[16];
+		struct perf_data_sample_id sample_id;
 	};
 
 	struct perf_data_sample_event {
 		struct perf_event_header header;
 		UINT64 ip; // Instruction point
 		UINT32 pid, tid;
+		UINT64 time;
 		UINT64 id;
 		UINT32 cpu, res;
 	};
@@ -682,7 +693,7 @@ namespace perfdata
 		UINT64 start;
 		UINT64 len;
 		UINT64 pgoff;
-		char filename[PATH_MAX];
+		char filename[PATH_MAX + sizeof(perf_data_sample_id)];	// Variable size, followed by sample_id
 	};
 }
 
@@ -723,9 +734,10 @@ private:
 	size_t WriteFeatures(size_t file_section_offset, size_t data_offset);
 	size_t WriteDataSection(size_t offset);
 
-	PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring& command);
-	PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type);
-	PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff);
+	PerfEvent PerfDataWriter::get_comm_event(DWORD pid, std::wstring& command, UINT64 time);
+	PerfEvent PerfDataWriter::get_sample_event(DWORD pid, UINT64 ip, UINT32 cpu, UINT64 event_type, UINT64 time);
+	PerfEvent PerfDataWriter::get_mmap_event(DWORD pid, UINT64 addr, UINT64 len, std::wstring& filename, UINT64 pgoff, UINT64 time);
+	perfdata::perf_data_sample_id get_sample_id(DWORD pid, UINT64 time);
 	
 public:
 	enum PerfSupportedEventTypes
@@ -768,7 +780,9 @@ public:
 	{
 		perfdata::perf_file_attr fattr{ 0 };
 		fattr.attr.size = sizeof(perfdata::perf_event_attr);
-		fattr.attr.sample_type = perfdata::PERF_SAMPLE_IP | perfdata::PERF_SAMPLE_TID | perfdata::PERF_SAMPLE_CPU | perfdata::PERF_SAMPLE_ID;
+		fattr.attr.sample_type = perfdata::PERF_SAMPLE_IP | perfdata::PERF_SAMPLE_TID | perfdata::PERF_SAMPLE_TIME | perfdata::PERF_SAMPLE_CPU | perfdata::PERF_SAMPLE_ID;
+		// COMM and MMAP events carry time too, so modules loaded during sampling are resolved by time
+		fattr.attr.sample_id_all = 1;
 		// We just need to disable flags as all are enabled by default on perf_event_attr
 		fattr.attr.disabled = 0;
 		fattr.attr.inherit = 0;
@@ -786,6 +800,7 @@ public:
 		m_sampling_events.push_back(perf_sampling_event);
 	}
 
+	// Last argument of each event is its time, in nanoseconds since sampling started.
 	template <typename... Ts>
 	void RegisterEvent(PerfSupportedEventTypes type, Ts... args)
 	{
@@ -794,7 +809,7 @@ public:
 		{
 		case COMM:
 		{
-			if constexpr (sizeof...(Ts) == 2)
+			if constexpr (sizeof...(Ts) == 3)
 			{
 				event = get_comm_event(args...);
 			}
@@ -802,7 +817,7 @@ public:
 		}
 		case SAMPLE:
 		{
-			if constexpr (sizeof...(Ts) == 4)
+			if constexpr (sizeof...(Ts) == 5)
 			{
 				event = get_sample_event(args...);
 			}
@@ -810,7 +825,7 @@ public:
 		}
 		case MMAP:
 		{
-			if constexpr (sizeof...(Ts) == 5)
+			if constexpr (sizeof...(Ts) == 6)
 			{
 				event = get_mmap_event(args...);
 			}
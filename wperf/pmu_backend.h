@@ -0,0 +1,56 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+
+enum class pmu_backend_status
+{
+    ok,
+    failed,                 // Request rejected (bad arguments, unsupported action)
+    invalid_state,          // Caller does not own the lock, see lock_denied_exception
+};
+
+/// <summary>
+/// Transport of `iorequest.h` requests between pmu_device and the PMU.
+/// By default pmu_device talks to wperf-driver with DeviceIoControl(),
+/// alternative backend (e.g. pmu_simulator) can be passed to
+/// pmu_device::init(). ACTION is enum pmu_ctl_action, IN and OUT are
+/// buffers in the same format the driver uses and RETURNED is set to
+/// number of bytes written to OUT.
+/// </summary>
+class pmu_backend
+{
+public:
+    virtual ~pmu_backend() = default;
+
+    virtual pmu_backend_status io_control(uint32_t action, const void* in, uint32_t in_size,
+        void* out, uint32_t out_size, uint32_t& returned) = 0;
+};
@@ -29,6 +29,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
+#include <algorithm>
 #include <numeric>
 #include <assert.h>
 #include "wperf-common/gitver.h"
@@ -42,6 +43,7 @@
 #include "wperf.h"
 #include "config.h"
 #include "timeline.h"
+#include "multiplex_scaling.h"
 
 #include <cfgmgr32.h>
 #include <devpkey.h>
@@ -210,6 +212,13 @@ void pmu_device::init()
     lock(do_force_lock);
 }
 
+void pmu_device::init(std::unique_ptr<pmu_backend> backend)
+{
+    m_backend = std::move(backend);
+    drvconfig::init();
+    lock(do_force_lock);
+}
+
 void pmu_device::spe_init()
 {
     if (!m_has_spe) return;
@@ -321,6 +330,13 @@ void pmu_device::core_init()
     pmu_ver = m_hw_cfg.pmu_ver;
     total_gpc_num = m_hw_cfg.total_gpc_num;
     memcpy(counter_idx_map, m_hw_cfg.counter_idx_map, sizeof(m_hw_cfg.counter_idx_map));
+
+    // Counting period range is what driver accepts
+    if (m_hw_cfg.period_max)
+    {
+        drvconfig::update(L"count.period_min", (LONG)m_hw_cfg.period_min);
+        drvconfig::update(L"count.period_max", (LONG)m_hw_cfg.period_max);
+    }
     /* Since we allocate events to GPCs greedily, in a situation where all GPCs are
     * available the n-th event is assigned to the n-th GPC. When not all GPCs are available howerver,
     * we need the `counter_idx_map` to translate to the real GPC number.
@@ -348,7 +364,7 @@ std::wstring pmu_device::get_spe_version_name()
 
 void pmu_device::dsu_init()
 {
-    m_has_dsu = detect_armh_dsu();
+    m_has_dsu = m_backend ? false : detect_armh_dsu();    // Backends do not provide DSU
     if (m_has_dsu == false)
         return;
 
@@ -385,7 +401,7 @@ void pmu_device::dsu_init()
 void pmu_device::dmc_init()
 {
     // unCore PMU - DDR controller
-    m_has_dmc = detect_armh_dma();
+    m_has_dmc = m_backend ? false : detect_armh_dma();    // Backends do not provide DMC
     if (m_has_dmc == false)
         return;
 
@@ -563,13 +579,8 @@ std::vector<std::wstring> pmu_device::get_product_names()
     return result;
 }
 
-void pmu_device::timeline_init()
+std::string pmu_device::timeline_timestamp()
 {
-    if (!timeline_mode)
-        return;
-
-    timeline::init();
-
     char buf[MAX_PATH];
     time_t rawtime;
     struct tm timeinfo;
@@ -577,6 +588,43 @@ void pmu_device::timeline_init()
     time(&rawtime);
     localtime_s(&timeinfo, &rawtime);
 
+    if (strftime(buf, sizeof(buf), "%Y_%m_%d_%H_%M_%S", &timeinfo) == 0)
+        throw fatal_exception("timestamp conversion failed in timeline mode");
+
+    return std::string(buf);
+}
+
+std::string pmu_device::timeline_filename(const std::string& timestamp, const std::string& event_class)
+{
+    std::string prefix("wperf_system_side_");
+    if (all_cores_p() == false)
+        prefix = "wperf_core_" + std::to_string(cores_idx[0]) + "_";
+
+    // Construct default timeline CSV filename ...
+    std::string filename = prefix + timestamp + "." + event_class + ".csv";
+    std::string timeline_filename = filename;
+
+    // ... and replace it with new templated one if --output <FILENAME> was speciffied for timeline (-t)
+    if (timeline_output_file.size())
+    {
+        timeline_filename = MultiByteFromWideString(timeline_output_file.c_str());
+        ReplaceTokenInString(timeline_filename, "{timestamp}", timestamp);      // Optional timestamp
+        ReplaceTokenInString(timeline_filename, "{class}", event_class);        // Event class name
+        ReplaceTokenInString(timeline_filename, "{core}", std::to_string(cores_idx[0]));           // 1st core designation
+    }
+
+    return timeline_filename;
+}
+
+void pmu_device::timeline_init()
+{
+    if (!timeline_mode)
+        return;
+
+    timeline::init();
+
+    std::string timestamp = timeline_timestamp();
+
     for (int e = EVT_CLASS_FIRST; e < EVT_CLASS_NUM; e++)
     {
         if (e == EVT_CORE && !(enc_bits & CTL_FLAG_CORE))
@@ -588,27 +636,8 @@ void pmu_device::timeline_init()
         if ((e == EVT_DMC_CLK || e == EVT_DMC_CLKDIV2) && !(enc_bits & CTL_FLAG_DMC))
             continue;
 
-        if (strftime(buf, sizeof(buf), "%Y_%m_%d_%H_%M_%S", &timeinfo) == 0)
-            throw fatal_exception("timestamp conversion failed in timeline mode");
-
-        std::string timestamp(buf);
         std::string event_class = MultiByteFromWideString(pmu_events_get_evt_class_name(static_cast<enum evt_class>(e)));
-        std::string prefix("wperf_system_side_");
-        if (all_cores_p() == false)
-            prefix = "wperf_core_" + std::to_string(cores_idx[0]) + "_";
-
-        // Construct default timeline CSV filename ...
-        std::string filename = prefix + timestamp + "." + event_class + ".csv";
-        std::string timeline_filename = filename;
-
-        // ... and replace it with new templated one if --output <FILENAME> was speciffied for timeline (-t)
-        if (timeline_output_file.size())
-        {
-            timeline_filename = MultiByteFromWideString(timeline_output_file.c_str());
-            ReplaceTokenInString(timeline_filename, "{timestamp}", timestamp);      // Optional timestamp
-            ReplaceTokenInString(timeline_filename, "{class}", event_class);        // Event class name
-            ReplaceTokenInString(timeline_filename, "{core}", std::to_string(cores_idx[0]));           // 1st core designation
-        }
+        std::string timeline_filename = this->timeline_filename(timestamp, event_class);
 
         if (do_verbose)
             m_out.GetOutputStream() << L"timeline file: " << L"'"
@@ -623,14 +652,7 @@ void pmu_device::timeline_init()
 // post_init members
 void pmu_device::post_init(std::vector<uint8_t> cores_idx_init, uint32_t dmc_idx_init, bool timeline_mode_init, uint32_t enable_bits)
 {
-    // Initliaze core numbers, please note we are sorting cores ascending
-    // because we may relay in ascending order for some simple algorithms.
-    // For example in wperf-driver::deviceControl() we only init one core
-    // per DSU cluster.
-    cores_idx = cores_idx_init;
-    std::sort(cores_idx.begin(), cores_idx.end());  // Keep this sorting!
-    // We want to keep only unique cores
-    cores_idx.erase(unique(cores_idx.begin(), cores_idx.end()), cores_idx.end());
+    set_cores_idx(cores_idx_init);
 
     dmc_idx = (uint8_t)dmc_idx_init;
     timeline_mode = timeline_mode_init;
@@ -644,6 +666,18 @@ void pmu_device::post_init(std::vector<uint8_t> cores_idx_init, uint32_t dmc_idx
     timeline_init();
 }
 
+void pmu_device::set_cores_idx(std::vector<uint8_t> cores)
+{
+    // Initliaze core numbers, please note we are sorting cores ascending
+    // because we may relay in ascending order for some simple algorithms.
+    // For example in wperf-driver::deviceControl() we only init one core
+    // per DSU cluster.
+    cores_idx = cores;
+    std::sort(cores_idx.begin(), cores_idx.end());  // Keep this sorting!
+    // We want to keep only unique cores
+    cores_idx.erase(unique(cores_idx.begin(), cores_idx.end()), cores_idx.end());
+}
+
 void pmu_device::timeline_close()
 {
     timeline::print();
@@ -660,7 +694,8 @@ pmu_device::~pmu_device()
     {
         m_out.GetErrorOutputStream() << L"error: " << WideStringFromMultiByte(e.what()) << std::endl;
     }
-    CloseHandle(m_device_handle);
+    if (m_device_handle)
+        CloseHandle(m_device_handle);
 }
 
 void pmu_device::set_sample_src(std::vector<struct evt_sample_src>& sample_sources, bool sample_kernel)
@@ -687,7 +722,7 @@ void pmu_device::set_sample_src(std::vector<struct evt_sample_src>& sample_sourc
         sz = sizeof(PMUSampleSetSrcHdr) + sizeof(SampleSrcDesc);
         ctl = reinterpret_cast<PMUSampleSetSrcHdr*>(new uint8_t[sz]);
         ctl->sources[0].event_src = CYCLE_EVT_IDX;
-        ctl->sources[0].interval = 0x8000000;
+        ctl->sources[0].interval = SAMPLE_SRC_DEFAULT_INTERVAL;
         ctl->sources[0].filter_bits = sample_kernel ? 0 : FILTER_BIT_EXCL_EL1;
     }
 
@@ -721,7 +756,59 @@ bool pmu_device::get_sample(std::vector<FrameChain>& sample_info)
     return true;
 }
 
-void pmu_device::start_sample()
+/* In histogram mode driver does not send every sample, it counts samples per (PC, counter)
+*  pair instead. Each histogram entry is returned as one frame (without LR) and its weight
+*  (how many times it was sampled) is stored in SAMPLE_WEIGHT at the same index.
+*  Return false if histogram was empty.
+*/
+bool pmu_device::get_sample_histogram(std::vector<FrameChain>& sample_info, std::vector<uint32_t>& sample_weight)
+{
+    struct PMUCtlGetSampleHdr hdr;
+    hdr.core_idx = cores_idx[0];
+    DWORD res_len;
+
+    // Histogram payload is too big for the stack
+    auto histogram = std::make_unique<PMUSampleHistogramPayload>();
+
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_GET_HISTOGRAM, &hdr, sizeof(struct PMUCtlGetSampleHdr), histogram.get(), sizeof(PMUSampleHistogramPayload), &res_len);
+    if (!status)
+        throw fatal_exception("PMU_CTL_SAMPLE_GET_HISTOGRAM failed");
+
+    if (histogram->size == 0)
+        return false;
+
+    for (UINT32 i = 0; i < histogram->size && i < PC_HISTOGRAM_SIZE; i++)
+    {
+        const PCHistogramEntry& entry = histogram->payload[i];
+        FrameChain frame = { 0 };
+        frame.pc = entry.pc;
+        frame.ov_flags = 1ULL << entry.counter_idx;
+        sample_info.push_back(frame);
+        sample_weight.push_back(entry.count);
+    }
+
+    return true;
+}
+
+/* Change intervals of counters which are already sampling. Driver does not stop
+*  counters, new interval is used when counter overflows next time.
+*/
+void pmu_device::set_sample_interval(const std::map<uint32_t, uint32_t>& intervals)
+{
+    struct PMUSampleSetIntervalHdr hdr = { 0 };
+    hdr.core_idx = cores_idx[0];
+    DWORD res_len;
+
+    for (const auto& [counter_idx, interval] : intervals)
+        if (counter_idx < _countof(hdr.interval))
+            hdr.interval[counter_idx] = interval;
+
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_SET_INTERVAL, &hdr, sizeof(struct PMUSampleSetIntervalHdr), NULL, 0, &res_len);
+    if (!status)
+        throw fatal_exception("PMU_CTL_SAMPLE_SET_INTERVAL failed");
+}
+
+void pmu_device::start_sample(bool histogram)
 {
     struct pmu_ctl_hdr ctl;
     DWORD res_len;
@@ -729,6 +816,8 @@ void pmu_device::start_sample()
     ctl.cores_idx.cores_count = 1;
     ctl.cores_idx.cores_no[0] = cores_idx[0];
     ctl.flags = CTL_FLAG_CORE;
+    if (histogram)
+        ctl.flags |= CTL_FLAG_SAMPLE_HISTOGRAM;
 
     BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_SAMPLE_START, &ctl, sizeof(struct pmu_ctl_hdr), NULL, 0, &res_len);
     if (!status)
@@ -1071,6 +1160,48 @@ void pmu_device::events_assign(uint32_t core_idx, std::map<enum evt_class, std::
     ctl->dmc_idx = dmc_idx;
     count_kernel = include_kernel;
     ctl->filter_bits = count_kernel ? 0 : FILTER_BIT_EXCL_EL1;
+
+    // Consecutive events of the same group get the same (non-zero) unit id so driver
+    // schedules them together when multiplexing, see mux_init(). Weights from
+    // `--config mux.weights=...` are given to units in order, padding events keep
+    // the default weight.
+    if (events.count(EVT_CORE))
+    {
+        std::wstring weights_str;
+        std::vector<UINT8> weights;
+        if (drvconfig::get(L"mux.weights", weights_str) && weights_str.size())
+            drvconfig::parse_weights(weights_str, weights);
+
+        const auto& core_events = events[EVT_CORE];
+        uint8_t unit_id = 0;
+        size_t unit_idx = 0;
+        int prev_group = EVT_NOTED_NO_GROUP;
+        for (size_t i = 0; i < core_events.size() && i < MAX_MANAGED_CORE_EVENTS; i++)
+        {
+            const bool padding = core_events[i].type == EVT_PADDING;
+            const int group = padding ? EVT_NOTED_NO_GROUP : core_events[i].group;
+            const bool unit_start = !padding && (group == EVT_NOTED_NO_GROUP || group != prev_group);
+
+            if (group != EVT_NOTED_NO_GROUP)
+            {
+                if (group != prev_group)
+                    unit_id = unit_id == UINT8_MAX ? 1 : unit_id + 1;
+                ctl->core_groups[i] = unit_id;
+            }
+
+            if (unit_start && unit_idx < weights.size())
+                ctl->core_weights[i] = weights[unit_idx];
+            if (unit_start)
+                unit_idx++;
+
+            prev_group = group;
+        }
+
+        if (weights.size() > unit_idx)
+            warning(L"mux.weights has " + std::to_wstring(weights.size()) + L" weights but there are only "
+                + std::to_wstring(unit_idx) + L" core event units, extra weights are ignored");
+    }
+
     uint16_t* ctl2 =
         reinterpret_cast<uint16_t*>(buf.get() + sizeof(struct pmu_ctl_evt_assign_hdr));
 
@@ -1118,6 +1249,35 @@ void pmu_device::core_events_read()
     }
 }
 
+/* Read counters of the core the calling thread runs on (`core_no`) without stopping
+*  them. Only the device handle is used so this is safe to call from many threads.
+*  If the thread was migrated `out.core_idx` differs from `core_no`.
+*/
+void pmu_device::core_events_read_live(uint32_t core_no, struct PMUReadLiveOut& out)
+{
+    struct PMUCtlReadLiveHdr ctl;
+    DWORD res_len;
+
+    ctl.core_idx = core_no;
+
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_READ_COUNTING_LIVE, &ctl, (DWORD)sizeof(struct PMUCtlReadLiveHdr), &out, (DWORD)sizeof(struct PMUReadLiveOut), &res_len);
+    if (!status)
+        throw fatal_exception("PMU_CTL_READ_COUNTING_LIVE failed");
+}
+
+void pmu_device::query_overhead(OverheadOut& out)
+{
+    DWORD res_len;
+
+    enum pmu_ctl_action action = PMU_CTL_QUERY_OVERHEAD;
+    BOOL status = DeviceAsyncIoControl(m_device_handle, PMU_CTL_QUERY_OVERHEAD, &action, (DWORD)sizeof(enum pmu_ctl_action), &out, (DWORD)sizeof(OverheadOut), &res_len);
+    if (!status)
+        throw fatal_exception("PMU_CTL_QUERY_OVERHEAD failed");
+
+    if (res_len != sizeof(OverheadOut))
+        throw fatal_exception("PMU_CTL_QUERY_OVERHEAD returned unexpected length of data");
+}
+
 void pmu_device::dsu_events_read_nth(uint8_t core_no)
 {
     struct pmu_ctl_hdr ctl;
@@ -1157,6 +1317,26 @@ void pmu_device::dmc_events_read(void)
         throw fatal_exception("DMC_CTL_READ_COUNTING failed");
 }
 
+const DMCReadOut& pmu_device::dmc_rdwr_read(std::vector<uint64_t>& rdwr)
+{
+    dmc_events_read();
+
+    uint8_t ch_base = dmc_idx == ALL_DMC_CHANNEL ? 0 : dmc_idx;
+    uint8_t ch_end = dmc_idx == ALL_DMC_CHANNEL ? (uint8_t)dmc_regions.size() : (uint8_t)(dmc_idx + 1);
+
+    rdwr.assign(ch_end - ch_base, 0);
+    for (uint8_t i = ch_base; i < ch_end; i++)
+    {
+        const DMCReadOut& out = dmc_outs[i];
+        for (int j = 0; j < out.clkdiv2_events_num; j++)
+            if (out.clkdiv2_events[j].event_idx == DMC_EVENT_RDWR)
+                rdwr[i - ch_base] = out.clkdiv2_events[j].value;
+    }
+
+    // Counting DPC refreshes all monitored channels at once
+    return dmc_outs[ch_base];
+}
+
 void pmu_device::do_version_query(_Out_ version_info& driver_ver)
 {
     struct pmu_ctl_ver_hdr ctl;
@@ -1285,6 +1465,18 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
         std::vector<std::wstring> col_event_name, col_event_idx,
             col_multiplexed, col_event_note;
         std::vector<uint64_t> col_counter_value, col_scaled_value;
+        std::vector<double> col_scaling_error;
+
+        // Driver accounts multiplexing time in cycles, fall back to timer rounds if it did not.
+        auto scaled_value = [round](const struct pmu_event_usr* evt) {
+            if (evt->time_enabled)
+                return MultiplexScaling::ScaledValue(evt->value, evt->time_enabled, evt->time_running);
+            return MultiplexScaling::ScaledValue(evt->value, round, evt->scheduled);
+        };
+        auto scaling_error = [](const struct pmu_event_usr* evt) {
+            return MultiplexScaling::ScalingError(evt->value, evt->time_enabled, evt->time_running,
+                                                  evt->scheduled, evt->slice_sq_lo, evt->slice_sq_hi);
+        };
 
         for (size_t j = 0; j < evt_num; j++)
         {
@@ -1315,7 +1507,8 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
                     col_event_idx.push_back(L"fixed");
                     col_event_note.push_back(L"e");
                     col_multiplexed.push_back(std::to_wstring(evt->scheduled) + L"/" + std::to_wstring(round));
-                    col_scaled_value.push_back((uint64_t)((double)evt->value / ((double)evt->scheduled / (double)round)));
+                    col_scaled_value.push_back(scaled_value(evt));
+                    col_scaling_error.push_back(scaling_error(evt));
                 }
                 else {
                     col_counter_value.push_back(evt->value);
@@ -1323,13 +1516,14 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
                     col_event_idx.push_back(IntToHexWideString(evt->event_idx, 2));
                     col_event_note.push_back(events[j - 1].note);
                     col_multiplexed.push_back(std::to_wstring(evt->scheduled) + L"/" + std::to_wstring(round));
-                    col_scaled_value.push_back((uint64_t)((double)evt->value / ((double)evt->scheduled / (double)round)));
+                    col_scaled_value.push_back(scaled_value(evt));
+                    col_scaling_error.push_back(scaling_error(evt));
                 }
 
                 if (overall)
                 {
                     overall[j].counter_value += evt->value;
-                    overall[j].scaled_value += (uint64_t)((double)evt->value / ((double)evt->scheduled / (double)round));
+                    overall[j].scaled_value += scaled_value(evt);
                 }
             }
             else
@@ -1355,12 +1549,13 @@ void pmu_device::print_core_stat(std::vector<struct evt_noted>& events)
 
         if (multiplexing)
         {
-            TableOutput<PerformanceCounterOutputTraitsL<true>, GlobalCharType> table(m_outputType);
+            TableOutput<PerformanceCounterOutputTraitsL<true, true>, GlobalCharType> table(m_outputType);
             table.PresetHeaders();
             table.SetAlignment(0, ColumnAlignL::RIGHT);
             table.SetAlignment(4, ColumnAlignL::RIGHT);
             table.SetAlignment(5, ColumnAlignL::RIGHT);
-            table.Insert(col_counter_value, col_event_name, col_event_idx, col_event_note, col_multiplexed, col_scaled_value);
+            table.SetAlignment(6, ColumnAlignL::RIGHT);
+            table.Insert(col_counter_value, col_event_name, col_event_idx, col_event_note, col_multiplexed, col_scaled_value, col_scaling_error);
             if (!timeline_mode)
                 m_out.Print(table);
             table.m_core = GlobalStringType(std::to_wstring(i));
@@ -1568,6 +1763,74 @@ void pmu_device::print_core_metrics(std::vector<struct evt_noted>& events)
     }
 }
 
+/// <summary>
+/// Report how much counting on `cores_idx` cost: counting DPCs and PMU interrupts of each
+/// core (since last reset()), all IOCTLs of this session and wperf post-processing of the
+/// last counting (`post_processing_ns`). `overhead` is in percent of DURATION (seconds).
+/// Table is printed with `-v` only, JSON output always gets it: stat JSON or, when
+/// SAMPLING, sampling JSON (PMU interrupts are reset when sampling starts).
+/// </summary>
+void pmu_device::print_overhead(double duration, uint64_t post_processing_ns, bool sampling)
+{
+    OverheadOut overhead;
+    query_overhead(overhead);
+
+    std::vector<std::wstring> col_path, col_core;
+    std::vector<uint64_t> col_calls, col_total, col_avg, col_max;
+    std::vector<double> col_overhead;
+
+    auto add_row = [&](const wchar_t* path, const std::wstring& core, const struct overhead_stat& stat) {
+        col_path.push_back(path);
+        col_core.push_back(core);
+        col_calls.push_back(stat.calls);
+        col_total.push_back(stat.time_ns);
+        col_avg.push_back(stat.calls ? stat.time_ns / stat.calls : 0);
+        col_max.push_back(stat.max_ns);
+        col_overhead.push_back(duration > 0 ? 100.0 * stat.time_ns / (duration * 1000000000.0) : 0);
+    };
+
+    for (uint8_t i : cores_idx)
+    {
+        if (i >= overhead.core_num)
+            continue;
+
+        add_row(L"dpc", std::to_wstring(i), overhead.dpc[i]);
+        if (overhead.isr[i].calls)
+            add_row(L"isr", std::to_wstring(i), overhead.isr[i]);
+    }
+
+    add_row(L"ioctl", L"all", overhead.ioctl);
+
+    struct overhead_stat post_processing = { 1, post_processing_ns, post_processing_ns };
+    add_row(L"post_processing", L"all", post_processing);
+
+    TableOutput<OverheadOutputTraitsL, GlobalCharType> table(m_outputType);
+    table.PresetHeaders();
+    table.SetAlignment(2, ColumnAlignL::RIGHT);
+    table.SetAlignment(3, ColumnAlignL::RIGHT);
+    table.SetAlignment(4, ColumnAlignL::RIGHT);
+    table.SetAlignment(5, ColumnAlignL::RIGHT);
+    table.SetAlignment(6, ColumnAlignL::RIGHT);
+    table.Insert(col_path, col_core, col_calls, col_total, col_avg, col_max, col_overhead);
+    if (sampling)
+    {
+        m_globalSamplingJSON.m_overhead = table;
+        m_globalSamplingJSON.m_hasOverhead = true;
+    }
+    else
+    {
+        m_globalJSON.m_overhead = table;
+        m_globalJSON.m_hasOverhead = true;
+    }
+
+    if (do_verbose && !timeline_mode)
+    {
+        m_out.GetOutputStream() << std::endl;
+        m_out.GetOutputStream() << L"Profiler overhead:" << std::endl;
+        m_out.Print(table);
+    }
+}
+
 void pmu_device::print_dsu_stat(std::vector<struct evt_noted>& events, bool report_l3_metric)
 {
     const enum evt_class e_class = EVT_DSU;
@@ -2187,6 +2450,464 @@ void pmu_device::print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::
     }
 }
 
+// Driver counting timer refreshes counters every `count.period`, without
+// multiplexing it only has to read them before they overflow and runs every
+// two periods.
+LONG pmu_device::counting_timer_period()
+{
+    LONG period = PMU_CTL_START_PERIOD;
+    drvconfig::get(L"count.period", period);
+
+    return (multiplexings[EVT_CORE] || multiplexings[EVT_DSU]) ? period : 2 * period;
+}
+
+void pmu_device::ddr_monitor_init(double interval)
+{
+    std::vector<uint32_t> channels;
+    if (dmc_idx == ALL_DMC_CHANNEL)
+    {
+        channels.resize(dmc_regions.size());
+        std::iota(channels.begin(), channels.end(), 0);
+    }
+    else
+    {
+        channels.push_back(dmc_idx);
+    }
+
+    // Driver refreshes DMC counters from its counting timer, reading more often
+    // than that only shows the same values.
+    const LONG period = counting_timer_period();
+    const double refresh = period / 1000000.0;
+
+    if (interval < refresh)
+        warning(L"ddr monitor interval " + DoubleToWideString(interval * 1000.0) + L"ms is shorter than DMC counters refresh "
+            + DoubleToWideString(refresh * 1000.0) + L"ms, use `--config count.period=<N>` to refresh them more often");
+
+    m_ddr_monitor = std::make_unique<DdrBandwidthMonitor>(channels);
+    m_ddr_monitor_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+    m_ddr_monitor_epoch_ns = 0;
+    m_ddr_monitor_period_ns = (uint64_t)period * 1000;      // Until read-outs show the real one
+
+    std::string filename = timeline_filename(timeline_timestamp(), "ddr_bw");
+    m_ddr_monitor_file.open(filename);
+    if (!m_ddr_monitor_file.is_open())
+    {
+        m_out.GetErrorOutputStream() << L"ddr monitor: can't open '" << std::wstring(filename.begin(), filename.end()) << L"'" << std::endl;
+        throw fatal_exception("ERROR_DDR_MONITOR_FILE");
+    }
+
+    m_ddr_monitor->WriteCsvHeader(m_ddr_monitor_file);
+
+    m_out.GetOutputStream() << L"ddr monitor: sampling every " << DoubleToWideString(interval * 1000.0) << L"ms to '"
+                            << std::wstring(filename.begin(), filename.end()) << L"'" << std::endl;
+}
+
+// Take baseline of DMC counters, call after counting was (re)started.
+void pmu_device::ddr_monitor_start()
+{
+    std::vector<uint64_t> rdwr;
+
+    const DMCReadOut& out = dmc_rdwr_read(rdwr);
+    if (m_ddr_monitor_epoch_ns == 0)
+        m_ddr_monitor_epoch_ns = out.refresh_time_ns;
+
+    m_ddr_monitor->Start((out.refresh_time_ns - m_ddr_monitor_epoch_ns) / 1e9, rdwr);
+    m_ddr_monitor_round = out.round;
+    m_ddr_monitor_refresh_ns = out.refresh_time_ns;
+    m_ddr_monitor_next = std::chrono::steady_clock::now() + m_ddr_monitor_interval;
+}
+
+// Samples are timed by the driver: `rdwr` totals cover the time between two
+// refreshes of DMC counters by the counting DPC, not between our reads.
+void pmu_device::ddr_monitor_poll(std::chrono::steady_clock::time_point now)
+{
+    std::vector<uint64_t> rdwr;
+
+    const DMCReadOut& out = dmc_rdwr_read(rdwr);
+    if (out.round == m_ddr_monitor_round)
+    {
+        // Not refreshed since the last sample, read again when the next refresh is due
+        // (or shortly if the DPC is late)
+        const uint64_t due_ns = m_ddr_monitor_refresh_ns + m_ddr_monitor_period_ns;
+        const uint64_t wait_ns = due_ns > out.read_time_ns ? due_ns - out.read_time_ns : m_ddr_monitor_period_ns / 8;
+        m_ddr_monitor_next = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(wait_ns));
+        return;
+    }
+
+    if (out.round > m_ddr_monitor_round && out.refresh_time_ns > m_ddr_monitor_refresh_ns)
+        m_ddr_monitor_period_ns = (out.refresh_time_ns - m_ddr_monitor_refresh_ns) / (out.round - m_ddr_monitor_round);
+
+    if (m_ddr_monitor->Update((out.refresh_time_ns - m_ddr_monitor_epoch_ns) / 1e9, rdwr))
+        m_ddr_monitor->WriteCsvRow(m_ddr_monitor_file);
+
+    m_ddr_monitor_round = out.round;
+    m_ddr_monitor_refresh_ns = out.refresh_time_ns;
+
+    // Do not catch up with reads we were late for, keep the cadence from now on
+    m_ddr_monitor_next += m_ddr_monitor_interval;
+    if (m_ddr_monitor_next <= now)
+        m_ddr_monitor_next = now + m_ddr_monitor_interval;
+}
+
+// Sleep MS while taking DDR bandwidth (`--ddr-monitor`) and heatmap (`--heatmap`)
+// samples when they are due.
+void pmu_device::monitor_sleep(DWORD ms)
+{
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+
+    for (;;)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto wake = until;
+
+        if (m_ddr_monitor)
+        {
+            if (now >= m_ddr_monitor_next)
+                ddr_monitor_poll(now);
+            wake = (std::min)(wake, m_ddr_monitor_next);
+        }
+
+        if (m_heatmap)
+        {
+            if (now >= m_heatmap_next)
+                heatmap_poll(now);
+            wake = (std::min)(wake, m_heatmap_next);
+        }
+
+        if (now >= until)
+            break;
+
+        const auto wait_ms = std::chrono::ceil<std::chrono::milliseconds>(wake - now).count();
+        Sleep((DWORD)(std::max)(wait_ms, 1LL));
+    }
+}
+
+void pmu_device::print_ddr_monitor()
+{
+    const DdrBandwidthMonitor& mon = *m_ddr_monitor;
+
+    std::vector<std::wstring> col_channel;
+    std::vector<uint64_t> col_samples;
+    std::vector<double> col_avg, col_p50, col_p90, col_p99, col_max, col_share;
+
+    auto add_row = [&](const std::wstring& channel, const LogHistogram& hist, double share) {
+        col_channel.push_back(channel);
+        col_samples.push_back(hist.Count());
+        col_avg.push_back(hist.Mean());
+        col_p50.push_back(hist.Percentile(50.0));
+        col_p90.push_back(hist.Percentile(90.0));
+        col_p99.push_back(hist.Percentile(99.0));
+        col_max.push_back(hist.Max());
+        col_share.push_back(share);
+    };
+
+    for (size_t i = 0; i < mon.Channels().size(); i++)
+        add_row(L"dmc " + std::to_wstring(mon.Channels()[i]), mon.Channel(i), mon.Share(i));
+    add_row(L"all", mon.Total(), mon.Samples() ? 100.0 : 0.0);
+
+    TableOutput<DdrMonitorOutputTraitsL, GlobalCharType> table(m_outputType);
+    table.PresetHeaders();
+    table.SetAlignment(0, ColumnAlignL::RIGHT);
+    table.SetAlignment(1, ColumnAlignL::RIGHT);
+    table.Insert(col_channel, col_samples, col_avg, col_p50, col_p90, col_p99, col_max, col_share);
+
+    const LogHistogram& imb = mon.Imbalance();
+    TableOutput<DdrImbalanceOutputTraitsL, GlobalCharType> table_imbalance(m_outputType);
+    table_imbalance.PresetHeaders();
+    table_imbalance.SetAlignment(0, ColumnAlignL::RIGHT);
+    table_imbalance.Insert(std::vector<uint64_t>{ imb.Count() }, std::vector<double>{ imb.Mean() },
+        std::vector<double>{ imb.Percentile(50.0) }, std::vector<double>{ imb.Percentile(90.0) },
+        std::vector<double>{ imb.Percentile(99.0) }, std::vector<double>{ imb.Max() });
+
+    m_globalJSON.m_ddrMonitor = table;
+    m_globalJSON.m_ddrImbalance = table_imbalance;
+    m_globalJSON.m_hasDdrMonitor = true;
+
+    if (timeline_mode)
+        return;
+
+    m_out.GetOutputStream() << std::endl
+        << L"ddr bandwidth (MB/s) over " << DoubleToWideString(mon.Duration()) << L"s:" << std::endl;
+    m_out.Print(table);
+
+    m_out.GetOutputStream() << std::endl
+        << L"ddr channel imbalance (busiest / mean channel):" << std::endl;
+    m_out.Print(table_imbalance);
+}
+
+void pmu_device::heatmap_init(double interval, const std::vector<struct evt_noted>& events)
+{
+    std::vector<std::wstring> metric_names;
+    std::vector<uint32_t> cores(cores_idx.begin(), cores_idx.end());
+
+    m_heatmap_metrics.clear();
+
+    // Heatmap shows Telemetry Solution metrics requested with `-m`, see print_core_metrics().
+    // Each metric is calculated from the first group of events it was scheduled with.
+    for (auto it = events.begin(); it != events.end(); it++)
+    {
+        const struct evt_noted& event = *it;
+
+        if (event.metric.empty() || m_product_name.empty())
+            continue;
+
+        if (m_product_metrics.count(m_product_name) == 0 || m_product_metrics[m_product_name].count(event.metric) == 0)
+            continue;
+
+        auto found = std::find(metric_names.begin(), metric_names.end(), event.metric);
+        size_t m = found - metric_names.begin();
+
+        if (found == metric_names.end())
+        {
+            metric_names.push_back(event.metric);
+            m_heatmap_metrics.push_back({ event.group, m_product_metrics[m_product_name][event.metric].metric_formula_sy, {} });
+        }
+
+        if (m_heatmap_metrics[m].group != event.group)
+            continue;
+
+        // Index 0 of ReadOut.evts is the cycle counter
+        const uint32_t index = (uint32_t)(it - events.begin() + 1);
+        m_heatmap_metrics[m].vars.push_back({ index, pmu_events_get_event_name(event.index) });
+    }
+
+    if (m_heatmap_metrics.empty())
+    {
+        m_out.GetErrorOutputStream() << L"heatmap: no Telemetry Solution metric to show, specify metrics with `-m`" << std::endl;
+        throw fatal_exception("ERROR_HEATMAP");
+    }
+
+    m_heatmap = std::make_unique<CoreHeatmap>(cores, metric_names);
+    m_heatmap_prev = std::make_unique<ReadOut[]>(core_num);
+    m_heatmap_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval));
+    m_heatmap_epoch = std::chrono::steady_clock::now();
+    m_heatmap_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::microseconds(counting_timer_period()));  // Until `round` deltas show the real one
+
+    m_heatmap_filename = timeline_filename(timeline_timestamp(), "heatmap");
+
+    m_out.GetOutputStream() << L"heatmap: " << metric_names.size() << L" metrics on " << cores.size() << L" cores every "
+                            << DoubleToWideString(interval * 1000.0) << L"ms to '"
+                            << std::wstring(m_heatmap_filename.begin(), m_heatmap_filename.end()) << L"'" << std::endl;
+}
+
+// Take baseline of core counters, call after counting was (re)started.
+void pmu_device::heatmap_start()
+{
+    core_events_read();
+    for (uint8_t core_no : cores_idx)
+        m_heatmap_prev[core_no] = core_outs[core_no];
+
+    m_heatmap_prev_time = std::chrono::steady_clock::now();
+    m_heatmap_next = m_heatmap_prev_time + m_heatmap_interval;
+}
+
+void pmu_device::heatmap_poll(std::chrono::steady_clock::time_point now)
+{
+    core_events_read();
+
+    // Counting DPC publishes counter values once per tick, wait until every core had one.
+    // Come back when the next one is due (or shortly if the DPC is late).
+    uint64_t rounds = UINT64_MAX;
+    for (uint8_t core_no : cores_idx)
+        rounds = (std::min)(rounds, core_outs[core_no].round - m_heatmap_prev[core_no].round);
+
+    if (rounds == 0)
+    {
+        m_heatmap_next = m_heatmap_prev_time + m_heatmap_period;
+        if (m_heatmap_next <= now)
+            m_heatmap_next = now + m_heatmap_period / 8;
+        return;
+    }
+
+    if (rounds != UINT64_MAX)
+        m_heatmap_period = (now - m_heatmap_prev_time) / rounds;
+
+    const size_t lanes = cores_idx.size();
+    std::vector<std::vector<double>> values;
+
+    for (const auto& metric : m_heatmap_metrics)
+    {
+        std::map<std::wstring, std::vector<double>> vars;
+
+        for (const auto& [index, name] : metric.vars)
+        {
+            std::vector<double>& lane = vars[name];
+            lane.resize(lanes);
+
+            for (size_t c = 0; c < lanes; c++)
+            {
+                const struct pmu_event_usr& curr = core_outs[cores_idx[c]].evts[index];
+                const struct pmu_event_usr& prev = m_heatmap_prev[cores_idx[c]].evts[index];
+                uint64_t delta = curr.value - prev.value;
+
+                if (multiplexings[EVT_CORE])
+                    delta = MultiplexScaling::ScaledValue(delta, curr.time_enabled - prev.time_enabled, curr.time_running - prev.time_running);
+
+                lane[c] = static_cast<double>(delta);
+            }
+        }
+
+        values.push_back(metric_calculate_shunting_yard_expression(vars, metric.formula_sy, lanes));
+    }
+
+    m_heatmap->AddInterval(std::chrono::duration<double>(now - m_heatmap_epoch).count(), values);
+
+    for (uint8_t core_no : cores_idx)
+        m_heatmap_prev[core_no] = core_outs[core_no];
+    m_heatmap_prev_time = now;
+
+    m_heatmap_next += m_heatmap_interval;
+    if (m_heatmap_next <= now)
+        m_heatmap_next = now + m_heatmap_interval;
+}
+
+/// <summary>
+/// Write heatmap file (all intervals so far) and report every metric across
+/// cores: min / median / p99 / max of per core means over all intervals, and
+/// the core with the highest mean.
+/// </summary>
+void pmu_device::print_heatmap()
+{
+    const CoreHeatmap& heatmap = *m_heatmap;
+
+    std::wofstream heatmap_file(m_heatmap_filename);
+    if (!heatmap_file.is_open())
+    {
+        m_out.GetErrorOutputStream() << L"heatmap: can't open '" << std::wstring(m_heatmap_filename.begin(), m_heatmap_filename.end()) << L"'" << std::endl;
+        throw fatal_exception("ERROR_HEATMAP");
+    }
+    heatmap.WriteCsv(heatmap_file);
+
+    std::vector<std::wstring> col_metric, col_max_core;
+    std::vector<uint64_t> col_intervals;
+    std::vector<double> col_min, col_median, col_p99, col_max;
+
+    for (size_t m = 0; m < heatmap.Metrics().size(); m++)
+    {
+        CoreHeatmap::Summary summary = heatmap.CoreSummary(m);
+
+        size_t max_core = 0;
+        for (size_t c = 1; c < heatmap.Cores().size(); c++)
+            if (heatmap.CoreMean(m, c) > heatmap.CoreMean(m, max_core))
+                max_core = c;
+
+        col_metric.push_back(heatmap.Metrics()[m]);
+        col_intervals.push_back(heatmap.Intervals());
+        col_min.push_back(summary.min);
+        col_median.push_back(summary.median);
+        col_p99.push_back(summary.p99);
+        col_max.push_back(summary.max);
+        col_max_core.push_back(std::to_wstring(heatmap.Cores()[max_core]));
+    }
+
+    TableOutput<HeatmapOutputTraitsL, GlobalCharType> table(m_outputType);
+    table.PresetHeaders();
+    table.SetAlignment(0, ColumnAlignL::LEFT);
+    table.SetAlignment(6, ColumnAlignL::RIGHT);
+    table.Insert(col_metric, col_intervals, col_min, col_median, col_p99, col_max, col_max_core);
+
+    m_globalJSON.m_heatmap = table;
+    m_globalJSON.m_hasHeatmap = true;
+
+    if (timeline_mode)
+        return;
+
+    m_out.GetOutputStream() << std::endl
+        << L"heatmap (per core mean over " << heatmap.Intervals() << L" intervals, across " << heatmap.Cores().size() << L" cores):" << std::endl;
+    m_out.Print(table);
+}
+
+/// <summary>
+/// Evaluate and print Arm Topdown tree of PLAN. Event values of every event
+/// group of the plan are summed over all counted cores (scaled when
+/// multiplexed) and every metric is calculated from its event group.
+/// Stage 1 metrics are printed from the highest value, each followed by
+/// metrics of stage 2 groups it drills down into.
+/// </summary>
+void pmu_device::print_topdown(const TopdownPlan& plan, const std::vector<struct evt_noted>& events)
+{
+    std::vector<std::map<std::wstring, double>> group_vars(plan.EventGroups().size());
+
+    for (uint32_t i : cores_idx)
+    {
+        struct pmu_event_usr* evts = core_outs[i].evts;
+        uint64_t round = core_outs[i].round;
+
+        for (auto it = events.begin(); it != events.end(); it++)
+        {
+            const auto& event = *it;
+            const size_t group = plan.EventGroupIndex(event.group);
+
+            if (event.metric != L"topdown" || group == SIZE_MAX)
+                continue;
+
+            const auto index = it - events.begin() + 1;
+            assert(index < core_outs[i].evt_num);
+            struct pmu_event_usr* evt = &evts[index];
+
+            uint64_t value = evt->value;
+            if (multiplexings[EVT_CORE])
+                value = evt->time_enabled ? MultiplexScaling::ScaledValue(evt->value, evt->time_enabled, evt->time_running)
+                                          : MultiplexScaling::ScaledValue(evt->value, round, evt->scheduled);
+
+            group_vars[group][pmu_events_get_event_name((uint16_t)evt->event_idx)] += static_cast<double>(value);
+        }
+    }
+
+    std::map<std::wstring, double> values;
+    for (const auto& metric : plan.Metrics())
+    {
+        const auto& formula_sy = m_product_metrics[m_product_name][metric].metric_formula_sy;
+        values[metric] = metric_calculate_shunting_yard_expression(group_vars[plan.EventGroupOf(metric)], formula_sy);
+    }
+
+    std::vector<TopdownPlan::Node> stage1 = plan.Stage1();
+    std::stable_sort(stage1.begin(), stage1.end(),
+        [&values](const auto& a, const auto& b) { return values[a.metric] > values[b.metric]; });
+
+    std::vector<uint64_t> col_stage;
+    std::vector<std::wstring> col_parent, col_group, col_metric, col_unit;
+    std::vector<double> col_value;
+
+    auto add_row = [&](uint64_t stage, const std::wstring& parent, const std::wstring& group, const std::wstring& metric) {
+        col_stage.push_back(stage);
+        col_parent.push_back(parent);
+        col_group.push_back(group);
+        col_metric.push_back(metric);
+        col_value.push_back(values[metric]);
+        col_unit.push_back(m_product_metrics[m_product_name][metric].metric_unit);
+    };
+
+    for (const auto& node : stage1)
+    {
+        add_row(1, L"-", plan.Stage1Group(), node.metric);
+
+        for (const auto& group : node.groups)
+            for (const auto& metric : plan.GroupMetrics(group))
+                add_row(2, node.metric, group, metric);
+    }
+
+    TableOutput<TopdownOutputTraitsL, GlobalCharType> table(m_outputType);
+    table.PresetHeaders();
+    table.SetAlignment(1, ColumnAlignL::LEFT);
+    table.SetAlignment(2, ColumnAlignL::LEFT);
+    table.SetAlignment(3, ColumnAlignL::LEFT);
+    table.SetAlignment(5, ColumnAlignL::LEFT);
+    table.Insert(col_stage, col_parent, col_group, col_metric, col_value, col_unit);
+
+    m_globalJSON.m_topdown = table;
+    m_globalJSON.m_hasTopdown = true;
+
+    if (timeline_mode)
+        return;
+
+    m_out.GetOutputStream() << std::endl
+        << L"Topdown analysis (" << plan.Stage1Group() << L", " << plan.Metrics().size() << L" metrics in "
+        << plan.EventGroups().size() << L" event groups" << (multiplexings[EVT_CORE] ? L", multiplexed" : L"")
+        << L", " << cores_idx.size() << L" cores):" << std::endl;
+    m_out.Print(table);
+}
+
 void pmu_device::do_list_prep_events(_Out_ std::vector<std::wstring>& col_alias_name,
     _Out_ std::vector<std::wstring>& col_raw_index,
     _Out_ std::vector<std::wstring>& col_event_type,
@@ -2584,6 +3305,49 @@ void pmu_device::do_test_prep_tests(_Out_ std::vector<std::wstring>& col_test_na
             col_test_result.push_back(s);
     }
 
+    // Overhead of counting DPC with the shortest counting period
+    LONG period_min = PMU_CTL_START_PERIOD_MIN;
+    drvconfig::get(L"count.period_min", period_min);
+
+    uint64_t dpc_calls = 0, dpc_time_ns = 0;
+    measure_dpc_overhead(0, period_min, dpc_calls, dpc_time_ns);
+
+    col_test_name.push_back(L"count.dpc_calls");
+    col_test_result.push_back(std::to_wstring(dpc_calls));
+    col_test_name.push_back(L"count.dpc_time_avg (ns)");
+    col_test_result.push_back(std::to_wstring(dpc_calls ? dpc_time_ns / dpc_calls : 0));
+    col_test_name.push_back(L"count.dpc_overhead (%)");
+    col_test_result.push_back(DoubleToWideString(100.0 * dpc_time_ns / (DPC_OVERHEAD_MEASURE_MS * 1000000.0)));
+
+    // Driver self-overhead, IOCTLs are counted from the start of this session
+    OverheadOut overhead;
+    query_overhead(overhead);
+
+    col_test_name.push_back(L"count.dpc_time_max (ns)");
+    col_test_result.push_back(std::to_wstring(overhead.dpc[0].max_ns));
+    col_test_name.push_back(L"ioctl.calls");
+    col_test_result.push_back(std::to_wstring(overhead.ioctl.calls));
+    col_test_name.push_back(L"ioctl.time_avg (ns)");
+    col_test_result.push_back(std::to_wstring(overhead.ioctl.calls ? overhead.ioctl.time_ns / overhead.ioctl.calls : 0));
+    col_test_name.push_back(L"ioctl.time_max (ns)");
+    col_test_result.push_back(std::to_wstring(overhead.ioctl.max_ns));
+
+    // PMU overflow interrupts of all cores, since the last sampling was started
+    struct overhead_stat isr = {};
+    for (uint32_t i = 0; i < overhead.core_num && i < MAX_PMU_CTL_CORES_COUNT; i++)
+    {
+        isr.calls += overhead.isr[i].calls;
+        isr.time_ns += overhead.isr[i].time_ns;
+        isr.max_ns = (std::max)(isr.max_ns, overhead.isr[i].max_ns);
+    }
+
+    col_test_name.push_back(L"isr.calls");
+    col_test_result.push_back(std::to_wstring(isr.calls));
+    col_test_name.push_back(L"isr.time_avg (ns)");
+    col_test_result.push_back(std::to_wstring(isr.calls ? isr.time_ns / isr.calls : 0));
+    col_test_name.push_back(L"isr.time_max (ns)");
+    col_test_result.push_back(std::to_wstring(isr.max_ns));
+
     // SPE information
     col_test_name.push_back(L"spe_device.version_name");
     col_test_result.push_back(spe_device::get_spe_version_name(hw_cfg.id_aa64dfr0_value));
@@ -2608,6 +3372,38 @@ void pmu_device::do_test(uint32_t enable_bits,
     m_out.Print(table, true);
 }
 
+/// <summary>
+/// Measure how much of the core counting DPCs take. Core CORE_NO counts one event more
+/// than there are free GPCs (so it multiplexes) with counting timer PERIOD (in us) for
+/// DPC_OVERHEAD_MEASURE_MS. Driver reports how many DPCs run and time spent in them.
+/// </summary>
+void pmu_device::measure_dpc_overhead(_In_ uint8_t core_no, _In_ LONG period, _Out_ uint64_t& dpc_calls, _Out_ uint64_t& dpc_time_ns)
+{
+    std::vector<uint8_t> cores_idx_saved = cores_idx;
+    LONG period_saved = PMU_CTL_START_PERIOD;
+    drvconfig::get(L"count.period", period_saved);
+
+    std::map<enum evt_class, std::vector<struct evt_noted>> events;
+    for (uint8_t i = 0; i <= gpc_nums[EVT_CORE]; i++)
+        events[EVT_CORE].push_back({ PMU_EVENT_INST_RETIRED, EVT_NORMAL, L"e", EVT_NOTED_NO_GROUP, L"" });
+
+    cores_idx = { core_no };
+    drvconfig::set(L"count.period", std::to_wstring(period) + L"us");
+
+    events_assign(core_no, events, false);
+    reset(CTL_FLAG_CORE);
+    start(CTL_FLAG_CORE);
+    Sleep(DPC_OVERHEAD_MEASURE_MS);
+    stop(CTL_FLAG_CORE);
+    core_events_read_nth(core_no);
+
+    drvconfig::set(L"count.period", std::to_wstring(period_saved) + L"us");
+    cores_idx = cores_idx_saved;
+
+    dpc_calls = core_outs[core_no].dpc_calls;
+    dpc_time_ns = core_outs[core_no].dpc_time_ns;
+}
+
 void pmu_device::do_version(_Out_ version_info& driver_ver)
 {
     do_version_query(driver_ver);
@@ -3086,6 +3882,18 @@ BOOL pmu_device::DeviceAsyncIoControl(
 )
 {
     *lpBytesReturned = 0;
+
+    if (m_backend)
+    {
+        uint32_t returned = 0;
+        pmu_backend_status status = m_backend->io_control(IoControlCode, lpBuffer, nNumberOfBytesToWrite, lpOutBuffer, nOutBufferSize, returned);
+        *lpBytesReturned = returned;
+        if (status == pmu_backend_status::invalid_state)
+            throw lock_denied_exception("Backend rejected request, caller does not own the lock");
+
+        return status == pmu_backend_status::ok;
+    }
+
     DEFINE_CUSTOM_IOCTL_RUNTIME(IoControlCode, IoControlCode);
     if (!DeviceIoControl(hDevice, IoControlCode, lpBuffer, nNumberOfBytesToWrite, lpOutBuffer, nOutBufferSize, lpBytesReturned, NULL))
     {
@@ -30,6 +30,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <windows.h>
+#include <chrono>
 #include <deque>
 #include <fstream>
 #include <map>
@@ -38,9 +39,13 @@
 #include <string>
 #include <vector>
 
+#include "ddr_bw_monitor.h"
 #include "events.h"
+#include "heatmap.h"
 #include "metric.h"
+#include "pmu_backend.h"
 #include "spe_device.h"
+#include "topdown.h"
 #include "wperf-common/iorequest.h"
 
 
@@ -50,6 +55,9 @@ struct evt_sample_src
     uint32_t interval;
 };
 
+inline constexpr uint32_t SAMPLE_SRC_DEFAULT_INTERVAL = 0x8000000;    // Cycle counter interval when no sample source is given
+inline constexpr DWORD DPC_OVERHEAD_MEASURE_MS = 200;                  // How long `wperf test` counts to measure counting DPC overhead
+
 struct pmu_device_cfg
 {
     uint8_t gpc_nums[EVT_CLASS_NUM];
@@ -119,6 +127,7 @@ public:
     ~pmu_device();
 
     void init();
+    void init(std::unique_ptr<pmu_backend> backend);    // Use BACKEND (e.g. pmu_simulator) instead of wperf-driver
     void core_init();
     void dsu_init();
     void dmc_init();
@@ -155,7 +164,9 @@ public:
 
     void set_sample_src(std::vector<struct evt_sample_src>& sample_sources, bool sample_kernel);
     bool get_sample(std::vector<FrameChain>& sample_info);  // Return false if sample buffer was empty
-    void start_sample();
+    bool get_sample_histogram(std::vector<FrameChain>& sample_info, std::vector<uint32_t>& sample_weight);  // Return false if histogram was empty
+    void set_sample_interval(const std::map<uint32_t, uint32_t>& intervals);   // Raw counter index -> new interval, see `-F`
+    void start_sample(bool histogram = false);
     void stop_sample();
     // Sampling
 
@@ -173,6 +184,24 @@ public:
     std::wstring timeline_output_file;
     // Timeline
 
+    // DDR bandwidth monitor, see `--ddr-monitor`
+    void ddr_monitor_init(double interval);
+    void ddr_monitor_start();
+    void print_ddr_monitor();
+    bool ddr_monitor_p() const { return !!m_ddr_monitor; }
+    // DDR bandwidth monitor
+
+    // Per core heatmap of metrics, see `--heatmap`
+    void heatmap_init(double interval, const std::vector<struct evt_noted>& events);
+    void heatmap_start();
+    void print_heatmap();
+    bool heatmap_p() const { return !!m_heatmap; }
+    // Per core heatmap of metrics
+
+    void monitor_sleep(DWORD ms);           // Sleep MS while taking `--ddr-monitor` and `--heatmap` samples
+
+    void print_topdown(const TopdownPlan& plan, const std::vector<struct evt_noted>& events);
+
     // Events
     const wchar_t* pmu_events_get_evt_class_name(enum evt_class e_class);
     const wchar_t* pmu_events_get_event_name(uint16_t index, enum evt_class e_class = EVT_CORE);
@@ -186,9 +215,12 @@ public:
     void events_assign(uint32_t core_idx, std::map<enum evt_class, std::vector<struct evt_noted>> events, bool include_kernel);
     void core_events_read_nth(uint8_t core_no);
     void core_events_read();
+    void core_events_read_live(uint32_t core_no, struct PMUReadLiveOut& out);  // Can be called from many threads, see PMU_CTL_READ_COUNTING_LIVE
+    void query_overhead(OverheadOut& out);      // Driver self-overhead, see PMU_CTL_QUERY_OVERHEAD
     void dsu_events_read_nth(uint8_t core_no);
     void dsu_events_read(void);
     void dmc_events_read(void);
+    const DMCReadOut& dmc_rdwr_read(std::vector<uint64_t>& rdwr);  // `rdwr` totals of monitored DMC channels, returns read-out of the first one
     void events_query(std::map<enum evt_class, std::vector<uint16_t>>& events_out);         // Query for events available to the user
     void events_query_driver(std::map<enum evt_class, std::vector<uint16_t>>& events_out);  // Query driver for known events
 
@@ -197,6 +229,7 @@ public:
     void print_dmc_stat(std::vector<struct evt_noted>& clk_events, std::vector<struct evt_noted>& clkdiv2_events, bool report_ddr_bw_metric);
 
     void print_core_metrics(std::vector<struct evt_noted>& events);
+    void print_overhead(double duration, uint64_t post_processing_ns, bool sampling = false);
 
     static bool do_detect_prep_detect(std::map<std::wstring, std::wstring> &device_interface_list);      // device_interface_list[device_interface] -> hardware_ids
     static void do_detect();
@@ -216,6 +249,7 @@ public:
         _In_ uint32_t enable_bits, _In_ std::map<enum evt_class, std::vector<struct evt_noted>>& ioctl_events); // part of do_test()
     void do_version(_Out_ version_info& driver_ver);
     void do_version_query(_Out_ version_info& driver_ver);    // part of do_version()
+    void measure_dpc_overhead(_In_ uint8_t core_no, _In_ LONG period, _Out_ uint64_t& dpc_calls, _Out_ uint64_t& dpc_time_ns);
 
     BOOL DeviceAsyncIoControl(_In_ HANDLE hDevice, _In_ ULONG IoControlCode, _In_ LPVOID lpBuffer, _In_ DWORD nNumberOfBytesToWrite,
         _Out_ LPVOID lpOutBuffer, _In_ DWORD nOutBufferSize, _Out_ LPDWORD lpBytesReturned);
@@ -269,6 +303,7 @@ public:
 
     const ReadOut* get_core_outs() { return core_outs.get();  };
     std::vector<uint8_t> get_cores_idx() { return cores_idx; };
+    void set_cores_idx(std::vector<uint8_t> cores);     // Cores used by start(), stop(), reset() and *_events_read()
 
     void query_hw_cfg(struct hw_cfg& out);
     struct hw_cfg m_hw_cfg;
@@ -312,6 +347,39 @@ private:
         return cores_idx.size() > 1;
     }
 
+    std::string timeline_timestamp();
+    std::string timeline_filename(const std::string& timestamp, const std::string& event_class);
+
+    LONG counting_timer_period();       // Microseconds between driver refreshes of counters, see PMU_CTL_START
+
+    std::unique_ptr<DdrBandwidthMonitor> m_ddr_monitor;
+    uint64_t m_ddr_monitor_epoch_ns = 0;                            // Driver time 0 of the monitor samples
+    uint64_t m_ddr_monitor_round = 0;                               // DMC counters refresh round of the last sample
+    uint64_t m_ddr_monitor_refresh_ns = 0;                          // ... and driver time of that refresh
+    uint64_t m_ddr_monitor_period_ns = 0;                           // DMC counters refresh period seen in driver read-outs
+    std::chrono::steady_clock::duration m_ddr_monitor_interval{};
+    std::chrono::steady_clock::time_point m_ddr_monitor_next;       // When to read DMC counters next time
+    std::wofstream m_ddr_monitor_file;                              // Samples are streamed here as they are taken
+    void ddr_monitor_poll(std::chrono::steady_clock::time_point now);
+
+    struct heatmap_metric
+    {
+        int group;                                                  // Event group metric is calculated from
+        std::wstring formula_sy;
+        std::vector<std::pair<uint32_t, std::wstring>> vars;        // [index in ReadOut.evts] -> formula variable
+    };
+
+    std::unique_ptr<CoreHeatmap> m_heatmap;
+    std::vector<heatmap_metric> m_heatmap_metrics;                  // Same order as m_heatmap->Metrics()
+    std::unique_ptr<ReadOut[]> m_heatmap_prev;                      // Core counters at the end of previous interval
+    std::chrono::steady_clock::time_point m_heatmap_epoch;
+    std::chrono::steady_clock::duration m_heatmap_interval{};
+    std::chrono::steady_clock::duration m_heatmap_period{};         // Core counters refresh period seen in `round` deltas
+    std::chrono::steady_clock::time_point m_heatmap_prev_time;      // When m_heatmap_prev was read
+    std::chrono::steady_clock::time_point m_heatmap_next;
+    std::string m_heatmap_filename;
+    void heatmap_poll(std::chrono::steady_clock::time_point now);
+
     // wperf test helpers
     void get_event_scheduling_test_data(_In_ std::map<enum evt_class, std::vector<struct evt_noted>>& ioctl_events, _Out_ std::wstring& evt_indexes, _Out_ std::wstring& evt_notes, enum evt_class e_class);
     std::wstring get_counter_idx_map_str(const struct hw_cfg& hw_cfg);
@@ -323,6 +391,7 @@ private:
     void warning(const std::wstring wrn);
 
     HANDLE m_device_handle;
+    std::unique_ptr<pmu_backend> m_backend;             // When set all IOCTLs go here, see DeviceAsyncIoControl()
     uint32_t pmu_ver;
     const wchar_t* vendor_name;
     std::vector<uint8_t> cores_idx;                     // Cores
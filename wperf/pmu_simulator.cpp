@@ -0,0 +1,802 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <cwchar>
+
+// No <windows.h> in the simulator, it also builds with g++ without Windows SDK
+#include "wperf-common/base_types.h"
+#include "wperf-common/iorequest.h"
+#include "wperf-common/mux_scheduler.h"
+#include "pmu_simulator.h"
+
+namespace
+{
+    const uint16_t armv8_arch_core_events[] =
+    {
+#define WPERF_ARMV8_ARCH_EVENTS(n,a,b,c,d) b,
+#include "wperf-common/armv8-arch-events.def"
+#undef WPERF_ARMV8_ARCH_EVENTS
+    };
+
+    uint64_t splitmix64(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // xorshift64*, uniform in [0, 1)
+    double next_uniform(uint64_t& state)
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return static_cast<double>((state * 0x2545F4914F6CDD1DULL) >> 11) * 0x1.0p-53;
+    }
+
+    // 128-bit sum of squares as in account_slice() of wperf-driver
+    void add_square(struct pmu_event_usr& event, uint64_t count)
+    {
+        const uint64_t lo = count & 0xFFFFFFFFULL, hi = count >> 32;
+        const uint64_t cross = lo * hi;
+        const uint64_t mid = (lo * lo >> 32) + (cross & 0xFFFFFFFFULL) * 2;
+        const uint64_t sq_hi = hi * hi + (cross >> 32) * 2 + (mid >> 32);
+        const uint64_t sq_lo = count * count;
+
+        event.slice_sq_hi += sq_hi;
+        event.slice_sq_lo += sq_lo;
+        if (event.slice_sq_lo < sq_lo)
+            event.slice_sq_hi += 1;
+    }
+
+    void account_slice(struct pmu_event_usr& event, uint64_t count, uint64_t cycles, bool counting)
+    {
+        event.time_enabled += cycles;
+        if (!counting)
+            return;
+
+        event.value += count;
+        event.scheduled += 1;
+        event.time_running += cycles;
+        add_square(event, count);
+    }
+
+    // Copy request with size checked by the caller, shorter requests (older wperf) are zero extended
+    template <typename T>
+    T read_request(const void* in, uint32_t in_size)
+    {
+        T req;
+        memset(&req, 0, sizeof(req));
+        memcpy(&req, in, std::min<size_t>(in_size, sizeof(req)));
+        return req;
+    }
+}
+
+struct pmu_simulator::sim_core
+{
+    uint32_t idx = 0;
+    uint64_t rng = 0;
+
+    // Counting
+    bool counting = false;
+    uint64_t round = 0;
+    std::vector<struct pmu_event_usr> events;       // [0] is cycle counter, same order as ReadOut.evts
+    std::vector<uint32_t> counters;                 // [event] -> counter index or INVALID_COUNTER_IDX
+    bool multiplex = false;
+    MuxScheduler mux{};
+
+    // Sampling
+    bool sampling = false;
+    bool histogram = false;
+    std::map<uint32_t, std::pair<uint32_t, uint32_t>> sample_src;   // [counter_idx] -> (event, interval)
+    std::map<uint32_t, uint64_t> sample_left;                       // [counter_idx] -> counts left to overflow
+    std::vector<FrameChain> samples;
+    std::map<std::pair<uint64_t, uint32_t>, uint32_t> pc_histogram; // [(pc, counter_idx)] -> count
+    struct PMUSampleSummary summary{};
+
+    // SPE
+    bool spe = false;
+    uint8_t spe_filter = 0;
+    std::vector<uint8_t> spe_buffer;
+};
+
+pmu_simulator::pmu_simulator(const pmu_simulator_cfg& cfg) : m_cfg(cfg)
+{
+    m_cfg.core_num = std::clamp<uint32_t>(m_cfg.core_num, 1, MAX_PMU_CTL_CORES_COUNT - 1);
+    m_cfg.gpc_num = std::clamp<uint8_t>(m_cfg.gpc_num, 1, AARCH64_MAX_HWC_SUPP);
+    m_cfg.sample_pcs = std::max<uint32_t>(m_cfg.sample_pcs, 1);
+
+    for (uint32_t i = 0; i < m_cfg.core_num; i++)
+    {
+        auto core = std::make_unique<sim_core>();
+        core->idx = i;
+        core->rng = splitmix64(m_cfg.seed ^ (uint64_t(i) << 32)) | 1;
+        core->events.resize(1);
+        core->events[0].event_idx = CYCLE_EVENT_IDX;
+        core->counters.push_back(CYCLE_COUNTER_IDX);
+        m_cores.push_back(std::move(core));
+    }
+}
+
+pmu_simulator::~pmu_simulator() {}
+
+double pmu_simulator::get_event_rate(uint16_t event) const
+{
+    auto it = m_cfg.event_rates.find(event);
+    if (it != m_cfg.event_rates.end())
+        return it->second;
+
+    // Spread of rates from rare events (e.g. refills) to about two per cycle
+    uint64_t h = splitmix64(m_cfg.seed * 0x100000001B3ULL + event);
+    double u = static_cast<double>(h >> 11) * 0x1.0p-53;
+    return 0.0005 + u * u * 2.0;
+}
+
+uint64_t pmu_simulator::next_count(sim_core& core, uint64_t cycles, double rate)
+{
+    double noise = 1.0 + m_cfg.jitter * (next_uniform(core.rng) - 0.5);
+    double count = static_cast<double>(cycles) * rate * noise;
+    return count > 0.0 ? static_cast<uint64_t>(count + 0.5) : 0;
+}
+
+void pmu_simulator::run_rounds(uint32_t core_idx, uint64_t rounds)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+
+    if (core_idx < m_cores.size())
+        advance(*m_cores[core_idx], rounds);
+}
+
+void pmu_simulator::advance(sim_core& core, uint64_t rounds)
+{
+    for (uint64_t i = 0; i < rounds && (core.counting || core.sampling); i++)
+        run_round(core);
+}
+
+// One DPC of counting timer (or sampling period when only sampling)
+void pmu_simulator::run_round(sim_core& core)
+{
+    const uint64_t cycles = next_count(core, m_cfg.cycles_per_round, 1.0);
+
+    if (core.sampling)
+        for (const auto& [counter_idx, src] : core.sample_src)
+        {
+            const double rate = src.first == CYCLE_EVENT_IDX ? 1.0 : get_event_rate(static_cast<uint16_t>(src.first));
+            generate_samples(core, counter_idx, src.first == CYCLE_EVENT_IDX ? cycles : next_count(core, cycles, rate));
+        }
+
+    if (!core.counting)
+        return;
+
+    account_slice(core.events[0], cycles, cycles, true);
+    for (size_t i = 1; i < core.events.size(); i++)
+    {
+        const bool counting = core.counters[i] != INVALID_COUNTER_IDX;
+        const uint64_t count = counting ? next_count(core, cycles, get_event_rate(static_cast<uint16_t>(core.events[i].event_idx))) : 0;
+        account_slice(core.events[i], count, cycles, counting);
+    }
+
+    if (core.multiplex)
+    {
+        mux_schedule(&core.mux);
+        for (size_t i = 1; i < core.events.size(); i++)
+        {
+            const UINT8 counter = core.mux.event_counter[i - 1];
+            core.counters[i] = counter == MUX_NO_COUNTER ? INVALID_COUNTER_IDX : counter;
+        }
+    }
+
+    core.round++;
+}
+
+void pmu_simulator::generate_samples(sim_core& core, uint32_t counter_idx, uint64_t count)
+{
+    const uint32_t interval = std::max<uint32_t>(core.sample_src[counter_idx].second, 1);
+    uint64_t& left = core.sample_left[counter_idx];
+    if (left == 0)
+        left = interval;
+
+    for (; count >= left; count -= left, left = interval)
+    {
+        core.summary.sample_generated++;
+
+        double u = next_uniform(core.rng);
+        uint64_t pc = m_cfg.sample_pc_base + 4 * static_cast<uint64_t>(u * u * m_cfg.sample_pcs);
+
+        if (core.histogram)
+        {
+            auto key = std::make_pair(pc, counter_idx);
+            auto it = core.pc_histogram.find(key);
+            if (it != core.pc_histogram.end())
+                it->second++;
+            else if (core.pc_histogram.size() < PC_HISTOGRAM_SIZE)
+                core.pc_histogram[key] = 1;
+            else
+                core.summary.sample_dropped++;
+            continue;
+        }
+
+        if (core.samples.size() >= SAMPLE_CHAIN_BUFFER_SIZE)
+        {
+            core.summary.sample_dropped++;
+            continue;
+        }
+
+        FrameChain frame = { 0 };
+        frame.pc = pc;
+        frame.ov_flags = 1ULL << counter_idx;
+        frame.period = interval;
+        core.samples.push_back(frame);
+    }
+    left -= count;
+}
+
+// Records end with END packet and carry PC, operation type and events, see SPEParser
+void pmu_simulator::generate_spe_records(sim_core& core)
+{
+    const uint8_t filter = core.spe_filter ? core.spe_filter : SPE_OPERATON_FILTER_B | SPE_OPERATON_FILTER_LD | SPE_OPERATON_FILTER_ST;
+
+    for (uint32_t r = 0; r < m_cfg.spe_records_per_get; r++)
+    {
+        double u = next_uniform(core.rng);
+        uint64_t pc = m_cfg.sample_pc_base + 4 * static_cast<uint64_t>(u * u * m_cfg.sample_pcs);
+
+        uint8_t op;
+        do
+            op = uint8_t(1) << static_cast<uint32_t>(next_uniform(core.rng) * 3);
+        while (!(op & filter));
+
+        uint8_t optype_hdr, optype_payload;
+        uint16_t events = 0x0002;                           // Retired
+        if (op == SPE_OPERATON_FILTER_B)
+        {
+            optype_hdr = 0x4A;                              // Branch
+            optype_payload = next_uniform(core.rng) < 0.5 ? 0x01 : 0x00;
+            if (next_uniform(core.rng) < 0.05)
+                events |= 0x0080;                           // Mispredicted
+        }
+        else
+        {
+            optype_hdr = 0x49;                              // Load / store
+            optype_payload = op == SPE_OPERATON_FILTER_ST ? 0x01 : 0x00;
+            events |= 0x0004;                               // L1D access
+            if (next_uniform(core.rng) < 0.1)
+                events |= 0x0008;                           // L1D refill
+        }
+
+        core.spe_buffer.push_back(0xB0);                    // Address packet, PC
+        for (int i = 0; i < 8; i++)
+            core.spe_buffer.push_back(static_cast<uint8_t>(pc >> (8 * i)));
+        core.spe_buffer.push_back(optype_hdr);
+        core.spe_buffer.push_back(optype_payload);
+        core.spe_buffer.push_back(0x52);                    // Events packet, 2 bytes
+        core.spe_buffer.push_back(static_cast<uint8_t>(events));
+        core.spe_buffer.push_back(static_cast<uint8_t>(events >> 8));
+        core.spe_buffer.push_back(0x01);                    // End
+    }
+}
+
+pmu_backend_status pmu_simulator::io_control(uint32_t action, const void* in, uint32_t in_size,
+    void* out, uint32_t out_size, uint32_t& returned)
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    returned = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    const pmu_backend_status status = dispatch(action, in, in_size, out, out_size, returned);
+    const uint64_t time_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    m_ioctl_calls++;
+    m_ioctl_time_ns += time_ns;
+    m_ioctl_max_ns = std::max(m_ioctl_max_ns, time_ns);
+    return status;
+}
+
+pmu_backend_status pmu_simulator::dispatch(uint32_t action, const void* in, uint32_t in_size,
+    void* out, uint32_t out_size, uint32_t& returned)
+{
+    if (!in)
+        return pmu_backend_status::failed;
+
+    if (action == PMU_CTL_LOCK_ACQUIRE || action == PMU_CTL_LOCK_RELEASE)
+        return lock_ctl(action, in, in_size, out, out_size, returned);
+
+    if (action == PMU_CTL_QUERY_VERSION)
+        return query_version(in, in_size, out, out_size, returned);
+
+    if (!m_locked)
+        return pmu_backend_status::invalid_state;
+
+    switch (action)
+    {
+    case PMU_CTL_QUERY_HW_CFG:          return query_hw_cfg(out, out_size, returned);
+    case PMU_CTL_QUERY_SUPP_EVENTS:     return query_supp_events(out, out_size, returned);
+    case PMU_CTL_ASSIGN_EVENTS:         return assign_events(in, in_size);
+    case PMU_CTL_START:
+    case PMU_CTL_STOP:
+    case PMU_CTL_RESET:                 return counting_ctl(action, in, in_size);
+    case PMU_CTL_READ_COUNTING:         return read_counting(in, in_size, out, out_size, returned);
+    case PMU_CTL_READ_COUNTING_LIVE:    return read_counting_live(in, in_size, out, out_size, returned);
+    case PMU_CTL_QUERY_OVERHEAD:        return query_overhead(in_size, out, out_size, returned);
+    case PMU_CTL_SAMPLE_SET_SRC:
+    case PMU_CTL_SAMPLE_START:
+    case PMU_CTL_SAMPLE_STOP:
+    case PMU_CTL_SAMPLE_GET:
+    case PMU_CTL_SAMPLE_GET_HISTOGRAM:
+    case PMU_CTL_SAMPLE_SET_INTERVAL:   return sample_ctl(action, in, in_size, out, out_size, returned);
+    case PMU_CTL_SPE_INIT:
+    case PMU_CTL_SPE_GET_SIZE:
+    case PMU_CTL_SPE_GET_BUFFER:
+    case PMU_CTL_SPE_START:
+    case PMU_CTL_SPE_STOP:              return m_cfg.has_spe ? spe_ctl(action, in, in_size, out, out_size, returned) : pmu_backend_status::failed;
+    }
+
+    return pmu_backend_status::failed;  // DSU and DMC
+}
+
+pmu_backend_status pmu_simulator::lock_ctl(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned)
+{
+    if (in_size != sizeof(struct lock_request) || out_size < sizeof(enum status_flag))
+        return pmu_backend_status::failed;
+
+    const auto req = read_request<struct lock_request>(in, in_size);
+    enum status_flag* sts_flag = static_cast<enum status_flag*>(out);
+
+    if (action == PMU_CTL_LOCK_ACQUIRE)
+    {
+        // Single client: lock is taken again only by the same (forced or not) caller
+        m_locked = req.flag == LOCK_GET || req.flag == LOCK_GET_FORCE;
+        *sts_flag = m_locked ? STS_LOCK_AQUIRED : STS_UNKNOWN_ERROR;
+        if (m_locked)
+            m_ioctl_calls = m_ioctl_time_ns = m_ioctl_max_ns = 0;
+    }
+    else
+    {
+        m_locked = false;
+        for (auto& core : m_cores)
+            core->counting = core->sampling = core->spe = false;
+        *sts_flag = STS_IDLE;
+    }
+
+    returned = sizeof(enum status_flag);
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::query_hw_cfg(void* out, uint32_t out_size, uint32_t& returned) const
+{
+    if (out_size < sizeof(struct hw_cfg))
+        return pmu_backend_status::failed;
+
+    struct hw_cfg cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.pmu_ver = 0b0101;                                       // FEAT_PMUv3p4
+    cfg.fpc_num = FIXED_COUNTERS_NO;
+    cfg.gpc_num = m_cfg.gpc_num;
+    cfg.total_gpc_num = m_cfg.gpc_num;
+    cfg.vendor_id = m_cfg.vendor_id;
+    cfg.arch_id = 0xF;
+    cfg.part_id = m_cfg.part_id;
+    cfg.core_num = static_cast<UINT16>(m_cfg.core_num);
+    cfg.midr_value = (UINT64(cfg.vendor_id) << 24) | (UINT64(cfg.arch_id) << 16) | (UINT64(cfg.part_id) << 4);
+    cfg.id_aa64dfr0_value = (UINT64(cfg.pmu_ver) << 8) | (m_cfg.has_spe ? (UINT64(0b001) << 32) : 0);
+    for (UINT8 i = 0; i < m_cfg.gpc_num; i++)
+        cfg.counter_idx_map[i] = i;
+    cfg.counter_idx_map[AARCH64_MAX_HWC_SUPP] = CYCLE_COUNTER_IDX;
+    wcsncpy(cfg.device_id_str, L"simulator", MAX_DEVICE_ID_STR_SIZE - 1);
+    cfg.period_min = PMU_CTL_START_PERIOD_MIN;
+    cfg.period_max = PMU_CTL_START_PERIOD;
+
+    memcpy(out, &cfg, sizeof(cfg));
+    returned = sizeof(cfg);
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::query_supp_events(void* out, uint32_t out_size, uint32_t& returned) const
+{
+    const uint16_t evt_num = static_cast<uint16_t>(sizeof(armv8_arch_core_events) / sizeof(armv8_arch_core_events[0]));
+    const uint32_t size = sizeof(struct evt_hdr) + sizeof(armv8_arch_core_events);
+    if (out_size < size)
+        return pmu_backend_status::failed;
+
+    struct evt_hdr* hdr = static_cast<struct evt_hdr*>(out);
+    hdr->evt_class = EVT_CORE;
+    hdr->num = evt_num;
+    memcpy(hdr + 1, armv8_arch_core_events, sizeof(armv8_arch_core_events));
+
+    returned = size;
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::query_version(const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned) const
+{
+    if (in_size != sizeof(struct pmu_ctl_ver_hdr) || out_size < sizeof(struct version_info))
+        return pmu_backend_status::failed;
+
+    // Simulator is always the version of its caller
+    const auto req = read_request<struct pmu_ctl_ver_hdr>(in, in_size);
+    struct version_info ver;
+    memset(&ver, 0, sizeof(ver));
+    ver.major = req.version.major;
+    ver.minor = req.version.minor;
+    ver.patch = req.version.patch;
+    wcsncpy(ver.gitver, L"simulator", MAX_GITVER_SIZE - 1);
+    wcsncpy(ver.featurestring, m_cfg.has_spe ? L"+spe" : L"", MAX_FEATURESTRING_SIZE - 1);
+
+    memcpy(out, &ver, sizeof(ver));
+    returned = sizeof(ver);
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::assign_events(const void* in, uint32_t in_size)
+{
+    if (in_size < sizeof(struct pmu_ctl_evt_assign_hdr))
+        return pmu_backend_status::failed;
+
+    const auto req = read_request<struct pmu_ctl_evt_assign_hdr>(in, in_size);
+    const uint8_t* payload = static_cast<const uint8_t*>(in) + sizeof(struct pmu_ctl_evt_assign_hdr);
+    const uint32_t payload_size = in_size - sizeof(struct pmu_ctl_evt_assign_hdr);
+
+    if (req.core_idx != ALL_CORE && req.core_idx >= m_cores.size())
+        return pmu_backend_status::failed;
+
+    for (uint32_t consumed = 0; consumed + sizeof(struct evt_hdr) <= payload_size;)
+    {
+        struct evt_hdr hdr;
+        memcpy(&hdr, payload + consumed, sizeof(hdr));
+        consumed += sizeof(struct evt_hdr) + hdr.num * sizeof(uint16_t);
+        if (consumed > payload_size)
+            return pmu_backend_status::failed;
+
+        if (hdr.evt_class != EVT_CORE)
+            return pmu_backend_status::failed;
+
+        if (hdr.num + FIXED_COUNTERS_NO > MAX_MANAGED_CORE_EVENTS)
+            return pmu_backend_status::failed;
+
+        const uint16_t* raw = reinterpret_cast<const uint16_t*>(payload + consumed - hdr.num * sizeof(uint16_t));
+        std::vector<uint16_t> raw_evts(hdr.num);
+        std::copy(raw, raw + hdr.num, raw_evts.begin());
+
+        const uint32_t core_base = req.core_idx == ALL_CORE ? 0 : req.core_idx;
+        const uint32_t core_end = req.core_idx == ALL_CORE ? static_cast<uint32_t>(m_cores.size()) : req.core_idx + 1;
+        for (uint32_t c = core_base; c < core_end; c++)
+        {
+            sim_core& core = *m_cores[c];
+
+            core.multiplex = hdr.num > m_cfg.gpc_num;
+            if (core.multiplex)
+            {
+                if (!mux_init(&core.mux, hdr.num, req.core_groups, req.core_weights, m_cfg.gpc_num))
+                    return pmu_backend_status::failed;
+                mux_schedule(&core.mux);
+            }
+
+            core.events.resize(1);
+            core.counters.resize(1);
+            core.events[0] = {};
+            core.events[0].event_idx = CYCLE_EVENT_IDX;
+            core.events[0].filter_bits = req.filter_bits;
+
+            for (uint16_t j = 0; j < hdr.num; j++)
+            {
+                struct pmu_event_usr event = {};
+                event.event_idx = raw_evts[j];
+                event.filter_bits = req.filter_bits;
+                core.events.push_back(event);
+
+                if (core.multiplex)
+                    core.counters.push_back(core.mux.event_counter[j] == MUX_NO_COUNTER ? INVALID_COUNTER_IDX : core.mux.event_counter[j]);
+                else
+                    core.counters.push_back(j);
+            }
+        }
+    }
+
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::counting_ctl(uint32_t action, const void* in, uint32_t in_size)
+{
+    if (in_size != sizeof(struct pmu_ctl_hdr))
+        return pmu_backend_status::failed;
+
+    const auto req = read_request<struct pmu_ctl_hdr>(in, in_size);
+    const size_t cores_count = req.cores_idx.cores_count;
+    if (cores_count == 0 || cores_count >= MAX_PMU_CTL_CORES_COUNT)
+        return pmu_backend_status::failed;
+
+    for (size_t i = 0; i < cores_count; i++)
+        if (req.cores_idx.cores_no[i] >= m_cores.size())
+            return pmu_backend_status::failed;
+
+    if (!(req.flags & CTL_FLAG_CORE))
+        return pmu_backend_status::ok;
+
+    for (size_t i = 0; i < cores_count; i++)
+    {
+        sim_core& core = *m_cores[req.cores_idx.cores_no[i]];
+        switch (action)
+        {
+        case PMU_CTL_START:
+            core.counting = true;
+            break;
+        case PMU_CTL_STOP:
+            core.counting = false;
+            break;
+        case PMU_CTL_RESET:
+            core.round = 0;
+            for (auto& event : core.events)
+            {
+                const UINT32 event_idx = event.event_idx;
+                const UINT64 filter_bits = event.filter_bits;
+                event = {};
+                event.event_idx = event_idx;
+                event.filter_bits = filter_bits;
+            }
+            break;
+        }
+    }
+
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::read_counting(const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned)
+{
+    if (in_size != sizeof(struct pmu_ctl_hdr))
+        return pmu_backend_status::failed;
+
+    const auto req = read_request<struct pmu_ctl_hdr>(in, in_size);
+    if (req.cores_idx.cores_count != 1 || req.cores_idx.cores_no[0] >= m_cores.size() || out_size < sizeof(ReadOut))
+        return pmu_backend_status::failed;
+
+    sim_core& core = *m_cores[req.cores_idx.cores_no[0]];
+    advance(core, m_cfg.rounds_per_read);
+
+    ReadOut* read_out = static_cast<ReadOut*>(out);
+    memset(read_out, 0, sizeof(ReadOut));
+    read_out->evt_num = static_cast<UINT32>(core.events.size());
+    read_out->round = core.round;
+    read_out->dpc_calls = core.round;
+    std::copy(core.events.begin(), core.events.end(), read_out->evts);
+
+    returned = sizeof(ReadOut);
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::read_counting_live(const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned)
+{
+    if (in_size != sizeof(struct PMUCtlReadLiveHdr) || out_size < sizeof(struct PMUReadLiveOut))
+        return pmu_backend_status::failed;
+
+    const auto req = read_request<struct PMUCtlReadLiveHdr>(in, in_size);
+    if (req.core_idx >= m_cores.size())
+        return pmu_backend_status::failed;
+
+    // Caller is never migrated, read is always done on its core
+    sim_core& core = *m_cores[req.core_idx];
+    advance(core, m_cfg.rounds_per_read);
+
+    struct PMUReadLiveOut* live = static_cast<struct PMUReadLiveOut*>(out);
+    memset(live, 0, sizeof(struct PMUReadLiveOut));
+    live->core_idx = core.idx;
+    live->evt_num = static_cast<UINT32>(core.events.size());
+    for (size_t i = 0; i < core.events.size(); i++)
+        live->value[i] = core.events[i].value;
+
+    returned = sizeof(struct PMUReadLiveOut);
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::query_overhead(uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned) const
+{
+    if (in_size != sizeof(enum pmu_ctl_action) || out_size < sizeof(OverheadOut))
+        return pmu_backend_status::failed;
+
+    OverheadOut* overhead = static_cast<OverheadOut*>(out);
+    memset(overhead, 0, sizeof(OverheadOut));
+    overhead->core_num = static_cast<UINT32>(m_cores.size());
+    overhead->ioctl.calls = m_ioctl_calls;
+    overhead->ioctl.time_ns = m_ioctl_time_ns;
+    overhead->ioctl.max_ns = m_ioctl_max_ns;
+
+    // Every round is one counting DPC and every sample one overflow interrupt
+    for (const auto& core : m_cores)
+    {
+        overhead->dpc[core->idx].calls = core->round;
+        overhead->isr[core->idx].calls = core->summary.sample_generated;
+    }
+
+    returned = sizeof(OverheadOut);
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::sample_ctl(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned)
+{
+    uint32_t core_idx;
+    if (action == PMU_CTL_SAMPLE_START || action == PMU_CTL_SAMPLE_STOP)
+    {
+        if (in_size != sizeof(struct pmu_ctl_hdr))
+            return pmu_backend_status::failed;
+        core_idx = read_request<struct pmu_ctl_hdr>(in, in_size).cores_idx.cores_no[0];
+    }
+    else
+    {
+        if (in_size < sizeof(UINT32))
+            return pmu_backend_status::failed;
+        memcpy(&core_idx, in, sizeof(UINT32));      // All other headers start with core_idx
+    }
+
+    if (core_idx >= m_cores.size())
+        return pmu_backend_status::failed;
+
+    sim_core& core = *m_cores[core_idx];
+
+    switch (action)
+    {
+    case PMU_CTL_SAMPLE_SET_SRC:
+    {
+        const size_t src_num = (in_size - sizeof(PMUSampleSetSrcHdr)) / sizeof(SampleSrcDesc);
+        const SampleSrcDesc* sources = reinterpret_cast<const SampleSrcDesc*>(static_cast<const uint8_t*>(in) + sizeof(PMUSampleSetSrcHdr));
+        uint32_t gpc_num = 0;
+
+        core.sample_src.clear();
+        core.sample_left.clear();
+        for (size_t i = 0; i < src_num && i < size_t(m_cfg.gpc_num) + FIXED_COUNTERS_NO; i++)
+        {
+            SampleSrcDesc src;
+            memcpy(&src, sources + i, sizeof(src));
+            const uint32_t counter_idx = src.event_src == CYCLE_EVENT_IDX ? CYCLE_COUNTER_IDX : gpc_num++;
+            core.sample_src[counter_idx] = { src.event_src, src.interval };
+        }
+        break;
+    }
+    case PMU_CTL_SAMPLE_SET_INTERVAL:
+    {
+        if (in_size != sizeof(struct PMUSampleSetIntervalHdr))
+            return pmu_backend_status::failed;
+
+        const auto req = read_request<struct PMUSampleSetIntervalHdr>(in, in_size);
+        for (auto& [counter_idx, src] : core.sample_src)
+            if (req.interval[counter_idx])
+                src.second = req.interval[counter_idx];
+        break;
+    }
+    case PMU_CTL_SAMPLE_START:
+        core.sampling = true;
+        core.histogram = !!(read_request<struct pmu_ctl_hdr>(in, in_size).flags & CTL_FLAG_SAMPLE_HISTOGRAM);
+        core.samples.clear();
+        core.pc_histogram.clear();
+        core.sample_left.clear();
+        core.summary = {};
+        break;
+    case PMU_CTL_SAMPLE_STOP:
+        if (out_size < sizeof(struct PMUSampleSummary))
+            return pmu_backend_status::failed;
+        core.sampling = false;
+        memcpy(out, &core.summary, sizeof(struct PMUSampleSummary));
+        returned = sizeof(struct PMUSampleSummary);
+        break;
+    case PMU_CTL_SAMPLE_GET:
+    {
+        if (out_size < sizeof(struct PMUSamplePayload))
+            return pmu_backend_status::failed;
+
+        advance(core, m_cfg.rounds_per_read);
+
+        struct PMUSamplePayload* payload = static_cast<struct PMUSamplePayload*>(out);
+        memset(payload, 0, sizeof(struct PMUSamplePayload));
+        payload->size = static_cast<UINT32>(core.samples.size());
+        std::copy(core.samples.begin(), core.samples.end(), payload->payload);
+        core.samples.clear();
+        returned = sizeof(struct PMUSamplePayload);
+        break;
+    }
+    case PMU_CTL_SAMPLE_GET_HISTOGRAM:
+    {
+        if (out_size < sizeof(struct PMUSampleHistogramPayload))
+            return pmu_backend_status::failed;
+
+        advance(core, m_cfg.rounds_per_read);
+
+        struct PMUSampleHistogramPayload* payload = static_cast<struct PMUSampleHistogramPayload*>(out);
+        payload->size = 0;
+        for (const auto& [key, count] : core.pc_histogram)
+        {
+            PCHistogramEntry& entry = payload->payload[payload->size++];
+            entry.pc = key.first;
+            entry.counter_idx = key.second;
+            entry.count = count;
+        }
+        core.pc_histogram.clear();
+        returned = static_cast<uint32_t>(offsetof(struct PMUSampleHistogramPayload, payload) + sizeof(PCHistogramEntry) * payload->size);
+        break;
+    }
+    }
+
+    return pmu_backend_status::ok;
+}
+
+pmu_backend_status pmu_simulator::spe_ctl(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned)
+{
+    if (action == PMU_CTL_SPE_INIT)
+    {
+        for (auto& core : m_cores)
+            core->spe_buffer.clear();
+        return pmu_backend_status::ok;
+    }
+
+    // wperf sends spe_ctl_hdr for PMU_CTL_SPE_START in a pmu_ctl_hdr sized buffer
+    const auto req = read_request<struct spe_ctl_hdr>(in, in_size);
+    if (req.cores_idx.cores_no[0] >= m_cores.size())
+        return pmu_backend_status::failed;
+
+    sim_core& core = *m_cores[req.cores_idx.cores_no[0]];
+
+    switch (action)
+    {
+    case PMU_CTL_SPE_START:
+        core.spe = true;
+        core.spe_filter = req.operation_filter;
+        core.spe_buffer.clear();
+        break;
+    case PMU_CTL_SPE_STOP:
+        core.spe = false;
+        break;
+    case PMU_CTL_SPE_GET_SIZE:
+    {
+        if (out_size < sizeof(size_t))
+            return pmu_backend_status::failed;
+
+        if (core.spe)
+            generate_spe_records(core);
+        const size_t size = core.spe_buffer.size();
+        memcpy(out, &size, sizeof(size_t));
+        returned = sizeof(size_t);
+        break;
+    }
+    case PMU_CTL_SPE_GET_BUFFER:
+    {
+        const size_t size = std::min<size_t>({ core.spe_buffer.size(), static_cast<size_t>(req.buffer_size), out_size });
+        if (size)
+            memcpy(out, core.spe_buffer.data(), size);
+        core.spe_buffer.erase(core.spe_buffer.begin(), core.spe_buffer.begin() + size);
+        returned = static_cast<uint32_t>(size);
+        break;
+    }
+    }
+
+    return pmu_backend_status::ok;
+}
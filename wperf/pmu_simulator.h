@@ -0,0 +1,124 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "pmu_backend.h"
+
+/// <summary>
+/// Configuration of simulated PMU, see pmu_simulator.
+/// </summary>
+struct pmu_simulator_cfg
+{
+    uint32_t core_num = 8;                  // 1 ... MAX_PMU_CTL_CORES_COUNT - 1 (127), see note below
+    uint8_t gpc_num = 6;                    // General purpose counters per core
+    uint8_t vendor_id = 0x41;               // MIDR_EL1 implementer and part number, default is Neoverse N1
+    uint16_t part_id = 0xD0C;
+    bool has_spe = true;
+    uint64_t seed = 1;                      // Same seed and the same sequence of requests give the same counts
+    uint64_t cycles_per_round = 1000000;    // Cycles counted in one counting timer round
+    double jitter = 0.1;                    // Relative noise of per round counts, 0 - constant streams
+    uint32_t rounds_per_read = 1;           // Rounds run on a counting core before each read of its counters
+    std::map<uint16_t, double> event_rates; // [event] -> counts per cycle, other events get a rate derived from seed
+    uint32_t sample_pcs = 1024;             // Number of distinct PCs of generated samples (skewed, low PCs are hot)
+    uint64_t sample_pc_base = 0x140001000;  // Address of the first generated PC, PCs are 4 bytes apart
+    uint32_t spe_records_per_get = 256;     // SPE records generated for each PMU_CTL_SPE_GET_SIZE
+};
+
+/// <summary>
+/// In-process model of wperf-driver: implements `iorequest.h` protocol so the whole
+/// user space pipeline (counting, multiplexing, timeline, sampling and SPE decoding)
+/// can be tested and benchmarked without Arm hardware, see pmu_device::init().
+///
+/// Time does not flow on its own: counting timer rounds (DPCs of the driver) are run
+/// with run_rounds() or, `rounds_per_read` at a time, when counters of a counting core
+/// are read. Each round every scheduled event counts `cycles * rate` with optional
+/// noise and multiplexing follows wperf-common/mux_scheduler.h exactly like the driver,
+/// including time_enabled / time_running and slice squares accounting. Samples are
+/// generated from counter overflows of sampled events, SPE buffer gets records with
+/// PC, operation type and events packets.
+///
+/// DSU and DMC are not simulated. Self-overhead reports real time spent handling requests,
+/// DPCs and interrupts are counted but take no time.
+///
+/// Number of simulated cores is limited to 127 by the protocol itself, the same as for the
+/// driver: pmu_ctl_cores_count_hdr carries fewer than MAX_PMU_CTL_CORES_COUNT UINT8 core
+/// numbers and wperf keeps core indexes in uint8_t (pmu_device_cfg::core_num). Going beyond
+/// that (e.g. 256 cores) needs a wider core index in iorequest.h and pmu_device first.
+/// </summary>
+class pmu_simulator : public pmu_backend
+{
+public:
+    explicit pmu_simulator(const pmu_simulator_cfg& cfg);
+    ~pmu_simulator();
+
+    pmu_backend_status io_control(uint32_t action, const void* in, uint32_t in_size,
+        void* out, uint32_t out_size, uint32_t& returned) override;
+
+    void run_rounds(uint32_t core_idx, uint64_t rounds);    // Run counting timer rounds of counting (or sampling) core
+    double get_event_rate(uint16_t event) const;            // Average counts per cycle of EVENT
+    const pmu_simulator_cfg& get_cfg() const { return m_cfg; }
+
+private:
+    struct sim_core;
+
+    pmu_backend_status dispatch(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned);
+    pmu_backend_status lock_ctl(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned);
+    pmu_backend_status query_hw_cfg(void* out, uint32_t out_size, uint32_t& returned) const;
+    pmu_backend_status query_supp_events(void* out, uint32_t out_size, uint32_t& returned) const;
+    pmu_backend_status query_version(const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned) const;
+    pmu_backend_status assign_events(const void* in, uint32_t in_size);
+    pmu_backend_status counting_ctl(uint32_t action, const void* in, uint32_t in_size);
+    pmu_backend_status read_counting(const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned);
+    pmu_backend_status read_counting_live(const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned);
+    pmu_backend_status query_overhead(uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned) const;
+    pmu_backend_status sample_ctl(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned);
+    pmu_backend_status spe_ctl(uint32_t action, const void* in, uint32_t in_size, void* out, uint32_t out_size, uint32_t& returned);
+
+    uint64_t next_count(sim_core& core, uint64_t cycles, double rate);
+    void advance(sim_core& core, uint64_t rounds);
+    void run_round(sim_core& core);
+    void generate_samples(sim_core& core, uint32_t counter_idx, uint64_t count);
+    void generate_spe_records(sim_core& core);
+
+    pmu_simulator_cfg m_cfg;
+    std::vector<std::unique_ptr<sim_core>> m_cores;
+    bool m_locked = false;
+    uint64_t m_ioctl_calls = 0;             // Requests handled since PMU_CTL_LOCK_ACQUIRE, see PMU_CTL_QUERY_OVERHEAD
+    uint64_t m_ioctl_time_ns = 0;
+    uint64_t m_ioctl_max_ns = 0;
+    std::mutex m_mutex;                     // Requests are handled one at a time like in driver's sequential queue
+};
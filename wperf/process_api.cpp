@@ -104,6 +104,50 @@ HMODULE GetModule(HANDLE pHandle, std::wstring pname)
     return nullptr;
 }
 
+/// <summary>
+/// Snapshot of modules currently loaded into process PHANDLE.
+/// Modules which can't be queried (e.g. being unloaded) are skipped.
+/// </summary>
+/// <param name="pHandle">Process handle with PROCESS_QUERY_INFORMATION and PROCESS_VM_READ access</param>
+/// <param name="modules">Output list of modules, times are not set</param>
+/// <returns>FALSE if module list can't be read, e.g. process has exited</returns>
+BOOL GetProcessModules(HANDLE pHandle, std::vector<ModuleMapEntry>& modules)
+{
+    std::vector<HMODULE> hMods(1024);
+    DWORD cbNeeded;
+
+    if (!EnumProcessModules(pHandle, hMods.data(), static_cast<DWORD>(hMods.size() * sizeof(HMODULE)), &cbNeeded))
+        return FALSE;
+
+    if (cbNeeded > hMods.size() * sizeof(HMODULE))
+    {
+        hMods.resize(cbNeeded / sizeof(HMODULE));
+        if (!EnumProcessModules(pHandle, hMods.data(), static_cast<DWORD>(hMods.size() * sizeof(HMODULE)), &cbNeeded))
+            return FALSE;
+    }
+
+    for (DWORD i = 0; i < (cbNeeded / sizeof(HMODULE)) && i < hMods.size(); i++)
+    {
+        wchar_t szModName[MAX_PATH];
+        wchar_t szBaseName[MAX_PATH];
+        MODULEINFO modinfo;
+
+        if (!GetModuleFileNameExW(pHandle, hMods[i], szModName, MAX_PATH)
+            || !GetModuleBaseNameW(pHandle, hMods[i], szBaseName, MAX_PATH)
+            || !GetModuleInformation(pHandle, hMods[i], &modinfo, sizeof(MODULEINFO)))
+            continue;
+
+        ModuleMapEntry mod;
+        mod.name = szBaseName;
+        mod.path = szModName;
+        mod.base = reinterpret_cast<uint64_t>(modinfo.lpBaseOfDll);
+        mod.size = modinfo.SizeOfImage;
+        modules.push_back(mod);
+    }
+
+    return TRUE;
+}
+
 VOID SpawnProcess(const wchar_t* pe_file, const wchar_t* command_line, PROCESS_INFORMATION* pi, uint32_t delay)
 {
     STARTUPINFO si;
@@ -33,6 +33,7 @@
 #include <vector>
 #include <tlhelp32.h>
 #include <psapi.h>
+#include "module_map.h"
 
 #define MAX_PROCESSES					1024
 #define MAX_SPAWN_RETRIES				4
@@ -52,6 +53,7 @@ struct HardwareInformation
 VOID GetHardwareInfo(HardwareInformation &hinfo);
 DWORD FindProcess(std::wstring lpcszFileName);
 HMODULE GetModule(HANDLE pHandle, std::wstring pname);
+BOOL GetProcessModules(HANDLE pHandle, std::vector<ModuleMapEntry>& modules);
 VOID SpawnProcess(const wchar_t* pe_file, const wchar_t* command_line, PROCESS_INFORMATION* pi, uint32_t delay);
 BOOL SetAffinity(HardwareInformation& hInfo, DWORD pid, UINT8 core);
 std::vector<DWORD> EnumerateThreads(DWORD pid);
\ No newline at end of file
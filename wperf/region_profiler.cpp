@@ -0,0 +1,143 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "region_profiler.h"
+
+RegionThread::RegionThread(size_t num_values)
+    : m_num_values(num_values), m_stride(VALUES + num_values),
+      m_acc(new std::atomic<uint64_t>[m_MAX_REGIONS * (VALUES + num_values)]),
+      m_stack(m_MAX_DEPTH), m_start(m_MAX_DEPTH * num_values)
+{
+    for (size_t i = 0; i < m_MAX_REGIONS * m_stride; i++)
+        m_acc[i].store(0, std::memory_order_relaxed);
+}
+
+bool RegionThread::Begin(uint32_t region, uint32_t core, const uint64_t* values)
+{
+    if (region >= m_MAX_REGIONS || m_depth == m_MAX_DEPTH || m_overflow)
+    {
+        m_overflow++;
+        return false;
+    }
+
+    m_stack[m_depth] = { region, core, 0 };
+    std::copy(values, values + m_num_values, m_start.begin() + m_depth * m_num_values);
+    m_depth++;
+    return true;
+}
+
+bool RegionThread::End(uint32_t region, uint32_t core, const uint64_t* values)
+{
+    if (m_overflow)
+    {
+        m_overflow--;
+        return false;
+    }
+
+    // Regions have to be properly nested
+    if (m_depth == 0 || m_stack[m_depth - 1].region != region)
+        return false;
+
+    m_depth--;
+    const Frame& frame = m_stack[m_depth];
+
+    // Parent pays for the whole instrumentation of this region and its children, see RegionCalibration
+    if (m_depth)
+        m_stack[m_depth - 1].nested += 1 + frame.nested;
+
+    if (core == m_NO_CORE || core != frame.core)
+    {
+        Add(Acc(region, MIGRATED), 1);
+        return false;
+    }
+
+    const uint64_t* start = m_start.data() + m_depth * m_num_values;
+    for (size_t i = 0; i < m_num_values; i++)
+        Add(Acc(region, VALUES + i), values[i] >= start[i] ? values[i] - start[i] : 0);
+
+    Add(Acc(region, NESTED), frame.nested);
+    Add(Acc(region, CALLS), 1);
+    return true;
+}
+
+void RegionThread::Merge(uint32_t region, RegionTotals& totals) const
+{
+    if (region >= m_MAX_REGIONS)
+        return;
+
+    totals.values.resize(m_num_values, 0);
+    totals.calls += Acc(region, CALLS).load(std::memory_order_relaxed);
+    totals.migrated += Acc(region, MIGRATED).load(std::memory_order_relaxed);
+    totals.nested += Acc(region, NESTED).load(std::memory_order_relaxed);
+    for (size_t i = 0; i < m_num_values; i++)
+        totals.values[i] += Acc(region, VALUES + i).load(std::memory_order_relaxed);
+}
+
+RegionThread* RegionThreads::Current(const RegionThreadSlot& slot) const
+{
+    if (slot.data && slot.generation == m_generation.load(std::memory_order_acquire))
+        return slot.data.get();
+    return nullptr;
+}
+
+RegionThread* RegionThreads::Attach(RegionThreadSlot& slot, size_t num_values)
+{
+    slot.data = std::make_shared<RegionThread>(num_values);
+    slot.generation = m_generation.load(std::memory_order_relaxed);
+    m_threads.push_back(slot.data);
+    return slot.data.get();
+}
+
+void RegionThreads::Reset()
+{
+    m_threads.clear();
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void RegionCalibration::Correct(RegionTotals& totals) const
+{
+    for (size_t i = 0; i < totals.values.size() && i < self.size() && i < inner.size(); i++)
+    {
+        uint64_t overhead = totals.calls * self[i] + totals.nested * inner[i];
+        totals.values[i] = totals.values[i] > overhead ? totals.values[i] - overhead : 0;
+    }
+}
+
+uint64_t RegionCalibration::Median(std::vector<uint64_t> samples)
+{
+    if (samples.empty())
+        return 0;
+
+    auto mid = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), mid, samples.end());
+    return *mid;
+}
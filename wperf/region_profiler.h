@@ -0,0 +1,155 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// <summary>
+/// Aggregated counts of one code region, see RegionThread::Merge().
+/// </summary>
+struct RegionTotals
+{
+    uint64_t calls = 0;             // Completed region_begin() / region_end() pairs
+    uint64_t migrated = 0;          // Pairs dropped because thread changed core in between
+    uint64_t nested = 0;            // Instrumented regions completed inside this one
+    std::vector<uint64_t> values;   // Sums of counter deltas of `calls` pairs
+};
+
+/// <summary>
+/// Per thread state of code region instrumentation (see wperf_region_begin() in wperf-lib).
+/// Every thread owns one RegionThread: a stack of open regions and accumulators of
+/// completed ones. Begin() and End() are called only by the owning thread and take no
+/// locks. Each accumulator has exactly one writer so it is updated with relaxed atomic
+/// load and store (no read-modify-write) and Merge() can be called from any thread at
+/// report time.
+///
+/// Counter values passed to Begin() and End() are live reads of the core the thread
+/// runs on. Pairs where the thread ended on another core (or where the read could not
+/// be done on the thread's core, m_NO_CORE) are not accumulated but counted as migrated.
+/// </summary>
+class RegionThread
+{
+public:
+    RegionThread(size_t num_values);
+
+    bool Begin(uint32_t region, uint32_t core, const uint64_t* values);    // Return false if region was not opened
+    bool End(uint32_t region, uint32_t core, const uint64_t* values);      // Return false if region was not accumulated
+    void Merge(uint32_t region, RegionTotals& totals) const;               // Add accumulated counts of region to totals
+
+    size_t Depth() const { return m_depth + m_overflow; }
+    size_t NumValues() const { return m_num_values; }
+
+    static constexpr uint32_t m_MAX_REGIONS = 256;
+    static constexpr size_t m_MAX_DEPTH = 64;
+    static constexpr uint32_t m_NO_CORE = UINT32_MAX;
+
+private:
+    struct Frame
+    {
+        uint32_t region;
+        uint32_t core;
+        uint64_t nested;
+    };
+
+    enum Field { CALLS, MIGRATED, NESTED, VALUES };
+
+    std::atomic<uint64_t>& Acc(uint32_t region, size_t field) const { return m_acc[region * m_stride + field]; }
+    static void Add(std::atomic<uint64_t>& acc, uint64_t value)
+    {
+        acc.store(acc.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    const size_t m_num_values;
+    const size_t m_stride;                          // Accumulators of one region: CALLS, MIGRATED, NESTED and m_num_values values
+    std::unique_ptr<std::atomic<uint64_t>[]> m_acc; // m_MAX_REGIONS x m_stride
+    std::vector<Frame> m_stack;                     // m_MAX_DEPTH frames, allocated once so Begin() does not allocate
+    std::vector<uint64_t> m_start;                  // Counter values at Begin() of each frame, m_MAX_DEPTH x m_num_values
+    size_t m_depth = 0;
+    size_t m_overflow = 0;                          // Regions begun on full stack, their End() is ignored
+};
+
+/// <summary>
+/// Data of the calling thread as kept by the thread itself (thread_local in wperf-lib),
+/// see RegionThreads.
+/// </summary>
+struct RegionThreadSlot
+{
+    std::shared_ptr<RegionThread> data;
+    uint64_t generation = 0;
+};
+
+/// <summary>
+/// RegionThread of every thread which used regions. Threads share ownership of their data
+/// through RegionThreadSlot, so Reset() (wperf_region_close()) only drops references and
+/// data a thread is still writing in Begin() / End() stays valid until the thread sees the
+/// new generation in Current() or exits.
+///
+/// Current() takes no lock. Attach(), Reset() and Threads() must be serialized by the caller.
+/// </summary>
+class RegionThreads
+{
+public:
+    RegionThread* Current(const RegionThreadSlot& slot) const;          // Data of SLOT or nullptr if it was released by Reset()
+    RegionThread* Attach(RegionThreadSlot& slot, size_t num_values);    // Allocate new data for SLOT
+    void Reset();                                                       // Release data of all threads
+
+    const std::vector<std::shared_ptr<RegionThread>>& Threads() const { return m_threads; }
+
+private:
+    std::vector<std::shared_ptr<RegionThread>> m_threads;
+    std::atomic<uint64_t> m_generation{ 1 };
+};
+
+/// <summary>
+/// Instrumentation overhead of code regions. Live reads of counters go through the
+/// driver, so region_begin() / region_end() are not free and their cost is counted
+/// by the regions themselves:
+///
+///   SELF  - counts of an empty region: everything region_begin() does after its
+///           read and region_end() does before its read,
+///   INNER - counts one complete empty region adds to the region enclosing it.
+///
+/// Both are measured per event by wperf_region_calibrate() as medians of many runs so
+/// counting DPC ticks and interrupts hitting single runs do not skew them. Corrected
+/// value of a region is VALUE - CALLS * SELF - NESTED * INNER, clamped at 0.
+/// </summary>
+struct RegionCalibration
+{
+    std::vector<uint64_t> self;
+    std::vector<uint64_t> inner;
+
+    bool IsCalibrated() const { return !self.empty(); }
+    void Correct(RegionTotals& totals) const;
+
+    static uint64_t Median(std::vector<uint64_t> samples);
+};
@@ -0,0 +1,102 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "sample_rate.h"
+
+void SampleRateController::SetInterval(uint32_t counter_idx, uint32_t interval)
+{
+    m_intervals[counter_idx] = interval;
+    m_samples[counter_idx] = 0;
+}
+
+uint32_t SampleRateController::GetInterval(uint32_t counter_idx) const
+{
+    auto it = m_intervals.find(counter_idx);
+    return it == m_intervals.end() ? 0 : it->second;
+}
+
+void SampleRateController::AddSamples(uint32_t counter_idx, uint64_t samples)
+{
+    if (m_intervals.count(counter_idx))
+        m_samples[counter_idx] += samples;
+}
+
+/// <summary>
+/// Compute new intervals from samples received in last ELAPSED seconds and
+/// reset sample counts. Returned map contains only counters which interval
+/// changed: [raw counter index] -> new interval.
+/// </summary>
+std::map<uint32_t, uint32_t> SampleRateController::Update(double elapsed)
+{
+    std::map<uint32_t, uint32_t> changed;
+
+    if (elapsed <= 0.0)
+        return changed;
+
+    for (auto& [counter_idx, interval] : m_intervals)
+    {
+        uint32_t next = NextInterval(interval, m_samples[counter_idx], elapsed, m_frequency);
+        m_samples[counter_idx] = 0;
+
+        if (next != interval)
+        {
+            interval = next;
+            changed[counter_idx] = next;
+        }
+    }
+
+    return changed;
+}
+
+/// <summary>
+/// Counter with INTERVAL generated SAMPLES in ELAPSED seconds, so it counts
+/// about INTERVAL * SAMPLES / ELAPSED events per second. Interval which gives
+/// FREQUENCY samples per second is that divided by FREQUENCY. No samples at
+/// all means event is (currently) rare, interval shrinks by m_MAX_STEP.
+/// </summary>
+uint32_t SampleRateController::NextInterval(uint32_t interval, uint64_t samples, double elapsed, double frequency)
+{
+    if (elapsed <= 0.0 || frequency <= 0.0)
+        return interval;
+
+    double factor = static_cast<double>(samples) / (elapsed * frequency);
+
+    if (factor > 1.0 - m_TOLERANCE && factor < 1.0 + m_TOLERANCE)
+        return interval;
+
+    factor = std::clamp(factor, 1.0 / m_MAX_STEP, m_MAX_STEP);
+
+    double next = std::clamp(static_cast<double>(interval) * factor,
+                             static_cast<double>(m_MIN_INTERVAL),
+                             static_cast<double>(m_MAX_INTERVAL));
+    return static_cast<uint32_t>(next);
+}
@@ -0,0 +1,66 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <map>
+
+/// <summary>
+/// Frequency mode of sampling (`-F <Hz>`). Instead of fixed overflow interval
+/// every sampled counter gets its interval adjusted so it produces about
+/// m_frequency samples per second on sampled core. Caller feeds number of
+/// samples it received per counter with AddSamples() and periodically calls
+/// Update() which returns intervals which changed and should be sent to the
+/// driver. Intervals change at most m_MAX_STEP times per update so short
+/// bursts do not swing the interval too much, and small deviations (see
+/// m_TOLERANCE) are ignored to avoid reprogramming counters for nothing.
+/// </summary>
+class SampleRateController
+{
+public:
+    SampleRateController(double frequency) : m_frequency(frequency) {}
+
+    void SetInterval(uint32_t counter_idx, uint32_t interval);
+    uint32_t GetInterval(uint32_t counter_idx) const;
+    void AddSamples(uint32_t counter_idx, uint64_t samples = 1);
+    std::map<uint32_t, uint32_t> Update(double elapsed);
+
+    static uint32_t NextInterval(uint32_t interval, uint64_t samples, double elapsed, double frequency);
+
+    static constexpr double m_MAX_STEP = 4.0;           // Max interval change factor per update
+    static constexpr double m_TOLERANCE = 0.1;          // Sample rate within +/-10% of target keeps interval
+    static constexpr uint32_t m_MIN_INTERVAL = 1000;    // Keep rare events from flooding core with interrupts when they burst
+    static constexpr uint32_t m_MAX_INTERVAL = 0xFFFF0000;
+
+private:
+    std::map<uint32_t, uint32_t> m_intervals;           // [raw counter index] -> current interval
+    std::map<uint32_t, uint64_t> m_samples;             // [raw counter index] -> samples since last update
+    double m_frequency;
+};
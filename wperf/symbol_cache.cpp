@@ -0,0 +1,329 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include "mapped_file.h"
+#include "symbol_cache.h"
+
+namespace
+{
+    constexpr char FILE_MAGIC[8] = { 'W', 'P', 'S', 'Y', 'M', 'C', 'H', '\0' };
+
+    void put32(std::vector<uint8_t>& buf, size_t pos, uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            buf[pos + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    void put64(std::vector<uint8_t>& buf, size_t pos, uint64_t v)
+    {
+        for (int i = 0; i < 8; i++)
+            buf[pos + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    uint32_t get32(const uint8_t* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint64_t get64(const uint8_t* p)
+    {
+        return get32(p) | (static_cast<uint64_t>(get32(p + 4)) << 32);
+    }
+
+    // wchar_t is UTF-16 on Windows and UTF-32 elsewhere, file always stores UTF-8
+    std::string to_utf8(const std::wstring& str)
+    {
+        std::string out;
+
+        for (size_t i = 0; i < str.size(); i++)
+        {
+            uint32_t cp = static_cast<uint32_t>(str[i]);
+
+            if (sizeof(wchar_t) == 2 && cp >= 0xd800 && cp <= 0xdbff && i + 1 < str.size())
+            {
+                uint32_t lo = static_cast<uint32_t>(str[i + 1]);
+                if (lo >= 0xdc00 && lo <= 0xdfff)
+                {
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                    i++;
+                }
+            }
+
+            if (cp < 0x80)
+                out += static_cast<char>(cp);
+            else if (cp < 0x800)
+            {
+                out += static_cast<char>(0xc0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+            else if (cp < 0x10000)
+            {
+                out += static_cast<char>(0xe0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+            else
+            {
+                out += static_cast<char>(0xf0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (cp & 0x3f));
+            }
+        }
+        return out;
+    }
+
+    std::wstring from_utf8(const char* str)
+    {
+        std::wstring out;
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(str);
+
+        while (*p)
+        {
+            uint32_t cp = *p++;
+            int extra = 0;
+
+            if (cp >= 0xf0)      { cp &= 0x07; extra = 3; }
+            else if (cp >= 0xe0) { cp &= 0x0f; extra = 2; }
+            else if (cp >= 0xc0) { cp &= 0x1f; extra = 1; }
+
+            for (; extra > 0 && (*p & 0xc0) == 0x80; extra--)
+                cp = (cp << 6) | (*p++ & 0x3f);
+
+            if (sizeof(wchar_t) == 2 && cp >= 0x10000)
+            {
+                cp -= 0x10000;
+                out += static_cast<wchar_t>(0xd800 + (cp >> 10));
+                out += static_cast<wchar_t>(0xdc00 + (cp & 0x3ff));
+            }
+            else
+                out += static_cast<wchar_t>(cp);
+        }
+        return out;
+    }
+
+    // String table with interning, references are offsets into the table
+    class StringTable
+    {
+        std::map<std::wstring, uint32_t> m_index;
+    public:
+        std::vector<uint8_t> m_data;
+
+        uint32_t Add(const std::wstring& str)
+        {
+            auto it = m_index.find(str);
+            if (it != m_index.end())
+                return it->second;
+
+            const uint32_t offset = static_cast<uint32_t>(m_data.size());
+            const std::string utf8 = to_utf8(str);
+            m_data.insert(m_data.end(), utf8.begin(), utf8.end());
+            m_data.push_back(0);
+            m_index[str] = offset;
+            return offset;
+        }
+    };
+}
+
+/// <summary>
+/// Serialize cache to its binary format, see `SymbolCache` for layout.
+/// </summary>
+std::vector<uint8_t> SymbolCache::Serialize() const
+{
+    StringTable strings;
+    size_t line_count = 0;
+
+    for (const auto& f : m_functions)
+        line_count += f.lines.size();
+
+    const size_t functions_off = m_HEADER_SIZE;
+    const size_t lines_off = functions_off + m_functions.size() * m_FUNCTION_SIZE;
+    const size_t strings_off = lines_off + line_count * m_LINE_SIZE;
+
+    std::vector<uint8_t> buf(strings_off, 0);
+    uint32_t line_idx = 0;
+
+    for (size_t i = 0; i < m_functions.size(); i++)
+    {
+        const SymbolCacheFunction& f = m_functions[i];
+        const size_t pos = functions_off + i * m_FUNCTION_SIZE;
+
+        put32(buf, pos + 0, f.sec_idx);
+        put32(buf, pos + 4, f.size);
+        put64(buf, pos + 8, f.offset);
+        put32(buf, pos + 16, strings.Add(f.name));
+        put32(buf, pos + 20, line_idx);
+        put32(buf, pos + 24, static_cast<uint32_t>(f.lines.size()));
+
+        for (const auto& l : f.lines)
+        {
+            const size_t lpos = lines_off + line_idx * m_LINE_SIZE;
+
+            put32(buf, lpos + 0, strings.Add(l.source_file));
+            put32(buf, lpos + 4, l.line_num);
+            put32(buf, lpos + 8, l.col_num);
+            put32(buf, lpos + 12, l.is_statement);
+            put32(buf, lpos + 16, l.address_section);
+            put32(buf, lpos + 20, l.address_offset);
+            put32(buf, lpos + 24, l.length);
+            put32(buf, lpos + 28, l.rva);
+            put64(buf, lpos + 32, l.virtual_address);
+            line_idx++;
+        }
+    }
+
+    memcpy(buf.data(), FILE_MAGIC, sizeof(FILE_MAGIC));
+    put32(buf, 8, m_VERSION);
+    put32(buf, 12, m_flags);
+    put64(buf, 16, m_key);
+    put32(buf, 24, static_cast<uint32_t>(m_functions.size()));
+    put32(buf, 28, static_cast<uint32_t>(line_count));
+    put64(buf, 32, functions_off);
+    put64(buf, 40, lines_off);
+    put64(buf, 48, strings_off);
+    put64(buf, 56, strings.m_data.size());
+
+    buf.insert(buf.end(), strings.m_data.begin(), strings.m_data.end());
+    return buf;
+}
+
+/// <summary>
+/// Read cache from SIZE bytes of DATA (e.g. file content or memory mapped
+/// view). All offsets are validated, returns false for malformed data or
+/// unsupported version.
+/// </summary>
+bool SymbolCache::Deserialize(const uint8_t* data, size_t size)
+{
+    if (size < m_HEADER_SIZE || memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+        return false;
+    if (get32(data + 8) != m_VERSION)
+        return false;
+
+    const uint64_t function_count = get32(data + 24);
+    const uint64_t line_count = get32(data + 28);
+    const uint64_t functions_off = get64(data + 32);
+    const uint64_t lines_off = get64(data + 40);
+    const uint64_t strings_off = get64(data + 48);
+    const uint64_t strings_size = get64(data + 56);
+
+    if (functions_off > size || function_count * m_FUNCTION_SIZE > size - functions_off
+        || lines_off > size || line_count * m_LINE_SIZE > size - lines_off
+        || strings_off > size || strings_size > size - strings_off
+        || (strings_size && data[strings_off + strings_size - 1] != 0))
+        return false;
+
+    auto get_string = [&](uint32_t offset, std::wstring& str) -> bool {
+        if (offset >= strings_size)
+            return false;
+        str = from_utf8(reinterpret_cast<const char*>(data + strings_off + offset));
+        return true;
+    };
+
+    std::map<uint32_t, std::wstring> source_files;      // Interned strings are decoded once
+    std::vector<SymbolCacheFunction> functions(static_cast<size_t>(function_count));
+
+    for (size_t i = 0; i < functions.size(); i++)
+    {
+        const uint8_t* p = data + functions_off + i * m_FUNCTION_SIZE;
+        SymbolCacheFunction& f = functions[i];
+        const uint64_t first_line = get32(p + 20);
+        const uint64_t lines = get32(p + 24);
+
+        f.sec_idx = get32(p + 0);
+        f.size = get32(p + 4);
+        f.offset = get64(p + 8);
+        if (!get_string(get32(p + 16), f.name) || first_line + lines > line_count)
+            return false;
+
+        f.lines.resize(static_cast<size_t>(lines));
+        for (size_t j = 0; j < f.lines.size(); j++)
+        {
+            const uint8_t* lp = data + lines_off + (first_line + j) * m_LINE_SIZE;
+            SymbolCacheLine& l = f.lines[j];
+            const uint32_t source_file = get32(lp + 0);
+
+            if (source_files.count(source_file) == 0 && !get_string(source_file, source_files[source_file]))
+                return false;
+
+            l.source_file = source_files[source_file];
+            l.line_num = get32(lp + 4);
+            l.col_num = get32(lp + 8);
+            l.is_statement = get32(lp + 12);
+            l.address_section = get32(lp + 16);
+            l.address_offset = get32(lp + 20);
+            l.length = get32(lp + 24);
+            l.rva = get32(lp + 28);
+            l.virtual_address = get64(lp + 32);
+        }
+    }
+
+    m_flags = get32(data + 12);
+    m_key = get64(data + 16);
+    m_functions = std::move(functions);
+    return true;
+}
+
+bool SymbolCache::Save(const std::wstring& filename) const
+{
+    std::ofstream os(std::filesystem::path(filename), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+        return false;
+
+    const std::vector<uint8_t> buf = Serialize();
+    os.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    return os.good();
+}
+
+bool SymbolCache::Load(const std::wstring& filename)
+{
+    MappedFile file(filename);
+    if (file.data() == nullptr)
+        return false;
+
+    return Deserialize(file.data(), file.size());
+}
+
+/// <summary>
+/// Cache file name for PDB_FILE, e.g. `<DIR>\python312.pdb.<KEY>.sym`.
+/// </summary>
+std::wstring SymbolCache::GenFilename(const std::wstring& dir, const std::wstring& pdb_file, uint64_t key)
+{
+    std::wstringstream name;
+    name << std::filesystem::path(pdb_file).filename().wstring() << L"."
+         << std::hex << std::setw(16) << std::setfill(L'0') << key << L".sym";
+    return (std::filesystem::path(dir) / name.str()).wstring();
+}
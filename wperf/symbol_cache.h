@@ -0,0 +1,98 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SymbolCacheLine
+{
+    std::wstring source_file;
+    uint32_t line_num{};
+    uint32_t col_num{};
+    uint32_t is_statement{};
+    uint32_t address_section{};
+    uint32_t address_offset{};
+    uint32_t length{};
+    uint32_t rva{};
+    uint64_t virtual_address{};
+};
+
+struct SymbolCacheFunction
+{
+    uint32_t sec_idx{};
+    uint32_t size{};
+    uint64_t offset{};
+    std::wstring name;
+    std::vector<SymbolCacheLine> lines;
+};
+
+/// <summary>
+/// Persistent cache of symbols (functions and their line tables) read from
+/// a PDB file. Cache is keyed by KEY (hash of PDB GUID and age) and
+/// FLAGS (options which change symbol names, e.g. short names).
+///
+/// Binary format is platform neutral (little-endian, UTF-8 strings) and is
+/// made of fixed size records which refer to each other and to a string
+/// table by offset, so it can be used directly from a memory mapped view:
+///
+///   header | function records | line records | string table
+///
+/// Source file names are interned in the string table.
+///
+/// Load() maps cache file through `MappedFile`.
+/// </summary>
+class SymbolCache
+{
+public:
+    uint64_t m_key = 0;
+    uint32_t m_flags = 0;
+    std::vector<SymbolCacheFunction> m_functions;
+
+    std::vector<uint8_t> Serialize() const;
+    bool Deserialize(const uint8_t* data, size_t size);
+
+    bool Save(const std::wstring& filename) const;
+    bool Load(const std::wstring& filename);
+
+    static std::wstring GenFilename(const std::wstring& dir, const std::wstring& pdb_file, uint64_t key);
+
+    static constexpr uint32_t m_VERSION = 1;
+    static constexpr size_t m_HEADER_SIZE = 64;
+    static constexpr size_t m_FUNCTION_SIZE = 32;
+    static constexpr size_t m_LINE_SIZE = 40;
+
+    enum Flags : uint32_t
+    {
+        FLAG_SHORT_NAMES = 1 << 0,
+    };
+};
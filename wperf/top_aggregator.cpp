@@ -0,0 +1,142 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+
+#include "top_aggregator.h"
+
+void TopAggregator::Add(uint32_t event_src, const std::wstring& symbol, double weight)
+{
+    m_weights[event_src][symbol] += weight;
+    m_totals[event_src] += weight;
+}
+
+/// <summary>
+/// Age all weights by ELAPSED seconds. Entries which decayed below
+/// m_PRUNE_WEIGHT are removed so memory use follows the working set
+/// of hot functions and not the whole session.
+/// </summary>
+void TopAggregator::Decay(double elapsed)
+{
+    const double factor = DecayFactor(elapsed, m_half_life);
+    if (factor >= 1.0)
+        return;
+
+    for (auto it = m_weights.begin(); it != m_weights.end(); )
+    {
+        double total = 0.0;
+        auto& symbols = it->second;
+        for (auto sym = symbols.begin(); sym != symbols.end(); )
+        {
+            sym->second *= factor;
+            if (sym->second < m_PRUNE_WEIGHT)
+            {
+                sym = symbols.erase(sym);
+                continue;
+            }
+            total += sym->second;
+            ++sym;
+        }
+
+        if (symbols.empty())
+        {
+            m_totals.erase(it->first);
+            it = m_weights.erase(it);
+            continue;
+        }
+
+        m_totals[it->first] = total;
+        ++it;
+    }
+}
+
+/// <summary>
+/// Returns up to N heaviest symbols of EVENT_SRC, heaviest first.
+/// Symbols with equal weight are ordered by name so output is stable
+/// between refreshes.
+/// </summary>
+std::vector<TopEntry> TopAggregator::Top(uint32_t event_src, size_t n) const
+{
+    std::vector<TopEntry> result;
+    auto it = m_weights.find(event_src);
+    if (it == m_weights.end())
+        return result;
+
+    for (const auto& [symbol, weight] : it->second)
+        result.push_back({ symbol, weight });
+
+    auto heavier = [](const TopEntry& a, const TopEntry& b) {
+        return a.weight != b.weight ? a.weight > b.weight : a.symbol < b.symbol;
+    };
+
+    if (n < result.size())
+    {
+        std::partial_sort(result.begin(), result.begin() + n, result.end(), heavier);
+        result.resize(n);
+    }
+    else
+        std::sort(result.begin(), result.end(), heavier);
+
+    return result;
+}
+
+std::vector<uint32_t> TopAggregator::GetEvents() const
+{
+    std::vector<uint32_t> events;
+    for (const auto& [event_src, _] : m_weights)
+        events.push_back(event_src);
+    return events;
+}
+
+double TopAggregator::GetTotal(uint32_t event_src) const
+{
+    auto it = m_totals.find(event_src);
+    return it == m_totals.end() ? 0.0 : it->second;
+}
+
+size_t TopAggregator::GetSize() const
+{
+    size_t size = 0;
+    for (const auto& [_, symbols] : m_weights)
+        size += symbols.size();
+    return size;
+}
+
+/// <summary>
+/// Returns factor weights are multiplied by after ELAPSED seconds for given
+/// HALF_LIFE (in seconds). Half-life of zero (or less) disables decay.
+/// </summary>
+double TopAggregator::DecayFactor(double elapsed, double half_life)
+{
+    if (half_life <= 0.0 || elapsed <= 0.0)
+        return 1.0;
+    return std::pow(0.5, elapsed / half_life);
+}
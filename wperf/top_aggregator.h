@@ -0,0 +1,72 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TopEntry
+{
+    std::wstring symbol;
+    double weight{};
+};
+
+/// <summary>
+/// Incremental aggregation of samples for `wperf top`. Every resolved sample
+/// adds weight to its (event, symbol) pair. Weights decay exponentially with
+/// the configured half-life so the view follows what is hot now, old samples
+/// fade away instead of dominating the table for the whole session.
+/// Half-life of zero disables decay, weights then accumulate over the whole
+/// session (same as `wperf sample`).
+/// </summary>
+class TopAggregator
+{
+public:
+    TopAggregator(double half_life = 0.0) : m_half_life(half_life) {}
+
+    void Add(uint32_t event_src, const std::wstring& symbol, double weight = 1.0);
+    void Decay(double elapsed);
+    std::vector<TopEntry> Top(uint32_t event_src, size_t n) const;
+    std::vector<uint32_t> GetEvents() const;
+    double GetTotal(uint32_t event_src) const;
+    size_t GetSize() const;
+
+    static double DecayFactor(double elapsed, double half_life);
+
+    static constexpr double m_PRUNE_WEIGHT = 0.01;  // Entries decayed below this weight are dropped
+
+private:
+    std::map<uint32_t, std::unordered_map<std::wstring, double>> m_weights;    // [event_src] -> [symbol] -> weight
+    std::map<uint32_t, double> m_totals;                                        // [event_src] -> sum of weights
+    double m_half_life;
+};
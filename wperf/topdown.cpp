@@ -0,0 +1,207 @@
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+#include "topdown.h"
+
+// First of these groups found for the product is stage 1
+const std::vector<std::wstring> TopdownPlan::m_STAGE1_GROUPS = { L"Topdown_L1", L"Cycle_Accounting" };
+
+// Stage 1 metric -> stage 2 metric groups. Cores without Topdown_L1 have no
+// `bad_speculation` and `retiring`, their groups go under stalled cycles.
+const std::vector<std::pair<std::wstring, std::vector<std::wstring>>> TopdownPlan::m_DRILL_DOWN =
+{
+    { L"frontend_bound",          { L"ITLB_Effectiveness", L"L1I_Cache_Effectiveness", L"L2_Cache_Effectiveness", L"LL_Cache_Effectiveness" } },
+    { L"backend_bound",           { L"DTLB_Effectiveness", L"L1D_Cache_Effectiveness", L"L2_Cache_Effectiveness", L"LL_Cache_Effectiveness" } },
+    { L"bad_speculation",         { L"Branch_Effectiveness" } },
+    { L"retiring",                { L"Operation_Mix" } },
+    { L"frontend_stalled_cycles", { L"Branch_Effectiveness", L"ITLB_Effectiveness", L"L1I_Cache_Effectiveness", L"L2_Cache_Effectiveness", L"LL_Cache_Effectiveness" } },
+    { L"backend_stalled_cycles",  { L"DTLB_Effectiveness", L"L1D_Cache_Effectiveness", L"L2_Cache_Effectiveness", L"LL_Cache_Effectiveness", L"Operation_Mix" } },
+};
+
+/// <summary>
+/// Build plan from GROUPS_OF_METRICS (metric group -> metrics) and
+/// METRIC_EVENTS (metric -> events) of the product, for COUNTERS free
+/// hardware counters. Metrics without events are left out. Plan is
+/// Empty() if product has no stage 1 metric group.
+/// </summary>
+TopdownPlan::TopdownPlan(const std::map<std::wstring, std::vector<std::wstring>>& groups_of_metrics,
+                         const std::map<std::wstring, std::vector<std::wstring>>& metric_events,
+                         size_t counters)
+{
+    auto add_group = [&](const std::wstring& group) {
+        if (m_group_metrics.count(group))
+            return true;
+        if (groups_of_metrics.count(group) == 0)
+            return false;
+
+        std::vector<std::wstring>& metrics = m_group_metrics[group];
+        for (const auto& metric : groups_of_metrics.at(group))
+            if (metric_events.count(metric))
+                metrics.push_back(metric);
+        return !metrics.empty();
+    };
+
+    for (const auto& group : m_STAGE1_GROUPS)
+        if (add_group(group))
+        {
+            m_stage1_group = group;
+            break;
+        }
+
+    if (m_stage1_group.empty())
+        return;
+
+    for (const auto& metric : m_group_metrics[m_stage1_group])
+    {
+        Node node = { metric, {} };
+
+        auto drill_down = std::find_if(m_DRILL_DOWN.begin(), m_DRILL_DOWN.end(),
+                                       [&metric](const auto& d) { return d.first == metric; });
+        if (drill_down != m_DRILL_DOWN.end())
+            for (const auto& group : drill_down->second)
+                if (add_group(group))
+                    node.groups.push_back(group);
+
+        m_stage1.push_back(node);
+    }
+
+    // Plan event groups stage by stage, stage 2 can reuse or extend stage 1 groups
+    std::vector<std::vector<std::wstring>> event_groups;
+    std::vector<std::wstring> stage2;
+
+    m_metrics = m_group_metrics[m_stage1_group];
+    for (const auto& node : m_stage1)
+        for (const auto& group : node.groups)
+            for (const auto& metric : m_group_metrics[group])
+                if (std::find(m_metrics.begin(), m_metrics.end(), metric) == m_metrics.end()
+                    && std::find(stage2.begin(), stage2.end(), metric) == stage2.end())
+                    stage2.push_back(metric);
+
+    for (const auto& stage : { std::vector<std::wstring>(m_metrics), stage2 })
+    {
+        std::vector<std::vector<std::wstring>> sets;
+        std::vector<size_t> assignment;
+
+        for (const auto& metric : stage)
+            sets.push_back(metric_events.at(metric));
+
+        Pack(sets, counters, event_groups, assignment);
+
+        for (size_t i = 0; i < stage.size(); i++)
+            m_metric_event_group[stage[i]] = assignment[i];
+    }
+
+    m_metrics.insert(m_metrics.end(), stage2.begin(), stage2.end());
+
+    for (const auto& events : event_groups)
+        m_event_groups.push_back({ events, -1 });
+}
+
+const std::vector<std::wstring>& TopdownPlan::GroupMetrics(const std::wstring& group) const
+{
+    static const std::vector<std::wstring> none;
+
+    auto it = m_group_metrics.find(group);
+    return it == m_group_metrics.end() ? none : it->second;
+}
+
+size_t TopdownPlan::EventGroupOf(const std::wstring& metric) const
+{
+    return m_metric_event_group.at(metric);
+}
+
+size_t TopdownPlan::EventGroupIndex(int id) const
+{
+    for (size_t i = 0; i < m_event_groups.size(); i++)
+        if (m_event_groups[i].id == id)
+            return i;
+
+    return SIZE_MAX;
+}
+
+/// <summary>
+/// Pack event SETS into GROUPS of at most COUNTERS events, ASSIGNMENT[i] is
+/// index of group set i was packed into. Sets are placed largest first:
+/// into a group which already has all its events, or else into the group
+/// which needs fewest new events and still fits, or else into a new group.
+/// GROUPS may already hold groups (e.g. of previous stage) to be reused.
+/// Sets larger than COUNTERS get a group of their own.
+/// </summary>
+void TopdownPlan::Pack(const std::vector<std::vector<std::wstring>>& sets, size_t counters,
+                       std::vector<std::vector<std::wstring>>& groups, std::vector<size_t>& assignment)
+{
+    std::vector<size_t> order(sets.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&sets](size_t a, size_t b) { return sets[a].size() > sets[b].size(); });
+
+    assignment.assign(sets.size(), SIZE_MAX);
+
+    for (size_t i : order)
+    {
+        const std::set<std::wstring> set(sets[i].begin(), sets[i].end());
+        size_t best = SIZE_MAX, best_new = SIZE_MAX;
+
+        for (size_t g = 0; g < groups.size(); g++)
+        {
+            size_t new_events = 0;
+            for (const auto& event : set)
+                if (std::find(groups[g].begin(), groups[g].end(), event) == groups[g].end())
+                    new_events++;
+
+            if (groups[g].size() + new_events <= counters && new_events < best_new)
+            {
+                best = g;
+                best_new = new_events;
+
+                if (new_events == 0)
+                    break;
+            }
+        }
+
+        if (best == SIZE_MAX)
+        {
+            best = groups.size();
+            groups.emplace_back();
+        }
+
+        for (const auto& event : sets[i])
+            if (std::find(groups[best].begin(), groups[best].end(), event) == groups[best].end())
+                groups[best].push_back(event);
+
+        assignment[i] = best;
+    }
+}
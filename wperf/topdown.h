@@ -0,0 +1,94 @@
+#pragma once
+// BSD 3-Clause License
+//
+// Copyright (c) 2024, Arm Limited
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// Plan of native Arm Topdown analysis for `wperf stat --topdown`.
+///
+/// Stage 1 is metric group `Topdown_L1` (or `Cycle_Accounting` on cores
+/// without slot events) which splits pipeline utilization. Every stage 1
+/// metric drills down into stage 2 metric groups ("micro-architecture
+/// exploration") which explain it, see m_DRILL_DOWN.
+///
+/// Events of all metrics of both stages are packed into as few event groups
+/// as fit in the hardware counters (see Pack()) so whole tree is counted in
+/// one session. Each metric is calculated from the one event group it was
+/// assigned to, so its events are always counted together.
+/// </summary>
+class TopdownPlan
+{
+public:
+    struct Node
+    {
+        std::wstring metric;                // Stage 1 metric
+        std::vector<std::wstring> groups;   // Stage 2 metric groups it drills down into
+    };
+
+    struct EventGroup
+    {
+        std::vector<std::wstring> events;
+        int id = -1;                        // Event group number assigned when group is scheduled
+    };
+
+    TopdownPlan(const std::map<std::wstring, std::vector<std::wstring>>& groups_of_metrics,
+                const std::map<std::wstring, std::vector<std::wstring>>& metric_events,
+                size_t counters);
+
+    bool Empty() const { return m_stage1.empty(); }
+    const std::wstring& Stage1Group() const { return m_stage1_group; }
+    const std::vector<Node>& Stage1() const { return m_stage1; }
+    const std::vector<std::wstring>& GroupMetrics(const std::wstring& group) const;
+    const std::vector<std::wstring>& Metrics() const { return m_metrics; }  // Stage 1 first, no duplicates
+
+    const std::vector<EventGroup>& EventGroups() const { return m_event_groups; }
+    size_t EventGroupOf(const std::wstring& metric) const;
+    size_t EventGroupIndex(int id) const;                                   // SIZE_MAX if no event group has ID
+    void SetEventGroupId(size_t group, int id) { m_event_groups[group].id = id; }
+
+    static void Pack(const std::vector<std::vector<std::wstring>>& sets, size_t counters,
+                     std::vector<std::vector<std::wstring>>& groups, std::vector<size_t>& assignment);
+
+private:
+    static const std::vector<std::wstring> m_STAGE1_GROUPS;
+    static const std::vector<std::pair<std::wstring, std::vector<std::wstring>>> m_DRILL_DOWN;
+
+    std::wstring m_stage1_group;
+    std::vector<Node> m_stage1;
+    std::map<std::wstring, std::vector<std::wstring>> m_group_metrics;     // Stage 1 and 2 metric group -> its metrics in plan
+    std::vector<std::wstring> m_metrics;
+    std::vector<EventGroup> m_event_groups;
+    std::map<std::wstring, size_t> m_metric_event_group;                    // Metric -> index in m_event_groups
+};
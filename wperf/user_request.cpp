@@ -28,6 +28,7 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <algorithm>
 #include <filesystem>
 #include <numeric>
 #include <sstream>
@@ -52,26 +53,40 @@ SYNOPSIS:
     wperf [--version] [--help] [OPTIONS]
 
     wperf stat [-e] [-m] [-t] [-i] [-n] [-c] [-C] [-E] [-k] [--dmc] [-q] [--json]
-               [--output] [--config] [--force-lock]
+               [--output] [--config] [--ddr-monitor] [--heatmap] [--topdown] [--force-lock]
     wperf stat [-e] [-m] [-t] [-i] [-n] [-c] [-C] [-E] [-k] [--dmc] [-q] [--json]
-               [--output] [--config] -- COMMAND [ARGS]
+               [--output] [--config] [--ddr-monitor] [--heatmap] [--topdown] -- COMMAND [ARGS]
         Counting mode, for obtaining aggregate counts of occurrences of special
         events.
 
     wperf sample [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config]
                  [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock]
                  [--sample-display-row] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble]
+                 [--disassembly-cache] [--disassembler] [--symbol-cache] [--export_folded] [--sample-histogram]
+                 [-F]
         Sampling mode, for determining the frequencies of event occurrences
         produced by program locations at the function, basic block, and/or
         instruction levels.
 
     wperf record [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config]
                  [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock]
-                 [--sample-display-row] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble] -- COMMAND [ARGS]
+                 [--sample-display-row] [--symbol] [--record_spawn_delay] [--annotate] [--disassemble]
+                 [--disassembly-cache] [--disassembler] [--symbol-cache] [--export_folded]
+                 [--sample-histogram] [-F] -- COMMAND [ARGS]
         Same as sample but also automatically spawns the process and pins it to
         the core specified by `-c`. Process name is defined by COMMAND. User can
         pass verbatim arguments to the process with [ARGS].
 
+    wperf top [-e] [--timeout] [-c] [-C] [-E] [-q] [--json] [--output] [--config]
+              [--image_name] [--pe_file] [--pdb_file] [--sample-display-long] [--force-lock]
+              [--sample-display-row] [--symbol] [--symbol-cache] [--refresh] [--decay]
+              [--sample-histogram] [-F]
+        Live sampling mode. Samples are read, resolved and aggregated while
+        the process runs and the table of hottest functions is refreshed
+        every `--refresh` interval, until Ctrl+C is pressed or `--timeout`
+        expires. With `--json` each refresh is printed as one JSON object
+        per line (JSON lines).
+
     wperf list [-v] [--json] [--force-lock]
         List supported events and metrics. Enable verbose mode for more details.
 
@@ -137,12 +152,83 @@ OPTIONS:
     -n
         Number of consecutive counts in timeline mode (disabled by default).
 
+    --ddr-monitor
+        Sample DDR bandwidth of DMC channels (see `--dmc`) with given interval
+        while counting, implies metric `ddr_bw`. Input may be suffixed with one
+        (or none) of the following units: "ms", "s", "m", "h", "d". Every
+        sample (bandwidth of each channel, all channels and channel imbalance)
+        is streamed to CSV file as soon as it is taken, file is named like
+        timeline files with class `ddr_bw` (see `-t` and `--output-csv`).
+        Bandwidth percentiles and channel imbalance are reported after each
+        count. DMC counters are refreshed by the driver every `count.period`
+        (two periods without multiplexing), shorter intervals are merged.
+
+    --heatmap
+        Sample Telemetry Solution metrics (see `-m`) of every core with given
+        interval while counting. Input may be suffixed with one (or none) of
+        the following units: "ms", "s", "m", "h", "d". Without `-m` metrics
+        `ipc`, `frontend_stalled_cycles`, `backend_stalled_cycles`,
+        `l1d_cache_mpki`, `l2_cache_mpki` and `ll_cache_read_mpki` are used
+        (if supported). Heatmap (metric value per interval and core with
+        min, median and p99 across cores) is written to CSV file named like
+        timeline files with class `heatmap` (see `-t` and `--output-csv`).
+        Spread of metrics across cores is reported after each count. Core
+        counters are refreshed by the driver every `count.period` (two
+        periods without multiplexing), shorter intervals are merged.
+
+    --topdown
+        Run Arm Topdown analysis in one counting session. Stage 1 metrics
+        (metric group `Topdown_L1`, or `Cycle_Accounting` if CPU has no slot
+        events) and stage 2 metric groups they drill down into are counted
+        together in as few event groups as fit in PMU counters. The tree of
+        stage 1 and stage 2 metrics of all counted cores is reported after
+        each count.
+
     --annotate
         Enable translating addresses taken from samples in sample/record mode into source code line numbers.
 
     --disassemble
         Enable disassemble output on sampling mode. Implies 'annotate'.
 
+    --disassembly-cache
+        Specify directory where disassembly of sampled functions is cached
+        between runs. Cache file is created per module and is only reused
+        for the same build of the module (PDB signature, link time stamp and
+        image size) and the same `--disassembler`. Use with `--disassemble`.
+
+    --disassembler
+        Select disassembler used by `--disassemble`: `builtin` (default) decodes
+        AArch64 instructions in-process, `llvm` uses `llvm-objdump` from PATH.
+
+    --symbol-cache
+        Specify directory where symbols (functions and line tables) read from
+        PDB files are cached between runs. Cache file is created per PDB file
+        and is only reused for the PDB with the same GUID and age as recorded
+        in the image (images without debug record are not cached).
+
+    --export_folded
+        Export sampled call stacks in folded format (`frame;frame count`), one
+        file per sample source named `<image>.<event>.folded`. Output can be
+        used directly as flame graph input. Stacks are made of the sampled
+        function and its caller (resolved from the link register).
+
+    --sample-histogram
+        Aggregate samples in the driver: each core counts samples per sampled
+        PC and event in a fixed-size table which is read periodically. This
+        sustains much shorter sampling intervals than default mode, which
+        transfers every sample, at the cost of per sample detail (no caller
+        address). Not available with SPE.
+
+    -F
+        Sample at given frequency (samples per second per event) instead of
+        fixed intervals. Interval of each event is adjusted while sampling, so
+        rare and frequent events produce similar number of samples. Every
+        sample records interval it was taken with and results are weighted by
+        it: overhead is a share of sampled events rather than of samples, and
+        `top` shows estimated event counts. Interval given with
+        `-e event:interval` is used as the starting point. Not available with
+        SPE and `--sample-histogram`.
+
     --image_name
         Specify the image name you want to sample.
 
@@ -162,9 +248,20 @@ OPTIONS:
     --symbol
         Filter results for specific symbols (for use with 'record' and 'sample' commands).
 
+    --refresh
+        Set refresh interval of `top` (2s by default). Input may be suffixed
+        with one (or none) of the following units: "ms", "s", "m", "h", "d".
+        Minimum is 100ms.
+
+    --decay
+        Set half-life of sample weights in `top` (10s by default), functions
+        which are no longer sampled fade away from the table. Use `0` to
+        disable decay and aggregate samples for the whole session.
+
     --record_spawn_delay
         Set the waiting time, in milliseconds, before reading process data after
-        spawning it with `record`.
+        spawning it with `record`. Sampling starts right after the process is
+        spawned, only module enumeration and symbol loading wait for this delay.
 
     --force-lock
         Force driver to give lock to current `wperf` process, use when you want
@@ -201,7 +298,15 @@ OPTIONS:
          Set current working dir for storing output JSON and CSV file.
 
     --config
-        Specify configuration parameters.
+        Specify configuration parameters, e.g. `--config count.period=10`.
+        Counting (multiplexing) period is in milliseconds, use `us` suffix for
+        sub-millisecond periods, e.g. `--config count.period=500us` (`ms` suffix
+        is also accepted). `wperf test` shows count.period and its range
+        (count.period_min/max) in microseconds.
+        `--config mux.weights=W1,W2,...` sets multiplexing weights (1-255) of core
+        event scheduling units in order of `-e`: an event group `{...}` is one
+        unit, every other event is a unit of its own. A unit with weight 2 is
+        scheduled twice as often as a unit with weight 1 (default).
 
 OPTIONS aliases:
     -l
@@ -358,7 +463,7 @@ void user_request::init(wstr_vec& raw_args, const struct pmu_device_cfg& pmu_cfg
             m_out.GetOutputStream() << std::endl;
         }
     }
-    else if (do_sample || do_record)
+    else if (do_sample || do_record || do_top)
     {
         m_out.GetErrorOutputStream() << "no pid or process name specified, sample address are not de-ASLRed" << std::endl;
         throw fatal_exception("ERROR_IMAGE_NAME");
@@ -406,6 +511,14 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
     bool waiting_man_query = false;
     bool waiting_cwd = false;
     bool waiting_symbol = false;
+    bool waiting_disassembly_cache = false;
+    bool waiting_disassembler = false;
+    bool waiting_symbol_cache = false;
+    bool waiting_ddr_monitor = false;
+    bool waiting_heatmap = false;
+    bool waiting_top_refresh = false;
+    bool waiting_top_decay = false;
+    bool waiting_sample_frequency = false;
 
     bool sample_pe_file_given = false;
 
@@ -484,7 +597,7 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
 
         if (waiting_events)
         {
-            if (do_sample || do_record)
+            if (do_sample || do_record || do_top)
             {
                 m_sampling_flags.clear();   // Prepare to collect SPE filters
                 if (parse_events_str_for_feat_spe(a, m_sampling_flags))   // Check if we are sampling with SPE
@@ -495,6 +608,13 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
                         throw fatal_exception("ERROR_SPE_NOT_SUPP");
                     }
 
+                    // SPE records are decoded when sampling ends, there is nothing to refresh with
+                    if (do_top)
+                    {
+                        m_out.GetErrorOutputStream() << L"top: SPE sampling is not supported, use software sampling events: " << a << std::endl;
+                        throw fatal_exception("ERROR_SPE_NOT_SUPP");
+                    }
+
                     m_sampling_with_spe = true;
 
                     for (const auto& [key, value] : m_sampling_flags)
@@ -546,6 +666,32 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (waiting_disassembly_cache)
+        {
+            waiting_disassembly_cache = false;
+            disassembly_cache_dir = a;
+            continue;
+        }
+
+        if (waiting_symbol_cache)
+        {
+            waiting_symbol_cache = false;
+            symbol_cache_dir = a;
+            continue;
+        }
+
+        if (waiting_disassembler)
+        {
+            waiting_disassembler = false;
+            if (a != L"builtin" && a != L"llvm")
+            {
+                m_out.GetErrorOutputStream() << L"unknown disassembler '" << a << L"', use 'builtin' or 'llvm'" << std::endl;
+                throw fatal_exception("ERROR_DISASSEMBLER");
+            }
+            disassembler = a;
+            continue;
+        }
+
         if (waiting_output_filename)
         {
             waiting_output_filename = false;
@@ -609,16 +755,7 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
                     throw fatal_exception("ERROR_METRIC");
                 }
 
-                metric_desc desc = metrics[metric];
-                for (const auto& x : desc.events)
-                    events[x.first].insert(events[x.first].end(), x.second.begin(), x.second.end());
-                for (const auto& y : desc.groups)
-                    groups[y.first].insert(groups[y.first].end(), y.second.begin(), y.second.end());
-
-                if (metric == L"l3_cache")
-                    report_l3_cache_metric = true;
-                else if (metric == L"ddr_bw")
-                    report_ddr_bw_metric = true;
+                add_metric(metric, events, groups);
             }
 
             waiting_metrics = false;
@@ -721,6 +858,61 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (waiting_heatmap)
+        {
+            heatmap_interval = convert_timeout_arg_to_seconds(a, L"--heatmap");
+            if (heatmap_interval < 0.001)
+            {
+                m_out.GetErrorOutputStream() << L"heatmap: interval '" << a << L"' too short, minimum is 1ms" << std::endl;
+                throw fatal_exception("ERROR_HEATMAP");
+            }
+            waiting_heatmap = false;
+            continue;
+        }
+
+        if (waiting_ddr_monitor)
+        {
+            ddr_monitor_interval = convert_timeout_arg_to_seconds(a, L"--ddr-monitor");
+            if (ddr_monitor_interval < 0.001)
+            {
+                m_out.GetErrorOutputStream() << L"ddr monitor: interval '" << a << L"' too short, minimum is 1ms" << std::endl;
+                throw fatal_exception("ERROR_DDR_MONITOR");
+            }
+            waiting_ddr_monitor = false;
+            continue;
+        }
+
+        if (waiting_top_refresh)
+        {
+            top_refresh = convert_timeout_arg_to_seconds(a, L"--refresh");
+            if (top_refresh < 0.1)
+            {
+                m_out.GetErrorOutputStream() << L"top: refresh interval '" << a << L"' too short, minimum is 100ms" << std::endl;
+                throw fatal_exception("ERROR_TOP_REFRESH");
+            }
+            waiting_top_refresh = false;
+            continue;
+        }
+
+        if (waiting_sample_frequency)
+        {
+            sample_frequency = _wtoi(a.c_str());
+            if (sample_frequency == 0)
+            {
+                m_out.GetErrorOutputStream() << L"sampling: invalid sampling frequency '" << a << L"'" << std::endl;
+                throw fatal_exception("ERROR_SAMPLE_FREQUENCY");
+            }
+            waiting_sample_frequency = false;
+            continue;
+        }
+
+        if (waiting_top_decay)
+        {
+            top_decay = convert_timeout_arg_to_seconds(a, L"--decay");
+            waiting_top_decay = false;
+            continue;
+        }
+
         if (waiting_sample_display_row)
         {
             sample_display_row = _wtoi(a.c_str());
@@ -791,6 +983,36 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"top")
+        {
+            do_top = true;
+            continue;
+        }
+
+        if (a == L"--sample-histogram")
+        {
+            do_sample_histogram = true;
+            continue;
+        }
+
+        if (a == L"-F")
+        {
+            waiting_sample_frequency = true;
+            continue;
+        }
+
+        if (a == L"--refresh")
+        {
+            waiting_top_refresh = true;
+            continue;
+        }
+
+        if (a == L"--decay")
+        {
+            waiting_top_decay = true;
+            continue;
+        }
+
         if (a == L"detect")
         {
             do_detect = true;
@@ -816,6 +1038,24 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--disassembly-cache")
+        {
+            waiting_disassembly_cache = true;
+            continue;
+        }
+
+        if (a == L"--disassembler")
+        {
+            waiting_disassembler = true;
+            continue;
+        }
+
+        if (a == L"--symbol-cache")
+        {
+            waiting_symbol_cache = true;
+            continue;
+        }
+
         if (a == L"--force-lock")
         {
             do_force_lock = true;
@@ -828,6 +1068,12 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--export_folded")
+        {
+            do_export_folded = true;
+            continue;
+        }
+
         if (a == L"--record_spawn_delay")
         {
             waiting_record_spawn_delay = true;
@@ -930,6 +1176,24 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
             continue;
         }
 
+        if (a == L"--ddr-monitor")
+        {
+            waiting_ddr_monitor = true;
+            continue;
+        }
+
+        if (a == L"--heatmap")
+        {
+            waiting_heatmap = true;
+            continue;
+        }
+
+        if (a == L"--topdown")
+        {
+            do_topdown = true;
+            continue;
+        }
+
         if (a == L"-v" || a == L"--verbose")
         {
             do_verbose = true;
@@ -1006,6 +1270,101 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
         m_out.GetErrorOutputStream() << L"warning: unexpected arg '" << a << L"' ignored" << std::endl;
     }
 
+    if (ddr_monitor_interval > 0.0)
+    {
+        if (!do_count)
+        {
+            m_out.GetErrorOutputStream() << L"ddr monitor: --ddr-monitor is supported only by `stat`" << std::endl;
+            throw fatal_exception("ERROR_DDR_MONITOR");
+        }
+
+        if (!report_ddr_bw_metric)
+        {
+            if (metrics.count(L"ddr_bw") == 0)
+            {
+                m_out.GetErrorOutputStream() << L"ddr monitor: metric 'ddr_bw' not supported, DMC not detected" << std::endl;
+                throw fatal_exception("ERROR_DDR_MONITOR");
+            }
+
+            add_metric(L"ddr_bw", events, groups);
+        }
+    }
+
+    if (heatmap_interval > 0.0)
+    {
+        if (!do_count)
+        {
+            m_out.GetErrorOutputStream() << L"heatmap: --heatmap is supported only by `stat`" << std::endl;
+            throw fatal_exception("ERROR_HEATMAP");
+        }
+
+        auto has_core_metric = [](const auto& evts) {
+            return std::any_of(evts.begin(), evts.end(), [](const struct evt_noted& e) { return !e.metric.empty(); });
+        };
+
+        // Without `-m` show default set of Telemetry Solution metrics supported by this CPU
+        if (!has_core_metric(events[EVT_CORE]) && !has_core_metric(groups[EVT_CORE]))
+        {
+            const std::vector<std::wstring> heatmap_metrics = { L"ipc", L"frontend_stalled_cycles", L"backend_stalled_cycles",
+                                                                L"l1d_cache_mpki", L"l2_cache_mpki", L"ll_cache_read_mpki" };
+            bool added = false;
+
+            for (const auto& metric : heatmap_metrics)
+                if (metrics.count(metric))
+                {
+                    add_metric(metric, events, groups);
+                    added = true;
+                }
+
+            if (!added)
+            {
+                m_out.GetErrorOutputStream() << L"heatmap: no default metric supported on this CPU, specify metrics with `-m`" << std::endl;
+                throw fatal_exception("ERROR_HEATMAP");
+            }
+        }
+    }
+
+    if (do_topdown)
+    {
+        if (!do_count)
+        {
+            m_out.GetErrorOutputStream() << L"topdown: --topdown is supported only by `stat`" << std::endl;
+            throw fatal_exception("ERROR_TOPDOWN");
+        }
+
+        std::map<std::wstring, std::vector<std::wstring>> metric_events;
+        for (const auto& [name, desc] : metrics)
+        {
+            std::wstring raw_str = desc.raw_str;    // e.g. "{cpu_cycles,stall_backend}"
+            raw_str.erase(std::remove_if(raw_str.begin(), raw_str.end(),
+                [](wchar_t c) { return c == L'{' || c == L'}'; }), raw_str.end());
+            TokenizeWideStringOfStrings(raw_str, L',', metric_events[name]);
+        }
+
+        topdown = std::make_unique<TopdownPlan>(groups_of_metrics, metric_events, pmu_cfg.gpc_nums[EVT_CORE]);
+        if (topdown->Empty())
+        {
+            m_out.GetErrorOutputStream() << L"topdown: no Topdown_L1 or Cycle_Accounting metric group for this CPU" << std::endl;
+            throw fatal_exception("ERROR_TOPDOWN");
+        }
+
+        // Schedule every planned event group, its group number is the number of groups before it
+        for (size_t i = 0; i < topdown->EventGroups().size(); i++)
+        {
+            const auto& group_events = topdown->EventGroups()[i].events;
+            const auto id = std::count_if(groups[EVT_CORE].begin(), groups[EVT_CORE].end(),
+                                          [](const evt_noted& e) { return e.type == EVT_HDR; });
+
+            std::wstring raw_str;
+            for (const auto& event : group_events)
+                raw_str += (raw_str.empty() ? L"{" : L",") + event;
+            raw_str += L"}";
+
+            parse_events_str(raw_str, events, groups, L"topdown", pmu_cfg);
+            topdown->SetEventGroupId(i, static_cast<int>(id));
+        }
+    }
+
     std::wstring output_filename_full_path = output_filename;
     std::wstring output_filename_csv_full_path = output_csv_filename;
 
@@ -1047,7 +1406,32 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
     if (output_csv_filename.size() && do_timeline)
         timeline_output_file = output_filename_csv_full_path;   // -t ... --output-csv filename.csv
 
-    if (do_sample && cores_idx.size() > 1)
+    // DDR monitor and heatmap write CSV files also outside of timeline mode
+    if (output_csv_filename.size() && !do_timeline && (ddr_monitor_interval > 0.0 || heatmap_interval > 0.0))
+        timeline_output_file = output_filename_csv_full_path;   // --ddr-monitor/--heatmap ... --output-csv filename.csv
+
+    if (do_sample_histogram && m_sampling_with_spe)
+    {
+        m_out.GetErrorOutputStream() << L"sampling: --sample-histogram can't be used with SPE" << std::endl;
+        throw fatal_exception("ERROR_SPE_NOT_SUPP");
+    }
+
+    if (sample_frequency && (m_sampling_with_spe || do_sample_histogram))
+    {
+        m_out.GetErrorOutputStream() << L"sampling: -F can't be used with SPE or --sample-histogram" << std::endl;
+        throw fatal_exception("ERROR_SAMPLE_FREQUENCY");
+    }
+
+    // Sample buffer of the driver is drained every 100ms in frequency mode
+    const size_t sample_src_num = (std::max)(ioctl_events_sample.size(), size_t(1));
+    if (sample_frequency && sample_frequency * sample_src_num > SAMPLE_CHAIN_BUFFER_SIZE * 10)
+    {
+        m_out.GetErrorOutputStream() << L"sampling: -F " << sample_frequency << L" is too high for " << sample_src_num
+            << L" event(s), driver can deliver up to " << SAMPLE_CHAIN_BUFFER_SIZE * 10 << L" samples per second" << std::endl;
+        throw fatal_exception("ERROR_SAMPLE_FREQUENCY");
+    }
+
+    if ((do_sample || do_top) && cores_idx.size() > 1)
     {
         m_out.GetErrorOutputStream() << L"sampling: you can specify 1 core with -c option"
             << std::endl;
@@ -1055,6 +1439,23 @@ void user_request::parse_raw_args(wstr_vec& raw_args, const struct pmu_device_cf
     }
 }
 
+// Add events (and groups of events) of metric METRIC to EVENTS and GROUPS.
+void user_request::add_metric(const std::wstring& metric,
+    std::map<enum evt_class, std::deque<struct evt_noted>>& events,
+    std::map<enum evt_class, std::vector<struct evt_noted>>& groups)
+{
+    metric_desc desc = metrics[metric];
+    for (const auto& x : desc.events)
+        events[x.first].insert(events[x.first].end(), x.second.begin(), x.second.end());
+    for (const auto& y : desc.groups)
+        groups[y.first].insert(groups[y.first].end(), y.second.begin(), y.second.end());
+
+    if (metric == L"l3_cache")
+        report_l3_cache_metric = true;
+    else if (metric == L"ddr_bw")
+        report_ddr_bw_metric = true;
+}
+
 bool user_request::has_events()
 {
     return !!ioctl_events.size();
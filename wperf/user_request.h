@@ -29,12 +29,14 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <memory>
 #include <numeric>
 #include "parsers.h"
 #include "pmu_device.h"
 #include "utils.h"
 #include "events.h"
 #include "output.h"
+#include "topdown.h"
 
 typedef std::vector<std::wstring> wstr_vec;
 
@@ -61,6 +63,9 @@ public:
     void load_config_events(std::wstring config_name,
         std::map<enum evt_class, std::vector<struct extra_event>>& extra_events);
     void load_config_metrics(std::wstring config_name, const struct pmu_device_cfg& pmu_cfg);
+    void add_metric(const std::wstring& metric,
+        std::map<enum evt_class, std::deque<struct evt_noted>>& events,
+        std::map<enum evt_class, std::vector<struct evt_noted>>& groups);
 
     static void print_help();
     static void print_help_header();
@@ -80,6 +85,8 @@ public:
     bool do_timeline;
     bool do_sample;
     bool do_record;
+    bool do_top = false;            // Live, continuously refreshed sampling view
+    bool do_sample_histogram = false;   // Driver aggregates samples into per core PC histogram
     bool do_version;
     bool do_verbose;
     bool do_help;
@@ -91,7 +98,9 @@ public:
     bool do_detect = false;
     bool do_force_lock = false;     // Force lock acquire of the driver
     bool do_export_perf_data;
+    bool do_export_folded = false;  // Export folded stacks (flame graph input) of sampling
     bool do_cwd = false;            // Set current working dir for storing output files
+    bool do_topdown = false;        // Native Arm Topdown analysis of counted cores (--topdown)
     bool report_l3_cache_metric;
     bool report_ddr_bw_metric;
     std::vector<uint8_t> cores_idx;
@@ -100,6 +109,11 @@ public:
     double count_interval;
     int count_timeline;
     uint32_t record_spawn_delay = 1000;
+    double ddr_monitor_interval = 0.0;      // DDR bandwidth sampling interval in seconds, 0 - disabled (--ddr-monitor)
+    double heatmap_interval = 0.0;          // Per core metric sampling interval in seconds, 0 - disabled (--heatmap)
+    double top_refresh = 2.0;               // `top` refresh interval in seconds (--refresh)
+    double top_decay = 10.0;                // `top` half-life of sample weights in seconds, 0 disables decay (--decay)
+    uint32_t sample_frequency = 0;          // Target samples per second per event, 0 - fixed sampling intervals (-F)
     std::wstring man_query_args;
     std::wstring symbol_arg;
     std::wstring sample_image_name;
@@ -108,11 +122,15 @@ public:
     std::wstring record_commandline;        // <sample_pe_file> <arg> <arg> <arg> ...
     std::wstring timeline_output_file; 
     std::wstring m_cwd;                     // Current working dir for storing output files
+    std::wstring disassembly_cache_dir;     // Directory with on-disk disassembly cache (--disassembly-cache)
+    std::wstring disassembler = L"builtin"; // Disassembler backend: builtin or llvm (--disassembler)
+    std::wstring symbol_cache_dir;          // Directory with on-disk PDB symbol cache (--symbol-cache)
     uint32_t sample_display_row;
     bool sample_display_short;
     std::map<enum evt_class, std::vector<struct evt_noted>> ioctl_events;
     std::vector<struct evt_sample_src> ioctl_events_sample;
     std::map<std::wstring, metric_desc> metrics;
+    std::unique_ptr<TopdownPlan> topdown;               // Metrics and event groups of `--topdown`
     std::map<uint32_t, uint32_t> sampling_inverval;     //!< [event_index] -> event_sampling_interval
     bool m_sampling_with_spe = false;                   // SPE: User requested sampling with SPE
     std::map<std::wstring, bool> m_sampling_flags;      // SPE: sampling flags
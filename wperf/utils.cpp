@@ -28,6 +28,8 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <atomic>
+#include <exception>
 #include <iostream>
 #include <string>
 #include <sstream>
@@ -36,6 +38,7 @@
 #include <cwctype>
 #include <unordered_map>
 #include <numeric>
+#include <thread>
 #include "utils.h"
 
 /// <summary>
@@ -306,3 +309,74 @@ std::wstring GetFullFilePath(std::wstring dir_str, std::wstring filename_str)
     std::filesystem::path full_path = dir / file;
     return full_path;
 }
+
+/// <summary>
+/// 64-bit FNV-1a hash of DATA. Pass previous result as HASH to hash data in chunks.
+/// </summary>
+/// <param name="data">Pointer to data to hash</param>
+/// <param name="size">Size of data in bytes</param>
+/// <param name="hash">Initial hash value (FNV offset basis by default)</param>
+/// <returns>Hash value</returns>
+uint64_t Fnv1aHash(const void* data, size_t size, uint64_t hash)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/// <summary>
+/// Calls FUNC(i) for each i in [0, COUNT) on a pool of worker threads.
+/// Items are handed out to workers one at a time, so items of very
+/// different cost (e.g. PDB files of different size) are balanced.
+/// First exception thrown by FUNC is rethrown in the calling thread after
+/// all workers finish; remaining items are skipped.
+/// </summary>
+/// <param name="count">Number of items</param>
+/// <param name="func">Function called for each item index</param>
+/// <param name="max_workers">Maximum number of threads, 0 means number of hardware threads</param>
+void ParallelForEach(size_t count, const std::function<void(size_t)>& func, size_t max_workers)
+{
+    if (max_workers == 0)
+        max_workers = (std::max)(std::thread::hardware_concurrency(), 1u);
+    const size_t workers = (std::min)(count, max_workers);
+
+    if (workers <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < count && !failed; i = next++)
+        {
+            try
+            {
+                func(i);
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                    error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
@@ -32,6 +32,7 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <functional>
 #include <iomanip>
 #include <string>
 #include <type_traits>
@@ -58,6 +59,8 @@ void TokenizeWideStringOfStringsDelim(const std::wstring& str, const wchar_t& de
 double ConvertNumberWithUnit(double number, std::wstring unit, const std::unordered_map<std::wstring, double>& unitConversionMap);
 void ReplaceAllTokensInWString(std::wstring& str, const std::wstring& old_token, const std::wstring& new_token);
 std::wstring GetFullFilePath(std::wstring dir_str, std::wstring filename_str);
+uint64_t Fnv1aHash(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+void ParallelForEach(size_t count, const std::function<void(size_t)>& func, size_t max_workers = 0);
 
 /// <summary>
 /// Converts integer VALUE to decimal WSTRING, e.g. 123 -> "123"